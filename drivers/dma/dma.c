@@ -50,6 +50,7 @@
 #include "mm/cache.h"
 #include "mutex.h"
 #include "peripherals/pmc.h"
+#include "timer.h"
 
 /*----------------------------------------------------------------------------
  *        Macros
@@ -132,6 +133,11 @@ struct _dma_ctrl {
 	struct _dma_controller controllers[DMA_CONTROLLERS];
 	bool polling;
 	uint8_t polling_timeout;
+#ifdef CONFIG_HAVE_DMA_STATS
+	struct _dma_stats stats;
+	uint32_t completions;   /* Transfers completed, to detect idle polls */
+	uint64_t wait_start;    /* Tick of the first idle poll, 0 if none */
+#endif
 };
 
 /*----------------------------------------------------------------------------
@@ -202,6 +208,10 @@ static struct _dma_sg_desc* _dma_sg_desc_alloc(uint8_t count)
 
 	_dma_sg_pool.count -= count;
 	_dma_sg_pool.head = next;
+#ifdef CONFIG_HAVE_DMA_STATS
+	if (ARRAY_SIZE(_dma_sg_pool.desc) - _dma_sg_pool.count > _dma_ctrl.stats.sg_max)
+		_dma_ctrl.stats.sg_max = ARRAY_SIZE(_dma_sg_pool.desc) - _dma_sg_pool.count;
+#endif
 
 	if (_dma_sg_pool.count == 0) {
 		_dma_sg_pool.head = NULL;
@@ -516,8 +526,18 @@ void dma_initialize(bool polling)
 	}
 }
 
+bool dma_is_polling(void)
+{
+	return _dma_ctrl.polling;
+}
+
 void dma_poll(void)
 {
+#ifdef CONFIG_HAVE_DMA_STATS
+	uint32_t completions = _dma_ctrl.completions;
+	uint64_t now;
+#endif
+
 	if (_dma_ctrl.polling) {
 		uint32_t ctrl;
 		for (ctrl = 0; ctrl < DMA_CONTROLLERS; ctrl++) {
@@ -525,6 +545,23 @@ void dma_poll(void)
 			dma_irq_handler(controller->pid, controller);
 		}
 	}
+
+#ifdef CONFIG_HAVE_DMA_STATS
+	/* Drivers call dma_poll() in a loop while they wait for a transfer,
+	 * in polling and in interrupt mode: measure from the first call
+	 * that finds nothing new to the completion */
+	now = timer_get_tick();
+	_dma_ctrl.stats.polls++;
+	if (completions != _dma_ctrl.completions) {
+		if (_dma_ctrl.wait_start)
+			_dma_ctrl.stats.busy_wait += timer_get_interval(_dma_ctrl.wait_start, now);
+		_dma_ctrl.wait_start = 0;
+	} else {
+		_dma_ctrl.stats.idle_polls++;
+		if (!_dma_ctrl.wait_start)
+			_dma_ctrl.wait_start = now ? now : 1;
+	}
+#endif
 }
 
 struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
@@ -559,6 +596,14 @@ struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
 				dma_prepare_channel(channel);
 
 				channel->sg_list = NULL;
+				channel->ring = NULL;
+
+#ifdef CONFIG_HAVE_DMA_STATS
+				channel->stats.allocations++;
+				_dma_ctrl.stats.channels++;
+				if (_dma_ctrl.stats.channels > _dma_ctrl.stats.channels_max)
+					_dma_ctrl.stats.channels_max = _dma_ctrl.stats.channels;
+#endif
 
 				return channel;
 			}
@@ -605,9 +650,13 @@ int dma_free_channel(struct _dma_channel* channel)
 		return -EBUSY;
 	case DMA_STATE_ALLOCATED:
 	case DMA_STATE_DONE:
+#ifdef CONFIG_HAVE_DMA_STATS
+		_dma_ctrl.stats.channels--;
+#endif
 		channel->state = DMA_STATE_FREE;
 		_dma_sg_desc_free(channel->sg_list);
 		channel->sg_list = NULL;
+		channel->ring = NULL;
 		break;
 	}
 	return 0;
@@ -622,6 +671,9 @@ int dma_start_transfer(struct _dma_channel* channel)
 
 	/* Change state to 'started' */
 	channel->state = DMA_STATE_STARTED;
+#ifdef CONFIG_HAVE_DMA_STATS
+	channel->stats_start = timer_get_tick();
+#endif
 
 	/* Start DMA transfer */
 	if (!_dma_ctrl.polling) {
@@ -706,6 +758,16 @@ int dma_configure_transfer(struct _dma_channel* channel,
 	if (list_size == 0)
 		return -EINVAL;
 
+#ifdef CONFIG_HAVE_DMA_STATS
+	{
+		uint8_t i;
+
+		channel->stats_bytes = 0;
+		for (i = 0; i < list_size; i++)
+			channel->stats_bytes += list[i].len * DMA_DATA_WIDTH_IN_BYTE(cfg_dma->data_width);
+	}
+#endif
+
 	if ((list_size == 1) && (!cfg_dma->loop))
 		return _dma_configure_transfer(channel, cfg_dma, list);
 	else
@@ -739,4 +801,89 @@ bool dma_is_transfer_done(struct _dma_channel* channel)
 		&& (channel->state != DMA_STATE_SUSPENDED));
 }
 
+#ifdef CONFIG_HAVE_DMA_STATS
+
+void dma_stats_complete(struct _dma_channel* channel, uint32_t bytes,
+			uint64_t start, bool error)
+{
+	struct _dma_channel_stats* stats = &channel->stats;
+	uint32_t latency;
+
+	_dma_ctrl.completions++;
+	if (error) {
+		stats->errors++;
+		return;
+	}
+
+	latency = (uint32_t)timer_get_interval(start, timer_get_tick());
+	if (!stats->transfers || latency < stats->latency_min)
+		stats->latency_min = latency;
+	if (latency > stats->latency_max)
+		stats->latency_max = latency;
+	stats->latency_sum += latency;
+	stats->bytes += bytes;
+	stats->transfers++;
+}
+
+void dma_get_stats(struct _dma_stats* stats, bool clear)
+{
+	*stats = _dma_ctrl.stats;
+	if (clear) {
+		/* Keep the current state, restart the high-water marks */
+		memset(&_dma_ctrl.stats, 0, sizeof(_dma_ctrl.stats));
+		_dma_ctrl.stats.channels = stats->channels;
+		_dma_ctrl.stats.channels_max = stats->channels;
+		_dma_ctrl.stats.sg_max = ARRAY_SIZE(_dma_sg_pool.desc) - _dma_sg_pool.count;
+		_dma_ctrl.wait_start = 0;
+	}
+}
+
+void dma_get_channel_stats(struct _dma_channel* channel,
+			   struct _dma_channel_stats* stats, bool clear)
+{
+	*stats = channel->stats;
+	if (clear)
+		memset(&channel->stats, 0, sizeof(channel->stats));
+}
+
+void dma_dump_stats(void)
+{
+	static const char* states[] = { "free", "alloc", "start", "done", "susp" };
+	uint32_t ctrl, chan;
+
+	printf("DMA: %u/%u channels allocated (max %u), SG descriptors max %u/%u\r\n",
+	       (unsigned)_dma_ctrl.stats.channels,
+	       (unsigned)(DMA_CONTROLLERS * DMA_CHANNELS),
+	       (unsigned)_dma_ctrl.stats.channels_max,
+	       (unsigned)_dma_ctrl.stats.sg_max,
+	       (unsigned)ARRAY_SIZE(_dma_sg_pool.desc));
+	printf("DMA: %u polls, %u idle, %u ticks busy waiting\r\n",
+	       (unsigned)_dma_ctrl.stats.polls,
+	       (unsigned)_dma_ctrl.stats.idle_polls,
+	       (unsigned)_dma_ctrl.stats.busy_wait);
+	printf("ctrl ch state allocs  xfers errors      KiB  latency min/avg/max\r\n");
+
+	for (ctrl = 0; ctrl < DMA_CONTROLLERS; ctrl++) {
+		for (chan = 0; chan < DMA_CHANNELS; chan++) {
+			struct _dma_channel* channel = &_dma_ctrl.controllers[ctrl].channels[chan];
+			struct _dma_channel_stats* stats = &channel->stats;
+
+			if (!stats->allocations)
+				continue;
+			printf("%4u %2u %5s %6u %6u %6u %8u  %u/%u/%u\r\n",
+			       (unsigned)ctrl, (unsigned)chan,
+			       states[channel->state],
+			       (unsigned)stats->allocations,
+			       (unsigned)stats->transfers,
+			       (unsigned)stats->errors,
+			       (unsigned)(stats->bytes >> 10),
+			       (unsigned)stats->latency_min,
+			       stats->transfers ? (unsigned)(stats->latency_sum / stats->transfers) : 0,
+			       (unsigned)stats->latency_max);
+		}
+	}
+}
+
+#endif /* CONFIG_HAVE_DMA_STATS */
+
 /**@}*/
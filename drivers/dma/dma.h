@@ -113,6 +113,31 @@ enum {
 /** \addtogroup dma_structs DMA Driver Structs
 		@{*/
 
+struct _dma_ring;
+
+#ifdef CONFIG_HAVE_DMA_STATS
+/** DMA channel statistics */
+struct _dma_channel_stats {
+	uint32_t allocations;  /* Allocations of the channel */
+	uint32_t transfers;    /* Completed transfers */
+	uint32_t errors;       /* Transfers ended by a bus error */
+	uint64_t bytes;        /* Bytes moved by the completed transfers */
+	uint32_t latency_min;  /* Shortest transfer, in timer ticks */
+	uint32_t latency_max;  /* Longest transfer, in timer ticks */
+	uint64_t latency_sum;  /* Sum of the transfer durations, in timer ticks */
+};
+
+/** DMA driver statistics */
+struct _dma_stats {
+	uint32_t polls;        /* Calls to dma_poll() */
+	uint32_t idle_polls;   /* Calls to dma_poll() without new completion */
+	uint64_t busy_wait;    /* Ticks spent polling for a completion */
+	uint16_t channels;     /* Channels currently allocated */
+	uint16_t channels_max; /* High-water mark of the allocated channels */
+	uint16_t sg_max;       /* High-water mark of the used SG descriptors */
+};
+#endif
+
 /** DMA driver channel */
 struct _dma_channel {
 #if defined(CONFIG_HAVE_DMAC)
@@ -134,6 +159,12 @@ struct _dma_channel {
 	volatile uint8_t state;		/* Channel State */
 
 	struct _dma_sg_desc* sg_list;
+	struct _dma_ring* ring;     /* Descriptor ring, see dma_ring.h */
+#ifdef CONFIG_HAVE_DMA_STATS
+	struct _dma_channel_stats stats;
+	uint32_t stats_bytes;       /* Length of the configured transfer */
+	uint64_t stats_start;       /* Start tick of the transfer */
+#endif
 };
 
 struct _dma_transfer_cfg {
@@ -175,6 +206,11 @@ struct _dma_controller {
  */
 extern void dma_initialize(bool polling);
 
+/**
+ * \brief Check if the DMA driver was initialized in polling mode.
+ */
+extern bool dma_is_polling(void);
+
 /**
  * \brief Poll for transfers completion.
  * If polling mode is enabled, this function will call callbacks for completed
@@ -281,6 +317,46 @@ extern uint32_t dma_get_transferred_data_len(struct _dma_channel* channel, uint8
  */
 extern void dma_irq_handler(uint32_t source, void* user_arg);
 
+#ifdef CONFIG_HAVE_DMA_STATS
+
+/**
+ * \brief Account a finished transfer in the channel statistics, called by
+ * the controller drivers.
+ * \param channel Channel pointer
+ * \param bytes Length of the transfer in bytes
+ * \param start Tick at which the transfer was started
+ * \param error true if the transfer ended with a bus error
+ */
+extern void dma_stats_complete(struct _dma_channel* channel, uint32_t bytes,
+			       uint64_t start, bool error);
+
+/**
+ * \brief Get the DMA driver statistics.
+ * \param stats Pointer to the structure to fill
+ * \param clear Reset the counters after reading them
+ */
+extern void dma_get_stats(struct _dma_stats* stats, bool clear);
+
+/**
+ * \brief Get the statistics of a DMA channel.
+ * \param channel Channel pointer
+ * \param stats Pointer to the structure to fill
+ * \param clear Reset the counters after reading them
+ */
+extern void dma_get_channel_stats(struct _dma_channel* channel,
+				  struct _dma_channel_stats* stats, bool clear);
+
+/**
+ * \brief Print the DMA driver and channel statistics on the console.
+ */
+extern void dma_dump_stats(void);
+
+#else
+
+#define dma_stats_complete(channel, bytes, start, error) do {} while (0)
+
+#endif /* CONFIG_HAVE_DMA_STATS */
+
 /**     @}*/
 
 #endif /* _DMA_H_ */
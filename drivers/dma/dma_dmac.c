@@ -36,6 +36,7 @@
 #include "compiler.h"
 #include "dma/dma.h"
 #include "dma/dma_dmac.h"
+#include "dma/dma_ring.h"
 #include "errno.h"
 #include "irq/irq.h"
 #include "peripherals/pmc.h"
@@ -175,6 +176,13 @@ void dma_irq_handler(uint32_t source, void* user_arg)
 			continue;
 		if (channel->state == DMA_STATE_FREE)
 			continue;
+		if (channel->ring) {
+			dma_ring_irq_handler(channel->ring, (gis >> chan) &
+				(DMAC_EBCISR_BTC0 | DMAC_EBCISR_CBTC0 | DMAC_EBCISR_ERR0));
+			continue;
+		}
+		if (gis & (DMAC_EBCISR_ERR0 << chan))
+			dma_stats_complete(channel, 0, channel->stats_start, true);
 		if (gis & (DMAC_EBCISR_CBTC0 << chan)) {
 			if (channel->rep_count) {
 				if (channel->rep_count == 1) {
@@ -186,6 +194,8 @@ void dma_irq_handler(uint32_t source, void* user_arg)
 			} else {
 				channel->state = DMA_STATE_DONE;
 				exec = 1;
+				dma_stats_complete(channel, channel->stats_bytes,
+						   channel->stats_start, false);
 			}
 		}
 		/* Execute callback */
@@ -0,0 +1,259 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * DMA transfer planner, see dma_plan.h.
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "callback.h"
+#include "dma/dma.h"
+#include "dma/dma_plan.h"
+#include "dma/dma_ring.h"
+#include "errno.h"
+#include "mm/cache.h"
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Number of data in a chunk.
+ */
+static uint32_t _dma_plan_chunk_len(uint8_t chunk)
+{
+#if defined(CONFIG_HAVE_XDMAC)
+	return 1 << chunk;
+#elif defined(CONFIG_HAVE_DMAC)
+	return chunk ? 2 << chunk : 1;
+#endif
+}
+
+/**
+ * \brief Widest data width, up to 'width', on which 'value' is aligned.
+ */
+static uint8_t _dma_plan_align(uint32_t value, uint8_t width)
+{
+	while (width && (value & (DMA_DATA_WIDTH_IN_BYTE(width) - 1)))
+		width--;
+	return width;
+}
+
+/**
+ * \brief Append a descriptor of 'size' bytes to the plan and advance the
+ * addresses of the request.
+ */
+static int _dma_plan_add(struct _dma_plan_req* req, struct _dma_plan_seg* seg,
+			 uint8_t max_segs, int count, uint32_t size,
+			 uint8_t width, uint8_t chunk)
+{
+	if (count >= max_segs)
+		return -ENOSPC;
+
+	seg += count;
+	seg->xfer.saddr = req->saddr;
+	seg->xfer.daddr = req->daddr;
+	seg->xfer.len = size >> width;
+	seg->cfg.data_width = width;
+	seg->cfg.chunk_size = chunk;
+	seg->cfg.incr_saddr = req->incr_saddr;
+	seg->cfg.incr_daddr = req->incr_daddr;
+	seg->cfg.loop = false;
+
+	if (req->incr_saddr)
+		req->saddr = (const uint8_t*)req->saddr + size;
+	if (req->incr_daddr)
+		req->daddr = (uint8_t*)req->daddr + size;
+	req->len -= size;
+
+	return count + 1;
+}
+
+/**
+ * \brief Plan a transfer and queue it on a ring, the last descriptor holding
+ * the callback.
+ */
+static int _dma_plan_submit(struct _dma_ring* ring, struct _dma_plan_req* req,
+			    bool fill, uint64_t pattern, struct _callback* cb)
+{
+	struct _dma_plan_seg seg[DMA_PLAN_MAX_SEGS];
+	struct _dma_ring_desc* desc;
+	uint16_t space = dma_ring_space(ring);
+	int count, i, err;
+
+	count = dma_plan_transfer(req, seg,
+			space < DMA_PLAN_MAX_SEGS ? space : DMA_PLAN_MAX_SEGS);
+	if (count < 0)
+		return count;
+
+	for (i = 0; i < count; i++) {
+		if (fill) {
+			/* Each descriptor reads the pattern from its own slot,
+			 * which is not reused before the descriptor completes */
+			desc = &ring->desc[ring->head];
+			desc->pattern = pattern;
+			cache_clean_region(&desc->pattern, sizeof(desc->pattern));
+			seg[i].xfer.saddr = &desc->pattern;
+		}
+		err = dma_ring_submit(ring, &seg[i].xfer, &seg[i].cfg,
+				      i == count - 1 ? cb : NULL);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int dma_plan_transfer(const struct _dma_plan_req* req,
+		      struct _dma_plan_seg* seg, uint8_t max_segs)
+{
+	struct _dma_plan_req cur = *req;
+	uint32_t ref, head, units, body, max_units, size;
+	uint8_t width = req->max_width;
+	uint8_t chunk;
+	int count = 0;
+
+	if (req->len == 0)
+		return -EINVAL;
+
+	/* A fixed address must be aligned on the data width, two incrementing
+	 * addresses must have the same alignment */
+	if (!req->incr_saddr)
+		width = _dma_plan_align((uint32_t)req->saddr, width);
+	if (!req->incr_daddr)
+		width = _dma_plan_align((uint32_t)req->daddr, width);
+	if (req->incr_saddr && req->incr_daddr)
+		width = _dma_plan_align((uint32_t)req->saddr ^ (uint32_t)req->daddr, width);
+
+	/* Head: up to the first incrementing address aligned on the width,
+	 * narrowing the width until the body holds at least one data */
+	if (req->incr_saddr)
+		ref = (uint32_t)req->saddr;
+	else if (req->incr_daddr)
+		ref = (uint32_t)req->daddr;
+	else
+		ref = 0;
+	for (;;) {
+		head = (0 - ref) & (DMA_DATA_WIDTH_IN_BYTE(width) - 1);
+		if (width == 0 || req->len >= head + DMA_DATA_WIDTH_IN_BYTE(width))
+			break;
+		width--;
+	}
+	if (head) {
+		count = _dma_plan_add(&cur, seg, max_segs, count, head,
+				      _dma_plan_align(ref | head, width),
+				      DMA_CHUNK_SIZE_1);
+		if (count < 0)
+			return count;
+	}
+
+	/* Body: largest chunk holding in the body, the descriptors being
+	 * a whole number of chunks */
+	units = cur.len >> width;
+	chunk = req->max_chunk;
+	while (chunk && _dma_plan_chunk_len(chunk) > units)
+		chunk--;
+	body = units - units % _dma_plan_chunk_len(chunk);
+	max_units = DMA_MAX_BT_SIZE - DMA_MAX_BT_SIZE % _dma_plan_chunk_len(chunk);
+	while (body) {
+		size = body < max_units ? body : max_units;
+		count = _dma_plan_add(&cur, seg, max_segs, count, size << width,
+				      width, chunk);
+		if (count < 0)
+			return count;
+		body -= size;
+	}
+
+	/* Data that do not fill a whole chunk */
+	units %= _dma_plan_chunk_len(chunk);
+	if (units) {
+		while (chunk && units % _dma_plan_chunk_len(chunk))
+			chunk--;
+		count = _dma_plan_add(&cur, seg, max_segs, count, units << width,
+				      width, chunk);
+		if (count < 0)
+			return count;
+	}
+
+	/* Tail: bytes that do not fill a whole data */
+	if (cur.len) {
+		count = _dma_plan_add(&cur, seg, max_segs, count, cur.len,
+				      _dma_plan_align(cur.len, width),
+				      DMA_CHUNK_SIZE_1);
+		if (count < 0)
+			return count;
+	}
+
+	return count;
+}
+
+int dma_memcpy(struct _dma_ring* ring, void* dst, const void* src,
+	       uint32_t len, struct _callback* cb)
+{
+	struct _dma_plan_req req = {
+		.saddr = src,
+		.daddr = dst,
+		.len = len,
+		.incr_saddr = true,
+		.incr_daddr = true,
+		.max_width = DMA_PLAN_MAX_WIDTH,
+		.max_chunk = DMA_PLAN_MAX_CHUNK,
+	};
+
+	return _dma_plan_submit(ring, &req, false, 0, cb);
+}
+
+int dma_memset(struct _dma_ring* ring, void* dst, uint8_t value,
+	       uint32_t len, struct _callback* cb)
+{
+	struct _dma_plan_req req = {
+		/* Any slot: the patterns are all aligned on 64 bits */
+		.saddr = &ring->desc[0].pattern,
+		.daddr = dst,
+		.len = len,
+		.incr_saddr = false,
+		.incr_daddr = true,
+		.max_width = DMA_PLAN_MAX_WIDTH,
+		.max_chunk = DMA_PLAN_MAX_CHUNK,
+	};
+
+	return _dma_plan_submit(ring, &req, true,
+				value * 0x0101010101010101ull, cb);
+}
@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * DMA transfer planner.
+ *
+ * The planner splits a transfer in descriptors using the widest data width and
+ * the largest chunk allowed by the alignment of the addresses:
+ * - a head, up to the first address aligned on the body data width;
+ * - a body, in bursts of the largest chunk size, split in several descriptors
+ *   when longer than DMA_MAX_BT_SIZE data;
+ * - the body data that do not fill a whole chunk, with a smaller chunk size;
+ * - a tail, with the bytes that do not fill a whole body data.
+ *
+ * dma_memcpy() and dma_memset() queue the planned descriptors on a descriptor
+ * ring (see dma_ring.h), where they are linked in one chain.
+ */
+
+#ifndef _DMA_PLAN_H_
+#define _DMA_PLAN_H_
+
+/*----------------------------------------------------------------------------
+ *        Includes
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+#include "dma/dma.h"
+#include "dma/dma_ring.h"
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Widest data width supported by the DMA controller */
+#ifdef DMA_DATA_WIDTH_DWORD
+#define DMA_PLAN_MAX_WIDTH DMA_DATA_WIDTH_DWORD
+#else
+#define DMA_PLAN_MAX_WIDTH DMA_DATA_WIDTH_WORD
+#endif
+
+/** Chunk size used by dma_memcpy() and dma_memset() */
+#ifndef DMA_PLAN_MAX_CHUNK
+#define DMA_PLAN_MAX_CHUNK DMA_CHUNK_SIZE_16
+#endif
+
+/** Maximum number of descriptors of a dma_memcpy() or dma_memset() */
+#ifndef DMA_PLAN_MAX_SEGS
+#define DMA_PLAN_MAX_SEGS 8
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** \addtogroup dma_structs DMA Driver Structs
+		@{*/
+
+/** Transfer to plan */
+struct _dma_plan_req {
+	const void* saddr;
+	void* daddr;
+	uint32_t len;       /* Length in bytes */
+	bool incr_saddr;
+	bool incr_daddr;
+	uint8_t max_width;  /* Widest data width allowed, DMA_DATA_WIDTH_xxx */
+	uint8_t max_chunk;  /* Largest chunk size allowed, DMA_CHUNK_SIZE_xxx */
+};
+
+/** Planned descriptor */
+struct _dma_plan_seg {
+	struct _dma_transfer_cfg xfer; /* Length in data units */
+	struct _dma_cfg cfg;
+};
+
+/**     @}*/
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+/** \addtogroup dma_functions DMA Driver functions
+		@{*/
+
+/**
+ * \brief Split a transfer in descriptors of the widest data width and the
+ * largest chunk size allowed by its addresses.
+ * A fixed address (peripheral register) limits the data width to its own
+ * alignment. Two incrementing addresses limit it to their common alignment.
+ * The head and tail descriptors use single data chunks.
+ * \param req Transfer to plan
+ * \param seg Planned descriptors
+ * \param max_segs Size of the \a seg array
+ * \return the number of descriptors, -EINVAL if the length is zero, or
+ * -ENOSPC if more than \a max_segs descriptors are needed
+ */
+extern int dma_plan_transfer(const struct _dma_plan_req* req,
+			     struct _dma_plan_seg* seg, uint8_t max_segs);
+
+/**
+ * \brief Queue a memory copy on a ring of a memory to memory channel.
+ * The buffers must be cleaned/invalidated from the cache by the caller.
+ * \param ring Ring pointer
+ * \param dst Destination address
+ * \param src Source address
+ * \param len Length in bytes
+ * \param cb Callback called once the whole copy is complete, with its status
+ * as second argument
+ * \return 0, -ENOSPC if the ring is too full, or -EINVAL
+ */
+extern int dma_memcpy(struct _dma_ring* ring, void* dst, const void* src,
+		      uint32_t len, struct _callback* cb);
+
+/**
+ * \brief Queue a memory fill on a ring of a memory to memory channel.
+ * The destination must be cleaned/invalidated from the cache by the caller.
+ * \param ring Ring pointer
+ * \param dst Destination address
+ * \param value Fill value
+ * \param len Length in bytes
+ * \param cb Callback called once the whole fill is complete, with its status
+ * as second argument
+ * \return 0, -ENOSPC if the ring is too full, or -EINVAL
+ */
+extern int dma_memset(struct _dma_ring* ring, void* dst, uint8_t value,
+		      uint32_t len, struct _callback* cb);
+
+/**     @}*/
+
+#endif /* _DMA_PLAN_H_ */
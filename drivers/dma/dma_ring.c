@@ -0,0 +1,613 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * DMA descriptor rings, see dma_ring.h.
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "barriers.h"
+#include "callback.h"
+#include "compiler.h"
+#include "dma/dma.h"
+#include "dma/dma_ring.h"
+#include "errno.h"
+#include "irq/irq.h"
+#include "mm/cache.h"
+#include "timer.h"
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static inline bool is_source_periph(struct _dma_channel* channel)
+{
+	return ((channel->src_txif != 0xff) | (channel->src_rxif != 0xff));
+}
+
+static inline bool is_dest_periph(struct _dma_channel* channel)
+{
+	return ((channel->dest_txif != 0xff) | (channel->dest_rxif != 0xff));
+}
+
+/**
+ * \brief Number of descriptors from index 'from' to index 'to'.
+ */
+static inline uint16_t _dma_ring_dist(struct _dma_ring* ring, uint16_t from,
+				      uint16_t to)
+{
+	return (to - from) & ring->mask;
+}
+
+/**
+ * \brief Index of the ring descriptor at the given address, or -1 if the
+ * address is not a descriptor of the ring.
+ */
+static int _dma_ring_index(struct _dma_ring* ring, uint32_t addr)
+{
+	uint32_t offset = addr - (uint32_t)ring->desc;
+
+	if (addr < (uint32_t)ring->desc ||
+	    offset % sizeof(struct _dma_ring_desc) ||
+	    offset / sizeof(struct _dma_ring_desc) > ring->mask)
+		return -1;
+	return offset / sizeof(struct _dma_ring_desc);
+}
+
+/**
+ * \brief Mask the interrupt of the DMA controller of the ring, to serialize
+ * the channel restarts with the interrupt handler.
+ */
+static void _dma_ring_lock(struct _dma_ring* ring)
+{
+	if (dma_is_polling())
+		return;
+#if defined(CONFIG_HAVE_XDMAC)
+	irq_disable(get_xdmac_id_from_addr(ring->channel->hw));
+#elif defined(CONFIG_HAVE_DMAC)
+	irq_disable(get_dmac_id_from_addr(ring->channel->hw));
+#endif
+}
+
+static void _dma_ring_unlock(struct _dma_ring* ring)
+{
+	if (dma_is_polling())
+		return;
+#if defined(CONFIG_HAVE_XDMAC)
+	irq_enable(get_xdmac_id_from_addr(ring->channel->hw));
+#elif defined(CONFIG_HAVE_DMAC)
+	irq_enable(get_dmac_id_from_addr(ring->channel->hw));
+#endif
+}
+
+static bool _dma_ring_running(struct _dma_ring* ring)
+{
+	struct _dma_channel* channel = ring->channel;
+
+#if defined(CONFIG_HAVE_XDMAC)
+	return (xdmac_get_global_channel_status(channel->hw) & (1 << channel->id)) != 0;
+#elif defined(CONFIG_HAVE_DMAC)
+	return (dmac_get_channel_status(channel->hw) & (DMAC_CHSR_ENA0 << channel->id)) != 0;
+#endif
+}
+
+/**
+ * \brief Number of descriptors, from the tail, completed by the controller.
+ * \param running true if the controller is running, in which case the
+ * descriptor it executes is not counted.
+ */
+static uint16_t _dma_ring_hw_done(struct _dma_ring* ring, bool running)
+{
+	struct _dma_channel* channel = ring->channel;
+	uint16_t tail = ring->tail;
+	uint16_t pending = _dma_ring_dist(ring, tail, ring->head);
+	uint16_t start = _dma_ring_dist(ring, tail, ring->hw_start);
+	uint16_t next;
+	int index;
+
+#if defined(CONFIG_HAVE_XDMAC)
+	/* The next descriptor address is loaded from each fetched descriptor,
+	 * which always points to the next slot of the ring, even at the end of
+	 * the linked list: it gives the first descriptor not executed yet */
+	index = _dma_ring_index(ring, xdmac_get_descriptor_addr(channel->hw,
+					channel->id) & XDMAC_CNDA_NDA_Msk);
+#elif defined(CONFIG_HAVE_DMAC)
+	uint16_t end = _dma_ring_dist(ring, tail, ring->hw_end);
+	uint32_t dscr;
+
+	/* The chain given to the controller ends with a null descriptor
+	 * address, it is complete once the channel is disabled */
+	if (!running)
+		return end;
+	dscr = dmac_get_descriptor_addr(channel->hw, channel->id);
+	if (dscr == 0)
+		return end > start ? end - 1 : start;
+	index = _dma_ring_index(ring, dscr);
+#endif
+
+	next = index < 0 ? start : _dma_ring_dist(ring, tail, index);
+	if (next > pending || next < start)
+		next = start;
+	if (running)
+		return next > start ? next - 1 : start;
+	return next;
+}
+
+/**
+ * \brief Release the descriptor at the tail of the ring and call its callback.
+ */
+static void _dma_ring_complete(struct _dma_ring* ring, int status)
+{
+	struct _callback cb;
+
+	if (status != -ECANCELED)
+		dma_stats_complete(ring->channel, ring->desc[ring->tail].stats_bytes,
+				   ring->desc[ring->tail].stats_start, status != 0);
+
+	/* Copy the callback first, so that it may submit to the freed slot */
+	callback_copy(&cb, &ring->desc[ring->tail].callback);
+	ring->tail = (ring->tail + 1) & ring->mask;
+
+	/* Without callback, keep the first error for the next transfer
+	 * that has one */
+	if (!cb.method) {
+		if (!ring->error)
+			ring->error = status;
+		return;
+	}
+	if (!status)
+		status = ring->error;
+	ring->error = 0;
+	callback_call(&cb, (void*)(intptr_t)status);
+}
+
+/**
+ * \brief Complete the descriptors executed by the controller.
+ * \return the number of completed descriptors
+ */
+static uint16_t _dma_ring_reap(struct _dma_ring* ring, bool running)
+{
+	uint16_t done = _dma_ring_hw_done(ring, running);
+	uint16_t i;
+
+	if (_dma_ring_dist(ring, ring->tail, ring->hw_start) < done)
+		ring->hw_start = (ring->tail + done) & ring->mask;
+	for (i = 0; i < done; i++)
+		_dma_ring_complete(ring, 0);
+	return done;
+}
+
+#if defined(CONFIG_HAVE_XDMAC)
+
+/**
+ * \brief XDMAC channel configuration of a transfer.
+ */
+static uint32_t _dma_ring_hw_cfg(struct _dma_channel* channel,
+				 struct _dma_cfg* cfg)
+{
+	bool src_is_periph = is_source_periph(channel);
+	bool dst_is_periph = is_dest_periph(channel);
+	uint32_t cc;
+
+	cc = (src_is_periph || dst_is_periph) ? XDMAC_CC_TYPE_PER_TRAN : XDMAC_CC_TYPE_MEM_TRAN;
+	cc |= src_is_periph ? XDMAC_CC_DSYNC_PER2MEM : XDMAC_CC_DSYNC_MEM2PER;
+	cc |= XDMAC_CC_CSIZE(cfg->chunk_size);
+	cc |= XDMAC_CC_DWIDTH(cfg->data_width);
+	cc |= src_is_periph ? XDMAC_CC_SIF_AHB_IF1 : XDMAC_CC_SIF_AHB_IF0;
+	cc |= dst_is_periph ? XDMAC_CC_DIF_AHB_IF1 : XDMAC_CC_DIF_AHB_IF0;
+	cc |= cfg->incr_saddr ? XDMAC_CC_SAM_INCREMENTED_AM : XDMAC_CC_SAM_FIXED_AM;
+	cc |= cfg->incr_daddr ? XDMAC_CC_DAM_INCREMENTED_AM : XDMAC_CC_DAM_FIXED_AM;
+	if (src_is_periph)
+		cc |= XDMAC_CC_PERID(channel->src_rxif);
+	else if (dst_is_periph)
+		cc |= XDMAC_CC_PERID(channel->dest_txif);
+	else
+		cc |= XDMAC_CC_SWREQ_SWR_CONNECTED | XDMAC_CC_PERID_Msk;
+
+	/* The chunk size only applies to peripheral requests, use it as
+	 * memory burst size for memory to memory transfers */
+	if (!src_is_periph && !dst_is_periph) {
+		if (cfg->chunk_size >= DMA_CHUNK_SIZE_16)
+			cc |= XDMAC_CC_MBSIZE_SIXTEEN;
+		else if (cfg->chunk_size >= DMA_CHUNK_SIZE_8)
+			cc |= XDMAC_CC_MBSIZE_EIGHT;
+		else if (cfg->chunk_size >= DMA_CHUNK_SIZE_4)
+			cc |= XDMAC_CC_MBSIZE_FOUR;
+	}
+	return cc;
+}
+
+/**
+ * \brief Microblock control bits describing the next descriptor.
+ */
+static uint32_t _dma_ring_next_ubc(struct _dma_ring* ring,
+				   struct _dma_ring_desc* next)
+{
+	uint32_t ubc = XDMA_UBC_NDE_FETCH_EN | (next->view << XDMA_UBC_NVIEW_Pos);
+
+	/* View 0 only holds the memory side address */
+	if (next->view != 0 || !is_source_periph(ring->channel))
+		ubc |= XDMA_UBC_NSEN_UPDATED;
+	if (next->view != 0 || !is_dest_periph(ring->channel))
+		ubc |= XDMA_UBC_NDEN_UPDATED;
+	return ubc;
+}
+
+/**
+ * \brief Restart an idle channel on the first descriptor not executed yet.
+ * Must be called with the DMA interrupt masked.
+ */
+static void _dma_ring_kick(struct _dma_ring* ring)
+{
+	struct _dma_channel* channel = ring->channel;
+	struct _xdmacd_cfg cfg;
+	struct _dma_ring_desc* first;
+	uint16_t start;
+	uint32_t ubc;
+
+	if (_dma_ring_running(ring))
+		return;
+	start = (ring->tail + _dma_ring_hw_done(ring, false)) & ring->mask;
+	if (start == ring->head)
+		return;
+
+	ring->hw_start = start;
+	first = &ring->desc[start];
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cfg = first->cc;
+	ubc = _dma_ring_next_ubc(ring, first);
+
+	channel->state = DMA_STATE_ALLOCATED;
+	xdmacd_configure_transfer(channel, &cfg,
+		XDMAC_CNDC_NDVIEW(first->view)
+		| XDMAC_CNDC_NDE_DSCR_FETCH_EN
+		| ((ubc & XDMA_UBC_NSEN) ? XDMAC_CNDC_NDSUP_SRC_PARAMS_UPDATED : 0)
+		| ((ubc & XDMA_UBC_NDEN) ? XDMAC_CNDC_NDDUP_DST_PARAMS_UPDATED : 0),
+		first);
+	if (first->view == 0) {
+		if (is_source_periph(channel))
+			xdmac_set_src_addr(channel->hw, channel->id, ring->periph_addr);
+		else
+			xdmac_set_dest_addr(channel->hw, channel->id, ring->periph_addr);
+	}
+	/* One interrupt per descriptor, plus bus errors */
+	xdmac_enable_channel_it(channel->hw, channel->id, XDMAC_CIE_BIE
+				| XDMAC_CIE_RBIE | XDMAC_CIE_WBIE | XDMAC_CIE_ROIE);
+	dma_start_transfer(channel);
+}
+
+/**
+ * \brief Write a descriptor and link it to the end of the ring.
+ */
+static int _dma_ring_fill(struct _dma_ring* ring, struct _dma_ring_desc* desc,
+			  struct _dma_ring_desc* prev, struct _dma_transfer_cfg* xfer,
+			  struct _dma_cfg* cfg)
+{
+	struct _dma_channel* channel = ring->channel;
+	bool src_is_periph = is_source_periph(channel);
+	bool dst_is_periph = is_dest_periph(channel);
+	void* periph_addr = NULL;
+	uint32_t ubc;
+
+	desc->cc = _dma_ring_hw_cfg(channel, cfg);
+
+	if (src_is_periph && !cfg->incr_saddr)
+		periph_addr = (void*)xfer->saddr;
+	else if (dst_is_periph && !cfg->incr_daddr)
+		periph_addr = xfer->daddr;
+	if (!ring->periph_addr)
+		ring->periph_addr = periph_addr;
+	else if (periph_addr != ring->periph_addr)
+		ring->periph_moved = true;
+
+	/* Use the smallest view: view 2 to change the channel configuration,
+	 * view 0 when only the memory address changes */
+	if (desc->cc != prev->cc)
+		desc->view = 2;
+	else if (periph_addr && !ring->periph_moved)
+		desc->view = 0;
+	else
+		desc->view = 1;
+
+	desc->hw.view1.mbr_nda = &ring->desc[(desc - ring->desc + 1) & ring->mask];
+	desc->hw.view1.mbr_ubc = XDMA_UBC_UBLEN(xfer->len);
+	if (desc->view == 0) {
+		desc->hw.view0.mbr_ta = src_is_periph ? xfer->daddr : (void*)xfer->saddr;
+	} else {
+		desc->hw.view1.mbr_sa = xfer->saddr;
+		desc->hw.view1.mbr_da = xfer->daddr;
+		desc->hw.view2.mbr_cfg = desc->cc;
+	}
+	cache_clean_region(&desc->hw, sizeof(desc->hw));
+	dsb();
+
+	/* Link the previous descriptor: one word write, so the controller
+	 * either sees the end of the list or the complete link */
+	ubc = prev->hw.view1.mbr_ubc & XDMA_UBC_UBLEN_Msk;
+	prev->hw.view1.mbr_ubc = ubc | _dma_ring_next_ubc(ring, desc);
+	cache_clean_region(&prev->hw, sizeof(prev->hw));
+	dsb();
+
+	return 0;
+}
+
+#elif defined(CONFIG_HAVE_DMAC)
+
+/**
+ * \brief Restart an idle channel with the descriptors submitted since its
+ * last start, chained. Must be called with the DMA interrupt masked.
+ */
+static void _dma_ring_kick(struct _dma_ring* ring)
+{
+	struct _dma_channel* channel = ring->channel;
+	struct _dmacd_cfg cfg;
+	struct _dma_ring_desc* desc;
+	uint16_t start, end, i;
+
+	if (_dma_ring_running(ring))
+		return;
+	start = ring->hw_end;
+	end = ring->head;
+	if (start == end)
+		return;
+
+	for (i = start; i != end; i = (i + 1) & ring->mask) {
+		desc = &ring->desc[i];
+		if (((i + 1) & ring->mask) == end)
+			desc->hw.dscr = NULL;
+		else
+			desc->hw.dscr = &ring->desc[(i + 1) & ring->mask];
+		cache_clean_region(&desc->hw, sizeof(desc->hw));
+	}
+	dsb();
+	ring->hw_start = start;
+	ring->hw_end = end;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cfg = is_source_periph(channel) ? DMAC_CFG_SRC_H2SEL_HW : 0;
+	cfg.cfg |= is_dest_periph(channel) ? DMAC_CFG_DST_H2SEL_HW : 0;
+
+	channel->state = DMA_STATE_ALLOCATED;
+	dmacd_configure_transfer(channel, &cfg, &ring->desc[start].hw);
+	dma_start_transfer(channel);
+}
+
+/**
+ * \brief Write a descriptor, it is chained when the channel is (re)started.
+ */
+static int _dma_ring_fill(struct _dma_ring* ring, struct _dma_ring_desc* desc,
+			  struct _dma_ring_desc* prev, struct _dma_transfer_cfg* xfer,
+			  struct _dma_cfg* cfg)
+{
+	struct _dma_channel* channel = ring->channel;
+	bool src_is_periph = is_source_periph(channel);
+	bool dst_is_periph = is_dest_periph(channel);
+
+	desc->hw.saddr = xfer->saddr;
+	desc->hw.daddr = xfer->daddr;
+	desc->hw.ctrla = (cfg->data_width << DMAC_CTRLA_SRC_WIDTH_Pos)
+		| (cfg->data_width << DMAC_CTRLA_DST_WIDTH_Pos)
+		| (cfg->chunk_size << DMAC_CTRLA_SCSIZE_Pos)
+		| (cfg->chunk_size << DMAC_CTRLA_DCSIZE_Pos)
+		| DMAC_CTRLA_BTSIZE(xfer->len);
+
+#if defined(CONFIG_SOC_SAMA5D3)
+	desc->hw.ctrlb = src_is_periph ? DMAC_CTRLB_SIF_AHB_IF2 : DMAC_CTRLB_SIF_AHB_IF0;
+	desc->hw.ctrlb |= dst_is_periph ? DMAC_CTRLB_DIF_AHB_IF2 : DMAC_CTRLB_DIF_AHB_IF0;
+#elif defined(CONFIG_SOC_SAM9XX5)
+	desc->hw.ctrlb = src_is_periph ? DMAC_CTRLB_SIF_AHB_IF1 : DMAC_CTRLB_SIF_AHB_IF0;
+	desc->hw.ctrlb |= dst_is_periph ? DMAC_CTRLB_DIF_AHB_IF1 : DMAC_CTRLB_DIF_AHB_IF0;
+#endif
+	if (src_is_periph)
+		desc->hw.ctrlb |= DMAC_CTRLB_FC_PER2MEM_DMA_FC;
+	else if (dst_is_periph)
+		desc->hw.ctrlb |= DMAC_CTRLB_FC_MEM2PER_DMA_FC;
+	else
+		desc->hw.ctrlb |= DMAC_CTRLB_FC_MEM2MEM_DMA_FC;
+	desc->hw.ctrlb |= cfg->incr_saddr ? DMAC_CTRLB_SRC_INCR_INCREMENTING : DMAC_CTRLB_SRC_INCR_FIXED;
+	desc->hw.ctrlb |= cfg->incr_daddr ? DMAC_CTRLB_DST_INCR_INCREMENTING : DMAC_CTRLB_DST_INCR_FIXED;
+	desc->hw.ctrlb |= DMAC_CTRLB_SRC_DSCR_FETCH_FROM_MEM | DMAC_CTRLB_DST_DSCR_FETCH_FROM_MEM;
+	desc->hw.dscr = NULL;
+
+	return 0;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int dma_ring_init(struct _dma_ring* ring, struct _dma_channel* channel,
+		  struct _dma_cfg* cfg, struct _dma_ring_desc* desc,
+		  uint16_t count)
+{
+	if (count < 2 || (count & (count - 1)))
+		return -EINVAL;
+	if (channel->state == DMA_STATE_FREE)
+		return -EPERM;
+	else if (channel->state == DMA_STATE_STARTED)
+		return -EBUSY;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->channel = channel;
+	ring->cfg = *cfg;
+	ring->desc = desc;
+	ring->mask = count - 1;
+	memset(desc, 0, count * sizeof(*desc));
+
+#if defined(CONFIG_HAVE_XDMAC)
+	xdmac_set_descriptor_addr(channel->hw, channel->id, 0, 0);
+#endif
+	channel->ring = ring;
+
+	return 0;
+}
+
+int dma_ring_submit(struct _dma_ring* ring, struct _dma_transfer_cfg* xfer,
+		    struct _dma_cfg* cfg, struct _callback* cb)
+{
+	uint16_t head = ring->head;
+	struct _dma_ring_desc* desc = &ring->desc[head];
+	int err;
+
+	if (xfer->len == 0 || xfer->len > DMA_MAX_BT_SIZE)
+		return -EINVAL;
+	if (((head + 1) & ring->mask) == ring->tail)
+		return -ENOSPC;
+
+	callback_copy(&desc->callback, cb);
+#ifdef CONFIG_HAVE_DMA_STATS
+	desc->stats_bytes = xfer->len * DMA_DATA_WIDTH_IN_BYTE((cfg ? cfg : &ring->cfg)->data_width);
+	desc->stats_start = timer_get_tick();
+#endif
+	err = _dma_ring_fill(ring, desc, &ring->desc[(head - 1) & ring->mask],
+			     xfer, cfg ? cfg : &ring->cfg);
+	if (err < 0)
+		return err;
+
+	/* Publish the descriptor to the consumer */
+	dmb();
+	ring->head = (head + 1) & ring->mask;
+
+	/* Restart the channel if it is idle, or if it stopped before fetching
+	 * the link to the new descriptor. When submitted from a completion
+	 * callback, the restart is done once all completions are reported */
+	if (!ring->reaping && !_dma_ring_running(ring)) {
+		_dma_ring_lock(ring);
+		_dma_ring_kick(ring);
+		_dma_ring_unlock(ring);
+	}
+
+	return 0;
+}
+
+uint16_t dma_ring_pending(struct _dma_ring* ring)
+{
+	return _dma_ring_dist(ring, ring->tail, ring->head);
+}
+
+uint16_t dma_ring_space(struct _dma_ring* ring)
+{
+	return ring->mask - dma_ring_pending(ring);
+}
+
+void dma_ring_stop(struct _dma_ring* ring)
+{
+	struct _dma_channel* channel = ring->channel;
+	bool running;
+
+	uint16_t end;
+
+	_dma_ring_lock(ring);
+	ring->reaping = true;
+
+	running = _dma_ring_running(ring);
+	if (running) {
+		dma_stop_transfer(channel);
+		while (_dma_ring_running(ring));
+#if defined(CONFIG_HAVE_XDMAC)
+		/* Stopped between two descriptors: the last fetched one is
+		 * complete */
+		if (xdmac_get_microblock_control(channel->hw, channel->id) == 0)
+			running = false;
+#endif
+	}
+
+	/* Report the completed transfers, cancel the others. The transfers
+	 * submitted by the callbacks are kept, and started by the
+	 * next submission. */
+	_dma_ring_reap(ring, running);
+	end = ring->head;
+	while (ring->tail != end)
+		_dma_ring_complete(ring, -ECANCELED);
+	ring->error = 0;
+
+	ring->hw_start = ring->tail;
+#if defined(CONFIG_HAVE_XDMAC)
+	xdmac_set_descriptor_addr(channel->hw, channel->id, 0, 0);
+#elif defined(CONFIG_HAVE_DMAC)
+	ring->hw_end = ring->tail;
+#endif
+	channel->state = DMA_STATE_ALLOCATED;
+
+	ring->reaping = false;
+	_dma_ring_unlock(ring);
+}
+
+void dma_ring_release(struct _dma_ring* ring)
+{
+	dma_ring_stop(ring);
+	ring->channel->ring = NULL;
+}
+
+void dma_ring_irq_handler(struct _dma_ring* ring, uint32_t status)
+{
+	bool running = _dma_ring_running(ring);
+	bool error;
+
+#if defined(CONFIG_HAVE_XDMAC)
+	error = (status & (XDMAC_CIS_RBEIS | XDMAC_CIS_WBEIS | XDMAC_CIS_ROIS)) != 0;
+#elif defined(CONFIG_HAVE_DMAC)
+	error = (status & DMAC_EBCISR_ERR0) != 0;
+#endif
+
+	ring->reaping = true;
+	if (error) {
+		/* Fail the descriptor being executed, restart on the next one */
+		dma_stop_transfer(ring->channel);
+		while (_dma_ring_running(ring));
+		_dma_ring_reap(ring, true);
+		if (ring->tail != ring->head)
+			_dma_ring_complete(ring, -EIO);
+		ring->hw_start = ring->tail;
+#if defined(CONFIG_HAVE_XDMAC)
+		xdmac_set_descriptor_addr(ring->channel->hw, ring->channel->id, 0, 0);
+#elif defined(CONFIG_HAVE_DMAC)
+		ring->hw_end = ring->tail;
+#endif
+		running = false;
+	} else {
+		_dma_ring_reap(ring, running);
+	}
+	ring->reaping = false;
+
+	if (!running) {
+		ring->channel->state = DMA_STATE_DONE;
+		_dma_ring_kick(ring);
+	}
+}
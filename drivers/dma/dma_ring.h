@@ -0,0 +1,184 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * DMA descriptor rings.
+ *
+ * A ring queues transfers on one DMA channel, each one with its own completion
+ * callback. Transfers can be submitted while the channel is running:
+ * - on XDMAC, the new descriptor is linked to the end of the running linked
+ *   list, the channel is only restarted if it ran dry before noticing it;
+ * - on DMAC, the descriptors submitted while the channel is running are
+ *   chained and started as one linked list when the running one completes.
+ *
+ * The ring has a single producer (dma_ring_submit()) and a single consumer
+ * (the DMA interrupt handler, or dma_poll() in polling mode), each one only
+ * updating its own index, so that submitting does not need a lock. The DMA
+ * interrupt is only masked while an idle channel is restarted.
+ *
+ * The callbacks are called with the transfer status as second argument
+ * (0, -EIO on bus error or -ECANCELED when the ring is stopped). The error of
+ * a transfer submitted without callback is reported to the next transfer
+ * submitted with one, so that a group of transfers completes only once.
+ */
+
+#ifndef _DMA_RING_H_
+#define _DMA_RING_H_
+
+/*----------------------------------------------------------------------------
+ *        Includes
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+#include "dma/dma.h"
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** \addtogroup dma_structs DMA Driver Structs
+		@{*/
+
+/** Ring descriptor. Allocate them (cache aligned, as the DMA controller
+ * fetches them from memory), but do not access their members. */
+struct _dma_ring_desc {
+#if defined(CONFIG_HAVE_XDMAC)
+	union {
+		struct _xdmac_desc_view0 view0;
+		struct _xdmac_desc_view1 view1;
+		struct _xdmac_desc_view2 view2;
+	} hw;
+	uint32_t cc;    /* Channel configuration of the transfer */
+	uint8_t view;   /* Descriptor view */
+#elif defined(CONFIG_HAVE_DMAC)
+	struct _dmac_desc hw;
+#endif
+	struct _callback callback;
+	uint64_t pattern;  /* Fill pattern, see dma_memset() */
+#ifdef CONFIG_HAVE_DMA_STATS
+	uint32_t stats_bytes;  /* Length of the transfer */
+	uint64_t stats_start;  /* Submission tick of the transfer */
+#endif
+};
+
+/** DMA descriptor ring */
+struct _dma_ring {
+	struct _dma_channel* channel;
+	struct _dma_cfg cfg;          /* Default configuration of the transfers */
+	struct _dma_ring_desc* desc;  /* Descriptors */
+	uint16_t mask;                /* Number of descriptors - 1 */
+	volatile uint16_t head;       /* Next descriptor to fill (producer) */
+	volatile uint16_t tail;       /* Next descriptor to complete (consumer) */
+	volatile uint16_t hw_start;   /* First descriptor of the last start */
+	volatile bool reaping;        /* Completions in progress, restart deferred */
+	int error;                    /* First error of transfers without callback */
+#if defined(CONFIG_HAVE_XDMAC)
+	void* periph_addr;            /* Peripheral address, for view 0 */
+	bool periph_moved;            /* Transfers use other peripheral addresses */
+#elif defined(CONFIG_HAVE_DMAC)
+	volatile uint16_t hw_end;     /* End of the chain given to the DMAC */
+#endif
+};
+
+/**     @}*/
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+/** \addtogroup dma_functions DMA Driver functions
+		@{*/
+
+/**
+ * \brief Attach a descriptor ring to an allocated DMA channel.
+ * \param ring Ring to initialize
+ * \param channel Channel pointer, must not be started
+ * \param cfg Default configuration of the transfers
+ * \param desc Descriptors of the ring
+ * \param count Number of descriptors, a power of two. The ring holds up to
+ * count - 1 pending transfers.
+ * \return error code
+ */
+extern int dma_ring_init(struct _dma_ring* ring, struct _dma_channel* channel,
+			 struct _dma_cfg* cfg, struct _dma_ring_desc* desc,
+			 uint16_t count);
+
+/**
+ * \brief Queue a transfer on a ring, starting the channel if it is idle.
+ * The buffers must be cleaned/invalidated from the cache by the caller.
+ * \param ring Ring pointer
+ * \param xfer Addresses and length (in data units) of the transfer
+ * \param cfg Configuration of this transfer, NULL for the ring default
+ * \param cb Callback called on completion, may be NULL
+ * \return 0, -ENOSPC if the ring is full, or -EINVAL
+ */
+extern int dma_ring_submit(struct _dma_ring* ring,
+			   struct _dma_transfer_cfg* xfer,
+			   struct _dma_cfg* cfg, struct _callback* cb);
+
+/**
+ * \brief Number of transfers queued on a ring and not completed yet.
+ * \param ring Ring pointer
+ */
+extern uint16_t dma_ring_pending(struct _dma_ring* ring);
+
+/**
+ * \brief Number of transfers that can be submitted to a ring.
+ * \param ring Ring pointer
+ */
+extern uint16_t dma_ring_space(struct _dma_ring* ring);
+
+/**
+ * \brief Stop the channel of a ring and cancel the pending transfers, the
+ * ring can be used again afterwards.
+ * \param ring Ring pointer
+ */
+extern void dma_ring_stop(struct _dma_ring* ring);
+
+/**
+ * \brief Detach a stopped ring from its channel.
+ * \param ring Ring pointer
+ */
+extern void dma_ring_release(struct _dma_ring* ring);
+
+/**
+ * \brief Process the completed descriptors of a ring, called by the DMA
+ * interrupt handler.
+ * \param ring Ring pointer
+ * \param status Channel interrupt status (XDMAC_CIS, or the channel bits of
+ * DMAC_EBCISR shifted to channel 0)
+ */
+extern void dma_ring_irq_handler(struct _dma_ring* ring, uint32_t status);
+
+/**     @}*/
+
+#endif /* _DMA_RING_H_ */
@@ -36,6 +36,7 @@
 #include "callback.h"
 #include "compiler.h"
 #include "dma/dma.h"
+#include "dma/dma_ring.h"
 #include "dma/dma_xdmac.h"
 #include "errno.h"
 #include "irq/irq.h"
@@ -180,6 +181,12 @@ void dma_irq_handler(uint32_t source, void* user_arg)
 		if (channel->state == DMA_STATE_FREE)
 			continue;
 
+		if (channel->ring) {
+			dma_ring_irq_handler(channel->ring,
+					     xdmac_get_channel_isr(xdmac, chan));
+			continue;
+		}
+
 		if (!(gcs & (1 << chan))) {
 			uint32_t cis = xdmac_get_channel_isr(xdmac, chan);
 
@@ -199,6 +206,12 @@ void dma_irq_handler(uint32_t source, void* user_arg)
 				channel->state = DMA_STATE_DONE;
 				exec = 1;
 			}
+
+			if (cis & (XDMAC_CIS_RBEIS | XDMAC_CIS_WBEIS | XDMAC_CIS_ROIS))
+				dma_stats_complete(channel, 0, channel->stats_start, true);
+			else if (exec)
+				dma_stats_complete(channel, channel->stats_bytes,
+						   channel->stats_start, false);
 		}
 
 		/* Execute callback */
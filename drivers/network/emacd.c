@@ -187,9 +187,11 @@ static void _emacd_tx_complete_handler(struct _ethd* emacd)
 
 		/* Process all buffers of the current transmitted frame */
 		while ((desc->status & ETH_TX_STATUS_LASTBUF) == 0) {
+			ethd_tx_release(emacd, 0, q->tx_tail);
 			RING_INC(q->tx_tail, q->tx_size);
 			desc = &q->tx_desc[q->tx_tail];
 		}
+		ethd_tx_release(emacd, 0, q->tx_tail);
 
 		/* Notify upper layer that a frame has been sent */
 		if (q->tx_callbacks) {
@@ -261,9 +263,11 @@ static void _emacd_tx_error_handler(struct _ethd* emacd)
 
 		/* Go to the last buffer descriptor of the frame */
 		while ((desc->status & ETH_TX_STATUS_LASTBUF) == 0) {
+			ethd_tx_release(emacd, 0, q->tx_tail);
 			RING_INC(q->tx_tail, q->tx_size);
 			desc = &q->tx_desc[q->tx_tail];
 		}
+		ethd_tx_release(emacd, 0, q->tx_tail);
 
 		/* Notify upper layer that a frame status */
 		// TODO: which error to notify?
@@ -308,6 +312,15 @@ static void _emacd_handler(struct _ethd * emacd)
 			/* Clear status */
 			rsr = emac_get_rx_status(emac);
 			emac_clear_rx_status(emac, rsr);
+			if (rsr & EMAC_RSR_OVR)
+				q->rx_stats.overruns++;
+			if (rsr & EMAC_RSR_BNA)
+				q->rx_stats.no_buffers++;
+
+			/* In polling mode, the RX interrupt stays masked
+			 * until the queue has been drained */
+			if (q->rx_polling)
+				emac_disable_it(emac, EMAC_IDR_RCOMP);
 
 			/* Invoke callback */
 			if (q->rx_callback)
@@ -443,6 +456,7 @@ uint8_t emacd_setup_queue(struct _ethd* emacd, uint8_t queue,
 	q->tx_desc = (struct _eth_desc*)((uint32_t)tx_desc & 0xFFFFFFF8);
 	q->tx_size = tx_size;
 	q->tx_callbacks = tx_callbacks;
+	q->tx_releases = NULL;
 	q->tx_wakeup_callback = NULL;
 
 	/* Reset TX & RX */
@@ -499,6 +513,20 @@ void emacd_set_rx_callback(struct _ethd* emacd,  uint8_t queue, ethd_callback_t
 	}
 }
 
+/**
+ * \brief Mask/unmask the RX completion interrupt, used by the polling mode
+ *  \param emacd  Pointer to EMAC Driver instance.
+ *  \param enable true to unmask the interrupt.
+ */
+void emacd_enable_rx_it(struct _ethd* emacd, uint8_t queue, bool enable)
+{
+	assert(queue == 0);
+	if (enable)
+		emac_enable_it(emacd->emac, EMAC_IER_RCOMP);
+	else
+		emac_disable_it(emacd->emac, EMAC_IDR_RCOMP);
+}
+
 const struct _ethd_op _emac_op = {
 	.configure = (_ethd_configure)emacd_configure,
 	.setup_queue = (_ethd_setup_queue)emacd_setup_queue,
@@ -512,4 +540,5 @@ const struct _ethd_op _emac_op = {
 	.poll = (_ethd_poll)ethd_poll,
 	.set_rx_callback = (_ethd_set_rx_callback)emacd_set_rx_callback,
 	.set_tx_wakeup_callback = (_ethd_set_tx_wakeup_callback)ethd_set_tx_wakeup_callback,
+	.enable_rx_it = (_ethd_enable_rx_it)emacd_enable_rx_it,
 };
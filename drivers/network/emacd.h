@@ -122,6 +122,8 @@ extern uint8_t emacd_poll(struct _ethd* emacd, uint8_t queue,
 extern void emacd_set_rx_callback(struct _ethd *emacd, uint8_t queue,
 		ethd_callback_t callback);
 
+extern void emacd_enable_rx_it(struct _ethd *emacd, uint8_t queue, bool enable);
+
 /** @}*/
 
 #ifdef __cplusplus
@@ -58,6 +58,8 @@
  *        Local functions
  *----------------------------------------------------------------------------*/
 
+static uint8_t _ethd_queue_tx(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback, bool copy);
+
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
@@ -78,17 +80,22 @@ bool ethd_configure(struct _ethd * ethd, enum _eth_type eth_type, void * addr, u
 	ethd->op = NULL;
 
 #ifdef CONFIG_HAVE_EMAC
-	if (ETH_TYPE_EMAC == eth_type)
+	if (ETH_TYPE_EMAC == eth_type) {
 		ethd->op = &_emac_op;
+		ethd->tx_max_buffer_size = ETH_TX_MAX_BUFFER_SIZE_EMAC;
+	}
 #endif
 #ifdef CONFIG_HAVE_GMAC
-	if (ETH_TYPE_GMAC == eth_type)
+	if (ETH_TYPE_GMAC == eth_type) {
 		ethd->op = &_gmac_op;
+		ethd->tx_max_buffer_size = ETH_TX_MAX_BUFFER_SIZE_GMAC;
+	}
 #endif
 
 	if (NULL == ethd->op)
 		return false;
 
+	ethd->caps = 0;
 	ethd->op->configure(ethd, addr, enable_caf, enable_nbc);
 	return true;
 }
@@ -103,13 +110,16 @@ uint8_t ethd_setup_queue(struct _ethd* ethd, uint8_t queue,
 		tx_callbacks);
 }
 
-uint8_t ethd_send_sg(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback)
+static uint8_t _ethd_queue_tx(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback, bool copy)
 {
 	void* eth = ethd->addr;
 	struct _ethd_queue* q = &ethd->queues[queue];
 	struct _eth_desc* desc;
+	uint32_t unit = copy ? ETH_TX_UNITSIZE : ethd->tx_max_buffer_size;
+	uint32_t count;
 	uint16_t idx, tx_head;
-	int i;
+	bool last;
+	int i, j;
 
 	if (callback && !q->tx_callbacks) {
 		trace_error("Cannot set send callback, no tx_callbacks buffer configured for queue %u", queue);
@@ -120,19 +130,30 @@ uint8_t ethd_send_sg(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_lis
 		trace_error("ethd_send_sg: ethernet frame is empty.\r\n");
 		return ETH_PARAM;
 	}
-	if (sgl->size >= q->tx_size) {
+
+	/* Count the buffer descriptors, large buffers are split */
+	count = 0;
+	for (i = 0; i < sgl->size; i++) {
+		const struct _eth_sg *sg = &sgl->entries[i];
+		count += sg->size ? (sg->size + unit - 1) / unit : 1;
+		if (!copy && sg->release && !q->tx_releases) {
+			trace_error("ethd_send_sg: no tx_releases buffer configured for queue %u\r\n", queue);
+			return ETH_PARAM;
+		}
+	}
+	if (count >= q->tx_size) {
 		trace_error("ethd_send_sg: ethernet frame has too many buffers.\r\n");
 		return ETH_PARAM;
 	}
 
 	/* Check available space */
-	if (RING_SPACE(q->tx_head, q->tx_tail, q->tx_size) < sgl->size) {
+	if (RING_SPACE(q->tx_head, q->tx_tail, q->tx_size) < count) {
 		trace_error("ethd_send_sg: not enough free buffers in TX queue.\r\n");
 		return ETH_TX_BUSY;
 	}
 
 	/* Tag end of TX queue */
-	tx_head = fixed_mod(q->tx_head + sgl->size, q->tx_size);
+	tx_head = fixed_mod(q->tx_head + count, q->tx_size);
 	idx = tx_head;
 	if (q->tx_callbacks)
 		q->tx_callbacks[idx] = NULL;
@@ -142,43 +163,73 @@ uint8_t ethd_send_sg(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_lis
 	/* Update buffer descriptors in reverse order to avoid a race
 	 * condition with hardware.
 	 */
+	last = true;
 	for (i = sgl->size - 1; i >= 0; i--) {
 		const struct _eth_sg *sg = &sgl->entries[i];
-		uint32_t status;
-
-		if (sg->size > ETH_TX_UNITSIZE) {
-			trace_error("ethd_send_sg: buffer size is too big.\r\n");
-			return ETH_PARAM;
-		}
+		int n = sg->size ? (sg->size + unit - 1) / unit : 1;
 
-		RING_DEC(idx, q->tx_size);
+		if (!copy && sg->buffer && sg->size)
+			cache_clean_region(sg->buffer, sg->size);
 
-		/* Reset TX callback */
-		if (q->tx_callbacks)
-			q->tx_callbacks[idx] = NULL;
+		for (j = n - 1; j >= 0; j--) {
+			uint8_t* buffer = (uint8_t*)sg->buffer + j * unit;
+			uint32_t size = sg->size - j * unit;
+			uint32_t status;
 
-		desc = &q->tx_desc[idx];
+			if (size > unit)
+				size = unit;
 
-		/* Copy data into transmittion buffer */
-		if (sg->buffer && sg->size) {
-			memcpy((void*)desc->addr, sg->buffer, sg->size);
-			cache_clean_region((void*)desc->addr, sg->size);
-		}
+			RING_DEC(idx, q->tx_size);
 
-		/* Compute buffer descriptor status word */
-		status = sg->size & ETH_RX_STATUS_LENGTH_MASK;
-		if (i == (sgl->size - 1)) {
-			status |= ETH_TX_STATUS_LASTBUF;
+			/* Reset TX callback */
 			if (q->tx_callbacks)
-				q->tx_callbacks[idx] = callback;
-		}
-		if (idx == (q->tx_size - 1)) {
-			status |= ETH_TX_STATUS_WRAP;
-		}
+				q->tx_callbacks[idx] = NULL;
+
+			/* The buffer is released with its last descriptor */
+			if (q->tx_releases) {
+				struct _eth_tx_release* release = &q->tx_releases[idx];
+				if (!copy && j == (n - 1) && sg->release) {
+					release->callback = sg->release;
+					release->buffer = sg->buffer;
+					release->arg = sg->release_arg;
+				} else {
+					release->callback = NULL;
+				}
+			}
+
+			desc = &q->tx_desc[idx];
+
+			if (copy) {
+				/* The descriptor may still point to a caller
+				 * buffer from a previous zero-copy transfer */
+				desc->addr = (uint32_t)q->tx_buffer + idx * ETH_TX_UNITSIZE;
+
+				/* Copy data into transmittion buffer */
+				if (sg->buffer && size) {
+					memcpy((void*)desc->addr, buffer, size);
+					cache_clean_region((void*)desc->addr, size);
+				}
+			} else {
+				/* Let the hardware fetch data from the caller buffer */
+				desc->addr = (uint32_t)buffer;
+			}
+
+			/* Compute buffer descriptor status word */
+			status = size & ETH_TX_STATUS_LENGTH_MASK;
+			if (last) {
+				status |= ETH_TX_STATUS_LASTBUF;
+				if (q->tx_callbacks)
+					q->tx_callbacks[idx] = callback;
+				last = false;
+			}
+			if (idx == (q->tx_size - 1)) {
+				status |= ETH_TX_STATUS_WRAP;
+			}
 
-		/* Update buffer descriptor status word: clear USED bit */
-		desc->status = status;
-		dsb();
+			/* Update buffer descriptor status word: clear USED bit */
+			desc->status = status;
+			dsb();
+		}
 	}
 
 	/* Update TX ring buffer pointers */
@@ -190,6 +241,16 @@ uint8_t ethd_send_sg(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_lis
 	return ETH_OK;
 }
 
+uint8_t ethd_send_sg(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback)
+{
+	return _ethd_queue_tx(ethd, queue, sgl, callback, true);
+}
+
+uint8_t ethd_send_sg_nocopy(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback)
+{
+	return _ethd_queue_tx(ethd, queue, sgl, callback, false);
+}
+
 void ethd_start(struct _ethd* ethd)
 {
 	ethd->op->start(ethd);
@@ -203,12 +264,44 @@ uint8_t ethd_send(struct _ethd* ethd, uint8_t queue, void *buffer, uint32_t size
 	/* Init single entry scatter-gather list */
 	sg.size = size;
 	sg.buffer = buffer;
+	sg.next = NULL;
+	sg.release = NULL;
+	sg.release_arg = NULL;
 	sgl.size = 1;
 	sgl.entries = &sg;
 
 	return ethd_send_sg(ethd, queue, &sgl, callback);
 }
 
+void ethd_set_tx_releases(struct _ethd* ethd, uint8_t queue, struct _eth_tx_release* tx_releases)
+{
+	struct _ethd_queue* q = &ethd->queues[queue];
+	uint16_t i;
+
+	if (tx_releases) {
+		for (i = 0; i < q->tx_size; i++)
+			tx_releases[i].callback = NULL;
+	}
+	q->tx_releases = tx_releases;
+}
+
+void ethd_tx_release(struct _ethd* ethd, uint8_t queue, uint16_t idx)
+{
+	struct _ethd_queue* q = &ethd->queues[queue];
+	struct _eth_tx_release* release;
+	ethd_release_cb_t callback;
+
+	if (!q->tx_releases)
+		return;
+
+	release = &q->tx_releases[idx];
+	callback = release->callback;
+	if (callback) {
+		release->callback = NULL;
+		callback(queue, release->buffer, release->arg);
+	}
+}
+
 /**
  * Return current load of TX.
  * \param ethd   Pointer to ETH Driver instance.
@@ -256,6 +349,7 @@ uint8_t ethd_poll(struct _ethd* ethd, uint8_t queue, uint8_t* buffer, uint32_t b
 		if (cur_frame) {
 			if (idx == q->rx_head) {
 				trace_info("no EOF (buffers probably too small)\r\n");
+				q->rx_stats.drops++;
 
 				do {
 					desc = &q->rx_desc[q->rx_head];
@@ -281,10 +375,12 @@ uint8_t ethd_poll(struct _ethd* ethd, uint8_t queue, uint8_t* buffer, uint32_t b
 			if (desc->status & ETH_RX_STATUS_EOF) {
 				/* Frame size from the ETH */
 				*recv_size = desc->status & ETH_RX_STATUS_LENGTH_MASK;
+				q->rx_status = desc->status;
 
 				/* Application frame buffer is too small all
 				 * data have not been copied */
 				if (cur_frame_size < *recv_size) {
+					q->rx_stats.drops++;
 					return ETH_SIZE_TOO_SMALL;
 				}
 
@@ -295,6 +391,7 @@ uint8_t ethd_poll(struct _ethd* ethd, uint8_t queue, uint8_t* buffer, uint32_t b
 					desc->addr &= ~ETH_RX_ADDR_OWN;
 					RING_INC(q->rx_head, q->rx_size);
 				}
+				q->rx_stats.frames++;
 
 				return ETH_OK;
 			}
@@ -312,6 +409,165 @@ uint8_t ethd_poll(struct _ethd* ethd, uint8_t queue, uint8_t* buffer, uint32_t b
 	return ETH_RX_NULL;
 }
 
+uint32_t ethd_rx_poll(struct _ethd* ethd, uint8_t queue, uint32_t budget, ethd_rx_handler_t handler, void* arg)
+{
+	struct _ethd_queue* q = &ethd->queues[queue];
+	struct _eth_sg frags[ETH_RX_MAX_FRAGMENTS];
+	struct _eth_sg_list frame;
+	struct _eth_desc* desc;
+	uint32_t processed = 0;
+	uint32_t scanned = 0;   /* descriptors looked at */
+	uint32_t consumed = 0;  /* descriptors to hand back */
+	uint32_t first = 0;     /* first descriptor of current frame */
+	uint32_t n = 0;         /* descriptors in current frame */
+	bool in_frame = false;
+	uint32_t idx, status, size, remaining, length, i;
+	uint8_t* start;
+
+	idx = q->rx_head;
+	while (processed < budget && scanned < q->rx_size) {
+		desc = &q->rx_desc[idx];
+		if ((desc->addr & ETH_RX_ADDR_OWN) == 0)
+			break;
+		status = desc->status;
+
+		/* A start of frame has been received, discard previous fragments */
+		if (status & ETH_RX_STATUS_SOF) {
+			if (in_frame)
+				q->rx_stats.drops++;
+			in_frame = true;
+			first = idx;
+			n = 0;
+			consumed = scanned;
+		}
+
+		RING_INC(idx, q->rx_size);
+		scanned++;
+
+		/* SOF has not been detected, skip the fragment */
+		if (!in_frame) {
+			consumed = scanned;
+			continue;
+		}
+
+		n++;
+		if ((status & ETH_RX_STATUS_EOF) == 0)
+			continue;
+
+		/* A complete frame has been received */
+		in_frame = false;
+		consumed = scanned;
+		if (n > ETH_RX_MAX_FRAGMENTS) {
+			q->rx_stats.drops++;
+			continue;
+		}
+
+		frame.size = n;
+		frame.entries = frags;
+		size = status & ETH_RX_STATUS_LENGTH_MASK;
+		remaining = size;
+		start = NULL;
+		length = 0;
+		for (i = 0; i < n; i++) {
+			struct _eth_sg* sg = &frags[i];
+			desc = &q->rx_desc[fixed_mod(first + i, q->rx_size)];
+			sg->buffer = (void*)(desc->addr & ETH_RX_ADDR_MASK);
+			sg->size = remaining > ETH_RX_UNITSIZE ? ETH_RX_UNITSIZE : remaining;
+			sg->next = (i + 1) < n ? &frags[i + 1] : NULL;
+			sg->release = NULL;
+			sg->release_arg = NULL;
+			remaining -= sg->size;
+
+			/* Invalidate each run of contiguous buffers at once */
+			if (start + length == (uint8_t*)sg->buffer) {
+				length += ETH_RX_UNITSIZE;
+			} else {
+				if (length)
+					cache_invalidate_region(start, length);
+				start = sg->buffer;
+				length = ETH_RX_UNITSIZE;
+			}
+		}
+		cache_invalidate_region(start, length);
+
+		q->rx_status = status;
+		handler(arg, queue, &frame, size);
+		processed++;
+
+		/* Give the hardware the spare buffers exchanged by the handler */
+		for (i = 0; i < n; i++) {
+			desc = &q->rx_desc[fixed_mod(first + i, q->rx_size)];
+			if (frags[i].buffer == (void*)(desc->addr & ETH_RX_ADDR_MASK))
+				continue;
+			cache_invalidate_region(frags[i].buffer, ETH_RX_UNITSIZE);
+			desc->addr = ((uint32_t)frags[i].buffer & ETH_RX_ADDR_MASK) |
+			             (desc->addr & ~ETH_RX_ADDR_MASK);
+		}
+	}
+
+	/* The whole ring has been filled without EOF */
+	if (in_frame && scanned == q->rx_size) {
+		trace_info("no EOF (buffers probably too small)\r\n");
+		q->rx_stats.drops++;
+		consumed = scanned;
+	}
+
+	/* Hand back all the processed buffers to the hardware */
+	for (i = 0; i < consumed; i++) {
+		q->rx_desc[q->rx_head].addr &= ~ETH_RX_ADDR_OWN;
+		RING_INC(q->rx_head, q->rx_size);
+	}
+	dsb();
+
+	q->rx_stats.frames += processed;
+	if (processed == budget) {
+		q->rx_stats.budget_exhausted++;
+		return processed;
+	}
+
+	/* Queue is empty: re-arm the RX interrupt */
+	if (q->rx_polling) {
+		ethd->op->enable_rx_it(ethd, queue, true);
+
+		/* A frame may have been received before the interrupt
+		 * was enabled */
+		if (q->rx_desc[q->rx_head].addr & ETH_RX_ADDR_OWN) {
+			ethd->op->enable_rx_it(ethd, queue, false);
+			return budget;
+		}
+	}
+
+	return processed;
+}
+
+void ethd_set_rx_polling(struct _ethd* ethd, uint8_t queue, bool enable)
+{
+	struct _ethd_queue* q = &ethd->queues[queue];
+
+	q->rx_polling = enable;
+	if (!enable && q->rx_callback)
+		ethd->op->enable_rx_it(ethd, queue, true);
+}
+
+void ethd_get_rx_stats(struct _ethd* ethd, uint8_t queue, struct _ethd_rx_stats* stats, bool clear)
+{
+	struct _ethd_queue* q = &ethd->queues[queue];
+
+	*stats = q->rx_stats;
+	if (clear)
+		memset(&q->rx_stats, 0, sizeof(q->rx_stats));
+}
+
+uint32_t ethd_get_rx_status(struct _ethd* ethd, uint8_t queue)
+{
+	return ethd->queues[queue].rx_status;
+}
+
+uint32_t ethd_get_caps(struct _ethd* ethd)
+{
+	return ethd->caps;
+}
+
 void ethd_set_rx_callback(struct _ethd *ethd, uint8_t queue, ethd_callback_t callback)
 {
 	ethd->op->set_rx_callback(ethd, queue, callback);
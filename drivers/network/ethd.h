@@ -89,11 +89,24 @@ enum _eth_speed {
 #define ETH_RX_STATUS_SOF         (1u << 14)
 #define ETH_RX_STATUS_EOF         (1u << 15)
 
+/* Checksums verified by the hardware, only valid on the last buffer of a frame
+ * when ETH_CAPS_RX_CHECKSUM is set */
+#define ETH_RX_STATUS_CSUM_MASK   (3u << 22)
+#define ETH_RX_STATUS_CSUM_NONE   (0u << 22) /**< Nothing checked */
+#define ETH_RX_STATUS_CSUM_IP     (1u << 22) /**< IP header checked */
+#define ETH_RX_STATUS_CSUM_IP_TCP (2u << 22) /**< IP header and TCP checked */
+#define ETH_RX_STATUS_CSUM_IP_UDP (3u << 22) /**< IP header and UDP checked */
+
 /* Bits contained in struct _eth_desc status when used for TX */
+#define ETH_TX_STATUS_LENGTH_MASK 0x3fffu
 #define ETH_TX_STATUS_LASTBUF (1u << 15)
 #define ETH_TX_STATUS_WRAP    (1u << 30)
 #define ETH_TX_STATUS_USED    (1u << 31)
 
+/* Hardware capabilities, see ethd_get_caps() */
+#define ETH_CAPS_RX_CHECKSUM (1u << 0) /**< IP/TCP/UDP checksums checked on RX */
+#define ETH_CAPS_TX_CHECKSUM (1u << 1) /**< IP/TCP/UDP checksums generated on TX */
+
 /**@}*/
 
 /** \addtogroup eth_buf_size ETH(EMACD/GMACD) Default Buffer Size
@@ -101,6 +114,15 @@ enum _eth_speed {
 #define ETH_RX_UNITSIZE            128  /**< RX buffer size, must be 128 */
 #define ETH_TX_UNITSIZE            1536 /**< TX buffer size, must be multiple
 					   of 32 (cache line) */
+#define ETH_TX_MAX_BUFFER_SIZE_EMAC 0x7ffu /**< Largest buffer handled by
+					   a single EMAC TX descriptor
+					   (11-bit length) */
+#define ETH_TX_MAX_BUFFER_SIZE_GMAC 0x3fffu /**< Largest buffer handled by
+					   a single GMAC TX descriptor
+					   (14-bit length) */
+/** Maximum number of RX buffers holding a single frame */
+#define ETH_RX_MAX_FRAGMENTS \
+	((ETH_MAX_FRAME_LENGTH + ETH_RX_UNITSIZE - 1) / ETH_RX_UNITSIZE)
 /**     @}*/
 
 /** \addtogroup eth_rc ETH(EMACD/GMACD) Return Codes
@@ -135,11 +157,34 @@ struct _eth_desc {
 	uint32_t status;
 };
 
+/** TX buffer release callback */
+typedef void (*ethd_release_cb_t)(uint8_t queue, void* buffer, void* arg);
+
 /** ETH scatter-gather entry */
 struct _eth_sg {
-	uint32_t        size;
-	void           *buffer;
-	struct _eth_sg *next;
+	uint32_t          size;
+	void             *buffer;
+	struct _eth_sg   *next;
+	ethd_release_cb_t release;     /**< Called when the buffer is sent
+					    (ethd_send_sg_nocopy only) */
+	void             *release_arg;
+};
+
+/** RX queue statistics */
+struct _ethd_rx_stats {
+	uint32_t frames;           /**< Frames received */
+	uint32_t drops;            /**< Frames dropped by the driver */
+	uint32_t overruns;         /**< Receive overrun events */
+	uint32_t no_buffers;       /**< Buffer not available events (ring full) */
+	uint32_t budget_exhausted; /**< ethd_rx_poll() passes that used up
+					their whole budget */
+};
+
+/** TX buffer release entry, one per TX descriptor */
+struct _eth_tx_release {
+	ethd_release_cb_t callback;
+	void             *buffer;
+	void             *arg;
 };
 
 /** ETH scatter-gather list */
@@ -156,6 +201,13 @@ struct _eth_sg_list {
 /** RX/TX callback */
 typedef void (*ethd_callback_t)(uint8_t queue, uint32_t status);
 
+/** RX frame handler. The frame is described by a scatter-gather list of
+ * RX buffers that are only valid until the handler returns. The handler may
+ * keep a buffer by replacing its entry with a spare buffer of
+ * ETH_RX_UNITSIZE bytes, cache line aligned, which is then given to the
+ * hardware in its place. */
+typedef void (*ethd_rx_handler_t)(void* arg, uint8_t queue, struct _eth_sg_list* frame, uint32_t size);
+
 /** TX Wakeup callback */
 typedef void (*ethd_wakeup_cb_t)(uint8_t queue);
 
@@ -186,6 +238,8 @@ typedef uint8_t (*_ethd_poll)(void* ethd, uint8_t queue, uint8_t* buffer, uint32
 
 typedef void (*_ethd_set_rx_callback)(void *ethd, uint8_t queue, ethd_callback_t callback);
 
+typedef void (*_ethd_enable_rx_it)(void *ethd, uint8_t queue, bool enable);
+
 typedef uint8_t (*_ethd_set_tx_wakeup_callback)(void *ethd, uint8_t queue, ethd_wakeup_cb_t wakeup_callback, uint16_t threshold);
 
 /** @}*/
@@ -206,6 +260,7 @@ struct _ethd_op {
 	_ethd_poll poll;
 	_ethd_set_rx_callback set_rx_callback;
 	_ethd_set_tx_wakeup_callback set_tx_wakeup_callback;
+	_ethd_enable_rx_it enable_rx_it;
 };
 
 struct _ethd_queue {
@@ -214,6 +269,9 @@ struct _ethd_queue {
 	uint16_t          rx_size;
 	uint16_t          rx_head;
 	ethd_callback_t   rx_callback;
+	bool              rx_polling;
+	struct _ethd_rx_stats rx_stats;
+	uint32_t          rx_status;
 
 	uint8_t          *tx_buffer;
 	struct _eth_desc *tx_desc;
@@ -221,6 +279,7 @@ struct _ethd_queue {
 	uint16_t          tx_head;
 	uint16_t          tx_tail;
 	ethd_callback_t  *tx_callbacks;
+	struct _eth_tx_release *tx_releases;
 
 	ethd_wakeup_cb_t tx_wakeup_callback;
 	uint16_t         tx_wakeup_threshold;
@@ -241,6 +300,9 @@ struct _ethd {
 	};
 	struct _ethd_queue queues[ETH_QUEUE_COUNT];
 	const struct _ethd_op *op;
+	uint32_t caps;        /**< ETH_CAPS_* flags */
+	uint32_t tx_max_buffer_size; /**< Largest buffer handled by a single
+					  TX descriptor */
 };
 
 /** @}*/
@@ -268,14 +330,30 @@ extern uint8_t ethd_setup_queue(struct _ethd* ethd, uint8_t queue,
 								ethd_callback_t *tx_callbacks);
 
 /**
- * \brief Send a frame splitted into buffers. If the frame size is larger than transfer buffer size
- * error returned. If frame transfer status is monitored, specify callback for each frame.
+ * \brief Send a frame splitted into buffers. Buffers larger than the transfer buffer size are
+ * copied into several transfer buffers. If frame transfer status is monitored, specify callback for each frame.
  *  \param ethd Pointer to ETH Driver instance.
  *  \param sgl Pointer to a scatter-gather list describing the buffers of the ethernet frame.
  *  \param callback Pointer to callback function.
  */
 extern uint8_t ethd_send_sg(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback);
 
+/**
+ * \brief Send a frame splitted into buffers without copying them into the
+ * transfer buffers: the buffer descriptors point directly to the buffers of
+ * the scatter-gather list, buffers larger than the length field of a TX
+ * descriptor (ETH_TX_MAX_BUFFER_SIZE_EMAC or ETH_TX_MAX_BUFFER_SIZE_GMAC)
+ * being split over several descriptors. The buffers are only cleaned from the
+ * cache, they are owned by the driver until the frame has been sent.
+ * Ownership of each buffer is given back by invoking its release callback
+ * from the TX completion interrupt (requires ethd_set_tx_releases()), or can
+ * be tracked with ethd_get_tx_load().
+ *  \param ethd Pointer to ETH Driver instance.
+ *  \param sgl Pointer to a scatter-gather list describing the buffers of the ethernet frame.
+ *  \param callback Pointer to callback function.
+ */
+extern uint8_t ethd_send_sg_nocopy(struct _ethd* ethd, uint8_t queue, const struct _eth_sg_list* sgl, ethd_callback_t callback);
+
 extern void ethd_start(struct _ethd* ethd);
 
 /**
@@ -289,6 +367,21 @@ extern void ethd_start(struct _ethd* ethd);
  */
 extern uint8_t ethd_send(struct _ethd* ethd, uint8_t queue, void *buffer, uint32_t size, ethd_callback_t callback);
 
+/**
+ * \brief Register the list used to track the release callbacks of the
+ * buffers sent by ethd_send_sg_nocopy(). The list must have one entry per
+ * TX descriptor of the queue. Must be invoked after ethd_setup_queue().
+ *  \param ethd Pointer to ETH Driver instance.
+ *  \param tx_releases Pointer to the release list, NULL to disable.
+ */
+extern void ethd_set_tx_releases(struct _ethd* ethd, uint8_t queue, struct _eth_tx_release* tx_releases);
+
+/**
+ * \brief Invoke the release callback attached to a TX descriptor, if any.
+ * Called by the EMAC/GMAC drivers for every processed TX descriptor.
+ */
+extern void ethd_tx_release(struct _ethd* ethd, uint8_t queue, uint16_t idx);
+
 extern uint32_t ethd_get_tx_load(struct _ethd* ethd, uint8_t queue);
 
 /**
@@ -303,6 +396,56 @@ extern uint32_t ethd_get_tx_load(struct _ethd* ethd, uint8_t queue);
  */
 extern uint8_t ethd_poll(struct _ethd* ethd, uint8_t queue, uint8_t* buffer, uint32_t buffer_size, uint32_t* recv_size);
 
+/**
+ * \brief Drain up to budget received frames from a RX queue.
+ * The handler is invoked for each complete frame with the RX buffers holding
+ * it. The RX buffers of all processed frames, or the spare buffers the
+ * handler exchanged them with, are handed back to the hardware at once at
+ * the end of the pass.
+ * In polling mode (see ethd_set_rx_polling()), the RX interrupt is re-armed
+ * only when the queue is found empty.
+ *  \param ethd    Pointer to ETH Driver instance.
+ *  \param budget  Maximum number of frames to process.
+ *  \param handler Frame handler.
+ *  \param arg     Argument given to the handler.
+ *  \return The number of processed frames. budget is returned when frames
+ *          are still pending and the queue must be polled again.
+ */
+extern uint32_t ethd_rx_poll(struct _ethd* ethd, uint8_t queue, uint32_t budget, ethd_rx_handler_t handler, void* arg);
+
+/**
+ * \brief Enable/disable the polling mode of a RX queue.
+ * In polling mode, the RX interrupt is masked as soon as it fires, the RX
+ * callback is invoked to schedule ethd_rx_poll(), which unmasks it once all
+ * pending frames have been processed.
+ *  \param ethd   Pointer to ETH Driver instance.
+ *  \param enable true to enable polling mode.
+ */
+extern void ethd_set_rx_polling(struct _ethd* ethd, uint8_t queue, bool enable);
+
+/**
+ * \brief Get the statistics of a RX queue.
+ *  \param ethd  Pointer to ETH Driver instance.
+ *  \param stats Pointer to the structure to fill.
+ *  \param clear Reset the statistics once read.
+ */
+extern void ethd_get_rx_stats(struct _ethd* ethd, uint8_t queue, struct _ethd_rx_stats* stats, bool clear);
+
+/**
+ * \brief Get the descriptor status of the last buffer of the last frame
+ * returned by ethd_poll() or given to the ethd_rx_poll() handler,
+ * used to retrieve the ETH_RX_STATUS_CSUM_* checksum status.
+ *  \param ethd  Pointer to ETH Driver instance.
+ */
+extern uint32_t ethd_get_rx_status(struct _ethd* ethd, uint8_t queue);
+
+/**
+ * \brief Get the hardware capabilities (ETH_CAPS_* flags) enabled by the
+ * driver.
+ *  \param ethd  Pointer to ETH Driver instance.
+ */
+extern uint32_t ethd_get_caps(struct _ethd* ethd);
+
 extern void ethd_set_rx_callback(struct _ethd *ethd, uint8_t queue, ethd_callback_t callback);
 
 /**
@@ -202,6 +202,29 @@ uint32_t gmac_get_network_config_register(Gmac* gmac)
 	return gmac->GMAC_NCFGR;
 }
 
+void gmac_enable_rx_checksum_offload(Gmac* gmac, bool enable)
+{
+	if (enable)
+		gmac->GMAC_NCFGR |= GMAC_NCFGR_RXCOEN;
+	else
+		gmac->GMAC_NCFGR &= ~GMAC_NCFGR_RXCOEN;
+}
+
+bool gmac_enable_tx_checksum_offload(Gmac* gmac, bool enable)
+{
+#ifdef GMAC_DCFGR_TXCOEN
+	/* Checksums can only be inserted when the whole frame is stored in
+	 * the TX packet buffer */
+	if (enable)
+		gmac->GMAC_DCFGR |= GMAC_DCFGR_TXPBMS | GMAC_DCFGR_TXCOEN;
+	else
+		gmac->GMAC_DCFGR &= ~GMAC_DCFGR_TXCOEN;
+	return true;
+#else
+	return !enable;
+#endif
+}
+
 void gmac_enable_mdio(Gmac* gmac)
 {
 	/* Disable RX/TX */
@@ -526,3 +549,55 @@ void gmac_halt_transmission(Gmac * gmac)
 {
 	gmac->GMAC_NCR |= GMAC_NCR_THALT;
 }
+
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+
+void gmac_set_st1_register(Gmac* gmac, uint8_t index, uint32_t value)
+{
+	if (index < GMAC_ST1_COUNT)
+		gmac->GMAC_ST1RPQ[index] = value;
+	else
+		trace_debug("Invalid screening type 1 register %d\r\n", index);
+}
+
+uint32_t gmac_get_st1_register(Gmac* gmac, uint8_t index)
+{
+	if (index < GMAC_ST1_COUNT)
+		return gmac->GMAC_ST1RPQ[index];
+	trace_debug("Invalid screening type 1 register %d\r\n", index);
+	return 0;
+}
+
+void gmac_set_st2_register(Gmac* gmac, uint8_t index, uint32_t value)
+{
+	if (index < GMAC_ST2_COUNT)
+		gmac->GMAC_ST2RPQ[index] = value;
+	else
+		trace_debug("Invalid screening type 2 register %d\r\n", index);
+}
+
+uint32_t gmac_get_st2_register(Gmac* gmac, uint8_t index)
+{
+	if (index < GMAC_ST2_COUNT)
+		return gmac->GMAC_ST2RPQ[index];
+	trace_debug("Invalid screening type 2 register %d\r\n", index);
+	return 0;
+}
+
+void gmac_set_st2_ethertype(Gmac* gmac, uint8_t index, uint16_t ethertype)
+{
+	if (index < GMAC_ST2_ETHERTYPE_COUNT)
+		gmac->GMAC_ST2ER[index] = GMAC_ST2ER_COMPVAL(ethertype);
+	else
+		trace_debug("Invalid screening type 2 EtherType register %d\r\n", index);
+}
+
+uint16_t gmac_get_st2_ethertype(Gmac* gmac, uint8_t index)
+{
+	if (index < GMAC_ST2_ETHERTYPE_COUNT)
+		return (gmac->GMAC_ST2ER[index] & GMAC_ST2ER_COMPVAL_Msk) >> GMAC_ST2ER_COMPVAL_Pos;
+	trace_debug("Invalid screening type 2 EtherType register %d\r\n", index);
+	return 0;
+}
+
+#endif /* CONFIG_HAVE_GMAC_QUEUES */
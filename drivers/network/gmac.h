@@ -91,6 +91,17 @@
 
 #define GMAC_MAX_JUMBO_FRAME_LENGTH 10240
 
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+/** Number of screening type 1 registers */
+#define GMAC_ST1_COUNT FIELD_ARRAY_SIZE(Gmac, GMAC_ST1RPQ)
+
+/** Number of screening type 2 registers */
+#define GMAC_ST2_COUNT FIELD_ARRAY_SIZE(Gmac, GMAC_ST2RPQ)
+
+/** Number of screening type 2 EtherType registers */
+#define GMAC_ST2_ETHERTYPE_COUNT FIELD_ARRAY_SIZE(Gmac, GMAC_ST2ER)
+#endif
+
 /**@}*/
 
 /*----------------------------------------------------------------------------
@@ -136,6 +147,19 @@ extern void gmac_set_network_config_register(Gmac* gmac, uint32_t ncfgr);
 
 extern uint32_t gmac_get_network_config_register(Gmac* gmac);
 
+/**
+ *  \brief Enable/disable the checking of IP/TCP/UDP checksums on RX.
+ *  Frames with a bad checksum are discarded and the checks performed are
+ *  reported in the RX descriptor status.
+ */
+extern void gmac_enable_rx_checksum_offload(Gmac* gmac, bool enable);
+
+/**
+ *  \brief Enable/disable the generation of IP/TCP/UDP checksums on TX.
+ *  \return false if the GMAC does not support TX checksum offload.
+ */
+extern bool gmac_enable_tx_checksum_offload(Gmac* gmac, bool enable);
+
 /**
  *  \brief Enable MDI with PHY
  *  \param gmac Pointer to an Gmac instance.
@@ -301,6 +325,40 @@ extern void gmac_start_transmission(Gmac* gmac);
  */
 extern void gmac_halt_transmission(Gmac* gmac);
 
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+
+/**
+ *  \brief Set a screening type 1 register (DS/TC field, UDP port)
+ */
+extern void gmac_set_st1_register(Gmac* gmac, uint8_t index, uint32_t value);
+
+/**
+ *  \brief Get a screening type 1 register
+ */
+extern uint32_t gmac_get_st1_register(Gmac* gmac, uint8_t index);
+
+/**
+ *  \brief Set a screening type 2 register (VLAN priority, EtherType)
+ */
+extern void gmac_set_st2_register(Gmac* gmac, uint8_t index, uint32_t value);
+
+/**
+ *  \brief Get a screening type 2 register
+ */
+extern uint32_t gmac_get_st2_register(Gmac* gmac, uint8_t index);
+
+/**
+ *  \brief Set a screening type 2 EtherType compare value
+ */
+extern void gmac_set_st2_ethertype(Gmac* gmac, uint8_t index, uint16_t ethertype);
+
+/**
+ *  \brief Get a screening type 2 EtherType compare value
+ */
+extern uint16_t gmac_get_st2_ethertype(Gmac* gmac, uint8_t index);
+
+#endif /* CONFIG_HAVE_GMAC_QUEUES */
+
 #ifdef __cplusplus
 }
 #endif
@@ -229,9 +229,11 @@ static void _gmacd_tx_complete_handler(struct _ethd* gmacd, uint8_t queue)
 
 		/* Process all buffers of the current transmitted frame */
 		while ((desc->status & ETH_TX_STATUS_LASTBUF) == 0) {
+			ethd_tx_release(gmacd, queue, q->tx_tail);
 			RING_INC(q->tx_tail, q->tx_size);
 			desc = &q->tx_desc[q->tx_tail];
 		}
+		ethd_tx_release(gmacd, queue, q->tx_tail);
 
 		/* Notify upper layer that a frame has been sent */
 		if (q->tx_callbacks) {
@@ -303,9 +305,11 @@ static void _gmacd_tx_error_handler(struct _ethd* gmacd, uint8_t queue)
 
 		/* Go to the last buffer descriptor of the frame */
 		while ((desc->status & ETH_TX_STATUS_LASTBUF) == 0) {
+			ethd_tx_release(gmacd, queue, q->tx_tail);
 			RING_INC(q->tx_tail, q->tx_size);
 			desc = &q->tx_desc[q->tx_tail];
 		}
+		ethd_tx_release(gmacd, queue, q->tx_tail);
 
 		/* Notify upper layer that a frame status */
 		// TODO: which error to notify?
@@ -350,6 +354,15 @@ static void _gmacd_handler(struct _ethd * gmacd, uint8_t queue)
 			/* Clear status */
 			rsr = gmac_get_rx_status(gmac);
 			gmac_clear_rx_status(gmac, rsr);
+			if (rsr & GMAC_RSR_RXOVR)
+				q->rx_stats.overruns++;
+			if (rsr & GMAC_RSR_BNA)
+				q->rx_stats.no_buffers++;
+
+			/* In polling mode, the RX interrupt stays masked
+			 * until the queue has been drained */
+			if (q->rx_polling)
+				gmac_disable_it(gmac, queue, GMAC_IDR_RCOMP);
 
 			/* Invoke callback */
 			if (q->rx_callback)
@@ -424,12 +437,22 @@ void gmacd_configure(struct _ethd * gmacd,
 	}
 	gmac_set_network_config_register(gmac, ncfgr);
 
+	/* Let the GMAC check and generate the IP/TCP/UDP checksums */
+	gmac_enable_rx_checksum_offload(gmac, true);
+	gmacd->caps |= ETH_CAPS_RX_CHECKSUM;
+	if (gmac_enable_tx_checksum_offload(gmac, true))
+		gmacd->caps |= ETH_CAPS_TX_CHECKSUM;
+
 	for (i = 0; i < GMAC_QUEUE_COUNT; i++) {
 		gmacd_setup_queue(gmacd, i,
 				DUMMY_BUFFERS, dummy_buffer, dummy_rx_desc,
 				DUMMY_BUFFERS, dummy_buffer, dummy_tx_desc,
 				NULL);
 	}
+
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+	gmacd_clear_screens(gmacd);
+#endif
 }
 
 /**
@@ -483,6 +506,7 @@ uint8_t gmacd_setup_queue(struct _ethd* gmacd, uint8_t queue,
 	q->tx_desc = (struct _eth_desc*)((uint32_t)tx_desc & 0xFFFFFFF8);
 	q->tx_size = tx_size;
 	q->tx_callbacks = tx_callbacks;
+	q->tx_releases = NULL;
 	q->tx_wakeup_callback = NULL;
 
 	/* Reset TX & RX */
@@ -541,6 +565,152 @@ void gmacd_set_rx_callback(struct _ethd* gmacd, uint8_t queue, ethd_callback_t c
 	}
 }
 
+/**
+ * \brief Mask/unmask the RX completion interrupt, used by the polling mode
+ *  \param gmacd  Pointer to GMAC Driver instance.
+ *  \param enable true to unmask the interrupt.
+ */
+void gmacd_enable_rx_it(struct _ethd* gmacd, uint8_t queue, bool enable)
+{
+	if (enable)
+		gmac_enable_it(gmacd->gmac, queue, GMAC_IER_RCOMP);
+	else
+		gmac_disable_it(gmacd->gmac, queue, GMAC_IDR_RCOMP);
+}
+
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+
+static uint8_t _gmacd_add_st1_screen(Gmac* gmac, uint32_t value)
+{
+	int i;
+
+	for (i = 0; i < GMAC_ST1_COUNT; i++) {
+		uint32_t st1 = gmac_get_st1_register(gmac, i);
+		if (st1 == value)
+			return ETH_OK;
+		if (!(st1 & (GMAC_ST1RPQ_DSTCE | GMAC_ST1RPQ_UDPE))) {
+			gmac_set_st1_register(gmac, i, value);
+			return ETH_OK;
+		}
+	}
+
+	trace_debug("No free screening type 1 register\r\n");
+	return ETH_PARAM;
+}
+
+static uint8_t _gmacd_add_st2_screen(Gmac* gmac, uint32_t value)
+{
+	int i;
+
+	for (i = 0; i < GMAC_ST2_COUNT; i++) {
+		uint32_t st2 = gmac_get_st2_register(gmac, i);
+		if (st2 == value)
+			return ETH_OK;
+		if (!(st2 & (GMAC_ST2RPQ_VLANE | GMAC_ST2RPQ_ETHE))) {
+			gmac_set_st2_register(gmac, i, value);
+			return ETH_OK;
+		}
+	}
+
+	trace_debug("No free screening type 2 register\r\n");
+	return ETH_PARAM;
+}
+
+static int _gmacd_get_st2_ethertype(Gmac* gmac, uint16_t ethertype)
+{
+	uint32_t used = 0;
+	int i;
+
+	/* Look for an EtherType register already referenced with this value */
+	for (i = 0; i < GMAC_ST2_COUNT; i++) {
+		uint32_t st2 = gmac_get_st2_register(gmac, i);
+		if (st2 & GMAC_ST2RPQ_ETHE) {
+			uint32_t idx = (st2 & GMAC_ST2RPQ_I2ETH_Msk) >> GMAC_ST2RPQ_I2ETH_Pos;
+			if (gmac_get_st2_ethertype(gmac, idx) == ethertype)
+				return idx;
+			used |= 1u << idx;
+		}
+	}
+
+	for (i = 0; i < GMAC_ST2_ETHERTYPE_COUNT; i++) {
+		if (!(used & (1u << i))) {
+			gmac_set_st2_ethertype(gmac, i, ethertype);
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * \brief Add a receive screening rule steering matching frames to a
+ * priority queue. Frames matching no rule are received on queue 0.
+ *  \param gmacd  Pointer to GMAC Driver instance.
+ *  \param screen Rule to add.
+ *  \return ETH_OK, or ETH_PARAM if the rule is invalid or no screening
+ *  register is available.
+ */
+uint8_t gmacd_add_screen(struct _ethd* gmacd, const struct _gmacd_screen* screen)
+{
+	Gmac* gmac = gmacd->gmac;
+	int idx;
+
+	if (screen->queue >= GMAC_QUEUE_COUNT)
+		return ETH_PARAM;
+
+	switch (screen->type) {
+	case GMACD_SCREEN_VLAN_PRIORITY:
+		if (screen->value > 7)
+			return ETH_PARAM;
+		return _gmacd_add_st2_screen(gmac,
+				GMAC_ST2RPQ_QNB(screen->queue) |
+				GMAC_ST2RPQ_VLANP(screen->value) |
+				GMAC_ST2RPQ_VLANE);
+	case GMACD_SCREEN_ETHERTYPE:
+		idx = _gmacd_get_st2_ethertype(gmac, screen->value);
+		if (idx < 0) {
+			trace_debug("No free screening EtherType register\r\n");
+			return ETH_PARAM;
+		}
+		return _gmacd_add_st2_screen(gmac,
+				GMAC_ST2RPQ_QNB(screen->queue) |
+				GMAC_ST2RPQ_I2ETH(idx) |
+				GMAC_ST2RPQ_ETHE);
+	case GMACD_SCREEN_UDP_PORT:
+		return _gmacd_add_st1_screen(gmac,
+				GMAC_ST1RPQ_QNB(screen->queue) |
+				GMAC_ST1RPQ_UDPM(screen->value) |
+				GMAC_ST1RPQ_UDPE);
+	case GMACD_SCREEN_DSTC:
+		if (screen->value > 0xff)
+			return ETH_PARAM;
+		return _gmacd_add_st1_screen(gmac,
+				GMAC_ST1RPQ_QNB(screen->queue) |
+				GMAC_ST1RPQ_DSTCM(screen->value) |
+				GMAC_ST1RPQ_DSTCE);
+	default:
+		return ETH_PARAM;
+	}
+}
+
+/**
+ * \brief Remove all receive screening rules, all frames go to queue 0.
+ *  \param gmacd  Pointer to GMAC Driver instance.
+ */
+void gmacd_clear_screens(struct _ethd* gmacd)
+{
+	int i;
+
+	for (i = 0; i < GMAC_ST1_COUNT; i++)
+		gmac_set_st1_register(gmacd->gmac, i, 0);
+	for (i = 0; i < GMAC_ST2_COUNT; i++)
+		gmac_set_st2_register(gmacd->gmac, i, 0);
+	for (i = 0; i < GMAC_ST2_ETHERTYPE_COUNT; i++)
+		gmac_set_st2_ethertype(gmacd->gmac, i, 0);
+}
+
+#endif /* CONFIG_HAVE_GMAC_QUEUES */
+
 const struct _ethd_op _gmac_op = {
 	.configure = (_ethd_configure)gmacd_configure,
 	.setup_queue = (_ethd_setup_queue)gmacd_setup_queue,
@@ -554,4 +724,5 @@ const struct _ethd_op _gmac_op = {
 	.poll = (_ethd_poll)ethd_poll,
 	.set_rx_callback = (_ethd_set_rx_callback)gmacd_set_rx_callback,
 	.set_tx_wakeup_callback = (_ethd_set_tx_wakeup_callback)ethd_set_tx_wakeup_callback,
+	.enable_rx_it = (_ethd_enable_rx_it)gmacd_enable_rx_it,
 };
@@ -41,6 +41,9 @@
  * -# Send ethernet packets using ethd_send(), ethd_get_tx_load() is used
  *    to get the free space in TX queue.
  * -# Check and obtain received ethernet packets via ethd_poll().
+ * -# On devices with priority queues, received frames can be steered to
+ *    queues other than 0 by VLAN priority, EtherType, UDP port or DS/TC
+ *    field using gmacd_add_screen().
  *
  * \sa \ref gmacb_module, \ref gmac_module
  *
@@ -78,6 +81,25 @@
 /** \addtogroup gmacd_types
     @{*/
 
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+
+/** Receive screening criteria, used to steer frames to priority queues */
+enum _gmacd_screen_type {
+	GMACD_SCREEN_VLAN_PRIORITY, /**< VLAN priority (0-7), type 2 screener */
+	GMACD_SCREEN_ETHERTYPE,     /**< EtherType, type 2 screener */
+	GMACD_SCREEN_UDP_PORT,      /**< UDP destination port, type 1 screener */
+	GMACD_SCREEN_DSTC,          /**< IPv4 DS / IPv6 TC field, type 1 screener */
+};
+
+/** Receive screening rule */
+struct _gmacd_screen {
+	enum _gmacd_screen_type type; /**< Field to compare */
+	uint16_t value;               /**< Value to match */
+	uint8_t queue;                /**< Destination queue */
+};
+
+#endif /* CONFIG_HAVE_GMAC_QUEUES */
+
 /** @}*/
 
 /*---------------------------------------------------------------------------
@@ -122,6 +144,17 @@ extern uint8_t gmacd_poll(struct _ethd* gmacd, uint8_t queue,
 extern void gmacd_set_rx_callback(struct _ethd *gmacd, uint8_t queue,
 		ethd_callback_t callback);
 
+extern void gmacd_enable_rx_it(struct _ethd *gmacd, uint8_t queue, bool enable);
+
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+
+extern uint8_t gmacd_add_screen(struct _ethd *gmacd,
+		const struct _gmacd_screen* screen);
+
+extern void gmacd_clear_screens(struct _ethd *gmacd);
+
+#endif /* CONFIG_HAVE_GMAC_QUEUES */
+
 /** @}*/
 
 #ifdef __cplusplus
@@ -64,6 +64,11 @@ static struct _nand_cfg nand_cfg;
 /*                     Global functions                                */
 /*---------------------------------------------------------------------*/
 
+#ifndef CONFIG_HAVE_NAND_FLASH_SIM
+
+/* With CONFIG_HAVE_NAND_FLASH_SIM, the bus access functions are provided by
+ * the simulator (see nand_flash_sim.c) */
+
 /**
  * \brief Initializes a _nand_flash instance based on the given physicalinterface.
  * \param nand  Pointer to a _nand_flash instance.
@@ -133,11 +138,68 @@ uint16_t nand_read_data16(const struct _nand_flash *nand)
 	return *((volatile uint16_t*)nand->data_addr);
 }
 
+/**
+ * \brief Reads data from the NANDFLASH data port into a buffer.
+ * \param nand  Pointer to a _nand_flash instance.
+ * \param buffer  Destination buffer.
+ * \param size  Number of bytes to read (rounded up to a whole number of
+ * words on a 16-bit bus).
+ */
+void nand_read_data_buffer(const struct _nand_flash *nand,
+		uint8_t *buffer, uint32_t size)
+{
+	uint32_t i;
+
+	if (nand_model_get_data_bus_width(&nand->model) == 16) {
+		uint16_t *buff16 = (uint16_t*)buffer;
+		volatile uint16_t *data16 = (volatile uint16_t*)nand->data_addr;
+		for (i = (size + 1) >> 1; i != 0; i--)
+			*buff16++ = *data16;
+	} else {
+		volatile uint8_t *data8 = (volatile uint8_t*)nand->data_addr;
+		for (i = size; i != 0; i--)
+			*buffer++ = *data8;
+	}
+}
+
+/**
+ * \brief Writes data from a buffer to the NANDFLASH data port.
+ * \param nand  Pointer to a _nand_flash instance.
+ * \param buffer  Source buffer.
+ * \param size  Number of bytes to write (rounded up to a whole number of
+ * words on a 16-bit bus).
+ */
+void nand_write_data_buffer(const struct _nand_flash *nand,
+		const uint8_t *buffer, uint32_t size)
+{
+	uint32_t i;
+
+	if (nand_model_get_data_bus_width(&nand->model) == 16) {
+		const uint16_t *buff16 = (const uint16_t*)buffer;
+		volatile uint16_t *data16 = (volatile uint16_t*)nand->data_addr;
+		for (i = (size + 1) >> 1; i != 0; i--)
+			*data16 = *buff16++;
+	} else {
+		volatile uint8_t *data8 = (volatile uint8_t*)nand->data_addr;
+		for (i = size; i != 0; i--)
+			*data8 = *buffer++;
+	}
+}
+
+#endif /* !CONFIG_HAVE_NAND_FLASH_SIM */
+
 /**
  * \brief Set ECC type.
  */
 void nand_set_ecc_type(uint8_t ecc_type)
 {
+#ifdef CONFIG_HAVE_NAND_FLASH_SIM
+	/* The PMECC cannot see the data of the simulated device */
+	if (ecc_type == ECC_PMECC) {
+		trace_warning("PMECC is not available with the NAND simulator\r\n");
+		ecc_type = ECC_NO;
+	}
+#endif
 	nand_cfg.ecc_type = ecc_type;
 }
 
@@ -164,6 +226,12 @@ bool nand_is_using_no_ecc(void)
  */
 void nand_set_nfc_enabled(bool enabled)
 {
+#ifdef CONFIG_HAVE_NAND_FLASH_SIM
+	if (enabled) {
+		trace_warning("NFC is not available with the NAND simulator\r\n");
+		enabled = false;
+	}
+#endif
 	nand_cfg.nfc_enabled = enabled;
 
 	if (nand_cfg.nfc_enabled)
@@ -208,6 +276,12 @@ bool nand_is_nfc_sram_enabled(void)
  */
 void nand_set_dma_enabled(bool enabled)
 {
+#ifdef CONFIG_HAVE_NAND_FLASH_SIM
+	if (enabled) {
+		trace_warning("DMA is not available with the NAND simulator\r\n");
+		enabled = false;
+	}
+#endif
 	nand_cfg.dma_enabled = enabled;
 }
 
@@ -98,6 +98,12 @@ extern uint8_t nand_read_data(const struct _nand_flash *nand);
 
 extern uint16_t nand_read_data16(const struct _nand_flash *nand);
 
+extern void nand_read_data_buffer(const struct _nand_flash *nand,
+		uint8_t *buffer, uint32_t size);
+
+extern void nand_write_data_buffer(const struct _nand_flash *nand,
+		const uint8_t *buffer, uint32_t size);
+
 extern void nand_set_ecc_type(uint8_t ecc_type);
 
 extern bool nand_is_using_pmecc(void);
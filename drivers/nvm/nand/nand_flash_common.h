@@ -146,6 +146,9 @@
 /** Invalid argument. */
 #define NAND_ERROR_INVALID_ARG        18
 
+/** Operation still in progress. */
+#define NAND_ERROR_BUSY               19
+
 
 /**@}*/
 /**@}*/
@@ -42,6 +42,14 @@
 #include "nand_flash_common.h"
 #include "nand_flash_dma.h"
 
+/*--------------------------------------------------------------------------
+ *        Local definitions
+ *------------------------------------------------------------------------*/
+
+/** DMA burst length, in data */
+#define NAND_DMA_CHUNK_SIZE DMA_CHUNK_SIZE_16
+#define NAND_DMA_CHUNK_LEN  16
+
 /*--------------------------------------------------------------------------
  *        Local Variables
  *------------------------------------------------------------------------*/
@@ -53,6 +61,17 @@ static struct _dma_channel *nand_dma_tx_channel;
 /** DMA transfer completion notifier */
 static volatile bool transfer_complete = false;
 
+/** Current transfer */
+static struct {
+	bool rx;
+	uint8_t *body;
+	uint32_t body_len;
+	volatile uint8_t *tail_dst;
+	volatile const uint8_t *tail_src;
+	uint32_t tail_len;
+	struct _callback callback;
+} nand_dma_xfer;
+
 /*-------------------------------------------------------------------------
  *        Local functions
  *------------------------------------------------------------------------*/
@@ -62,11 +81,103 @@ static volatile bool transfer_complete = false;
  */
 static int _nand_dma_callback(void* arg, void* arg2)
 {
+	uint32_t i;
+
+	if (nand_dma_xfer.rx)
+		cache_invalidate_region(nand_dma_xfer.body,
+				nand_dma_xfer.body_len);
+
+	/* The bytes that do not fill a whole burst are moved by the CPU,
+	 * once the DMA is done since NAND accesses must be sequential */
+	for (i = 0; i < nand_dma_xfer.tail_len; i++)
+		nand_dma_xfer.tail_dst[i] = nand_dma_xfer.tail_src[i];
+
 	transfer_complete = true;
+	callback_call(&nand_dma_xfer.callback, NULL);
+
+	return 0;
+}
+
+/**
+ * \brief Start a DMA transfer between the NAND data port and memory.
+ * The transfer uses word accesses in bursts of NAND_DMA_CHUNK_LEN data when
+ * both addresses are word aligned, byte accesses otherwise. The remaining
+ * bytes are copied by the CPU when the DMA completes.
+ * \param channel DMA channel.
+ * \param src_address Source address to be transferred.
+ * \param dest_address Destination address to be transferred.
+ * \param size Transfer size in byte.
+ * \param rx True if the destination is in system memory.
+ * \param cb Callback invoked at the end of the transfer, can be NULL.
+ * \returns 0 if the transfer was started; otherwise returns NAND_ERROR_DMA.
+ */
+static uint8_t _nand_dma_start(struct _dma_channel *channel,
+		uint32_t src_address, uint32_t dest_address, uint32_t size,
+		bool rx, struct _callback *cb)
+{
+	struct _dma_cfg cfg_dma;
+	struct _dma_transfer_cfg cfg;
+	uint32_t body;
+
+	cfg_dma.incr_saddr = true;
+	cfg_dma.incr_daddr = true;
+	cfg_dma.loop = false;
+	cfg_dma.chunk_size = NAND_DMA_CHUNK_SIZE;
+	if (((src_address | dest_address) & 3) == 0) {
+		cfg_dma.data_width = DMA_DATA_WIDTH_WORD;
+		body = size & ~(4 * NAND_DMA_CHUNK_LEN - 1);
+	} else {
+		cfg_dma.data_width = DMA_DATA_WIDTH_BYTE;
+		body = size & ~(NAND_DMA_CHUNK_LEN - 1);
+	}
+	if (body == 0) {
+		/* Too short for a burst, let the DMA move single bytes */
+		cfg_dma.data_width = DMA_DATA_WIDTH_BYTE;
+		cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
+		body = size;
+	}
+
+	nand_dma_xfer.rx = rx;
+	nand_dma_xfer.body = (uint8_t *)(rx ? dest_address : src_address);
+	nand_dma_xfer.body_len = body;
+	nand_dma_xfer.tail_dst = (volatile uint8_t *)(dest_address + body);
+	nand_dma_xfer.tail_src = (volatile const uint8_t *)(src_address + body);
+	nand_dma_xfer.tail_len = size - body;
+	if (cb)
+		callback_copy(&nand_dma_xfer.callback, cb);
+	else
+		callback_set(&nand_dma_xfer.callback, NULL, NULL);
+
+	dma_reset_channel(channel);
+	if (!rx)
+		cache_clean_region(nand_dma_xfer.body, body);
+
+	cfg.saddr = (uint32_t *)src_address;
+	cfg.daddr = (uint32_t *)dest_address;
+	cfg.len = body / DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
+	if (dma_configure_transfer(channel, &cfg_dma, &cfg, 1))
+		return NAND_ERROR_DMA;
+
+	/* Start transfer */
+	transfer_complete = false;
+	if (dma_start_transfer(channel))
+		return NAND_ERROR_DMA;
 
 	return 0;
 }
 
+/**
+ * \brief Wait for the end of the current DMA transfer.
+ */
+static void _nand_dma_wait(void)
+{
+	while (!transfer_complete) {
+		/* always call dma_poll, it will do nothing if polling mode
+		 * is disabled */
+		dma_poll();
+	}
+}
+
 /*--------------------------------------------------------------------------
  *        Exported functions
  *------------------------------------------------------------------------*/
@@ -107,32 +218,13 @@ uint8_t nand_dma_configure(void)
 uint8_t nand_dma_write(uint32_t src_address, uint32_t dest_address,
 		uint32_t size)
 {
-	struct _dma_cfg cfg_dma;
-	struct _dma_transfer_cfg cfg;
-
-	dma_reset_channel(nand_dma_tx_channel);
-	cache_clean_region((uint32_t *)src_address, size);
+	uint8_t error;
 
-	cfg.saddr = (uint32_t *)src_address;
-	cfg.daddr = (uint32_t *)dest_address;
-	cfg.len = size;
-	cfg_dma.incr_saddr = true;
-	cfg_dma.incr_daddr = true;
-	cfg_dma.loop = false;
-	cfg_dma.data_width = DMA_DATA_WIDTH_BYTE;
-	cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
-
-	dma_configure_transfer(nand_dma_tx_channel, &cfg_dma, &cfg, 1);
-
-	/* Start transfer */
-	transfer_complete = false;
-	dma_start_transfer(nand_dma_tx_channel);
-	/* Wait for completion */
-	while (!transfer_complete) {
-		/* always call dma_poll, it will do nothing if polling mode
-		 * is disabled */
-		dma_poll();
-	}
+	error = _nand_dma_start(nand_dma_tx_channel, src_address,
+			dest_address, size, false, NULL);
+	if (error)
+		return error;
+	_nand_dma_wait();
 	return 0;
 }
 
@@ -147,33 +239,53 @@ uint8_t nand_dma_write(uint32_t src_address, uint32_t dest_address,
 uint8_t nand_dma_read(uint32_t src_address, uint32_t dest_address,
 		uint32_t size)
 {
-	struct _dma_cfg cfg_dma;
-	struct _dma_transfer_cfg cfg;
+	uint8_t error;
 
-	dma_reset_channel(nand_dma_rx_channel);
-	cfg.saddr = (uint32_t *)src_address;
-	cfg.daddr = (uint32_t *)dest_address;
-	cfg.len = size;
+	error = _nand_dma_start(nand_dma_rx_channel, src_address,
+			dest_address, size, true, NULL);
+	if (error)
+		return error;
+	_nand_dma_wait();
+	return 0;
+}
 
-	cfg_dma.incr_saddr = true;
-	cfg_dma.incr_daddr = true;
-	cfg_dma.loop = false;
-	cfg_dma.data_width = DMA_DATA_WIDTH_BYTE;
-	cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
+/**
+ * \brief Start a DMA transfer to the NAND and return without waiting.
+ * \param src_address Source address to be transferred.
+ * \param dest_address Destination address to be transferred.
+ * \param size Transfer size in byte.
+ * \param cb Callback invoked once the transfer is complete, can be NULL.
+ * \returns 0 if the transfer was started; otherwise returns NAND_ERROR_DMA.
+ */
+uint8_t nand_dma_write_async(uint32_t src_address, uint32_t dest_address,
+		uint32_t size, struct _callback *cb)
+{
+	return _nand_dma_start(nand_dma_tx_channel, src_address,
+			dest_address, size, false, cb);
+}
 
-	dma_configure_transfer(nand_dma_rx_channel, &cfg_dma, &cfg, 1);
+/**
+ * \brief Start a DMA transfer from the NAND and return without waiting.
+ * The destination is invalidated from the data cache before \a cb is called.
+ * \param src_address Source address to be transferred.
+ * \param dest_address Destination address to be transferred.
+ * \param size Transfer size in byte.
+ * \param cb Callback invoked once the transfer is complete, can be NULL.
+ * \returns 0 if the transfer was started; otherwise returns NAND_ERROR_DMA.
+ */
+uint8_t nand_dma_read_async(uint32_t src_address, uint32_t dest_address,
+		uint32_t size, struct _callback *cb)
+{
+	return _nand_dma_start(nand_dma_rx_channel, src_address,
+			dest_address, size, true, cb);
+}
 
-	/* Start transfer */
-	transfer_complete = false;
-	dma_start_transfer(nand_dma_rx_channel);
-	/* Wait for completion */
-	while (!transfer_complete) {
-		/* always call dma_poll, it will do nothing if polling mode
-		 * is disabled */
-		dma_poll();
-	}
-	cache_invalidate_region((uint32_t *)dest_address, size);
-	return 0;
+/**
+ * \brief Check if the last DMA transfer is complete.
+ */
+bool nand_dma_is_complete(void)
+{
+	return transfer_complete;
 }
 
 /**
@@ -34,8 +34,11 @@
 /*                      Headers                                           */
 /*------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "callback.h"
+
 /*--------------------------------------------------------------------- */
 /*         Exported functions                                           */
 /*--------------------------------------------------------------------- */
@@ -48,6 +51,14 @@ extern uint8_t nand_dma_write(uint32_t src_address,
 extern uint8_t nand_dma_read(uint32_t src_address,
 		uint32_t dest_address, uint32_t size);
 
+extern uint8_t nand_dma_write_async(uint32_t src_address,
+		uint32_t dest_address, uint32_t size, struct _callback *cb);
+
+extern uint8_t nand_dma_read_async(uint32_t src_address,
+		uint32_t dest_address, uint32_t size, struct _callback *cb);
+
+extern bool nand_dma_is_complete(void);
+
 extern void nand_dma_free(void);
 
 #endif /* NAND_FLASH_DMA_H */
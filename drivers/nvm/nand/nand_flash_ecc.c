@@ -43,6 +43,7 @@
 #include "nand_flash_common.h"
 #include "nand_flash_ecc.h"
 
+#include "intmath.h"
 #include "trace.h"
 
 #include <assert.h>
@@ -53,7 +54,8 @@
 /*         Local variables                                               */
 /*---------------------------------------------------------------------- */
 
-CACHE_ALIGNED static uint8_t spare_buf[NAND_MAX_PAGE_SPARE_SIZE];
+/** PMECC state of the last page read */
+static struct _pmecc_snapshot pmecc_snapshot;
 
 /*---------------------------------------------------------------------- */
 /*         Local functions                                               */
@@ -61,54 +63,44 @@ CACHE_ALIGNED static uint8_t spare_buf[NAND_MAX_PAGE_SPARE_SIZE];
 
 /**
  * \brief Reads the data page of a NANDFLASH chip, and verify that
- * the data is valid by PMECC module. If one
+ * the data is valid by PMECC module. Erased pages are detected from the ECC
+ * bytes read along with the data, without reading the spare area again.
  * \param nand  Pointer to an EccNandFlash instance.
  * \param block  Number of block to read from.
  * \param page  Number of page to read inside given block.
  * \param data  Data area buffer.
+ * \param bitflips  Number of bits corrected in each sector, can be 0.
  * \return 0 if the data has been read and is valid; otherwise returns either
  * NAND_ERROR_CORRUPTEDDATA or ...
  */
 static uint8_t ecc_read_page_with_pmecc(const struct _nand_flash *nand,
-		uint16_t block, uint16_t page, void *data)
+		uint16_t block, uint16_t page, void *data, uint8_t *bitflips)
 {
-	volatile uint32_t pmecc_status;
+	uint32_t data_size = nand_model_get_page_data_size(&nand->model);
 	uint8_t error;
-	uint16_t i;
-	uint16_t page_spare_size = nand_model_get_page_spare_size(&nand->model);
 
 	if (!data)
 		return NAND_ERROR_ECC_NOT_COMPATIBLE;
 
-	/* Start by reading the data */
+	/* Start by reading the data, followed by the ECC bytes */
 	error = nand_raw_read_page(nand, block, page, data, NULL);
 	if (error) {
 		trace_error("ecc_read_page_with_pmecc: Failed to read page\r\n");
 		return error;
 	}
-	pmecc_status = pmecc_error_status();
-	if (pmecc_status) {
-		/* Check if the spare area was erased */
-		nand_raw_read_page(nand, block, page, NULL, spare_buf);
-		for (i = 0 ; i < page_spare_size; i++) {
-			if (spare_buf[i] != 0xff)
-				break;
-		}
-		if (i == page_spare_size)
-			pmecc_status = 0;
-	}
+	pmecc_save_snapshot(&pmecc_snapshot);
+	pmecc_auto_disable();
+	pmecc_disable();
 
 	/* bit correction will be done directly in destination buffer. */
-	if (pmecc_status && pmecc_correction(pmecc_status, (uint32_t)data)) {
-		pmecc_auto_disable();
-		pmecc_disable();
+	if (pmecc_correct_snapshot(&pmecc_snapshot, data,
+			(uint8_t*)data + data_size + pmecc_get_ecc_start_address(),
+			bitflips)) {
 		trace_error("ecc_read_page_with_pmecc: at B%d.P%d Unrecoverable data\r\n",
 				block, page);
 		return NAND_ERROR_CORRUPTEDDATA;
 	}
 
-	pmecc_auto_disable();
-	pmecc_disable();
 	return 0;
 }
 
@@ -141,10 +133,37 @@ static uint8_t ecc_write_page_with_pmecc(const struct _nand_flash *nand,
 /*         Exported functions */
 /*------------------------------------------------------------------------------ */
 
+/**
+ * \brief Returns the offset of the first spare byte which is neither used by
+ * the bad block marker nor by the ECC. The bytes from this offset up to the
+ * end of the spare area can be used to store user information with
+ * nand_ecc_write_page().
+ * \param nand  Pointer to an EccNandFlash instance.
+ * \return Offset in the spare area, equal to the spare size if there is no
+ * free byte.
+ */
+uint16_t nand_ecc_get_spare_free_offset(const struct _nand_flash *nand)
+{
+	uint16_t page_spare_size = nand_model_get_page_spare_size(&nand->model);
+	uint16_t offset = nand->badblock_marker_pos + 1;
+
+	if (nand_is_using_pmecc()) {
+		if (pmecc_auto_spare_en())
+			return page_spare_size;
+		offset = max_u32(offset, pmecc_get_ecc_end_address());
+	} else if (offset < 2) {
+		/* Large page devices may use both first bytes as marker */
+		offset = 2;
+	}
+
+	return min_u32(offset, page_spare_size);
+}
+
 /**
  * \brief Reads the data and/or spare of a page of a NANDFLASH chip, and verify that
  * the data is valid using the ECC information contained in the spare. If one
- * buffer pointer is 0, the corresponding area is not saved.
+ * buffer pointer is 0, the corresponding area is not saved. When PMECC is
+ * used, the spare area is read as is, without correction.
  * \param nand  Pointer to an EccNandFlash instance.
  * \param block  Number of block to read from.
  * \param page  Number of page to read inside given block.
@@ -155,14 +174,42 @@ static uint8_t ecc_write_page_with_pmecc(const struct _nand_flash *nand,
  */
 uint8_t nand_ecc_read_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page, void *data, void *spare)
+{
+	return nand_ecc_read_page_with_bitflips(nand, block, page, data, spare,
+			NULL);
+}
+
+/**
+ * \brief Same as nand_ecc_read_page(), and reports the number of bits
+ * corrected in each sector of the data area, so that the caller can decide
+ * to refresh the block before its data becomes uncorrectable.
+ * \param nand  Pointer to an EccNandFlash instance.
+ * \param block  Number of block to read from.
+ * \param page  Number of page to read inside given block.
+ * \param data  Data area buffer.
+ * \param spare  Spare area buffer.
+ * \param bitflips  Array of pmecc_get_sectors_per_page() entries receiving
+ * the number of bits corrected in each sector (PMECC_UNCORRECTABLE for a
+ * sector that could not be corrected), can be 0. Left untouched if PMECC is
+ * not used or no data is read.
+ * \return 0 if the data has been read and is valid; otherwise returns either
+ * NAND_ERROR_CORRUPTEDDATA or ...
+ */
+uint8_t nand_ecc_read_page_with_bitflips(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page, void *data, void *spare,
+		uint8_t *bitflips)
 {
 	NAND_TRACE("nand_ecc_read_page(B#%d:P#%d)\r\n", block, page);
 	assert(data || spare);
 
 	if (nand_is_using_pmecc()) {
-		if (spare)
-			return NAND_ERROR_ECC_NOT_COMPATIBLE;
-		return ecc_read_page_with_pmecc(nand, block, page, data);
+		uint8_t error = 0;
+		if (data)
+			error = ecc_read_page_with_pmecc(nand, block, page,
+					data, bitflips);
+		if (!error && spare)
+			error = nand_raw_read_page(nand, block, page, NULL, spare);
+		return error;
 	}
 
 	if (nand_is_using_no_ecc())
@@ -176,7 +223,9 @@ uint8_t nand_ecc_read_page(const struct _nand_flash *nand,
  * ECC for the data area and storing it in the spare. If no data buffer is
  * provided, the ECC is read from the existing page spare. If no spare buffer
  * is provided, the spare area is still written with the ECC information
- * calculated on the data buffer.
+ * calculated on the data buffer. When PMECC is used, a data buffer is
+ * mandatory and only the spare bytes starting at
+ * nand_ecc_get_spare_free_offset() are taken from the spare buffer.
  * \param nand Pointer to an EccNandFlash instance.
  * \param block  Number of the block to write in.
  * \param page  Number of the page to write inside the given block.
@@ -192,7 +241,8 @@ uint8_t nand_ecc_write_page(const struct _nand_flash *nand,
 
 	if (nand_is_using_pmecc()) {
 		if (spare)
-			return NAND_ERROR_ECC_NOT_COMPATIBLE;
+			return nand_raw_write_page_with_pmecc(nand, block, page,
+					data, spare);
 		return ecc_write_page_with_pmecc(nand, block, page, data);
 	}
 
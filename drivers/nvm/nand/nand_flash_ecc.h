@@ -62,10 +62,16 @@
 /*         Exported functions                                            */
 /*---------------------------------------------------------------------- */
 
+extern uint16_t nand_ecc_get_spare_free_offset(const struct _nand_flash *nand);
+
 extern uint8_t nand_ecc_read_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page,
 		void *data, void *spare);
 
+extern uint8_t nand_ecc_read_page_with_bitflips(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page,
+		void *data, void *spare, uint8_t *bitflips);
+
 extern uint8_t nand_ecc_write_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page,
 		void *data, void *spare);
@@ -55,6 +55,10 @@
 
 #define NAND_MFR_MICRON    0x2c
 
+/** Optional commands supported (bytes 8-9 of the parameter page) */
+#define ONFI_OPT_CMD_CACHE_PROGRAM (1 << 0)
+#define ONFI_OPT_CMD_CACHE_READ    (1 << 1)
+
 /*---------------------------------------------------------------------- */
 /*                   Variables                                           */
 /*---------------------------------------------------------------------- */
@@ -134,6 +138,9 @@ static bool nand_onfi_retrieve_param(const struct _nand_flash *nand)
 		onfi_parameter.onfi_compatible = true;
 		/* Bus width */
 		onfi_parameter.bus_width = (onfi_param_table[6] & 0x01) ? 16 : 8;
+		/* Optional commands supported */
+		onfi_parameter.optional_commands = onfi_param_table[8] |
+			(onfi_param_table[9] << 8);
 		/* Manufacturer */
 		memcpy(onfi_parameter.manufacturer, &onfi_param_table[32], 12);
 		onfi_parameter.manufacturer[12] = 0;
@@ -173,6 +180,8 @@ static bool nand_onfi_retrieve_param(const struct _nand_flash *nand)
 				(unsigned)onfi_parameter.logical_units);
 		trace_info_wp("ONFI ecc_correctability %d\r\n",
 				onfi_parameter.ecc_correctability);
+		trace_info_wp("ONFI optional_commands 0x%04x\r\n",
+				onfi_parameter.optional_commands);
 		return true;
 	}
 
@@ -243,6 +252,27 @@ uint8_t nand_onfi_get_ecc_correctability(void)
 	return onfi_parameter.ecc_correctability;
 }
 
+/**
+ * \brief Check if the device supports the Read Cache Sequential/End commands
+ * (31h/3Fh).
+ * \return true if the device is ONFI compliant and supports cache reads.
+ */
+bool nand_onfi_has_cache_read(void)
+{
+	return onfi_parameter.onfi_compatible &&
+		(onfi_parameter.optional_commands & ONFI_OPT_CMD_CACHE_READ);
+}
+
+/**
+ * \brief Check if the device supports the Page Cache Program command (15h).
+ * \return true if the device is ONFI compliant and supports cache programs.
+ */
+bool nand_onfi_has_cache_program(void)
+{
+	return onfi_parameter.onfi_compatible &&
+		(onfi_parameter.optional_commands & ONFI_OPT_CMD_CACHE_PROGRAM);
+}
+
 /**
  * \brief This function check if the NANDFLASH has an embedded ECC controller.
  * \return false if ONFI not compliant or internal ECC not supported, true if Internal ECC enabled.
@@ -63,6 +63,9 @@ struct _onfi_page_param {
 	/** Bus width */
 	uint8_t bus_width;
 
+	/** Optional commands supported */
+	uint16_t optional_commands;
+
 	/** Number of data bytes per page. */
 	uint32_t page_size;
 
@@ -110,6 +113,10 @@ extern uint16_t nand_onfi_get_blocks_per_lun(void);
 
 extern uint8_t nand_onfi_get_ecc_correctability(void);
 
+extern bool nand_onfi_has_cache_read(void);
+
+extern bool nand_onfi_has_cache_program(void);
+
 extern bool nand_onfi_get_model(struct _nand_flash_model *model);
 
 #endif /* NAND_FLASH_ONFI_H */
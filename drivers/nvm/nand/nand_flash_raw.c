@@ -41,6 +41,7 @@
 #include "nvm/nand/pmecc.h"
 #include "extram/smc.h"
 
+#include "dma/dma.h"
 #include "mm/cache.h"
 
 #include "nand_flash.h"
@@ -48,6 +49,7 @@
 #include "nand_flash_dma.h"
 #include "nand_flash_model_list.h"
 #include "nand_flash_commands.h"
+#include "nand_flash_onfi.h"
 
 #include <assert.h>
 #include <string.h>
@@ -61,6 +63,21 @@
 
 #define READ_STATUS_RETRIES 0xFFFF
 
+/** Timeout of each busy state of a multi-page transfer, in ms */
+#define JOB_TIMEOUT 100
+
+/*
+ * Steps of a multi-page transfer
+ */
+enum {
+	JOB_READ_ARRAY,  /* page read from the array (30h) */
+	JOB_READ_CACHE,  /* page moved to the cache register (31h/3Fh) */
+	JOB_READ_XFER,   /* page data output */
+	JOB_WRITE_XFER,  /* page data input */
+	JOB_WRITE_BUSY,  /* page program (15h/10h) */
+	JOB_DONE,
+};
+
 /*
  * NFC ALE CLE command parameter
  */
@@ -76,6 +93,12 @@
 
 CACHE_ALIGNED static uint8_t ecc_table[NAND_MAX_PMECC_BYTE_SIZE];
 
+/** PMECC state of the page waiting for correction in a multi-page read */
+static struct _pmecc_snapshot job_snapshot;
+
+/** ECC bytes of the page waiting for correction */
+static uint8_t job_ecc[NAND_MAX_PMECC_BYTE_SIZE];
+
 /*------------------------------------------------------------------------*/
 /*        Local Functions                                                 */
 /*------------------------------------------------------------------------*/
@@ -263,28 +286,13 @@ static void _data_array_in(const struct _nand_flash *nand, bool nfc_sram,
 
 	if (nand_is_dma_enabled()) {
 		nand_dma_read(address, (uint32_t)buffer, size);
+	} else if (nfc_sram) {
+		uint8_t *buff8 = buffer;
+		volatile uint8_t *data8 = (volatile uint8_t*)address;
+		for (i = size; i != 0; i--)
+			*buff8++ = *data8++;
 	} else {
-		uint8_t bus_width = nand_model_get_data_bus_width(&nand->model);
-
-		/* Check the data bus width of the NandFlash */
-		if (bus_width == 16 && !nfc_sram) {
-			uint16_t *buff16 = (uint16_t*)buffer;
-			volatile uint16_t *data16 = (volatile uint16_t*)address;
-			size = (size + 1) >> 1;
-			for (i = size; i != 0; i--) {
-				*buff16 = *data16;
-				buff16++;
-			}
-		} else {
-			uint8_t *buff8 = buffer;
-			volatile uint8_t *data8 = (volatile uint8_t*)address;
-			for(i = size; i != 0; i--) {
-				*buff8 = *data8;
-				if (nfc_sram)
-					data8++;
-				buff8++;
-			}
-		}
+		nand_read_data_buffer(nand, buffer, size);
 	}
 }
 
@@ -309,28 +317,13 @@ static void _data_array_out(const struct _nand_flash *nand, bool nfc_sram,
 
 	if (nand_is_dma_enabled()) {
 		nand_dma_write((uint32_t)buffer, address, size);
+	} else if (nfc_sram) {
+		uint8_t *buff8 = buffer;
+		volatile uint8_t *data8 = (volatile uint8_t*)address;
+		for (i = size; i != 0; i--)
+			*data8++ = *buff8++;
 	} else {
-		uint8_t bus_width = nand_model_get_data_bus_width(&nand->model);
-
-		/* Check the data bus width of the NandFlash */
-		if (bus_width == 16 && !nfc_sram) {
-			uint16_t *buff16 = (uint16_t*)buffer;
-			volatile uint16_t *data16 = (volatile uint16_t*)address;
-			size = (size + 1) >> 1;
-			for (i = size; i != 0; i--) {
-				*data16 = *buff16;
-				buff16++;
-			}
-		} else {
-			uint8_t *buff8 = buffer;
-			volatile uint8_t *data8 = (volatile uint8_t*)address;
-			for (i = size; i != 0; i--) {
-				*data8 = *buff8;
-				if (nfc_sram)
-					data8++;
-				buff8++;
-			}
-		}
+		nand_write_data_buffer(nand, buffer, size);
 	}
 }
 
@@ -633,16 +626,19 @@ static uint8_t _write_page(const struct _nand_flash *nand,
 }
 
 /**
- * \brief Writes the data and/or the spare area of a page on a NandFlash chip. If one
- * of the buffer pointer is 0, the corresponding area is not written.
+ * \brief Writes the data area of a page on a NandFlash chip along with its
+ * PMECC redundancy. If a spare buffer is given, the spare bytes located after
+ * the ECC area are programmed in the same operation; the other spare bytes
+ * (bad block marker, ECC) are left to the driver.
  * \param nand  Pointer to a struct _nand_flash instance.
  * \param block  Number of the block where the page to write resides.
  * \param page  Number of the page to write inside the given block.
  * \param data  Buffer containing the data area.
+ * \param spare  Buffer containing the spare area, can be 0.
  * \return 0 if the write operation is successful; otherwise returns 1.
 */
 static uint8_t _write_page_with_pmecc(const struct _nand_flash *nand,
-	uint16_t block, uint16_t page, uint8_t *data)
+	uint16_t block, uint16_t page, uint8_t *data, uint8_t *spare)
 {
 	uint8_t error = 0;
 	uint32_t data_size = nand_model_get_page_data_size(&nand->model);
@@ -706,6 +702,20 @@ static uint8_t _write_page_with_pmecc(const struct _nand_flash *nand,
 			ecc_table[i * ecc_bytes_per_sector + j] = pmecc_value(i, j);
 
 	_data_array_out(nand, false, ecc_table, pmecc_get_ecc_bytes_per_page(), 0);
+
+	/* Append the free spare bytes */
+	if (spare) {
+		uint32_t spare_size = nand_model_get_page_spare_size(&nand->model);
+		uint32_t ecc_end = pmecc_get_ecc_end_address();
+
+		if (ecc_end < spare_size) {
+			_send_cle_ale(nand, CLE_WRITE_EN | ALE_COL_EN,
+			              NAND_CMD_RANDOM_IN, 0, data_size + ecc_end, 0);
+			_data_array_out(nand, false, spare + ecc_end,
+			                spare_size - ecc_end, 0);
+		}
+	}
+
 	_send_cle_ale(nand, CLE_WRITE_EN, NAND_CMD_WRITE_2, 0, 0, 0);
 
 #ifdef CONFIG_HAVE_NFC
@@ -725,6 +735,266 @@ static uint8_t _write_page_with_pmecc(const struct _nand_flash *nand,
 	return error;
 }
 
+/**
+ * \brief Issue a STATUS command and enter a busy state of a multi-page
+ * transfer, left by nand_raw_job_poll() once all the bits of \a ready_mask
+ * are set in the status register.
+ */
+static void _job_wait(struct _nand_raw_job *job, uint8_t state,
+		uint8_t ready_mask)
+{
+	_send_cle_ale(job->nand, 0, NAND_CMD_STATUS, 0, 0, 0);
+	timer_start_timeout(&job->timeout, JOB_TIMEOUT);
+	job->ready_mask = ready_mask;
+	job->state = state;
+}
+
+/**
+ * \brief Read the ECC bytes of the page that has just been output and save
+ * the PMECC state, so that the page can be corrected by _job_correct() while
+ * the next one is read.
+ */
+static void _job_save_ecc(struct _nand_raw_job *job)
+{
+	uint32_t ecc_start = pmecc_get_ecc_start_address();
+	uint32_t ecc_end = pmecc_get_ecc_end_address();
+
+	/* The PMECC needs the spare area up to the end of the ECC */
+	_data_array_in(job->nand, false, ecc_table, ecc_end);
+	pmecc_wait_ready();
+
+	pmecc_save_snapshot(&job_snapshot);
+	if (job_snapshot.status)
+		memcpy(job_ecc, ecc_table + ecc_start, ecc_end - ecc_start);
+
+	job->pending = job->buffer;
+	job->pending_index = job->done;
+}
+
+/**
+ * \brief Correct the page saved by _job_save_ecc(), if any, and record its
+ * bitflips.
+ */
+static void _job_correct(struct _nand_raw_job *job)
+{
+	uint8_t bitflips[PMECC_MAX_SECTORS];
+	uint32_t sectors, i;
+
+	if (!job->pending)
+		return;
+
+	sectors = pmecc_get_sectors_per_page();
+	if (pmecc_correct_snapshot(&job_snapshot, job->pending, job_ecc, bitflips)) {
+		trace_error("nand_raw_job: page %u of the transfer: Unrecoverable data\r\n",
+				(unsigned)job->pending_index);
+		if (!job->error)
+			job->error = NAND_ERROR_CORRUPTEDDATA;
+	}
+
+	for (i = 0; i < sectors; i++)
+		if (bitflips[i] != PMECC_UNCORRECTABLE &&
+		    bitflips[i] > job->max_bitflips)
+			job->max_bitflips = bitflips[i];
+	if (job->bitflips)
+		memcpy(job->bitflips + job->pending_index * sectors, bitflips,
+		       sectors);
+
+	job->pending = NULL;
+}
+
+/**
+ * \brief Complete a multi-page transfer.
+ */
+static void _job_complete(struct _nand_raw_job *job, uint8_t error)
+{
+	_job_correct(job);
+	if (!job->error)
+		job->error = error;
+	if (job->pmecc) {
+		pmecc_auto_disable();
+		pmecc_disable();
+	}
+	job->state = JOB_DONE;
+	job->status = job->error;
+	callback_call(&job->callback, (void*)(uint32_t)job->error);
+}
+
+/**
+ * \brief DMA completion callback of a multi-page transfer.
+ */
+static int _job_xfer_callback(void *arg, void *arg2)
+{
+	struct _nand_raw_job *job = (struct _nand_raw_job *)arg;
+
+	job->xfer_done = true;
+	return 0;
+}
+
+/**
+ * \brief Start the transfer of the data area of the current page between the
+ * NAND data port and the job buffer. The data always goes through the EBI
+ * so that the PMECC sees it, the NFC SRAM is not used.
+ */
+static void _job_start_xfer(struct _nand_raw_job *job)
+{
+	const struct _nand_flash *nand = job->nand;
+	uint32_t data_size = nand_model_get_page_data_size(&nand->model);
+	struct _callback cb;
+
+	job->xfer_done = false;
+	job->state = job->write ? JOB_WRITE_XFER : JOB_READ_XFER;
+
+	if (nand_is_dma_enabled()) {
+		callback_set(&cb, _job_xfer_callback, job);
+		if (job->write) {
+			if (!nand_dma_write_async((uint32_t)job->buffer,
+					nand->data_addr, data_size, &cb))
+				return;
+		} else {
+			if (!nand_dma_read_async(nand->data_addr,
+					(uint32_t)job->buffer, data_size, &cb))
+				return;
+		}
+		_job_complete(job, NAND_ERROR_DMA);
+		return;
+	}
+
+	if (job->write)
+		_data_array_out(nand, false, job->buffer, data_size, 0);
+	else
+		_data_array_in(nand, false, job->buffer, data_size);
+	job->xfer_done = true;
+}
+
+/**
+ * \brief Output the data of the page held by the NAND cache (or data)
+ * register.
+ */
+static void _job_read_data(struct _nand_raw_job *job)
+{
+	/* Leave the status mode */
+	_send_cle_ale(job->nand, 0, NAND_CMD_READ_1, 0, 0, 0);
+
+	if (job->pmecc) {
+		pmecc_enable_read();
+		if (!pmecc_auto_spare_en())
+			pmecc_auto_enable();
+		pmecc_reset();
+		pmecc_start_data_phase();
+	}
+
+	_job_start_xfer(job);
+
+	/* Correct the previous page while this one is transferred */
+	_job_correct(job);
+}
+
+/**
+ * \brief Move the next page to the cache register with Read Cache
+ * Sequential, which starts reading the page after it from the array, or with
+ * Read Cache End for the last page.
+ */
+static void _job_read_cache(struct _nand_raw_job *job)
+{
+	uint8_t cmd = job->done + 1 < job->count ?
+		NAND_CMD_READ_CACHE_SEQ : NAND_CMD_READ_CACHE_END;
+
+	_send_cle_ale(job->nand, 0, cmd, 0, 0, 0);
+	_job_wait(job, JOB_READ_CACHE, NAND_STATUS_RDY);
+}
+
+/**
+ * \brief Input the data of the next page to program.
+ */
+static void _job_write_data(struct _nand_raw_job *job)
+{
+	if (job->pmecc) {
+		pmecc_reset();
+		pmecc_enable_write();
+		pmecc_start_data_phase();
+	}
+
+	_send_cle_ale(job->nand, CLE_WRITE_EN | ALE_COL_EN | ALE_ROW_EN,
+	              NAND_CMD_WRITE_1, 0, 0, job->row_address);
+
+	_job_start_xfer(job);
+}
+
+/**
+ * \brief Append the PMECC redundancy to the page being input.
+ */
+static void _job_write_ecc(struct _nand_raw_job *job)
+{
+	uint32_t data_size = nand_model_get_page_data_size(&job->nand->model);
+	uint32_t ecc_bytes_per_sector;
+	uint8_t nb_sectors_per_page;
+	uint32_t i, j;
+
+	_send_cle_ale(job->nand, CLE_WRITE_EN | ALE_COL_EN, NAND_CMD_RANDOM_IN,
+	              0, data_size + pmecc_get_ecc_start_address(), 0);
+
+	/* Wait until the kernel of the PMECC is not busy */
+	pmecc_wait_ready();
+	nb_sectors_per_page = pmecc_get_sectors_per_page();
+	ecc_bytes_per_sector = pmecc_get_ecc_bytes_per_page() / nb_sectors_per_page;
+
+	for (i = 0; i < nb_sectors_per_page; i++)
+		for (j = 0; j < ecc_bytes_per_sector; j++)
+			ecc_table[i * ecc_bytes_per_sector + j] = pmecc_value(i, j);
+
+	_data_array_out(job->nand, false, ecc_table,
+	                pmecc_get_ecc_bytes_per_page(), 0);
+}
+
+/**
+ * \brief Initialize a multi-page transfer.
+ * \return 0 if the arguments are valid, NAND_ERROR_INVALID_ARG otherwise.
+ */
+static uint8_t _job_init(const struct _nand_flash *nand,
+		struct _nand_raw_job *job, uint16_t block, uint16_t page,
+		uint16_t count, void *data, uint8_t *bitflips,
+		struct _callback *cb, bool write)
+{
+	uint32_t pages_per_block = nand_model_get_block_size_in_pages(&nand->model);
+
+	if (!data || !count || page + count > pages_per_block)
+		return NAND_ERROR_INVALID_ARG;
+
+	job->nand = nand;
+	job->buffer = (uint8_t *)data;
+	job->row_address = block * pages_per_block + page;
+	job->count = count;
+	job->done = 0;
+	job->write = write;
+	job->pmecc = nand_is_using_pmecc();
+	job->error = 0;
+	job->bitflips = bitflips;
+	job->max_bitflips = 0;
+	job->pending = NULL;
+	job->status = NAND_ERROR_BUSY;
+	if (cb)
+		callback_copy(&job->callback, cb);
+	else
+		callback_set(&job->callback, NULL, NULL);
+
+	if (count < 2)
+		job->cache = false;
+	else if (write)
+		job->cache = nand_onfi_has_cache_program();
+	else
+		job->cache = nand_onfi_has_cache_read();
+
+#ifdef CONFIG_HAVE_NFC
+	if (nand_is_nfc_enabled()) {
+		uint32_t data_size = nand_model_get_page_data_size(&nand->model);
+		uint32_t spare_size = nand_model_get_page_spare_size(&nand->model);
+		nfc_configure(data_size, spare_size, false, false);
+	}
+#endif
+
+	return 0;
+}
+
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
@@ -877,7 +1147,273 @@ uint8_t nand_raw_write_page(const struct _nand_flash *nand,
 		return _write_page(nand, block, page, data, spare);
 
 	if (nand_is_using_pmecc())
-		return _write_page_with_pmecc(nand, block, page, data);
+		return _write_page_with_pmecc(nand, block, page, data, NULL);
 
 	return NAND_ERROR_ECC_NOT_COMPATIBLE;
 }
+
+/**
+ * \brief Writes the data area of a page with its PMECC redundancy, and the
+ * free bytes of the spare area (located after the ECC bytes) in the same
+ * program operation.
+ * \param nand  Pointer to a struct _nand_flash instance.
+ * \param block  Number of the block where the page to write resides.
+ * \param page  Number of the page to write inside the given block.
+ * \param data  Buffer containing the data area.
+ * \param spare  Buffer containing the spare area, can be 0.
+ * \return 0 if the write operation is successful; otherwise returns
+ * NAND_ERROR_CANNOTWRITE or NAND_ERROR_ECC_NOT_COMPATIBLE.
+ */
+uint8_t nand_raw_write_page_with_pmecc(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page, void *data, void *spare)
+{
+	NAND_TRACE("nand_raw_write_page_with_pmecc(B#%d:P#%d)\r\n", block, page);
+
+	/* The spare area cannot be written after the ECC when it is protected */
+	if (!nand_is_using_pmecc() || (spare && pmecc_auto_spare_en()))
+		return NAND_ERROR_ECC_NOT_COMPATIBLE;
+
+	return _write_page_with_pmecc(nand, block, page, data, spare);
+}
+
+/**
+ * \brief Start reading the data area of \a count consecutive pages of a block,
+ * and return without waiting. The transfer is advanced by nand_raw_job_poll().
+ * When the device supports the ONFI cache read commands, each page is read
+ * from the array while the previous one is output on the bus. When PMECC is
+ * used, each page is checked and corrected while the next one is output, as
+ * nand_ecc_read_page() does, and the first error is reported at completion.
+ * The highest number of bits corrected in a sector is left in
+ * job->max_bitflips.
+ * \param nand  Pointer to a struct _nand_flash instance.
+ * \param job  Transfer descriptor, must stay valid until completion.
+ * \param block  Number of the block where the pages reside.
+ * \param page  Number of the first page to read inside the block.
+ * \param count  Number of pages to read, up to the end of the block.
+ * \param data  Buffer where the data areas will be stored.
+ * \param bitflips  Array of \a count * pmecc_get_sectors_per_page() entries
+ * receiving the number of bits corrected in each sector (or
+ * PMECC_UNCORRECTABLE), can be 0. Only used with PMECC.
+ * \param cb  Callback invoked with the final status (cast to a pointer) once
+ * the transfer is complete, can be 0.
+ * \return 0 if the transfer was started; otherwise returns an error code.
+ */
+uint8_t nand_raw_read_pages_async(const struct _nand_flash *nand,
+		struct _nand_raw_job *job, uint16_t block, uint16_t page,
+		uint16_t count, void *data, uint8_t *bitflips,
+		struct _callback *cb)
+{
+	uint8_t error;
+
+	NAND_TRACE("nand_raw_read_pages_async(B#%d:P#%d+%d)\r\n",
+			block, page, count);
+
+	error = _job_init(nand, job, block, page, count, data, bitflips, cb,
+			false);
+	if (error)
+		return error;
+
+	_send_cle_ale(nand, ALE_COL_EN | ALE_ROW_EN | CLE_VCMD2_EN,
+	              NAND_CMD_READ_1, NAND_CMD_READ_2, 0, job->row_address);
+	_job_wait(job, JOB_READ_ARRAY, NAND_STATUS_RDY);
+
+	return 0;
+}
+
+/**
+ * \brief Start programming the data area of \a count consecutive pages of a
+ * block, and return without waiting. The transfer is advanced by
+ * nand_raw_job_poll(). When the device supports the ONFI cache program
+ * command, each page is input while the previous one is programmed. When
+ * PMECC is used, the redundancy of each page is written along with it.
+ * If a program fails, the transfer stops and the whole block should be
+ * considered bad.
+ * \param nand  Pointer to a struct _nand_flash instance.
+ * \param job  Transfer descriptor, must stay valid until completion.
+ * \param block  Number of the block where the pages reside.
+ * \param page  Number of the first page to write inside the block.
+ * \param count  Number of pages to write, up to the end of the block.
+ * \param data  Buffer containing the data areas.
+ * \param cb  Callback invoked with the final status (cast to a pointer) once
+ * the transfer is complete, can be 0.
+ * \return 0 if the transfer was started; otherwise returns an error code.
+ */
+uint8_t nand_raw_write_pages_async(const struct _nand_flash *nand,
+		struct _nand_raw_job *job, uint16_t block, uint16_t page,
+		uint16_t count, void *data, struct _callback *cb)
+{
+	uint8_t error;
+
+	NAND_TRACE("nand_raw_write_pages_async(B#%d:P#%d+%d)\r\n",
+			block, page, count);
+
+	error = _job_init(nand, job, block, page, count, data, NULL, cb, true);
+	if (error)
+		return error;
+
+	_job_write_data(job);
+
+	return 0;
+}
+
+/**
+ * \brief Advance a multi-page transfer: check (without waiting) whether the
+ * current step is complete and start the following ones. Call it from the
+ * main loop or from a periodic timer interrupt handler. No other operation
+ * may be issued on the NAND while the transfer runs.
+ * \param job  Transfer started by nand_raw_read_pages_async() or
+ * nand_raw_write_pages_async().
+ * \return NAND_ERROR_BUSY while the transfer runs, then its final status.
+ */
+uint8_t nand_raw_job_poll(struct _nand_raw_job *job)
+{
+	const struct _nand_flash *nand = job->nand;
+	uint32_t data_size;
+	uint8_t status;
+
+	while (job->state != JOB_DONE) {
+		switch (job->state) {
+		case JOB_READ_ARRAY:
+		case JOB_READ_CACHE:
+		case JOB_WRITE_BUSY:
+			status = nand_read_data(nand);
+			if ((status & job->ready_mask) != job->ready_mask) {
+				if (timer_timeout_reached(&job->timeout))
+					_job_complete(job, NAND_ERROR_STATUS);
+				return job->status;
+			}
+			if (job->state == JOB_READ_ARRAY) {
+				if (job->cache)
+					_job_read_cache(job);
+				else
+					_job_read_data(job);
+			} else if (job->state == JOB_READ_CACHE) {
+				_job_read_data(job);
+			} else if (job->error) {
+				/* The array is idle after a failed program */
+				_job_complete(job, 0);
+			} else {
+				bool last = job->done + 1 == job->count;
+
+				/* With cache programs, FAILC is the status of
+				 * the previous page, FAIL the one of the last
+				 * page once the array is ready */
+				if (!job->cache)
+					status &= NAND_STATUS_FAIL;
+				else if (last)
+					status &= NAND_STATUS_FAIL |
+						(job->done ? NAND_STATUS_FAILC : 0);
+				else
+					status &= job->done ? NAND_STATUS_FAILC : 0;
+				if (status) {
+					trace_error("nand_raw_job: row %u Failed writing.\r\n",
+							(unsigned)job->row_address);
+					job->error = NAND_ERROR_CANNOTWRITE;
+					if (job->cache && !last)
+						/* Let the array finish */
+						_job_wait(job, JOB_WRITE_BUSY,
+						          NAND_STATUS_RDY | NAND_STATUS_ARDY);
+					else
+						_job_complete(job, 0);
+					break;
+				}
+				job->done++;
+				data_size = nand_model_get_page_data_size(&nand->model);
+				job->buffer += data_size;
+				job->row_address++;
+				if (job->done < job->count)
+					_job_write_data(job);
+				else
+					_job_complete(job, 0);
+			}
+			break;
+
+		case JOB_READ_XFER:
+			if (nand_is_dma_enabled())
+				dma_poll();
+			if (!job->xfer_done)
+				return job->status;
+			if (job->pmecc)
+				_job_save_ecc(job);
+			job->done++;
+			data_size = nand_model_get_page_data_size(&nand->model);
+			job->buffer += data_size;
+			job->row_address++;
+			if (job->done == job->count)
+				_job_complete(job, 0);
+			else if (job->cache)
+				_job_read_cache(job);
+			else {
+				_send_cle_ale(nand, ALE_COL_EN | ALE_ROW_EN | CLE_VCMD2_EN,
+				              NAND_CMD_READ_1, NAND_CMD_READ_2,
+				              0, job->row_address);
+				_job_wait(job, JOB_READ_ARRAY, NAND_STATUS_RDY);
+			}
+			break;
+
+		case JOB_WRITE_XFER:
+			if (nand_is_dma_enabled())
+				dma_poll();
+			if (!job->xfer_done)
+				return job->status;
+			if (job->pmecc)
+				_job_write_ecc(job);
+			if (job->cache && job->done + 1 < job->count) {
+				_send_cle_ale(nand, CLE_WRITE_EN, NAND_CMD_WRITE_CACHE, 0, 0, 0);
+				_job_wait(job, JOB_WRITE_BUSY, NAND_STATUS_RDY);
+			} else {
+				_send_cle_ale(nand, CLE_WRITE_EN, NAND_CMD_WRITE_2, 0, 0, 0);
+				_job_wait(job, JOB_WRITE_BUSY, NAND_STATUS_RDY |
+				          (job->cache ? NAND_STATUS_ARDY : 0));
+			}
+			break;
+		}
+	}
+
+	return job->status;
+}
+
+/**
+ * \brief Reads the data area of \a count consecutive pages of a block, see
+ * nand_raw_read_pages_async() for the description of the parameters.
+ * \return 0 if the data has been read and is valid; otherwise returns an
+ * error code.
+ */
+uint8_t nand_raw_read_pages(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page, uint16_t count, void *data,
+		uint8_t *bitflips)
+{
+	struct _nand_raw_job job;
+	uint8_t error;
+
+	error = nand_raw_read_pages_async(nand, &job, block, page, count,
+			data, bitflips, NULL);
+	if (error)
+		return error;
+
+	while ((error = nand_raw_job_poll(&job)) == NAND_ERROR_BUSY);
+
+	return error;
+}
+
+/**
+ * \brief Writes the data area of \a count consecutive pages of a block, see
+ * nand_raw_write_pages_async().
+ * \return 0 if the write operation is successful; otherwise returns an error
+ * code.
+ */
+uint8_t nand_raw_write_pages(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page, uint16_t count, void *data)
+{
+	struct _nand_raw_job job;
+	uint8_t error;
+
+	error = nand_raw_write_pages_async(nand, &job, block, page, count,
+			data, NULL);
+	if (error)
+		return error;
+
+	while ((error = nand_raw_job_poll(&job)) == NAND_ERROR_BUSY);
+
+	return error;
+}
@@ -46,6 +46,10 @@
  * -# nand_raw_read_page() and nand_raw_write_page is used to do read/write operation.
  * -# nand_raw_copy_page() is used to issue copy-page command to NANDFLASH device.
  * -# nand_raw_copy_block() calls nand_raw_copy_page to do a NANDFLASH block copy.
+ * -# nand_raw_read_pages_async() and nand_raw_write_pages_async() start a
+ *      transfer of several consecutive pages of a block, advanced by
+ *      nand_raw_job_poll(). nand_raw_read_pages() and nand_raw_write_pages()
+ *      are their blocking versions.
 */
 
 
@@ -56,12 +60,43 @@
 /*         Headers                                                               */
 /*------------------------------------------------------------------------------ */
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "callback.h"
 #include "gpio/pio.h"
+#include "timer.h"
 
 #include "nand_flash.h"
 
+/*------------------------------------------------------------------------------ */
+/*         Types                                                                 */
+/*------------------------------------------------------------------------------ */
+
+/** Multi-page transfer (see nand_raw_read_pages_async()), the fields are
+ * private */
+struct _nand_raw_job {
+	const struct _nand_flash *nand;
+	uint8_t *buffer;         /**< Data of the current page */
+	uint32_t row_address;    /**< Row address of the current page */
+	uint16_t count;          /**< Number of pages to transfer */
+	uint16_t done;           /**< Number of pages transferred */
+	bool write;              /**< Program instead of read */
+	bool cache;              /**< Use the cache read/program commands */
+	bool pmecc;              /**< Pages protected by the PMECC */
+	uint8_t state;           /**< Step of the current page */
+	uint8_t ready_mask;      /**< Status bits awaited in the busy states */
+	uint8_t error;           /**< First error, reported at completion */
+	uint8_t max_bitflips;    /**< Most bits corrected in a sector */
+	uint8_t *bitflips;       /**< Bits corrected per sector, can be 0 */
+	uint8_t *pending;        /**< Page waiting for its correction */
+	uint16_t pending_index;  /**< Index of that page in the transfer */
+	volatile bool xfer_done; /**< Data transfer complete */
+	volatile uint8_t status; /**< NAND_ERROR_BUSY, then the final status */
+	struct _timeout timeout; /**< Timeout of the current busy state */
+	struct _callback callback; /**< Completion callback */
+};
+
 /*------------------------------------------------------------------------------ */
 /*         Exported functions                                                    */
 /*------------------------------------------------------------------------------ */
@@ -84,6 +119,28 @@ extern uint8_t nand_raw_write_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page,
 		void *data, void *spare);
 
+extern uint8_t nand_raw_write_page_with_pmecc(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page,
+		void *data, void *spare);
+
+extern uint8_t nand_raw_read_pages_async(const struct _nand_flash *nand,
+		struct _nand_raw_job *job, uint16_t block, uint16_t page,
+		uint16_t count, void *data, uint8_t *bitflips,
+		struct _callback *cb);
+
+extern uint8_t nand_raw_write_pages_async(const struct _nand_flash *nand,
+		struct _nand_raw_job *job, uint16_t block, uint16_t page,
+		uint16_t count, void *data, struct _callback *cb);
+
+extern uint8_t nand_raw_job_poll(struct _nand_raw_job *job);
+
+extern uint8_t nand_raw_read_pages(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page, uint16_t count, void *data,
+		uint8_t *bitflips);
+
+extern uint8_t nand_raw_write_pages(const struct _nand_flash *nand,
+		uint16_t block, uint16_t page, uint16_t count, void *data);
+
 extern uint8_t nand_raw_copy_page(const struct _nand_flash *nand,
 		uint16_t source_block, uint16_t source_page,
 		uint16_t dest_block, uint16_t dest_page);
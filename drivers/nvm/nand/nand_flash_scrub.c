@@ -0,0 +1,964 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*---------------------------------------------------------------------- */
+/*         Headers                                                       */
+/*---------------------------------------------------------------------- */
+
+#include "nvm/nand/pmecc.h"
+
+#include "mm/cache.h"
+
+#include "nand_flash.h"
+#include "nand_flash_common.h"
+#include "nand_flash_ecc.h"
+#include "nand_flash_model.h"
+#include "nand_flash_raw.h"
+#include "nand_flash_scrub.h"
+#include "nand_flash_skip_block.h"
+
+#include "intmath.h"
+#include "timer.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------- */
+/*         Local definitions                                             */
+/*---------------------------------------------------------------------- */
+
+#define NO_BLOCK 0xFFFF
+
+/** Health map signature ("NSCR") */
+#define MAP_MAGIC 0x5243534e
+
+/** Size of the map header: magic, sequence, number of blocks, spare block,
+ * block being refreshed and block holding the data of a failed refresh */
+#define MAP_HEADER_SIZE 16
+
+/** Size of the map entry of a block */
+#define MAP_ENTRY_SIZE 8
+
+/** Number of pages read at once by nand_scrub_read_pages() */
+#define READ_CHUNK 8
+
+/** Maximum number of sectors in a page */
+#define MAX_SECTORS 8
+
+/* Refresh states */
+enum {
+	SCRUB_IDLE,
+	SCRUB_ERASE_SPARE,   /**< Erase the spare block */
+	SCRUB_COPY_OUT,      /**< Copy the block to the spare block */
+	SCRUB_SAVE_COPY,     /**< Save the map, which now records the copy */
+	SCRUB_ERASE_BLOCK,   /**< Erase the block */
+	SCRUB_COPY_BACK,     /**< Copy the spare block back to the block */
+	SCRUB_SAVE_DONE,     /**< Save the map, with the refresh done */
+};
+
+/** Page stream used to write/read the health map */
+struct _map_stream {
+	struct _nand_scrub *scrub;
+	uint16_t block;
+	uint16_t page;
+	uint32_t offset;      /**< Byte offset inside the current page */
+	uint32_t crc;
+	uint8_t error;
+};
+
+/*---------------------------------------------------------------------- */
+/*         Local variables                                               */
+/*---------------------------------------------------------------------- */
+
+/* Page buffer, large enough for the PMECC reads which also store the ECC */
+CACHE_ALIGNED static uint8_t page_buf[NAND_MAX_PAGE_DATA_SIZE + NAND_MAX_PAGE_SPARE_SIZE];
+
+CACHE_ALIGNED static uint8_t spare_buf[NAND_MAX_PAGE_SPARE_SIZE];
+
+static uint8_t read_bitflips[READ_CHUNK * MAX_SECTORS];
+
+static const uint32_t crc32_table[16] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+/*---------------------------------------------------------------------- */
+/*         Local functions                                               */
+/*---------------------------------------------------------------------- */
+
+static uint32_t _crc32_byte(uint32_t crc, uint8_t byte)
+{
+	crc = crc32_table[(crc ^ byte) & 0xf] ^ (crc >> 4);
+	return crc32_table[(crc ^ (byte >> 4)) & 0xf] ^ (crc >> 4);
+}
+
+static void _put_u16(uint8_t *buf, uint16_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+}
+
+static void _put_u32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+	buf[2] = value >> 16;
+	buf[3] = value >> 24;
+}
+
+static uint16_t _get_u16(const uint8_t *buf)
+{
+	return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t _get_u32(const uint8_t *buf)
+{
+	return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static bool _is_erased(const uint8_t *buf, uint32_t size)
+{
+	while (size--)
+		if (*buf++ != 0xff)
+			return false;
+	return true;
+}
+
+static bool _is_reserved(const struct _nand_scrub *scrub, uint16_t block)
+{
+	return block >= scrub->reserved_start &&
+		block < scrub->reserved_start + scrub->reserved_count;
+}
+
+/**
+ * \brief Returns a good reserved block which is not used by the service, or
+ * NO_BLOCK.
+ */
+static uint16_t _find_reserved_block(const struct _nand_scrub *scrub)
+{
+	uint16_t block;
+
+	for (block = scrub->reserved_start;
+	     block < scrub->reserved_start + scrub->reserved_count; block++) {
+		if (block == scrub->map_blocks[0] || block == scrub->map_blocks[1] ||
+		    block == scrub->spare_block || block == scrub->held_block)
+			continue;
+		if (nand_skipblock_check_block(scrub->nand, block) == GOODBLOCK)
+			return block;
+	}
+	return NO_BLOCK;
+}
+
+static void _stream_open(struct _map_stream *s, struct _nand_scrub *scrub,
+		uint16_t block)
+{
+	s->scrub = scrub;
+	s->block = block;
+	s->page = 0;
+	s->offset = 0;
+	s->crc = 0xffffffff;
+	s->error = 0;
+}
+
+static void _stream_write(struct _map_stream *s, const uint8_t *data,
+		uint32_t size)
+{
+	struct _nand_flash *nand = s->scrub->nand;
+	uint32_t page_size = nand_model_get_page_data_size(&nand->model);
+
+	while (size-- && !s->error) {
+		s->crc = _crc32_byte(s->crc, *data);
+		page_buf[s->offset++] = *data++;
+		if (s->offset == page_size) {
+			s->error = nand_ecc_write_page(nand, s->block, s->page,
+					page_buf, NULL);
+			s->page++;
+			s->offset = 0;
+		}
+	}
+}
+
+static uint8_t _stream_flush(struct _map_stream *s)
+{
+	struct _nand_flash *nand = s->scrub->nand;
+	uint32_t page_size = nand_model_get_page_data_size(&nand->model);
+
+	if (!s->error && s->offset) {
+		memset(page_buf + s->offset, 0xff, page_size - s->offset);
+		s->error = nand_ecc_write_page(nand, s->block, s->page,
+				page_buf, NULL);
+	}
+	return s->error;
+}
+
+static void _stream_read(struct _map_stream *s, uint8_t *data, uint32_t size)
+{
+	struct _nand_flash *nand = s->scrub->nand;
+	uint32_t page_size = nand_model_get_page_data_size(&nand->model);
+
+	while (size-- && !s->error) {
+		if (s->offset == 0)
+			s->error = nand_ecc_read_page(nand, s->block, s->page,
+					page_buf, NULL);
+		*data = page_buf[s->offset++];
+		s->crc = _crc32_byte(s->crc, *data++);
+		if (s->offset == page_size) {
+			s->page++;
+			s->offset = 0;
+		}
+	}
+}
+
+/**
+ * \brief Writes the health map in a map block.
+ */
+static uint8_t _write_map(struct _nand_scrub *scrub, uint16_t block,
+		uint32_t seq)
+{
+	struct _map_stream s;
+	uint8_t buf[MAP_HEADER_SIZE];
+	uint16_t refresh_block = NO_BLOCK;
+	uint16_t i;
+
+	/* The spare block holds a complete copy from the map save which ends
+	 * the copy out until the one which ends the refresh */
+	if (scrub->state >= SCRUB_SAVE_COPY && scrub->state < SCRUB_SAVE_DONE)
+		refresh_block = scrub->refresh_block;
+
+	_stream_open(&s, scrub, block);
+	_put_u32(buf, MAP_MAGIC);
+	_put_u32(buf + 4, seq);
+	_put_u16(buf + 8, scrub->num_blocks);
+	_put_u16(buf + 10, scrub->spare_block);
+	_put_u16(buf + 12, refresh_block);
+	_put_u16(buf + 14, scrub->held_block);
+	_stream_write(&s, buf, MAP_HEADER_SIZE);
+
+	for (i = 0; i < scrub->num_blocks; i++) {
+		const struct _nand_scrub_block *b = &scrub->blocks[i];
+		_put_u32(buf, b->reads);
+		buf[4] = b->max_bitflips;
+		buf[5] = b->flags;
+		_put_u16(buf + 6, b->refreshes);
+		_stream_write(&s, buf, MAP_ENTRY_SIZE);
+	}
+
+	_put_u32(buf, ~s.crc);
+	_stream_write(&s, buf, 4);
+	return _stream_flush(&s);
+}
+
+/**
+ * \brief Reads the health map of a map block into the block table.
+ * \return true if the map is valid, its sequence number, spare block, block
+ * being refreshed and held block are returned.
+ */
+static bool _read_map(struct _nand_scrub *scrub, uint16_t block,
+		uint32_t *seq, uint16_t *spare, uint16_t *refresh,
+		uint16_t *held)
+{
+	struct _map_stream s;
+	uint8_t buf[MAP_HEADER_SIZE];
+	uint32_t crc;
+	uint16_t i;
+
+	_stream_open(&s, scrub, block);
+	_stream_read(&s, buf, MAP_HEADER_SIZE);
+	if (s.error || _get_u32(buf) != MAP_MAGIC ||
+	    _get_u16(buf + 8) != scrub->num_blocks)
+		return false;
+	*seq = _get_u32(buf + 4);
+	*spare = _get_u16(buf + 10);
+	*refresh = _get_u16(buf + 12);
+	*held = _get_u16(buf + 14);
+
+	for (i = 0; i < scrub->num_blocks && !s.error; i++) {
+		struct _nand_scrub_block *b = &scrub->blocks[i];
+		_stream_read(&s, buf, MAP_ENTRY_SIZE);
+		b->reads = _get_u32(buf);
+		b->max_bitflips = buf[4];
+		b->flags = buf[5];
+		b->refreshes = _get_u16(buf + 6);
+	}
+
+	crc = ~s.crc;
+	_stream_read(&s, buf, 4);
+	return !s.error && _get_u32(buf) == crc;
+}
+
+/**
+ * \brief Reads the header of the health map of a map block.
+ */
+static bool _read_map_seq(struct _nand_scrub *scrub, uint16_t block,
+		uint32_t *seq)
+{
+	struct _map_stream s;
+	uint8_t buf[MAP_HEADER_SIZE];
+
+	_stream_open(&s, scrub, block);
+	_stream_read(&s, buf, MAP_HEADER_SIZE);
+	if (s.error || _get_u32(buf) != MAP_MAGIC ||
+	    _get_u16(buf + 8) != scrub->num_blocks)
+		return false;
+	*seq = _get_u32(buf + 4);
+	return true;
+}
+
+/**
+ * \brief Loads the most recent valid health map found in the reserved
+ * blocks, and resumes the refresh it records.
+ */
+static void _load_map(struct _nand_scrub *scrub)
+{
+	uint32_t seq, best_seq, limit = UINT32_MAX;
+	uint16_t block, best, spare, refresh, held;
+
+	for (;;) {
+		/* Most recent map older than the ones already tried */
+		best = NO_BLOCK;
+		best_seq = 0;
+		for (block = scrub->reserved_start;
+		     block < scrub->reserved_start + scrub->reserved_count;
+		     block++) {
+			if (nand_skipblock_check_block(scrub->nand, block) != GOODBLOCK)
+				continue;
+			if (_read_map_seq(scrub, block, &seq) &&
+			    seq < limit && seq >= best_seq) {
+				best = block;
+				best_seq = seq;
+			}
+		}
+		if (best == NO_BLOCK)
+			break;
+
+		if (_read_map(scrub, best, &seq, &spare, &refresh, &held)) {
+			scrub->map_blocks[0] = best;
+			scrub->map_index = 0;
+			scrub->map_seq = seq;
+			if (_is_reserved(scrub, held)) {
+				/* Never reuse the data of a failed refresh */
+				scrub->held_block = held;
+				trace_warning("nand_scrub: block %d holds the data of a failed refresh\r\n",
+						held);
+			}
+			if (refresh < scrub->num_blocks && _is_reserved(scrub, spare)) {
+				/* The copy of the block is complete in the spare
+				 * block, restart the refresh at the erase */
+				scrub->spare_block = spare;
+				scrub->refresh_block = refresh;
+				scrub->state = SCRUB_ERASE_BLOCK;
+				trace_info("nand_scrub: resuming refresh of block %d\r\n",
+						refresh);
+			}
+			return;
+		}
+		limit = best_seq;
+	}
+
+	trace_info("nand_scrub: no health map found\r\n");
+	memset(scrub->blocks, 0,
+			scrub->num_blocks * sizeof(struct _nand_scrub_block));
+	scrub->map_seq = 0;
+	scrub->save_needed = true;
+}
+
+/**
+ * \brief Saves the health map in the map block which does not hold the last
+ * one, replacing the map block if it wore out.
+ */
+static uint8_t _save_map(struct _nand_scrub *scrub)
+{
+	uint8_t index = scrub->map_index ^ 1;
+	uint16_t block = scrub->map_blocks[index];
+	uint8_t error;
+
+	for (;;) {
+		if (block == NO_BLOCK) {
+			trace_error("nand_scrub: no reserved block left for the map\r\n");
+			return NAND_ERROR_NOMOREBLOCKS;
+		}
+		error = nand_skipblock_erase_block(scrub->nand, block,
+				NORMAL_ERASE);
+		if (!error)
+			error = _write_map(scrub, block, scrub->map_seq + 1);
+		if (!error)
+			break;
+
+		trace_warning("nand_scrub: map block %d failed, retiring it\r\n",
+				block);
+		nand_skipblock_tag_block(scrub->nand, block, true);
+		scrub->map_blocks[index] = NO_BLOCK;
+		block = _find_reserved_block(scrub);
+		scrub->map_blocks[index] = block;
+	}
+
+	scrub->map_index = index;
+	scrub->map_seq++;
+	scrub->unsaved_reads = 0;
+	scrub->save_needed = false;
+	scrub->stats.map_saves++;
+	return 0;
+}
+
+/**
+ * \brief Copies a page, with the free bytes of its spare area. Erased pages
+ * are left erased. Uncorrectable data is not copied: it would be written
+ * with a new ECC and could no longer be told from good data.
+ */
+static uint8_t _copy_page(struct _nand_scrub *scrub, uint16_t src,
+		uint16_t dst, uint16_t page)
+{
+	struct _nand_flash *nand = scrub->nand;
+	uint32_t page_size = nand_model_get_page_data_size(&nand->model);
+	uint16_t spare_size = nand_model_get_page_spare_size(&nand->model);
+	uint16_t free_offset = nand_ecc_get_spare_free_offset(nand);
+	uint8_t *spare = free_offset < spare_size ? spare_buf : NULL;
+	uint8_t error;
+
+	error = nand_ecc_read_page(nand, src, page, page_buf, spare);
+	if (error == NAND_ERROR_CORRUPTEDDATA) {
+		trace_warning("nand_scrub: B#%d:P#%d is uncorrectable\r\n",
+				src, page);
+		scrub->stats.uncorrectable++;
+		scrub->blocks[src].flags |= NAND_SCRUB_UNCORRECTABLE;
+		return error;
+	} else if (error) {
+		return error;
+	}
+
+	if (_is_erased(page_buf, page_size) &&
+	    (!spare || _is_erased(spare + free_offset, spare_size - free_offset)))
+		return 0;
+
+	return nand_ecc_write_page(nand, dst, page, page_buf, spare);
+}
+
+/**
+ * \brief Clears the statistics of a block, its data being freshly written.
+ * A block which returned uncorrectable data stays flagged.
+ */
+static void _reset_block(struct _nand_scrub *scrub, uint16_t block)
+{
+	struct _nand_scrub_block *b = &scrub->blocks[block];
+
+	b->reads = 0;
+	b->max_bitflips = 0;
+	b->flags &= ~NAND_SCRUB_PENDING;
+	scrub->save_needed = true;
+}
+
+/**
+ * \brief Gives up the refresh in progress.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param error  Error code.
+ * \param erased  Whether the block has already been erased, in which case its
+ * data is only in the spare block, kept aside.
+ */
+static void _refresh_failed(struct _nand_scrub *scrub, uint8_t error,
+		bool erased)
+{
+	uint16_t block = scrub->refresh_block;
+
+	trace_error("nand_scrub: refresh of block %d failed (%d)\r\n",
+			block, error);
+	if (erased) {
+		trace_error("nand_scrub: data of block %d left in block %d\r\n",
+				block, scrub->spare_block);
+		scrub->held_block = scrub->spare_block;
+		scrub->spare_block = NO_BLOCK;
+	}
+	scrub->blocks[block].flags &= ~NAND_SCRUB_PENDING;
+	scrub->blocks[block].flags |= NAND_SCRUB_FAILED;
+	scrub->stats.failures++;
+	scrub->refresh_block = NO_BLOCK;
+	scrub->state = SCRUB_IDLE;
+	scrub->save_needed = true;
+}
+
+/**
+ * \brief Looks for the next block waiting for a refresh and starts it.
+ * \return true if a refresh was started.
+ */
+static bool _start_refresh(struct _nand_scrub *scrub)
+{
+	uint16_t i, block;
+	int rc;
+
+	for (i = 0; i < scrub->num_blocks; i++) {
+		block = scrub->cursor;
+		scrub->cursor = (scrub->cursor + 1) % scrub->num_blocks;
+
+		if (!(scrub->blocks[block].flags & NAND_SCRUB_PENDING))
+			continue;
+
+		if (_is_reserved(scrub, block) ||
+		    nand_skipblock_check_block(scrub->nand, block) != GOODBLOCK) {
+			scrub->blocks[block].flags &= ~NAND_SCRUB_PENDING;
+			continue;
+		}
+
+		if (scrub->relocate.method) {
+			/* The owner of the block moves the data itself, and
+			 * reports the erase of the block */
+			rc = callback_call(&scrub->relocate,
+					(void*)(uint32_t)block);
+			scrub->blocks[block].flags &= ~NAND_SCRUB_PENDING;
+			if (rc) {
+				scrub->blocks[block].flags |= NAND_SCRUB_FAILED;
+				scrub->stats.failures++;
+			} else {
+				scrub->blocks[block].refreshes++;
+				scrub->stats.refreshes++;
+			}
+			scrub->save_needed = true;
+			return true;
+		}
+
+		if (scrub->spare_block == NO_BLOCK) {
+			scrub->spare_block = _find_reserved_block(scrub);
+			if (scrub->spare_block == NO_BLOCK) {
+				trace_error("nand_scrub: no spare block left\r\n");
+				return false;
+			}
+		}
+
+		trace_info("nand_scrub: refreshing block %d (%u reads, %d bits)\r\n",
+				block, (unsigned)scrub->blocks[block].reads,
+				scrub->blocks[block].max_bitflips);
+		scrub->refresh_block = block;
+		scrub->state = SCRUB_ERASE_SPARE;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * \brief Performs the next step of the service: one page copy, one erase or
+ * one map save.
+ * \return false if there was nothing to do.
+ */
+static bool _step(struct _nand_scrub *scrub)
+{
+	uint16_t block = scrub->refresh_block;
+	uint8_t error;
+
+	switch (scrub->state) {
+	case SCRUB_IDLE:
+		if (_start_refresh(scrub))
+			return true;
+		if (scrub->save_needed)
+			return _save_map(scrub) == 0;
+		return false;
+
+	case SCRUB_ERASE_SPARE:
+		error = nand_skipblock_erase_block(scrub->nand,
+				scrub->spare_block, NORMAL_ERASE);
+		if (!error) {
+			scrub->refresh_page = 0;
+			scrub->state = SCRUB_COPY_OUT;
+		} else {
+			/* The spare block went bad, take another one */
+			scrub->spare_block = _find_reserved_block(scrub);
+			if (scrub->spare_block == NO_BLOCK)
+				_refresh_failed(scrub, NAND_ERROR_NOMOREBLOCKS, false);
+		}
+		break;
+
+	case SCRUB_COPY_OUT:
+		error = _copy_page(scrub, block, scrub->spare_block,
+				scrub->refresh_page);
+		if (error == NAND_ERROR_CANNOTWRITE) {
+			/* The spare block went bad, start over with another one */
+			nand_skipblock_tag_block(scrub->nand, scrub->spare_block,
+					true);
+			scrub->spare_block = _find_reserved_block(scrub);
+			if (scrub->spare_block == NO_BLOCK)
+				_refresh_failed(scrub, NAND_ERROR_NOMOREBLOCKS, false);
+			else
+				scrub->state = SCRUB_ERASE_SPARE;
+		} else if (error) {
+			_refresh_failed(scrub, error, false);
+		} else if (++scrub->refresh_page == scrub->pages_per_block) {
+			scrub->state = SCRUB_SAVE_COPY;
+		}
+		break;
+
+	case SCRUB_SAVE_COPY:
+		error = _save_map(scrub);
+		if (!error)
+			scrub->state = SCRUB_ERASE_BLOCK;
+		else
+			_refresh_failed(scrub, error, false);
+		break;
+
+	case SCRUB_ERASE_BLOCK:
+		/* A block which cannot be erased is marked bad */
+		error = nand_skipblock_erase_block(scrub->nand, block,
+				NORMAL_ERASE);
+		if (!error) {
+			scrub->refresh_page = 0;
+			scrub->state = SCRUB_COPY_BACK;
+		} else {
+			_refresh_failed(scrub, error, true);
+		}
+		break;
+
+	case SCRUB_COPY_BACK:
+		error = _copy_page(scrub, scrub->spare_block, block,
+				scrub->refresh_page);
+		if (error) {
+			if (error == NAND_ERROR_CANNOTWRITE)
+				nand_skipblock_tag_block(scrub->nand, block, true);
+			_refresh_failed(scrub, error, true);
+		} else if (++scrub->refresh_page == scrub->pages_per_block) {
+			_reset_block(scrub, block);
+			scrub->blocks[block].refreshes++;
+			scrub->stats.refreshes++;
+			scrub->state = SCRUB_SAVE_DONE;
+		}
+		break;
+
+	case SCRUB_SAVE_DONE:
+		/* On error, the map is saved again from the idle state */
+		_save_map(scrub);
+		scrub->refresh_block = NO_BLOCK;
+		scrub->state = SCRUB_IDLE;
+		break;
+	}
+
+	return true;
+}
+
+/*---------------------------------------------------------------------- */
+/*         Exported functions                                            */
+/*---------------------------------------------------------------------- */
+
+/**
+ * \brief Returns the size of the workspace needed by nand_scrub_initialize()
+ * for a device.
+ * \param nand  Pointer to a NandFlash instance.
+ */
+uint32_t nand_scrub_get_workspace_size(const struct _nand_flash *nand)
+{
+	return nand_model_get_device_size_in_blocks(&nand->model) *
+		sizeof(struct _nand_scrub_block);
+}
+
+/**
+ * \brief Initializes the scrubbing service of a device, loading the health
+ * map from the reserved blocks.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param nand  Pointer to a NandFlash instance.
+ * \param workspace  Block table, of nand_scrub_get_workspace_size() bytes.
+ * \param workspace_size  Size of the workspace.
+ * \param reserved_start  First block of the range reserved to the service.
+ * \param reserved_count  Number of reserved blocks, at least
+ * NAND_SCRUB_MIN_RESERVED_BLOCKS, plus some to replace the bad blocks.
+ * \return 0 if successful; otherwise returns an error code.
+ */
+uint8_t nand_scrub_initialize(struct _nand_scrub *scrub,
+		struct _nand_flash *nand, void *workspace, uint32_t workspace_size,
+		uint16_t reserved_start, uint16_t reserved_count)
+{
+	uint32_t page_size = nand_model_get_page_data_size(&nand->model);
+	uint32_t map_size;
+	uint8_t bitflips = NAND_SCRUB_BITFLIP_THRESHOLD;
+
+	memset(scrub, 0, sizeof(*scrub));
+	scrub->nand = nand;
+	scrub->blocks = workspace;
+	scrub->num_blocks = nand_model_get_device_size_in_blocks(&nand->model);
+	scrub->pages_per_block = nand_model_get_block_size_in_pages(&nand->model);
+	scrub->reserved_start = reserved_start;
+	scrub->reserved_count = reserved_count;
+	scrub->map_blocks[0] = NO_BLOCK;
+	scrub->map_blocks[1] = NO_BLOCK;
+	scrub->spare_block = NO_BLOCK;
+	scrub->held_block = NO_BLOCK;
+	scrub->refresh_block = NO_BLOCK;
+	scrub->state = SCRUB_IDLE;
+
+	if (workspace_size < nand_scrub_get_workspace_size(nand) ||
+	    reserved_count < NAND_SCRUB_MIN_RESERVED_BLOCKS ||
+	    reserved_start + reserved_count > scrub->num_blocks)
+		return NAND_ERROR_INVALID_ARG;
+
+	map_size = MAP_HEADER_SIZE + scrub->num_blocks * MAP_ENTRY_SIZE + 4;
+	if (map_size > page_size * scrub->pages_per_block)
+		return NAND_ERROR_INVALID_ARG;
+
+	if (bitflips == 0) {
+		if (nand_is_using_pmecc()) {
+			bitflips = pmecc_get_errors_per_sector();
+			bitflips = max_u32(1, bitflips - bitflips / 4);
+		} else {
+			/* No correction, no bitflip reported */
+			bitflips = 0xff;
+		}
+	}
+	nand_scrub_set_thresholds(scrub, NAND_SCRUB_READ_THRESHOLD, bitflips);
+
+	_load_map(scrub);
+
+	scrub->map_blocks[1] = _find_reserved_block(scrub);
+	if (scrub->map_blocks[0] == NO_BLOCK) {
+		/* No map yet, the first save goes to map_blocks[1] */
+		scrub->map_blocks[0] = _find_reserved_block(scrub);
+	}
+	if (scrub->spare_block == NO_BLOCK)
+		scrub->spare_block = _find_reserved_block(scrub);
+	if (scrub->map_blocks[0] == NO_BLOCK ||
+	    scrub->map_blocks[1] == NO_BLOCK ||
+	    scrub->spare_block == NO_BLOCK) {
+		trace_error("nand_scrub: not enough good reserved blocks\r\n");
+		return NAND_ERROR_NOMOREBLOCKS;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Sets the thresholds after which a block is refreshed.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param reads  Number of page reads of the block, 0 to disable.
+ * \param bitflips  Number of bits corrected in a sector, 0 to disable.
+ */
+void nand_scrub_set_thresholds(struct _nand_scrub *scrub,
+		uint32_t reads, uint8_t bitflips)
+{
+	scrub->read_threshold = reads;
+	scrub->bitflip_threshold = bitflips;
+}
+
+/**
+ * \brief Lets the owner of the blocks relocate their data, instead of the
+ * refresh in place. The callback gets the block number as second argument,
+ * and returns 0 once the data has been moved.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param cb  Relocation callback, 0 to refresh in place.
+ */
+void nand_scrub_set_relocate_callback(struct _nand_scrub *scrub,
+		struct _callback *cb)
+{
+	if (cb)
+		callback_copy(&scrub->relocate, cb);
+	else
+		callback_set(&scrub->relocate, NULL, NULL);
+}
+
+/**
+ * \brief Records pages read from a block, and the number of bits corrected in
+ * their sectors.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param block  Block read.
+ * \param pages  Number of pages read.
+ * \param bitflips  Bits corrected in each sector (PMECC_UNCORRECTABLE for an
+ * uncorrectable sector), can be 0.
+ * \param count  Number of entries of \a bitflips.
+ * \param uncorrectable  Whether uncorrectable data has been read.
+ */
+void nand_scrub_record_read(struct _nand_scrub *scrub, uint16_t block,
+		uint16_t pages, const uint8_t *bitflips, uint32_t count,
+		bool uncorrectable)
+{
+	struct _nand_scrub_block *b;
+	uint32_t i;
+
+	if (block >= scrub->num_blocks)
+		return;
+	b = &scrub->blocks[block];
+
+	b->reads += pages;
+	scrub->stats.reads += pages;
+	scrub->unsaved_reads += pages;
+
+	for (i = 0; bitflips && i < count; i++) {
+		if (bitflips[i] == PMECC_UNCORRECTABLE) {
+			uncorrectable = true;
+			continue;
+		}
+		scrub->stats.corrected_bits += bitflips[i];
+		if (bitflips[i] > b->max_bitflips)
+			b->max_bitflips = bitflips[i];
+	}
+
+	if (uncorrectable) {
+		if (!(b->flags & NAND_SCRUB_UNCORRECTABLE))
+			scrub->save_needed = true;
+		b->flags |= NAND_SCRUB_UNCORRECTABLE;
+		scrub->stats.uncorrectable++;
+	}
+
+	if (!(b->flags & NAND_SCRUB_PENDING) &&
+	    ((scrub->read_threshold && b->reads >= scrub->read_threshold) ||
+	     (scrub->bitflip_threshold &&
+	      b->max_bitflips >= scrub->bitflip_threshold) ||
+	     uncorrectable)) {
+		b->flags |= NAND_SCRUB_PENDING;
+		scrub->save_needed = true;
+	}
+
+	if (scrub->unsaved_reads >= NAND_SCRUB_SAVE_READS)
+		scrub->save_needed = true;
+}
+
+/**
+ * \brief Records the erase of a block, which clears its statistics.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param block  Block erased.
+ */
+void nand_scrub_block_erased(struct _nand_scrub *scrub, uint16_t block)
+{
+	if (block >= scrub->num_blocks || block == scrub->refresh_block)
+		return;
+
+	_reset_block(scrub, block);
+	scrub->blocks[block].flags &= ~NAND_SCRUB_FAILED;
+}
+
+/**
+ * \brief Reads a page as nand_ecc_read_page() does, and records the read.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param block  Number of the block to read from.
+ * \param page  Number of the page to read inside the given block.
+ * \param data  Data area buffer, as for nand_ecc_read_page().
+ * \param spare  Spare area buffer, can be 0.
+ * \return 0 if successful; otherwise returns an error code.
+ */
+uint8_t nand_scrub_read_page(struct _nand_scrub *scrub,
+		uint16_t block, uint16_t page, void *data, void *spare)
+{
+	uint8_t bitflips[MAX_SECTORS];
+	uint8_t error;
+
+	memset(bitflips, 0, sizeof(bitflips));
+	error = nand_ecc_read_page_with_bitflips(scrub->nand, block, page,
+			data, spare, data ? bitflips : NULL);
+	if (!error || error == NAND_ERROR_CORRUPTEDDATA)
+		nand_scrub_record_read(scrub, block, 1, bitflips,
+				ARRAY_SIZE(bitflips),
+				error == NAND_ERROR_CORRUPTEDDATA);
+	return error;
+}
+
+/**
+ * \brief Reads the data area of consecutive pages of a block, pipelined as
+ * nand_raw_read_pages() does, and records the reads.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param block  Number of the block to read from.
+ * \param page  First page to read.
+ * \param count  Number of pages to read.
+ * \param data  Data buffer, of \a count pages.
+ * \return 0 if successful; otherwise returns an error code.
+ */
+uint8_t nand_scrub_read_pages(struct _nand_scrub *scrub,
+		uint16_t block, uint16_t page, uint16_t count, void *data)
+{
+	uint32_t page_size = nand_model_get_page_data_size(&scrub->nand->model);
+	uint8_t *buffer = data;
+	uint16_t n;
+	uint8_t error = 0;
+
+	while (count && !error) {
+		n = min_u32(count, READ_CHUNK);
+		memset(read_bitflips, 0, sizeof(read_bitflips));
+		error = nand_raw_read_pages(scrub->nand, block, page, n, buffer,
+				read_bitflips);
+		if (!error || error == NAND_ERROR_CORRUPTEDDATA)
+			nand_scrub_record_read(scrub, block, n, read_bitflips,
+					ARRAY_SIZE(read_bitflips),
+					error == NAND_ERROR_CORRUPTEDDATA);
+		page += n;
+		count -= n;
+		buffer += n * page_size;
+	}
+	return error;
+}
+
+/**
+ * \brief Runs the service in idle time: refreshes the blocks which crossed a
+ * threshold and saves the health map. The work is split in steps (a page
+ * copy, an erase or a map save), started until the budget is spent.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param budget  Time the service may use, in ms. One step at most is
+ * performed when 0.
+ * \return true if work remains.
+ */
+bool nand_scrub_poll(struct _nand_scrub *scrub, uint32_t budget)
+{
+	struct _timeout timeout;
+
+	timer_start_timeout(&timeout, budget);
+	do {
+		if (!_step(scrub))
+			return false;
+	} while (!timer_timeout_reached(&timeout));
+
+	return true;
+}
+
+/**
+ * \brief Saves the health map now, e.g. before a shutdown. A refresh in
+ * progress is kept, and resumed by the next nand_scrub_initialize().
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \return 0 if successful; otherwise returns an error code.
+ */
+uint8_t nand_scrub_save(struct _nand_scrub *scrub)
+{
+	return _save_map(scrub);
+}
+
+/**
+ * \brief Returns the health of a block, or 0 if out of range.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param block  Block number.
+ */
+const struct _nand_scrub_block *nand_scrub_get_block(
+		const struct _nand_scrub *scrub, uint16_t block)
+{
+	if (block >= scrub->num_blocks)
+		return NULL;
+	return &scrub->blocks[block];
+}
+
+/**
+ * \brief Returns the scrubbing statistics.
+ * \param scrub  Pointer to a ScrubNandFlash instance.
+ * \param stats  Filled with the statistics.
+ */
+void nand_scrub_get_stats(const struct _nand_scrub *scrub,
+		struct _nand_scrub_stats *stats)
+{
+	*stats = scrub->stats;
+}
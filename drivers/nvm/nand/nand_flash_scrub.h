@@ -0,0 +1,202 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \page scrub_nand_page ScrubNandFlash
+ *
+ * \section Purpose
+ *
+ * ScrubNandFlash keeps the health of the blocks of a NANDFLASH device: the
+ * number of pages read from each block since it was last erased, and the
+ * highest number of bits ECC had to correct in one of its sectors. Reading a
+ * block disturbs its cells, and the number of corrected bits grows until the
+ * data cannot be corrected anymore; a block crossing one of the thresholds is
+ * refreshed in the background, before that happens.
+ *
+ * A block is refreshed in place through a spare block: its pages are copied
+ * to the spare block, the block is erased, and the pages are copied back. The
+ * health map (the statistics of all blocks and the refresh in progress) is
+ * saved in two blocks written alternately, so that the map and a block being
+ * refreshed survive a power loss. The map and spare blocks are taken from a
+ * range of blocks reserved by the application. Alternatively, the owner of the
+ * blocks (e.g. a flash translation layer) can relocate the data itself from
+ * a callback.
+ *
+ * \section Usage
+ *
+ * -# nand_scrub_initialize() loads the health map from the reserved blocks,
+ *      and resumes a refresh interrupted by a power loss.
+ * -# Read through nand_scrub_read_page() / nand_scrub_read_pages(), or report
+ *      the reads done through other layers with nand_scrub_record_read().
+ *      Report the erase of a block with nand_scrub_block_erased().
+ * -# Call nand_scrub_poll() when idle, with the time it may use.
+ * -# nand_scrub_save() saves the health map, e.g. before a shutdown.
+ */
+
+#ifndef NAND_FLASH_SCRUB_H
+#define NAND_FLASH_SCRUB_H
+
+/*---------------------------------------------------------------------- */
+/*         Headers                                                       */
+/*---------------------------------------------------------------------- */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+
+#include "nand_flash.h"
+
+/*---------------------------------------------------------------------- */
+/*         Definitions                                                   */
+/*---------------------------------------------------------------------- */
+
+/** Number of page reads of a block after which it is refreshed */
+#ifndef NAND_SCRUB_READ_THRESHOLD
+#define NAND_SCRUB_READ_THRESHOLD 100000
+#endif
+
+/** Number of corrected bits in a sector after which the block is refreshed,
+ * 0 to use 3/4 of the correction capability of PMECC */
+#ifndef NAND_SCRUB_BITFLIP_THRESHOLD
+#define NAND_SCRUB_BITFLIP_THRESHOLD 0
+#endif
+
+/** Number of page reads after which the health map is saved by
+ * nand_scrub_poll() */
+#ifndef NAND_SCRUB_SAVE_READS
+#define NAND_SCRUB_SAVE_READS 10000
+#endif
+
+/** Minimum number of reserved blocks: two for the map, one spare */
+#define NAND_SCRUB_MIN_RESERVED_BLOCKS 3
+
+/* Block flags */
+
+/** The block crossed a threshold and waits for a refresh */
+#define NAND_SCRUB_PENDING       (1 << 0)
+
+/** Uncorrectable data has been read from the block, the flag is kept when
+ * the block is refreshed or erased */
+#define NAND_SCRUB_UNCORRECTABLE (1 << 1)
+
+/** The last refresh of the block failed */
+#define NAND_SCRUB_FAILED        (1 << 2)
+
+/*---------------------------------------------------------------------- */
+/*         Types                                                         */
+/*---------------------------------------------------------------------- */
+
+/** Health of a block */
+struct _nand_scrub_block {
+	uint32_t reads;       /**< Pages read since the last erase */
+	uint8_t max_bitflips; /**< Most bits corrected in a sector since the last erase */
+	uint8_t flags;        /**< NAND_SCRUB_xxx flags */
+	uint16_t refreshes;   /**< Number of refreshes of the block */
+};
+
+/** Scrubbing statistics */
+struct _nand_scrub_stats {
+	uint32_t reads;          /**< Pages read */
+	uint32_t corrected_bits; /**< Bits corrected by ECC */
+	uint32_t uncorrectable;  /**< Pages with uncorrectable data */
+	uint32_t refreshes;      /**< Blocks refreshed or relocated */
+	uint32_t failures;       /**< Refreshes which failed */
+	uint32_t map_saves;      /**< Health map saves */
+};
+
+/** Scrubbing service instance, the fields are private */
+struct _nand_scrub {
+	struct _nand_flash *nand;
+	struct _nand_scrub_block *blocks; /**< Health of each block */
+	uint16_t num_blocks;
+	uint16_t pages_per_block;
+
+	uint16_t reserved_start;  /**< First reserved block */
+	uint16_t reserved_count;  /**< Number of reserved blocks */
+	uint16_t map_blocks[2];   /**< Blocks holding the health map */
+	uint8_t map_index;        /**< Map block holding the last map */
+	uint16_t spare_block;     /**< Block used for the refresh in place */
+	uint16_t held_block;      /**< Spare block holding the data of a failed refresh */
+	uint32_t map_seq;         /**< Sequence number of the last map */
+	uint32_t unsaved_reads;   /**< Page reads since the last map save */
+	bool save_needed;
+
+	uint32_t read_threshold;
+	uint8_t bitflip_threshold;
+
+	uint16_t cursor;          /**< Next block checked for a pending refresh */
+	uint16_t refresh_block;   /**< Block being refreshed */
+	uint16_t refresh_page;    /**< Next page to copy */
+	uint8_t state;
+
+	struct _callback relocate;
+
+	struct _nand_scrub_stats stats;
+};
+
+/*---------------------------------------------------------------------- */
+/*         Exported functions                                            */
+/*---------------------------------------------------------------------- */
+
+extern uint32_t nand_scrub_get_workspace_size(const struct _nand_flash *nand);
+
+extern uint8_t nand_scrub_initialize(struct _nand_scrub *scrub,
+		struct _nand_flash *nand, void *workspace, uint32_t workspace_size,
+		uint16_t reserved_start, uint16_t reserved_count);
+
+extern void nand_scrub_set_thresholds(struct _nand_scrub *scrub,
+		uint32_t reads, uint8_t bitflips);
+
+extern void nand_scrub_set_relocate_callback(struct _nand_scrub *scrub,
+		struct _callback *cb);
+
+extern void nand_scrub_record_read(struct _nand_scrub *scrub, uint16_t block,
+		uint16_t pages, const uint8_t *bitflips, uint32_t count,
+		bool uncorrectable);
+
+extern void nand_scrub_block_erased(struct _nand_scrub *scrub, uint16_t block);
+
+extern uint8_t nand_scrub_read_page(struct _nand_scrub *scrub,
+		uint16_t block, uint16_t page, void *data, void *spare);
+
+extern uint8_t nand_scrub_read_pages(struct _nand_scrub *scrub,
+		uint16_t block, uint16_t page, uint16_t count, void *data);
+
+extern bool nand_scrub_poll(struct _nand_scrub *scrub, uint32_t budget);
+
+extern uint8_t nand_scrub_save(struct _nand_scrub *scrub);
+
+extern const struct _nand_scrub_block *nand_scrub_get_block(
+		const struct _nand_scrub *scrub, uint16_t block);
+
+extern void nand_scrub_get_stats(const struct _nand_scrub *scrub,
+		struct _nand_scrub_stats *stats);
+
+#endif /* NAND_FLASH_SCRUB_H */
@@ -0,0 +1,812 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*---------------------------------------------------------------------- */
+/*         Headers                                                       */
+/*---------------------------------------------------------------------- */
+
+#include "nand_flash.h"
+#include "nand_flash_commands.h"
+#include "nand_flash_common.h"
+#include "nand_flash_model.h"
+#include "nand_flash_model_list.h"
+#include "nand_flash_sim.h"
+
+#include "trace.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------- */
+/*         Local definitions                                             */
+/*---------------------------------------------------------------------- */
+
+/** Size of the page and cache registers */
+#define MAX_PAGE_SIZE (NAND_MAX_PAGE_DATA_SIZE + NAND_MAX_PAGE_SPARE_SIZE)
+
+/** Size of one copy of the ONFI parameter page */
+#define PARAM_PAGE_SIZE 256
+
+/** Number of copies of the parameter page output by the device */
+#define PARAM_PAGE_COPIES 3
+
+/* Failure injected in a block */
+#define BLOCK_ERASE_FAIL   (1 << 0)
+#define BLOCK_PROGRAM_FAIL (1 << 1)
+
+/* Status register, the device is never write protected */
+#define STATUS_WP (1 << 7)
+
+/* What the data port outputs */
+enum {
+	OUT_DATA,
+	OUT_STATUS,
+	OUT_ID,
+	OUT_PARAM,
+	OUT_FEATURES,
+};
+
+struct _nand_sim {
+	bool initialized;
+	struct _nand_sim_config config;
+	struct _nand_flash_model model;
+
+	uint8_t *array;          /**< Pages, data then spare */
+	uint8_t *block_flags;    /**< Failures injected in each block */
+	uint32_t page_size;      /**< Size of a page, spare included */
+	uint32_t pages_per_block;
+	uint32_t num_pages;
+	uint16_t num_blocks;
+	uint8_t col_cycles;
+	uint8_t row_cycles;
+	bool bus16;
+
+	uint8_t cmd;             /**< Command waiting for addresses or data */
+	uint8_t addr[8];
+	uint8_t naddr;
+	uint8_t output;
+	uint8_t data_output;     /**< Output restored by a READ command */
+	uint8_t id_addr;
+	uint32_t column;         /**< Byte offset in the cache register */
+	uint32_t read_row;       /**< Page held by the page register */
+	uint32_t prog_row;       /**< Page to program */
+
+	bool fail;               /**< Status of the last program/erase */
+	bool failc;              /**< Status of the previous cache program */
+
+	uint64_t now;            /**< Virtual time, in ns */
+	uint64_t cache_busy;     /**< End of the cache register operation */
+	uint64_t array_busy;     /**< End of the array operation */
+
+	uint32_t read_bitflips;
+	uint32_t seed;
+
+	struct _nand_sim_stats stats;
+};
+
+/*---------------------------------------------------------------------- */
+/*         Exported variables                                            */
+/*---------------------------------------------------------------------- */
+
+const struct _nand_sim_config nand_sim_default_config = {
+	.id = { 0x2c, 0xf1, 0x80, 0x95, 0x02 },
+	.onfi = true,
+	.optional_commands = 0x0003,
+	.ecc_correctability = 4,
+	.timings = {
+		.t_r = 25000,
+		.t_prog = 200000,
+		.t_bers = 2000000,
+		.t_cbsy = 3000,
+		.t_rst = 5000,
+		.t_rc = 25,
+		.t_wc = 25,
+		.t_poll = 100,
+	},
+};
+
+/*---------------------------------------------------------------------- */
+/*         Local variables                                               */
+/*---------------------------------------------------------------------- */
+
+static struct _nand_sim sim;
+
+/** Cache register, holding the data input and output on the bus */
+static uint8_t cache_reg[MAX_PAGE_SIZE];
+
+/** Page register, holding the page read from the array by cache reads */
+static uint8_t page_reg[MAX_PAGE_SIZE];
+
+static uint8_t param_page[PARAM_PAGE_SIZE];
+
+/*---------------------------------------------------------------------- */
+/*         Local functions                                               */
+/*---------------------------------------------------------------------- */
+
+static uint64_t _max_u64(uint64_t a, uint64_t b)
+{
+	return a > b ? a : b;
+}
+
+static bool _cache_ready(void)
+{
+	return sim.now >= sim.cache_busy;
+}
+
+static bool _array_ready(void)
+{
+	return sim.now >= sim.array_busy;
+}
+
+static uint32_t _random(void)
+{
+	/* xorshift32 */
+	sim.seed ^= sim.seed << 13;
+	sim.seed ^= sim.seed >> 17;
+	sim.seed ^= sim.seed << 5;
+	return sim.seed;
+}
+
+static uint8_t *_page(uint32_t row)
+{
+	return sim.array + row * sim.page_size;
+}
+
+static uint32_t _get_column(void)
+{
+	uint32_t col = 0;
+	uint8_t i;
+
+	for (i = 0; i < sim.col_cycles; i++)
+		col |= sim.addr[i] << (8 * i);
+	return sim.bus16 ? col * 2 : col;
+}
+
+static uint32_t _get_row(uint8_t first)
+{
+	uint32_t row = 0;
+	uint8_t i;
+
+	for (i = 0; i < sim.row_cycles; i++)
+		row |= sim.addr[first + i] << (8 * i);
+	return row;
+}
+
+static void _put_u16(uint8_t *buf, uint16_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+}
+
+static void _put_u32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+	buf[2] = value >> 16;
+	buf[3] = value >> 24;
+}
+
+static void _put_string(uint8_t *buf, const char *str, uint32_t size)
+{
+	memset(buf, ' ', size);
+	memcpy(buf, str, strlen(str) < size ? strlen(str) : size);
+}
+
+/**
+ * \brief Builds the ONFI parameter page of the simulated device.
+ */
+static void _build_param_page(void)
+{
+	uint16_t crc = 0x4f4e;
+	int i, j;
+
+	memset(param_page, 0, sizeof(param_page));
+	memcpy(param_page, "ONFI", 4);
+	_put_u16(param_page + 4, 1 << 1);   /* ONFI 1.0 */
+	_put_u16(param_page + 6, sim.bus16 ? 1 : 0);
+	_put_u16(param_page + 8, sim.config.optional_commands);
+	_put_string(param_page + 32, "SIMULATOR", 12);
+	_put_string(param_page + 44, "NAND SIM", 20);
+	param_page[64] = sim.config.id[0];
+	_put_u32(param_page + 80, sim.model.page_size);
+	_put_u16(param_page + 84, sim.model.spare_size);
+	_put_u32(param_page + 92, sim.pages_per_block);
+	_put_u32(param_page + 96, sim.num_blocks);
+	param_page[100] = 1;
+	param_page[101] = (sim.col_cycles << 4) | sim.row_cycles;
+	param_page[112] = sim.config.ecc_correctability;
+
+	/* CRC-16 of bytes 0 to 253, polynomial 0x8005 */
+	for (i = 0; i < 254; i++) {
+		crc ^= param_page[i] << 8;
+		for (j = 0; j < 8; j++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+	}
+	_put_u16(param_page + 254, crc);
+}
+
+/**
+ * \brief Loads a page of the array in the page register, with the bitflips
+ * injected by read disturb.
+ */
+static void _load_page(uint32_t row)
+{
+	uint32_t i, bit;
+
+	memcpy(page_reg, _page(row), sim.page_size);
+	for (i = 0; i < sim.read_bitflips; i++) {
+		bit = _random() % (sim.page_size * 8);
+		page_reg[bit / 8] ^= 1 << (bit % 8);
+	}
+	sim.stats.bitflips += sim.read_bitflips;
+	sim.read_row = row;
+}
+
+static void _read_page(void)
+{
+	uint32_t row = _get_row(sim.col_cycles);
+
+	if (sim.naddr < sim.col_cycles + sim.row_cycles || row >= sim.num_pages) {
+		trace_warning("nand_sim: bad read address\r\n");
+		return;
+	}
+
+	_load_page(row);
+	memcpy(cache_reg, page_reg, sim.page_size);
+	sim.array_busy = sim.now + sim.config.timings.t_r;
+	sim.cache_busy = sim.array_busy;
+	sim.column = _get_column();
+	sim.output = OUT_DATA;
+	sim.data_output = OUT_DATA;
+	sim.stats.page_reads++;
+}
+
+/**
+ * \brief Moves the page register to the cache register, and reads the next
+ * page in the background for a sequential cache read.
+ */
+static void _cache_read(bool sequential)
+{
+	uint64_t start = _max_u64(sim.now, sim.array_busy);
+
+	memcpy(cache_reg, page_reg, sim.page_size);
+	sim.cache_busy = start + sim.config.timings.t_cbsy;
+	if (sequential && sim.read_row + 1 < sim.num_pages) {
+		_load_page(sim.read_row + 1);
+		sim.array_busy = start + sim.config.timings.t_r;
+	} else {
+		sim.array_busy = sim.cache_busy;
+	}
+	sim.column = 0;
+	sim.output = OUT_DATA;
+	sim.data_output = OUT_DATA;
+	sim.stats.cache_reads++;
+}
+
+/**
+ * \brief Programs the cache register, only clearing bits as a real device.
+ */
+static void _program(bool cache)
+{
+	uint64_t start = _max_u64(sim.now, sim.array_busy);
+	uint8_t *page;
+	bool failed;
+	uint32_t i;
+
+	if ((sim.cmd != NAND_CMD_WRITE_1 && sim.cmd != NAND_CMD_RANDOM_IN) ||
+	    sim.prog_row >= sim.num_pages) {
+		trace_warning("nand_sim: program without page address\r\n");
+		return;
+	}
+
+	failed = sim.block_flags[sim.prog_row / sim.pages_per_block] &
+		BLOCK_PROGRAM_FAIL;
+	if (!failed) {
+		page = _page(sim.prog_row);
+		for (i = 0; i < sim.page_size; i++)
+			page[i] &= cache_reg[i];
+	} else {
+		sim.stats.failures++;
+	}
+
+	sim.failc = sim.fail;
+	sim.fail = failed;
+	sim.array_busy = start + sim.config.timings.t_prog;
+	if (cache) {
+		sim.cache_busy = start + sim.config.timings.t_cbsy;
+		sim.stats.cache_programs++;
+	} else {
+		sim.cache_busy = sim.array_busy;
+		sim.stats.page_programs++;
+	}
+	sim.cmd = 0;
+}
+
+static void _erase(void)
+{
+	uint32_t row = _get_row(0);
+	uint32_t block = row / sim.pages_per_block;
+
+	if (sim.cmd != NAND_CMD_ERASE_1 || sim.naddr < sim.row_cycles ||
+	    block >= sim.num_blocks) {
+		trace_warning("nand_sim: bad erase address\r\n");
+		return;
+	}
+
+	sim.fail = sim.block_flags[block] & BLOCK_ERASE_FAIL;
+	if (!sim.fail)
+		memset(_page(block * sim.pages_per_block), 0xff,
+				sim.pages_per_block * sim.page_size);
+	else
+		sim.stats.failures++;
+
+	sim.array_busy = sim.now + sim.config.timings.t_bers;
+	sim.cache_busy = sim.array_busy;
+	sim.stats.erases++;
+	sim.cmd = 0;
+}
+
+static uint8_t _status(void)
+{
+	uint8_t status = STATUS_WP;
+
+	if (_cache_ready())
+		status |= NAND_STATUS_RDY;
+	if (_array_ready())
+		status |= NAND_STATUS_ARDY;
+	if (sim.fail)
+		status |= NAND_STATUS_FAIL;
+	if (sim.failc)
+		status |= NAND_STATUS_FAILC;
+	return status;
+}
+
+/**
+ * \brief Returns the next byte output by the device, without the bus cycle.
+ */
+static uint8_t _output_byte(void)
+{
+	uint8_t value;
+
+	switch (sim.output) {
+	case OUT_STATUS:
+		sim.stats.status_reads++;
+		if (!_cache_ready())
+			sim.stats.busy_polls++;
+		return _status();
+	case OUT_ID:
+		if (sim.id_addr == 0x20)
+			value = sim.config.onfi && sim.column < 4 ?
+				"ONFI"[sim.column] : 0;
+		else
+			value = sim.column < sizeof(sim.config.id) ?
+				sim.config.id[sim.column] : 0;
+		sim.column++;
+		return value;
+	case OUT_PARAM:
+		value = param_page[sim.column % PARAM_PAGE_SIZE];
+		sim.column = (sim.column + 1) % (PARAM_PAGE_SIZE * PARAM_PAGE_COPIES);
+		return value;
+	case OUT_FEATURES:
+		return 0;
+	default:
+		sim.stats.bytes_out++;
+		value = sim.column < sim.page_size ? cache_reg[sim.column] : 0xff;
+		sim.column++;
+		return value;
+	}
+}
+
+static void _input_byte(uint8_t value)
+{
+	if (sim.cmd != NAND_CMD_WRITE_1 && sim.cmd != NAND_CMD_RANDOM_IN)
+		return;
+	sim.stats.bytes_in++;
+	if (sim.column < sim.page_size)
+		cache_reg[sim.column] = value;
+	sim.column++;
+}
+
+/**
+ * \brief Time of a status read: a polling loop waiting for the device is
+ * slower than the bus.
+ */
+static uint32_t _read_cycle(void)
+{
+	if (sim.output == OUT_STATUS && !_cache_ready())
+		return sim.config.timings.t_poll;
+	return sim.config.timings.t_rc;
+}
+
+/*---------------------------------------------------------------------- */
+/*         Exported functions                                            */
+/*---------------------------------------------------------------------- */
+
+/**
+ * \brief Returns the size of the storage needed to simulate a device, or 0
+ * if its READ ID bytes do not match a known model.
+ * \param config  Simulated device.
+ */
+uint32_t nand_sim_get_storage_size(const struct _nand_sim_config *config)
+{
+	struct _nand_flash_model model;
+	uint32_t chip_id = config->id[0] | (config->id[1] << 8) |
+		(config->id[2] << 16) | ((uint32_t)config->id[3] << 24);
+
+	if (nand_model_list_find(chip_id, &model))
+		return 0;
+
+	return nand_model_get_device_size_in_pages(&model) *
+		(model.page_size + model.spare_size) +
+		nand_model_get_device_size_in_blocks(&model);
+}
+
+/**
+ * \brief Initializes the simulator, with an erased device.
+ * \param config  Simulated device, see nand_sim_default_config.
+ * \param storage  Storage of the device content.
+ * \param storage_size  Size of the storage, at least
+ * nand_sim_get_storage_size().
+ * \return 0 if successful; otherwise returns an error code.
+ */
+uint8_t nand_sim_initialize(const struct _nand_sim_config *config,
+		void *storage, uint32_t storage_size)
+{
+	uint32_t chip_id = config->id[0] | (config->id[1] << 8) |
+		(config->id[2] << 16) | ((uint32_t)config->id[3] << 24);
+	uint32_t size;
+
+	memset(&sim, 0, sizeof(sim));
+	sim.config = *config;
+
+	if (nand_model_list_find(chip_id, &sim.model))
+		return NAND_ERROR_UNKNOWNMODEL;
+
+	sim.page_size = sim.model.page_size + sim.model.spare_size;
+	sim.pages_per_block = nand_model_get_block_size_in_pages(&sim.model);
+	sim.num_pages = nand_model_get_device_size_in_pages(&sim.model);
+	sim.num_blocks = nand_model_get_device_size_in_blocks(&sim.model);
+	sim.bus16 = sim.model.data_bus_width == 16;
+	if (sim.page_size > MAX_PAGE_SIZE)
+		return NAND_ERROR_INVALID_ARG;
+
+	if (storage_size < nand_sim_get_storage_size(config))
+		return NAND_ERROR_INVALID_ARG;
+
+	/* Same number of address cycles as the raw layer */
+	for (size = sim.model.page_size; size > 2; size >>= 8)
+		sim.col_cycles++;
+	for (size = sim.num_pages; size > 0; size >>= 8)
+		sim.row_cycles++;
+
+	sim.array = storage;
+	sim.block_flags = sim.array + sim.num_pages * sim.page_size;
+	memset(sim.array, 0xff, sim.num_pages * sim.page_size);
+	memset(sim.block_flags, 0, sim.num_blocks);
+
+	sim.seed = 1;
+	sim.output = OUT_STATUS;
+	_build_param_page();
+	sim.initialized = true;
+
+	return 0;
+}
+
+/**
+ * \brief Writes the factory bad block marker of a block.
+ * \param block  Block number.
+ */
+void nand_sim_set_bad_block(uint16_t block)
+{
+	uint32_t pos = nand_model_has_small_blocks(&sim.model) ? 5 : 0;
+	uint32_t row = block * sim.pages_per_block;
+
+	if (block >= sim.num_blocks)
+		return;
+
+	_page(row)[sim.model.page_size + pos] = 0;
+	_page(row + 1)[sim.model.page_size + pos] = 0;
+}
+
+/**
+ * \brief Makes the erase and/or the program operations of a block fail.
+ * \param block  Block number.
+ * \param erase  Whether erases fail.
+ * \param program  Whether programs fail.
+ */
+void nand_sim_set_block_failure(uint16_t block, bool erase, bool program)
+{
+	if (block >= sim.num_blocks)
+		return;
+
+	sim.block_flags[block] = (erase ? BLOCK_ERASE_FAIL : 0) |
+		(program ? BLOCK_PROGRAM_FAIL : 0);
+}
+
+/**
+ * \brief Flips a bit stored in the array (e.g. charge loss).
+ * \param block  Block number.
+ * \param page  Page number in the block.
+ * \param bit  Bit number in the page, spare included.
+ */
+void nand_sim_flip_bit(uint16_t block, uint16_t page, uint32_t bit)
+{
+	if (block >= sim.num_blocks || page >= sim.pages_per_block ||
+	    bit >= sim.page_size * 8)
+		return;
+
+	_page(block * sim.pages_per_block + page)[bit / 8] ^= 1 << (bit % 8);
+}
+
+/**
+ * \brief Flips bits at random in each page read, leaving the array intact
+ * (read disturb).
+ * \param bits  Number of bits flipped in each page read.
+ * \param seed  Seed of the pseudo random generator, not 0.
+ */
+void nand_sim_set_read_bitflips(uint32_t bits, uint32_t seed)
+{
+	sim.read_bitflips = bits;
+	sim.seed = seed ? seed : 1;
+}
+
+/**
+ * \brief Returns the virtual time of the simulator, in ns.
+ */
+uint64_t nand_sim_get_time(void)
+{
+	return sim.now;
+}
+
+/**
+ * \brief Advances the virtual time, e.g. from a sleep function.
+ * \param ns  Time to add, in ns.
+ */
+void nand_sim_advance_time(uint64_t ns)
+{
+	sim.now += ns;
+}
+
+/**
+ * \brief Returns the simulator statistics.
+ */
+void nand_sim_get_stats(struct _nand_sim_stats *stats)
+{
+	*stats = sim.stats;
+}
+
+/**
+ * \brief Clears the simulator statistics.
+ */
+void nand_sim_reset_stats(void)
+{
+	memset(&sim.stats, 0, sizeof(sim.stats));
+}
+
+/*---------------------------------------------------------------------- */
+/*         Bus access functions (see nand_flash.h)                       */
+/*---------------------------------------------------------------------- */
+
+/**
+ * \brief Initializes a _nand_flash instance for the simulated device.
+ * \param nand  Pointer to a _nand_flash instance.
+ * \returns 0 if initialization is successful; otherwise returns non-zero
+ */
+uint8_t nand_initialize(struct _nand_flash *nand)
+{
+	if (!sim.initialized) {
+		trace_warning("nand_sim: simulator not initialized\r\n");
+		return NAND_ERROR_INVALID_ARG;
+	}
+
+	nand->data_addr = 0;
+	memset(&nand->model, 0, sizeof(nand->model));
+	return 0;
+}
+
+void nand_write_command(const struct _nand_flash *nand, uint8_t command)
+{
+	sim.now += sim.config.timings.t_wc;
+
+	switch (command) {
+	case NAND_CMD_STATUS:
+		sim.output = OUT_STATUS;
+		break;
+	case NAND_CMD_READ_1:
+		/* Also returns to data output after a status read */
+		sim.cmd = command;
+		sim.naddr = 0;
+		sim.output = sim.data_output;
+		break;
+	case NAND_CMD_RANDOM_OUT:
+	case NAND_CMD_ERASE_1:
+	case NAND_CMD_SET_FEATURES:
+		sim.cmd = command;
+		sim.naddr = 0;
+		break;
+	case NAND_CMD_READ_2:
+	case NAND_CMD_COPYBACK_READ_2:
+		_read_page();
+		break;
+	case NAND_CMD_READ_CACHE_SEQ:
+		_cache_read(true);
+		break;
+	case NAND_CMD_READ_CACHE_END:
+		_cache_read(false);
+		break;
+	case NAND_CMD_RANDOM_OUT_2:
+		sim.column = _get_column();
+		sim.output = OUT_DATA;
+		sim.data_output = OUT_DATA;
+		break;
+	case NAND_CMD_WRITE_1:
+		memset(cache_reg, 0xff, sim.page_size);
+		/* fall through */
+	case NAND_CMD_RANDOM_IN:
+		sim.cmd = command;
+		sim.naddr = 0;
+		break;
+	case NAND_CMD_WRITE_2:
+		_program(false);
+		break;
+	case NAND_CMD_WRITE_CACHE:
+		_program(true);
+		break;
+	case NAND_CMD_ERASE_2:
+		_erase();
+		break;
+	case NAND_CMD_READID:
+	case NAND_CMD_READ_PARAM_PAGE:
+		sim.cmd = command;
+		sim.naddr = 0;
+		break;
+	case NAND_CMD_GET_FEATURES:
+		sim.cmd = command;
+		sim.naddr = 0;
+		sim.output = OUT_FEATURES;
+		break;
+	case NAND_CMD_RESET:
+		sim.cmd = 0;
+		sim.fail = false;
+		sim.failc = false;
+		sim.array_busy = _max_u64(sim.now, sim.array_busy) +
+			sim.config.timings.t_rst;
+		sim.cache_busy = sim.array_busy;
+		sim.output = OUT_STATUS;
+		break;
+	default:
+		trace_warning("nand_sim: unsupported command 0x%02x\r\n", command);
+		break;
+	}
+}
+
+void nand_write_command16(const struct _nand_flash *nand, uint16_t command)
+{
+	nand_write_command(nand, command & 0xff);
+}
+
+void nand_write_address(const struct _nand_flash *nand, uint8_t address)
+{
+	sim.now += sim.config.timings.t_wc;
+
+	if (sim.naddr < sizeof(sim.addr))
+		sim.addr[sim.naddr++] = address;
+
+	switch (sim.cmd) {
+	case NAND_CMD_WRITE_1:
+	case NAND_CMD_RANDOM_IN:
+		/* Column, then page for a program or copy-back program */
+		if (sim.naddr == sim.col_cycles)
+			sim.column = _get_column();
+		else if (sim.naddr == sim.col_cycles + sim.row_cycles)
+			sim.prog_row = _get_row(sim.col_cycles);
+		break;
+	case NAND_CMD_READID:
+		sim.id_addr = address;
+		sim.column = 0;
+		sim.output = OUT_ID;
+		break;
+	case NAND_CMD_READ_PARAM_PAGE:
+		sim.array_busy = sim.now + sim.config.timings.t_r;
+		sim.cache_busy = sim.array_busy;
+		sim.column = 0;
+		sim.output = OUT_PARAM;
+		sim.data_output = OUT_PARAM;
+		break;
+	case NAND_CMD_SET_FEATURES:
+		sim.array_busy = sim.now + sim.config.timings.t_cbsy;
+		sim.cache_busy = sim.array_busy;
+		break;
+	}
+}
+
+void nand_write_address16(const struct _nand_flash *nand, uint16_t address)
+{
+	nand_write_address(nand, address & 0xff);
+}
+
+void nand_write_data(const struct _nand_flash *nand, uint8_t data)
+{
+	sim.now += sim.config.timings.t_wc;
+	_input_byte(data);
+}
+
+void nand_write_data16(const struct _nand_flash *nand, uint16_t data)
+{
+	sim.now += sim.config.timings.t_wc;
+	_input_byte(data & 0xff);
+	_input_byte(data >> 8);
+}
+
+uint8_t nand_read_data(const struct _nand_flash *nand)
+{
+	sim.now += _read_cycle();
+	return _output_byte();
+}
+
+uint16_t nand_read_data16(const struct _nand_flash *nand)
+{
+	uint16_t value;
+
+	sim.now += _read_cycle();
+	value = _output_byte();
+	if (sim.output == OUT_STATUS)
+		return value;
+	return value | (_output_byte() << 8);
+}
+
+void nand_read_data_buffer(const struct _nand_flash *nand,
+		uint8_t *buffer, uint32_t size)
+{
+	uint32_t cycles = sim.bus16 ? (size + 1) >> 1 : size;
+
+	if (sim.output == OUT_DATA && sim.column + size <= sim.page_size) {
+		memcpy(buffer, cache_reg + sim.column, size);
+		sim.column += size;
+		sim.stats.bytes_out += size;
+		sim.now += (uint64_t)cycles * sim.config.timings.t_rc;
+		return;
+	}
+
+	while (size--) {
+		sim.now += _read_cycle();
+		*buffer++ = _output_byte();
+	}
+}
+
+void nand_write_data_buffer(const struct _nand_flash *nand,
+		const uint8_t *buffer, uint32_t size)
+{
+	uint32_t cycles = sim.bus16 ? (size + 1) >> 1 : size;
+
+	sim.now += (uint64_t)cycles * sim.config.timings.t_wc;
+	while (size--)
+		_input_byte(*buffer++);
+}
@@ -0,0 +1,151 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \page sim_nand_page NandFlash simulator
+ *
+ * \section Purpose
+ *
+ * The simulator replaces the NANDFLASH bus access functions of nand_flash.c
+ * (commands, addresses and data) by a device model held in memory, so that
+ * the raw, skip-block, ECC (without PMECC) and scrubbing layers can run
+ * without a NANDFLASH device: on a board from RAM, or on a development host
+ * with the layers built by the native compiler.
+ *
+ * The simulated device decodes the command set used by the raw layer (reads,
+ * cache reads, programs, cache programs, copy-back, erases, status, READ ID,
+ * ONFI parameter page, features and reset). Its geometry comes from the
+ * NANDFLASH model list, from its READ ID bytes. Array operations keep the
+ * device busy on a virtual clock (tR, tPROG, tBERS...), which also advances
+ * with each bus cycle, so nand_sim_get_time() gives the time an operation
+ * would take on the device. Bad blocks, failing blocks and bitflips can be
+ * injected.
+ *
+ * The data goes through the CPU only: DMA, NFC and PMECC, which access the
+ * bus directly, cannot be used with the simulator.
+ *
+ * \section Usage
+ *
+ * -# Build with CONFIG_HAVE_NAND_FLASH_SIM, which removes the bus access
+ *      functions of nand_flash.c.
+ * -# Allocate nand_sim_get_storage_size() bytes, call nand_sim_initialize(),
+ *      then use the NANDFLASH layers as usual, starting with nand_initialize()
+ *      and nand_raw_initialize().
+ * -# On a host, timer_get_tick() / timer_timeout_reached() and sleep functions
+ *      should be based on nand_sim_get_time() and nand_sim_advance_time().
+ *
+ * The host test and benchmark in tests/nand_flash_sim show such a set-up.
+ */
+
+#ifndef NAND_FLASH_SIM_H
+#define NAND_FLASH_SIM_H
+
+/*---------------------------------------------------------------------- */
+/*         Headers                                                       */
+/*---------------------------------------------------------------------- */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------- */
+/*         Types                                                         */
+/*---------------------------------------------------------------------- */
+
+/** Timings of the simulated device, in ns */
+struct _nand_sim_timings {
+	uint32_t t_r;     /**< Page read from the array */
+	uint32_t t_prog;  /**< Page program */
+	uint32_t t_bers;  /**< Block erase */
+	uint32_t t_cbsy;  /**< Cache busy time of cache reads/programs */
+	uint32_t t_rst;   /**< Reset */
+	uint32_t t_rc;    /**< Read cycle of the bus */
+	uint32_t t_wc;    /**< Write cycle of the bus */
+	uint32_t t_poll;  /**< Status read of a polling loop */
+};
+
+/** Simulated device */
+struct _nand_sim_config {
+	uint8_t id[5];              /**< READ ID bytes, the second one selects
+	                                 the model in the NANDFLASH model list */
+	bool onfi;                  /**< Answer the ONFI signature and parameter page */
+	uint16_t optional_commands; /**< ONFI optional commands (bit 0: cache
+	                                 program, bit 1: cache read) */
+	uint8_t ecc_correctability; /**< ECC bits required, in the parameter page */
+	struct _nand_sim_timings timings;
+};
+
+/** Simulator statistics */
+struct _nand_sim_stats {
+	uint32_t page_reads;     /**< Pages read from the array */
+	uint32_t cache_reads;    /**< Pages read with cache read commands */
+	uint32_t page_programs;  /**< Pages programmed */
+	uint32_t cache_programs; /**< Pages programmed with cache program commands */
+	uint32_t erases;         /**< Blocks erased */
+	uint32_t failures;       /**< Program or erase operations which failed */
+	uint32_t status_reads;   /**< Status bytes read */
+	uint32_t busy_polls;     /**< Status bytes read while busy */
+	uint64_t bytes_in;       /**< Data bytes written to the device */
+	uint64_t bytes_out;      /**< Data bytes read from the device */
+	uint32_t bitflips;       /**< Bits flipped by read disturb injection */
+};
+
+/*---------------------------------------------------------------------- */
+/*         Exported variables                                            */
+/*---------------------------------------------------------------------- */
+
+/** 1 Gbit ONFI device with 2 KB pages, 64 byte spare, 64 pages per block,
+ * cache read and cache program */
+extern const struct _nand_sim_config nand_sim_default_config;
+
+/*---------------------------------------------------------------------- */
+/*         Exported functions                                            */
+/*---------------------------------------------------------------------- */
+
+extern uint32_t nand_sim_get_storage_size(const struct _nand_sim_config *config);
+
+extern uint8_t nand_sim_initialize(const struct _nand_sim_config *config,
+		void *storage, uint32_t storage_size);
+
+extern void nand_sim_set_bad_block(uint16_t block);
+
+extern void nand_sim_set_block_failure(uint16_t block, bool erase, bool program);
+
+extern void nand_sim_flip_bit(uint16_t block, uint16_t page, uint32_t bit);
+
+extern void nand_sim_set_read_bitflips(uint32_t bits, uint32_t seed);
+
+extern uint64_t nand_sim_get_time(void);
+
+extern void nand_sim_advance_time(uint64_t ns);
+
+extern void nand_sim_get_stats(struct _nand_sim_stats *stats);
+
+extern void nand_sim_reset_stats(void);
+
+#endif /* NAND_FLASH_SIM_H */
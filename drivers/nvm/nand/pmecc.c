@@ -106,53 +106,63 @@ static struct _pmecc_desc pmecc_desc;
 
  /**
  * \brief Build the pseudo syndromes table
- * \param sector Targetted sector.
+ * \param remainder Remainders of the targetted sector.
  */
-static void gen_partial_syndromes(uint32_t sector)
+static void gen_partial_syndromes(const volatile int16_t *remainder)
 {
 	uint32_t i;
-	volatile int16_t *remainder;
-
-	remainder = (volatile int16_t*)&PMECC->PMECC_REM[sector];
 
 	/* Fill odd syndromes */
 	for (i = 0; i < pmecc_desc.tt; i++)
 		pmecc_desc.partial_syn[1 + (2 * i)] = remainder[i];
 }
 
+/**
+ * \brief Reduce a sum of two field element indexes modulo nn.
+ * \param x Sum of indexes, must be less than 2 * nn.
+ */
+static inline int32_t gf_mod(int32_t x, int32_t nn)
+{
+	return x >= nn ? x - nn : x;
+}
+
 /**
  * \brief The substitute function evaluates the polynomial remainder,
  * with different values of the field primitive elements.
  */
 static uint32_t substitute(void)
 {
-	int32_t i, j;
-	int16_t *si;
-	int16_t *partial_syn = pmecc_desc.partial_syn;
+	int32_t i;
+	int16_t *si = pmecc_desc.si;
+	const int16_t *partial_syn = pmecc_desc.partial_syn;
 	const int16_t *alpha_to = pmecc_desc.alpha_to;
 	const int16_t *index_of = pmecc_desc.index_of;
+	const int32_t nn = pmecc_desc.nn;
+	const uint32_t mask = (1u << pmecc_desc.mm) - 1;
 
-	/* si[] is a table that holds the current syndrome value, an element of that table belongs to the field.*/
-	memset(pmecc_desc.si, 0, sizeof(pmecc_desc.si));
-	si = pmecc_desc.si;
+	si[0] = 0;
 
 	/* Computation 2t syndromes based on S(x) */
-	/* Odd syndromes */
+	/* Odd syndromes: only visit the bits set in the remainder. As
+	 * i * j < 2 * tt * mm < nn, no reduction is needed. */
 	for (i = 1; i <= 2 * pmecc_desc.tt - 1; i = i + 2) {
-		si[i] = 0;
-		for (j = 0; j < pmecc_desc.mm; j++) {
-			if (partial_syn[i] & ((uint16_t)0x1 << j))
-				si[i] = alpha_to[(i * j)] ^ si[i];
+		uint32_t rem = (uint16_t)partial_syn[i] & mask;
+		int32_t exp = 0;
+		int16_t syn = 0;
+
+		while (rem) {
+			if (rem & 1)
+				syn ^= alpha_to[exp];
+			rem >>= 1;
+			exp += i;
 		}
+		si[i] = syn;
 	}
 	/* Even syndrome = (Odd syndrome) ** 2 */
 	for (i = 2; i <= 2 * pmecc_desc.tt; i = i + 2) {
-		j = i / 2;
-		if (si[j] == 0) {
-			si[i] = 0;
-		} else {
-			si[i] = alpha_to[(2 * index_of[si[j]]) % pmecc_desc.nn];
-		}
+		int16_t syn = si[i / 2];
+
+		si[i] = syn ? alpha_to[gf_mod(2 * index_of[syn], nn)] : 0;
 	}
 	return 0;
 }
@@ -167,7 +177,11 @@ static uint32_t get_sigma(void)
 	int32_t i, j, k;
 	int16_t *lmu = pmecc_desc.lmu;
 	int16_t *si = pmecc_desc.si;
+	int16_t (*smu)[2 * PMECC_NB_ERROR_MAX + 1] = pmecc_desc.smu;
 	int16_t tt = pmecc_desc.tt;
+	const int16_t *alpha_to = pmecc_desc.alpha_to;
+	const int16_t *index_of = pmecc_desc.index_of;
+	const int32_t nn = pmecc_desc.nn;
 
 	int32_t mu[PMECC_NB_ERROR_MAX + 1]; /* mu */
 	int32_t dmu[PMECC_NB_ERROR_MAX + 1]; /* discrepancy */
@@ -184,10 +198,8 @@ static uint32_t get_sigma(void)
 	mu[0]  = -1;
 	/* Actually -1/2 */
 	/* Sigma(x) set to 1 */
-
-	for (i = 0; i < (2 * PMECC_NB_ERROR_MAX + 1); i++)
-		pmecc_desc.smu[0][i] = 0;
-	pmecc_desc.smu[0][0] = 1;
+	smu[0][0] = 1;
+	smu[0][1] = 0;
 
 	/* discrepancy set to 1 */
 	dmu[0] = 1;
@@ -204,9 +216,8 @@ static uint32_t get_sigma(void)
 	mu[1] = 0;
 
 	/* Sigma(x) set to 1 */
-	for (i = 0; i < (2 * PMECC_NB_ERROR_MAX + 1); i++)
-		pmecc_desc.smu[1][i] = 0;
-	pmecc_desc.smu[1][0] = 1;
+	smu[1][0] = 1;
+	smu[1][1] = 0;
 
 	/* discrepancy set to S1 */
 	dmu[1] = si[1];
@@ -218,8 +229,8 @@ static uint32_t get_sigma(void)
 	delta[1]  = (mu[1] * 2 - lmu[1]) >> 1;
 
 	/* Init the Sigma(x) last row */
-	for (i = 0; i < (2 * PMECC_NB_ERROR_MAX + 1); i++)
-		pmecc_desc.smu[tt + 1][i] = 0;
+	for (i = 0; i <= tt + 1; i++)
+		smu[tt + 1][i] = 0;
 
 	for (i = 1; i <= tt; i++) {
 		mu[i+1] = i << 1;
@@ -232,14 +243,14 @@ static uint32_t get_sigma(void)
 			if ((tt - (lmu[i] >> 1) - 1) & 0x1) {
 				if (dmu_0_count == (uint32_t)((tt - (lmu[i] >> 1) - 1) / 2) + 2) {
 					for (j = 0; j <= (lmu[i] >> 1) + 1; j++)
-						pmecc_desc.smu[tt+1][j] = pmecc_desc.smu[i][j];
+						smu[tt+1][j] = smu[i][j];
 					lmu[tt + 1] = lmu[i];
 					return 0;
 				}
 			} else {
 				if (dmu_0_count == (uint32_t)((tt - (lmu[i] >> 1) - 1) / 2) + 1) {
 					for (j = 0; j <= (lmu[i] >> 1) + 1; j++)
-						pmecc_desc.smu[tt + 1][j] = pmecc_desc.smu[i][j];
+						smu[tt + 1][j] = smu[i][j];
 					lmu[tt + 1] = lmu[i];
 					return 0;
 				}
@@ -247,11 +258,14 @@ static uint32_t get_sigma(void)
 
 			/* copy polynom */
 			for (j = 0; j <= (lmu[i] >> 1); j++)
-				pmecc_desc.smu[i + 1][j] = pmecc_desc.smu[i][j];
+				smu[i + 1][j] = smu[i][j];
+			smu[i + 1][j] = 0;
 
 			/* copy previous polynom order to the next */
 			lmu[i + 1] = lmu[i];
 		} else {
+			int32_t log_ratio;
+
 			/* find largest delta with dmu != 0 */
 			ro = 0;
 			largest = -1;
@@ -273,19 +287,19 @@ static uint32_t get_sigma(void)
 			else
 				lmu[i + 1] = ((lmu[ro] >> 1) + diff) * 2;
 
-			/* Init smu[i+1] with 0 */
-			for (k = 0; k < (2 * PMECC_NB_ERROR_MAX + 1); k++)
-				pmecc_desc.smu[i+1][k] = 0;
+			/* Init smu[i+1] with 0, up to its degree */
+			for (k = 0; k <= (lmu[i + 1] >> 1) + 1; k++)
+				smu[i + 1][k] = 0;
 
-			/* Compute smu[i+1] */
+			/* Compute smu[i+1] = smu[i] + (dmu[i] / dmu[ro]) * x^diff * smu[ro],
+			 * the division being done once in the log domain */
+			log_ratio = gf_mod(index_of[dmu[i]] + nn - index_of[dmu[ro]], nn);
 			for (k = 0; k <= (lmu[ro] >> 1); k++) {
-				if (pmecc_desc.smu[ro][k] && dmu[i])
-					pmecc_desc.smu[i + 1][k + diff] = pmecc_desc.alpha_to[(pmecc_desc.index_of[dmu[i]] +
-							(pmecc_desc.nn - pmecc_desc.index_of[dmu[ro]]) +
-							pmecc_desc.index_of[pmecc_desc.smu[ro][k]]) % pmecc_desc.nn];
+				if (smu[ro][k])
+					smu[i + 1][k + diff] = alpha_to[gf_mod(log_ratio + index_of[smu[ro][k]], nn)];
 			}
 			for (k = 0; k <= (lmu[i] >> 1); k++)
-				pmecc_desc.smu[i+1][k] ^= pmecc_desc.smu[i][k];
+				smu[i + 1][k] ^= smu[i][k];
 		}
 
 		/*************************************************/
@@ -297,13 +311,13 @@ static uint32_t get_sigma(void)
 
 		/* Do not compute discrepancy for the last iteration */
 		if (i < tt) {
-			for (k = 0 ; k <= (lmu[i + 1] >> 1); k++) {
-				if (k == 0)
-					dmu[i + 1] = si[2 * (i - 1) + 3];
+			const int16_t *syn = &si[2 * (i - 1) + 3];
+
+			dmu[i + 1] = syn[0];
+			for (k = 1; k <= (lmu[i + 1] >> 1); k++) {
 				/* check if one operand of the multiplier is null, its index is -1 */
-				else if (pmecc_desc.smu[i+1][k] && si[2 * (i - 1) + 3 - k])
-					dmu[i + 1] = pmecc_desc.alpha_to[(pmecc_desc.index_of[pmecc_desc.smu[i + 1][k]] +
-							pmecc_desc.index_of[si[2 * (i - 1) + 3 - k]]) % pmecc_desc.nn] ^ dmu[i + 1];
+				if (smu[i + 1][k] && syn[-k])
+					dmu[i + 1] ^= alpha_to[gf_mod(index_of[smu[i + 1][k]] + index_of[syn[-k]], nn)];
 			}
 		}
 	}
@@ -345,6 +359,25 @@ static int32_t error_location(uint32_t sector_size_in_bits)
 	return -1;
 }
 
+/**
+ * \brief Count the bits cleared in a buffer, up to a limit.
+ * \param buffer Buffer to check.
+ * \param size Size of the buffer in bytes.
+ * \param limit Count at which to stop.
+ * \return Number of bits at 0, or a value greater than \a limit.
+ */
+static uint32_t count_zero_bits(const uint8_t *buffer, uint32_t size,
+		uint32_t limit)
+{
+	uint32_t i, count = 0;
+
+	for (i = 0; i < size && count <= limit; i++)
+		if (buffer[i] != 0xff)
+			count += 8 - __builtin_popcount(buffer[i]);
+
+	return count;
+}
+
 /**
  * \brief Correct errors indicated in the PMECCEL error location registers.
  * \param sector_base_address Base address of the sector.
@@ -733,6 +766,14 @@ uint32_t pmecc_get_ecc_bytes_per_page(void)
 	return pmecc_get_ecc_end_address() - pmecc_get_ecc_start_address();
 }
 
+/**
+ * \brief Return the number of errors PMECC can correct in a sector.
+ */
+uint32_t pmecc_get_errors_per_sector(void)
+{
+	return pmecc_desc.tt;
+}
+
 /**
  * \brief Return PMECC ecc start address.
  */
@@ -767,10 +808,11 @@ uint32_t pmecc_correction(uint32_t pmecc_status, uint32_t page_buffer)
 	/* Set the sector size (512 or 1024 bytes) */
 	PMERRLOC->PMERRLOC_CFG = sector_size == 1024 ? PMERRLOC_CFG_SECTORSZ : 0;
 
-	for (sector = 0; sector < sector_count; sector++) {
+	/* Only the sectors flagged by the status need a decode */
+	for (sector = 0; sector < sector_count && pmecc_status; sector++) {
 		if (pmecc_status & 1) {
 			sector_base_address = page_buffer + sector * sector_size;
-			gen_partial_syndromes(sector);
+			gen_partial_syndromes((volatile int16_t*)&PMECC->PMECC_REM[sector]);
 			substitute();
 			get_sigma();
 			error_nbr = error_location(sector_size * 8 + pmecc_desc.tt * pmecc_desc.mm); /* number of bits of the sector + ecc */
@@ -784,3 +826,101 @@ uint32_t pmecc_correction(uint32_t pmecc_status, uint32_t page_buffer)
 
 	return 0;
 }
+
+/**
+ * \brief Save the status and the remainders of the page which has just been
+ * read, so that the PMECC can process the next page while this one is
+ * corrected with pmecc_correct_snapshot().
+ * Must be called once the PMECC is ready (see pmecc_wait_ready()).
+ * \param snapshot Storage for the PMECC state.
+ */
+void pmecc_save_snapshot(struct _pmecc_snapshot *snapshot)
+{
+	uint32_t sector, i, status;
+
+	status = pmecc_error_status();
+	snapshot->status = status;
+
+	for (sector = 0; status; sector++, status >>= 1) {
+		volatile int16_t *remainder;
+
+		if (!(status & 1))
+			continue;
+		remainder = (volatile int16_t*)&PMECC->PMECC_REM[sector];
+		for (i = 0; i < (uint32_t)pmecc_desc.tt; i++)
+			snapshot->remainders[sector][i] = remainder[i];
+	}
+}
+
+/**
+ * \brief Correct a page from a snapshot of the PMECC state.
+ * A flagged sector whose data and ECC bytes hold at most as many bits at 0
+ * as the correction capability is considered erased: its data is set to
+ * 0xFF and the bits at 0 are counted as corrected.
+ * \param snapshot PMECC state saved by pmecc_save_snapshot().
+ * \param page_buffer Data of the page to be corrected.
+ * \param ecc ECC bytes of the page as read from the spare area (starting at
+ * pmecc_get_ecc_start_address()).
+ * \param bitflips Array of pmecc_get_sectors_per_page() entries, receiving
+ * the number of bits corrected in each sector, or
+ * PMECC_UNCORRECTABLE. Can be NULL.
+ * \return 0 if all errors have been corrected, 1 if too many errors detected
+ */
+uint32_t pmecc_correct_snapshot(const struct _pmecc_snapshot *snapshot,
+		uint8_t *page_buffer, const uint8_t *ecc, uint8_t *bitflips)
+{
+	uint32_t sector, sector_count, sector_size, ecc_bytes_per_sector;
+	uint32_t status = snapshot->status;
+	uint32_t result = 0;
+	int32_t error_nbr;
+
+	sector_size = pmecc_get_sector_size();
+	sector_count = pmecc_get_sectors_per_page();
+	ecc_bytes_per_sector = pmecc_desc.ecc_size / sector_count;
+
+	if (bitflips)
+		memset(bitflips, 0, sector_count);
+	if (!status)
+		return 0;
+
+	/* Set the sector size (512 or 1024 bytes) */
+	PMERRLOC->PMERRLOC_CFG = sector_size == 1024 ? PMERRLOC_CFG_SECTORSZ : 0;
+
+	for (sector = 0; sector < sector_count && status; sector++, status >>= 1) {
+		uint8_t *data = page_buffer + sector * sector_size;
+		uint32_t zeros;
+
+		if (!(status & 1))
+			continue;
+
+		/* Erased sector, with possibly a few bitflips */
+		zeros = count_zero_bits(ecc + sector * ecc_bytes_per_sector,
+				ecc_bytes_per_sector, pmecc_desc.tt);
+		if (zeros <= (uint32_t)pmecc_desc.tt)
+			zeros += count_zero_bits(data, sector_size,
+					pmecc_desc.tt - zeros);
+		if (zeros <= (uint32_t)pmecc_desc.tt) {
+			if (zeros)
+				memset(data, 0xff, sector_size);
+			if (bitflips)
+				bitflips[sector] = zeros;
+			continue;
+		}
+
+		gen_partial_syndromes(snapshot->remainders[sector]);
+		substitute();
+		get_sigma();
+		error_nbr = error_location(sector_size * 8 + pmecc_desc.tt * pmecc_desc.mm);
+		if (error_nbr == -1) {
+			if (bitflips)
+				bitflips[sector] = PMECC_UNCORRECTABLE;
+			result = 1;
+			continue;
+		}
+		error_correction((uint32_t)data, error_nbr);
+		if (bitflips)
+			bitflips[sector] = error_nbr;
+	}
+
+	return result;
+}
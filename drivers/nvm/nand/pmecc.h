@@ -46,6 +46,28 @@
 /** Start address of ECC cvalue in spare zone, this must not be 0 since Bad block tag are at 0. */
 #define PMECC_ECC_DEFAULT_START_ADDR   0x02
 
+/** Maximum number of sectors in a page */
+#define PMECC_MAX_SECTORS              8
+
+/** Maximum number of errors corrected in a sector */
+#define PMECC_MAX_ERRORS               32
+
+/** Bitflip count of a sector which could not be corrected */
+#define PMECC_UNCORRECTABLE            0xFF
+
+/*----------------------------------------------------------------------- */
+/*         Types                                                          */
+/*----------------------------------------------------------------------- */
+
+/** PMECC state of a page, saved for a deferred correction */
+struct _pmecc_snapshot {
+	/** PMECC error status, one bit per sector */
+	uint32_t status;
+
+	/** Remainders of the sectors flagged in the status */
+	int16_t remainders[PMECC_MAX_SECTORS][PMECC_MAX_ERRORS];
+};
+
 /*------------------------------------------------------------------------------ */
 /*         Exported functions                                                    */
 /*------------------------------------------------------------------------------ */
@@ -87,12 +109,19 @@ extern uint32_t pmecc_get_sectors_per_page(void);
 
 extern uint32_t pmecc_get_ecc_bytes_per_page(void);
 
+extern uint32_t pmecc_get_errors_per_sector(void);
+
 extern uint32_t pmecc_get_ecc_start_address(void);
 
 extern uint32_t pmecc_get_ecc_end_address(void);
 
 extern uint32_t pmecc_correction(uint32_t pmecc_status, uint32_t page_buffer);
 
+extern void pmecc_save_snapshot(struct _pmecc_snapshot *snapshot);
+
+extern uint32_t pmecc_correct_snapshot(const struct _pmecc_snapshot *snapshot,
+		uint8_t *page_buffer, const uint8_t *ecc, uint8_t *bitflips);
+
 extern void pmecc_build_gf(uint32_t mm, int32_t *index_of, int32_t *alpha_to);
 
 #endif /* CONFIG_HAVE_PMECC */
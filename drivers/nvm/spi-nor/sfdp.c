@@ -34,6 +34,7 @@
 #include "nvm/spi-nor/sfdp.h"
 #include "nvm/spi-nor/spi-nor.h"
 #include "string.h"
+#include "trace.h"
 
 /*----------------------------------------------------------------------------
  *        Local Functions
@@ -69,6 +70,7 @@ struct sfdp_parameter_header {
 
 
 #define SFDP_BFPT_ID		0xff00u	/* Basic Flash Parameter Table */
+#define SFDP_SECTOR_MAP_ID	0xff81u	/* Sector Map Parameter Table */
 #define SFDP_4BAIT_ID		0xff84u	/* 4-byte Address Instruction Table */
 
 #define SFDP_SIGNATURE		0x50444653u
@@ -428,6 +430,156 @@ static int spi_flash_parse_bfpt(struct spi_flash *flash,
 	return 0;
 }
 
+/* Sector Map Parameter Table */
+
+/* Maximum supported size of the Sector Map Parameter Table, in DWORDs. */
+#define SMPT_DWORD_MAX			64
+
+/* Common to all descriptors. */
+#define SMPT_DESC_END			(0x1UL << 0)
+#define SMPT_DESC_TYPE_MAP		(0x1UL << 1)
+
+/* Configuration Detection Command Descriptor, 1st DWORD. */
+#define SMPT_CMD_ADDRESS_LEN_MASK	(0x3UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_0		(0x0UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_3		(0x1UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_4		(0x2UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_USE_CURRENT (0x3UL << 22)
+
+#define SMPT_CMD_READ_DUMMY(d)		(((d) >> 16) & 0xFu)
+#define SMPT_CMD_READ_DUMMY_IS_VARIABLE	0xFu
+#define SMPT_CMD_OPCODE(d)		(((d) >> 8) & 0xFFu)
+#define SMPT_CMD_READ_DATA(d)		(((d) >> 24) & 0xFFu)
+
+/* Configuration Map Descriptor, 1st DWORD. */
+#define SMPT_MAP_ID(d)			(((d) >> 8) & 0xFFu)
+#define SMPT_MAP_REGION_COUNT(d)	((((d) >> 16) & 0xFFu) + 1)
+
+/* Region DWORDs of a Configuration Map Descriptor. */
+#define SMPT_MAP_REGION_ERASE_TYPE(d)	((d) & 0xFu)
+#define SMPT_MAP_REGION_SIZE(d)		((((d) >> 8) + 1) << 8)
+
+static uint32_t smpt[SMPT_DWORD_MAX];
+
+/*
+ * Run the Configuration Detection Commands and return a pointer on the
+ * Configuration Map Descriptor in use, or NULL if none matches.
+ */
+static const uint32_t *spi_flash_smpt_get_map(struct spi_flash *flash, size_t len)
+{
+	struct spi_flash_command cmd;
+	uint8_t map_id = 0, data;
+	size_t i;
+	int rc;
+
+	/* Detection commands are 2 DWORDs each and come first. */
+	for (i = 0; i + 1 < len && !(smpt[i] & SMPT_DESC_TYPE_MAP); i += 2) {
+		uint8_t addr_len, dummy;
+
+		switch (smpt[i] & SMPT_CMD_ADDRESS_LEN_MASK) {
+		case SMPT_CMD_ADDRESS_LEN_0:
+			addr_len = 0;
+			break;
+		case SMPT_CMD_ADDRESS_LEN_3:
+			addr_len = 3;
+			break;
+		case SMPT_CMD_ADDRESS_LEN_4:
+			addr_len = 4;
+			break;
+		default:
+			addr_len = flash->addr_len ? flash->addr_len : 3;
+			break;
+		}
+
+		dummy = SMPT_CMD_READ_DUMMY(smpt[i]);
+		if (dummy == SMPT_CMD_READ_DUMMY_IS_VARIABLE)
+			dummy = 8;
+
+		spi_flash_command_init(&cmd, SMPT_CMD_OPCODE(smpt[i]), addr_len, SFLASH_TYPE_READ_REG);
+		cmd.proto = flash->reg_proto;
+		cmd.addr = smpt[i + 1];
+		cmd.num_wait_states = dummy;
+		cmd.data_len = 1;
+		cmd.rx_data = &data;
+		rc = spi_flash_exec(flash, &cmd);
+		if (rc < 0)
+			return NULL;
+
+		map_id = (map_id << 1) | ((data & SMPT_CMD_READ_DATA(smpt[i])) ? 1 : 0);
+	}
+
+	/* Then find the matching Configuration Map Descriptor. */
+	while (i < len) {
+		if (!(smpt[i] & SMPT_DESC_TYPE_MAP))
+			return NULL;
+
+		if (SMPT_MAP_ID(smpt[i]) == map_id)
+			return &smpt[i];
+
+		if (smpt[i] & SMPT_DESC_END)
+			break;
+		i += SMPT_MAP_REGION_COUNT(smpt[i]) + 1;
+	}
+
+	return NULL;
+}
+
+static int spi_flash_parse_smpt(struct spi_flash *flash,
+				const struct sfdp_parameter_header *smpt_header,
+				struct spi_flash_parameters *params)
+{
+	struct spi_flash_erase_map *map = &flash->erase_map;
+	const uint32_t *desc;
+	uint32_t offset, i, j, count, erase_mask;
+	size_t len;
+	int rc;
+
+	len = min_u32(SMPT_DWORD_MAX, smpt_header->length);
+	rc = spi_flash_read_sfdp(flash, SFDP_PARAM_HEADER_PTP(smpt_header),
+				 len * sizeof(uint32_t), smpt);
+	if (rc < 0)
+		return rc;
+
+	desc = spi_flash_smpt_get_map(flash, len);
+	if (!desc)
+		return -EINVAL;
+
+	count = SMPT_MAP_REGION_COUNT(desc[0]);
+	if (count > SFLASH_ERASE_REGION_MAX || desc + count >= smpt + len)
+		return -EINVAL;
+
+	offset = 0;
+	for (i = 0; i < count; i++) {
+		struct spi_flash_erase_region *region = &map->nonuniform_regions[i];
+		uint32_t region_desc = desc[1 + i];
+
+		region->offset = offset;
+		region->size = SMPT_MAP_REGION_SIZE(region_desc);
+
+		/* Only keep the erase types that fit the region boundaries. */
+		erase_mask = SMPT_MAP_REGION_ERASE_TYPE(region_desc);
+		for (j = 0; j < SFLASH_CMD_ERASE_MAX; j++) {
+			const struct spi_flash_erase_command *cmd = &map->commands[j];
+
+			if (!cmd->size || (region->offset % cmd->size) ||
+			    (region->size % cmd->size))
+				erase_mask &= ~(0x1UL << j);
+		}
+		region->cmd_mask = erase_mask;
+
+		offset += region->size;
+	}
+
+	/* The regions must cover the whole memory. */
+	if (offset != params->size)
+		return -EINVAL;
+
+	map->regions = map->nonuniform_regions;
+	map->num_regions = count;
+
+	return 0;
+}
+
 static struct sfdp_header header;
 static struct sfdp_parameter_header param_header;
 
@@ -494,6 +646,12 @@ int spi_flash_parse_sfdp(struct spi_flash *flash, struct spi_flash_parameters *p
 			goto exit;
 
 		switch (SFDP_PARAM_HEADER_ID(&param_header)) {
+		case SFDP_SECTOR_MAP_ID:
+			/* Keep the uniform map if the sector map is unusable. */
+			if (spi_flash_parse_smpt(flash, &param_header, params) < 0)
+				trace_warning("SF: ignoring invalid sector map\r\n");
+			break;
+
 		default:
 			break;
 		}
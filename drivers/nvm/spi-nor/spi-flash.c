@@ -73,7 +73,7 @@ int spi_flash_write_reg(struct spi_flash *flash, uint8_t inst, const uint8_t *bu
 	return spi_flash_exec(flash, &cmd);
 }
 
-static int spi_flash_is_ready(struct spi_flash *flash)
+int spi_flash_is_ready(struct spi_flash *flash)
 {
 	uint8_t sr, fsr;
 	int rc;
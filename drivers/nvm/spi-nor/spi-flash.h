@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "callback.h"
 #include "compiler.h"
 #include "intmath.h"
 #include "peripherals/bus.h"
@@ -99,6 +100,7 @@
 #define SFLASH_INST_ERASE_4K  0x20
 #define SFLASH_INST_ERASE_32K 0x52
 #define SFLASH_INST_ERASE_64K 0xD8
+#define SFLASH_INST_ERASE_CHIP 0xC7
 
 /**
  * 4-byte address instruction set.
@@ -176,6 +178,11 @@
 	 SFLASH_PROTO_DATA(data_nbits))
 
 #define SFLASH_CMD_ERASE_MAX	4
+
+/* Maximum number of regions of a non-uniform erase map */
+#ifndef SFLASH_ERASE_REGION_MAX
+#define SFLASH_ERASE_REGION_MAX	8
+#endif
 #define SFLASH_CMD_ERASE_MASK	0xFULL
 #define SFLASH_CMD_ERASE_OFFSET(_cmd_mask, _offset)		\
 	((((uint64_t)(_offset)) & ~SFLASH_CMD_ERASE_MASK) |	\
@@ -257,6 +264,15 @@ enum spi_flash_protocol {
  * @data_len:		Number of bytes to be sent during data clock cycles.
  * @tx_data:		Data sent to the SPI slave during data clock cycles.
  * @rx_data:		Data read from the SPI slave during data clock cycles.
+ * @timeout:		Timeout of the instruction end, in ms. Not applied when
+ *			the end of a non-blocking data phase is signaled by
+ *			interrupt.
+ * @callback:		Optional completion callback. When set, the controller
+ *			may return before the end of the data phase; the
+ *			callback is then invoked once the command is complete,
+ *			with the command status (0 or -errno) cast to a pointer
+ *			as second argument. It is not invoked if exec() itself
+ *			returns an error.
  */
 struct spi_flash_command {
 	enum spi_flash_protocol proto;
@@ -271,6 +287,7 @@ struct spi_flash_command {
 	const void *tx_data;
 	void *rx_data;
 	uint32_t timeout;
+	struct _callback *callback;
 #ifdef CONFIG_HAVE_AESB
 	bool use_aesb;
 #endif
@@ -310,6 +327,8 @@ struct spi_flash_erase_region {
  * @commands:		an array of erase commands shared by all the regions.
  * @uniform_region:	a pre-allocated erase region for SPI FLASH with a uniform
  *			sector size (legacy implementation).
+ * @nonuniform_regions:	storage for the regions of a non-uniform erase map,
+ *			as described by the SFDP Sector Map Parameter Table.
  * @regions:		point to an array describing the boundaries of the erase
  *			regions.
  * @num_regions:	the number of elements in the @regions array.
@@ -317,6 +336,7 @@ struct spi_flash_erase_region {
 struct spi_flash_erase_map {
 	struct spi_flash_erase_command commands[SFLASH_CMD_ERASE_MAX];
 	struct spi_flash_erase_region uniform_region;
+	struct spi_flash_erase_region nonuniform_regions[SFLASH_ERASE_REGION_MAX];
 	struct spi_flash_erase_region *regions;
 	uint32_t num_regions;
 };
@@ -462,6 +482,7 @@ extern uint8_t spi_flash_protocol_get_data_nbits(enum spi_flash_protocol proto);
 extern int spi_flash_hwcaps2cmd(uint32_t hwcaps);
 extern int spi_flash_read_reg(struct spi_flash *flash, uint8_t inst, uint8_t *buf, size_t len);
 extern int spi_flash_write_reg(struct spi_flash *flash, uint8_t inst, const uint8_t *buf, size_t len);
+extern int spi_flash_is_ready(struct spi_flash *flash);
 extern int spi_flash_wait_till_ready_timeout(struct spi_flash *flash, unsigned long timeout);
 
 extern int spi_flash_setup(struct spi_flash *flash, const struct spi_flash_parameters *params);
@@ -472,6 +472,9 @@ static int _bus_exec(union spi_flash_priv* priv, const struct spi_flash_command
 	bus_wait_transfer(priv->spi.bus);
 	bus_stop_transaction(priv->spi.bus);
 
+	if (rc >= 0)
+		callback_call(cmd->callback, (void*)(intptr_t)rc);
+
 	return rc;
 }
 
@@ -735,6 +738,11 @@ int spi_nor_configure(struct spi_flash *flash, const struct spi_flash_cfg *cfg)
 }
 
 int spi_nor_read(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len)
+{
+	return spi_nor_read_async(flash, from, buf, len, NULL);
+}
+
+int spi_nor_read_async(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len, struct _callback* cb)
 {
 	struct spi_flash_command cmd;
 
@@ -746,6 +754,7 @@ int spi_nor_read(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len)
 	cmd.num_wait_states = flash->num_wait_states;
 	cmd.data_len = len;
 	cmd.rx_data = buf;
+	cmd.callback = cb;
 #ifdef CONFIG_HAVE_AESB
 	cmd.use_aesb = flash->use_aesb;
 #endif
@@ -796,64 +805,249 @@ int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t
 	return rc;
 }
 
-int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
+/* Build the Page Program command of the page starting at job->to */
+static void _spi_nor_write_prepare(struct spi_nor_write_job *job)
 {
-	const struct spi_flash_erase_map *map = &flash->erase_map;
-	struct spi_flash_command cmd;
-	int rc = 0;
+	struct spi_flash *flash = job->flash;
+	size_t page_offset = job->to & (flash->page_size - 1);
+
+	spi_flash_command_init(&job->cmd, flash->write_inst, flash->addr_len, SFLASH_TYPE_WRITE);
+	job->cmd.proto = flash->write_proto;
+#ifdef CONFIG_HAVE_AESB
+	job->cmd.use_aesb = flash->use_aesb;
+#endif
+	job->cmd.addr = job->to;
+	job->cmd.data_len = min_u32(flash->page_size - page_offset, job->remaining);
+	job->cmd.tx_data = job->buf;
+}
+
+static void _spi_nor_write_complete(struct spi_nor_write_job *job, int status)
+{
+	job->status = status;
+	callback_call(&job->callback, (void*)(intptr_t)status);
+}
+
+/* Issue the prepared page program, then prepare the next one */
+static int _spi_nor_write_next_page(struct spi_nor_write_job *job)
+{
+	size_t len = job->cmd.data_len;
+	int rc;
+
+	rc = spi_flash_write_enable(job->flash);
+	if (rc < 0)
+		return rc;
+
+	rc = spi_flash_exec(job->flash, &job->cmd);
+	if (rc < 0)
+		return rc;
+	timer_start_timeout(&job->timeout, SFLASH_DEFAULT_TIMEOUT);
+
+	job->pending = len;
+	job->buf += len;
+	job->to += len;
+	job->remaining -= len;
+	if (job->remaining)
+		_spi_nor_write_prepare(job);
+
+	return 0;
+}
+
+int spi_nor_write_async(struct spi_flash *flash, struct spi_nor_write_job *job,
+			size_t to, const uint8_t* buf, size_t len,
+			struct _callback* progress, struct _callback* cb)
+{
+	int rc;
+
+	if (!len)
+		return -EINVAL;
 
 	rc = spi_flash_set_protection(flash, false);
 	if (rc < 0)
 		return rc;
 
-	if (!spi_flash_has_uniform_erase(flash)) {
-		/* @TODO: add support to non uniform erase map. */
-		return -ENOTSUP;
+	job->flash = flash;
+	job->buf = buf;
+	job->to = to;
+	job->remaining = len;
+	job->done = 0;
+	job->pending = 0;
+	callback_copy(&job->progress, progress);
+	callback_copy(&job->callback, cb);
+	_spi_nor_write_prepare(job);
+
+	rc = _spi_nor_write_next_page(job);
+	job->status = rc < 0 ? rc : -EINPROGRESS;
+
+	return rc;
+}
+
+int spi_nor_write_poll(struct spi_nor_write_job *job)
+{
+	int rc;
+
+	if (job->status != -EINPROGRESS)
+		return job->status;
+
+	rc = spi_flash_is_ready(job->flash);
+	if (rc == 0) {
+		if (!timer_timeout_reached(&job->timeout))
+			return -EINPROGRESS;
+		rc = -ETIMEDOUT;
+	}
+	if (rc < 0) {
+		_spi_nor_write_complete(job, rc);
+		return rc;
+	}
+
+	/* The current page is programmed */
+	job->done += job->pending;
+	job->pending = 0;
+	callback_call(&job->progress, (void*)job->done);
+
+	if (!job->remaining) {
+		_spi_nor_write_complete(job, 0);
+		return 0;
 	}
 
-	rc = spi_flash_set_protection(flash, false);
+	rc = _spi_nor_write_next_page(job);
+	if (rc < 0) {
+		_spi_nor_write_complete(job, rc);
+		return rc;
+	}
+
+	return -EINPROGRESS;
+}
+
+/*
+ * Select the erase command for the next step of an erase of 'len' bytes at
+ * 'offset': the chip erase when the whole memory is erased, otherwise the
+ * largest erase type of the region holding 'offset' that is aligned on
+ * 'offset' and fits in both the range and the region. As erase sizes are
+ * powers of two multiple of each other, this yields the minimal number of
+ * commands.
+ */
+static int _spi_nor_select_erase(const struct spi_flash *flash, size_t offset, size_t len,
+				 struct spi_flash_erase_command *erase)
+{
+	const struct spi_flash_erase_map *map = &flash->erase_map;
+	const struct spi_flash_erase_region *region = NULL;
+	const struct spi_flash_erase_command *best = NULL;
+	uint64_t max;
+	uint32_t i, rem;
+
+	if (offset == 0 && len >= flash->size) {
+		spi_flash_set_erase_command(erase, flash->size, SFLASH_INST_ERASE_CHIP);
+		return 0;
+	}
+
+	for (i = 0; i < map->num_regions; i++) {
+		if (offset >= map->regions[i].offset &&
+		    offset - map->regions[i].offset < map->regions[i].size) {
+			region = &map->regions[i];
+			break;
+		}
+	}
+	if (!region)
+		return -EINVAL;
+
+	max = region->offset + region->size - offset;
+	if (len < max)
+		max = len;
+
+	for (i = 0; i < SFLASH_CMD_ERASE_MAX; i++) {
+		const struct spi_flash_erase_command *e = &map->commands[i];
+
+		if (!(region->cmd_mask & (0x1UL << i)) || !e->size || e->size > max)
+			continue;
+
+		spi_flash_div_by_erase_size(e, offset, &rem);
+		if (rem)
+			continue;
+
+		if (!best || best->size < e->size)
+			best = e;
+	}
+	if (!best)
+		return -EINVAL;
+
+#ifdef SPI_NOR_VERBOSE_DEBUG
+	trace_info("spi-nor: erase params: inst=0x%x\r\n", best->inst);
+	trace_info("spi-nor: erase params: size=%lu\r\n", best->size);
+	trace_info("spi-nor: erase params: size_shift=%ld\r\n", best->size_shift);
+	trace_info("spi-nor: erase params: size_mask=0x%lx\r\n", best->size_mask);
+#endif
+	memcpy(erase, best, sizeof(*erase));
+	return 0;
+}
+
+/* Check that a range can be erased without erasing anything outside it */
+static int _spi_nor_check_erase(const struct spi_flash *flash, size_t offset, size_t len)
+{
+	struct spi_flash_erase_command erase;
+	int rc;
+
+	if (offset + len > flash->size || offset + len < offset)
+		return -EINVAL;
+
+	while (len) {
+		rc = _spi_nor_select_erase(flash, offset, len, &erase);
+		if (rc < 0)
+			return rc;
+
+		offset += erase.size;
+		len -= erase.size;
+	}
+
+	return 0;
+}
+
+/* Send the erase command of the next step and return its size */
+static int _spi_nor_erase_start(struct spi_flash *flash, size_t offset, size_t len, size_t *size)
+{
+	struct spi_flash_erase_command erase;
+	struct spi_flash_command cmd;
+	int rc;
+
+	rc = _spi_nor_select_erase(flash, offset, len, &erase);
+	if (rc < 0)
+		return rc;
+
+	rc = spi_flash_write_enable(flash);
 	if (rc < 0)
 		return rc;
 
-	spi_flash_command_init(&cmd, 0, flash->addr_len, SFLASH_TYPE_ERASE);
+	if (erase.inst == SFLASH_INST_ERASE_CHIP)
+		spi_flash_command_init(&cmd, erase.inst, 0, SFLASH_TYPE_ERASE);
+	else
+		spi_flash_command_init(&cmd, erase.inst, flash->addr_len, SFLASH_TYPE_ERASE);
 	cmd.proto = flash->reg_proto;
 #ifdef CONFIG_HAVE_AESB
 	cmd.use_aesb = flash->use_aesb;
 #endif
-	while (len) {
-		const struct spi_flash_erase_command *erase = NULL;
-		size_t i;
-
-		for (i = 0; i < SFLASH_CMD_ERASE_MAX; i++) {
-			const struct spi_flash_erase_command *e;
-			uint32_t rem;
-
-			if ((map->uniform_region.cmd_mask & (0x1UL << i))) {
-				e = &map->commands[i];
-				spi_flash_div_by_erase_size(e, offset, &rem);
-				if (rem)
-					continue;
-
-				if (e->size <= len && (!erase || erase->size < e->size))
-					erase = e;
-			}
-		}
-		if (!erase)
-			return -1;
+	cmd.addr = offset;
+	rc = spi_flash_exec(flash, &cmd);
+	if (rc < 0)
+		return rc;
 
-#ifdef SPI_NOR_VERBOSE_DEBUG
-		trace_info("spi-nor: erase params: inst=0x%x\r\n", erase->inst);
-		trace_info("spi-nor: erase params: size=%lu\r\n", erase->size);
-		trace_info("spi-nor: erase params: size_shift=%ld\r\n", erase->size_shift);
-		trace_info("spi-nor: erase params: size_mask=0x%lx\r\n", erase->size_mask);
-#endif
-		rc = spi_flash_write_enable(flash);
-		if (rc < 0)
-			break;
+	*size = erase.size;
+	return 0;
+}
 
-		cmd.inst = erase->inst;
-		cmd.addr = offset;
-		rc = spi_flash_exec(flash, &cmd);
+int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
+{
+	size_t size;
+	int rc = 0;
+
+	rc = _spi_nor_check_erase(flash, offset, len);
+	if (rc < 0)
+		return rc;
+
+	rc = spi_flash_set_protection(flash, false);
+	if (rc < 0)
+		return rc;
+
+	while (len) {
+		rc = _spi_nor_erase_start(flash, offset, len, &size);
 		if (rc < 0)
 			break;
 
@@ -861,9 +1055,76 @@ int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
 		if (rc < 0)
 			break;
 
-		offset += erase->size;
-		len -= erase->size;
+		offset += size;
+		len -= size;
+	}
+
+	return rc;
+}
+
+int spi_nor_erase_async(struct spi_flash *flash, struct spi_nor_erase_job *job,
+			size_t offset, size_t len, struct _callback* cb)
+{
+	size_t size;
+	int rc;
+
+	rc = _spi_nor_check_erase(flash, offset, len);
+	if (rc < 0 || !len) {
+		job->status = rc;
+		return rc;
+	}
+
+	rc = spi_flash_set_protection(flash, false);
+	if (rc < 0) {
+		job->status = rc;
+		return rc;
+	}
+
+	job->flash = flash;
+	callback_copy(&job->callback, cb);
+
+	rc = _spi_nor_erase_start(flash, offset, len, &size);
+	if (rc < 0) {
+		job->status = rc;
+		return rc;
+	}
+	timer_start_timeout(&job->timeout, SFLASH_DEFAULT_TIMEOUT);
+	job->offset = offset + size;
+	job->remaining = len - size;
+	job->status = -EINPROGRESS;
+
+	return 0;
+}
+
+int spi_nor_erase_poll(struct spi_nor_erase_job *job)
+{
+	size_t size;
+	int rc;
+
+	if (job->status != -EINPROGRESS)
+		return job->status;
+
+	rc = spi_flash_is_ready(job->flash);
+	if (rc == 0) {
+		if (!timer_timeout_reached(&job->timeout))
+			return -EINPROGRESS;
+		rc = -ETIMEDOUT;
 	}
 
+	if (rc > 0 && job->remaining) {
+		rc = _spi_nor_erase_start(job->flash, job->offset, job->remaining, &size);
+		if (rc == 0) {
+			timer_start_timeout(&job->timeout, SFLASH_DEFAULT_TIMEOUT);
+			job->offset += size;
+			job->remaining -= size;
+			return -EINPROGRESS;
+		}
+	}
+
+	if (rc > 0)
+		rc = 0;
+	job->status = rc;
+	callback_call(&job->callback, (void*)(intptr_t)rc);
+
 	return rc;
 }
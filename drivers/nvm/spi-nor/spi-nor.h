@@ -36,6 +36,7 @@
 #include "nvm/spi-nor/spi-flash.h"
 #include "nvm/spi-nor/sfdp.h"
 #include "peripherals/bus.h"
+#include "timer.h"
 
 /*----------------------------------------------------------------------------
  *        Constants
@@ -102,6 +103,56 @@ struct spi_nor_info {
 	const struct spi_flash_parameters	*params;
 };
 
+/**
+ * struct spi_nor_write_job - Asynchronous write (see spi_nor_write_async())
+ * @flash:		The SPI flash being written.
+ * @buf:		Data of the next page to program.
+ * @to:			Flash offset of the next page to program.
+ * @remaining:		Number of bytes left to program after the current page.
+ * @done:		Number of bytes already programmed.
+ * @pending:		Number of bytes of the page being programmed.
+ * @status:		-EINPROGRESS while the job runs, then the final status.
+ * @cmd:		Page Program command of the next page, prepared while
+ *			the current page programs.
+ * @timeout:		Timeout of the current page program.
+ * @progress:		Called with the number of bytes programmed so far
+ *			(cast to a pointer) after each page. Optional.
+ * @callback:		Called with the final status (cast to a pointer) once
+ *			the job is complete. Optional.
+ */
+struct spi_nor_write_job {
+	struct spi_flash *flash;
+	const uint8_t *buf;
+	size_t to;
+	size_t remaining;
+	size_t done;
+	size_t pending;
+	volatile int status;
+	struct spi_flash_command cmd;
+	struct _timeout timeout;
+	struct _callback progress;
+	struct _callback callback;
+};
+
+/**
+ * struct spi_nor_erase_job - Asynchronous erase (see spi_nor_erase_async())
+ * @flash:		The SPI flash being erased.
+ * @offset:		Offset of the next erase command.
+ * @remaining:		Number of bytes left to erase after the current command.
+ * @status:		-EINPROGRESS while the job runs, then the final status.
+ * @timeout:		Timeout of the current erase command.
+ * @callback:		Called with the final status (cast to a pointer) once
+ *			the job is complete. Optional.
+ */
+struct spi_nor_erase_job {
+	struct spi_flash *flash;
+	size_t offset;
+	size_t remaining;
+	volatile int status;
+	struct _timeout timeout;
+	struct _callback callback;
+};
+
 /*----------------------------------------------------------------------------
  *        Exported Variables
  *----------------------------------------------------------------------------*/
@@ -114,9 +165,75 @@ extern const struct spi_nor_info spi_nor_ids[];
 
 int spi_nor_configure(struct spi_flash *flash, const struct spi_flash_cfg *cfg);
 int spi_nor_read(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len);
+
+/**
+ * \brief Start a read from the SPI flash and return without waiting for the
+ * end of the data phase when the controller supports it (QSPI with DMA).
+ * \a cb is invoked with the read status (0 or -errno) cast to a pointer as
+ * second argument once \a buf holds the data; it is not invoked if this
+ * function returns an error. No other command may be issued on \a flash
+ * before \a cb has been invoked.
+ */
+int spi_nor_read_async(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len, struct _callback* cb);
 int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t len);
+
+/**
+ * \brief Start an asynchronous write of \a len bytes at offset \a to.
+ *
+ * The first page program is issued before returning; the following ones are
+ * issued by spi_nor_write_poll() once the flash reports the previous one is
+ * complete, so the CPU is never blocked while a page programs. The Page
+ * Program command of the next page is prepared while the current one
+ * programs.
+ *
+ * \param job       Job descriptor, must stay valid until completion.
+ * \param progress  Optional per-page progress callback (may be NULL).
+ * \param cb        Optional completion callback (may be NULL).
+ * \return 0 if the job was started, a negative error code otherwise.
+ */
+int spi_nor_write_async(struct spi_flash *flash, struct spi_nor_write_job *job,
+			size_t to, const uint8_t* buf, size_t len,
+			struct _callback* progress, struct _callback* cb);
+
+/**
+ * \brief Advance an asynchronous write: check (without waiting) whether the
+ * current page program is complete and start the next one.
+ *
+ * Call it from the main loop or from a periodic timer interrupt handler. No
+ * other command may be issued on the flash while the job runs.
+ *
+ * \return -EINPROGRESS while the job runs, then its final status.
+ */
+int spi_nor_write_poll(struct spi_nor_write_job *job);
+
+/**
+ * \brief Erase \a len bytes at \a offset.
+ *
+ * The range may span several regions of a non-uniform erase map. It is
+ * erased with the minimal sequence of erase commands (a chip erase if it
+ * covers the whole memory) and must be aligned on the smallest erase size
+ * of the regions at both of its ends; nothing is erased otherwise.
+ */
 int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len);
 
+/**
+ * \brief Start an asynchronous erase, see spi_nor_erase().
+ *
+ * The first erase command is sent before returning; the following ones are
+ * sent by spi_nor_erase_poll(), which behaves like spi_nor_write_poll().
+ *
+ * \param job  Job descriptor, must stay valid until completion.
+ * \param cb   Optional completion callback (may be NULL).
+ */
+int spi_nor_erase_async(struct spi_flash *flash, struct spi_nor_erase_job *job,
+			size_t offset, size_t len, struct _callback* cb);
+
+/**
+ * \brief Advance an asynchronous erase without waiting.
+ * \return -EINPROGRESS while the job runs, then its final status.
+ */
+int spi_nor_erase_poll(struct spi_nor_erase_job *job);
+
 int spansion_new_quad_enable(struct spi_flash *flash);
 int spansion_quad_enable(struct spi_flash *flash);
 int macronix_quad_enable(struct spi_flash *flash);
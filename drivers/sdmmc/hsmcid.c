@@ -712,6 +712,9 @@ static uint32_t hsmci_send_command(void *_set, sSdmmcCommand *cmd)
 	if (has_data && (cmd->wBlockSize == 0 || cmd->wNbBlocks == 0
 		|| cmd->pData == NULL))
 		return SDMMC_ERROR_PARAM;
+	/* Fragmented data buffers are not supported */
+	if (has_data && cmd->pIoVec)
+		return SDMMC_NOT_SUPPORTED;
 
 	if (hsmci_is_busy(set))
 		return SDMMC_ERROR_BUSY;
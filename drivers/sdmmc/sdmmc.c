@@ -86,6 +86,10 @@
  *        Local definitions
  *----------------------------------------------------------------------------*/
 
+#if SDMMC_BOUNCE_SLOTS < 2 || SDMMC_BOUNCE_SLOTS % 2 || SDMMC_BOUNCE_SLOTS > 254
+#error "SDMMC_BOUNCE_SLOTS shall be even, and in the range 2..254"
+#endif
+
 /** Device status */
 #define STAT_ADDRESS_OUT_OF_RANGE     (1UL << 31)
 #define STAT_ADDRESS_MISALIGN         (1UL << 30)
@@ -605,78 +609,330 @@ static void sdmmc_set_device_clock(struct sdmmc_set *set, uint32_t freq)
 	regs->SDMMC_CCR |= SDMMC_CCR_SDCLKEN;
 }
 
+/**
+ * \brief Get the address and the size of a data fragment of the command.
+ */
+static void sdmmc_get_frag(const sSdmmcCommand *cmd, uint16_t ix,
+    uint8_t **data, uint32_t *len)
+{
+	if (cmd->pIoVec) {
+		*data = cmd->pIoVec[ix].pData;
+		*len = cmd->pIoVec[ix].dwLen;
+	}
+	else {
+		*data = cmd->pData;
+		*len = (uint32_t)cmd->wNbBlocks * (uint32_t)cmd->wBlockSize;
+	}
+}
+
+/**
+ * \brief Compute how many bytes, at either edge of a data fragment, shall go
+ * through a bounce buffer.
+ * The ADMA requires word-aligned addresses. Besides, incoming data shall not
+ * share cache lines with unrelated variables, hence when receiving, the
+ * edges are bounced up to cache line boundaries.
+ */
+static void sdmmc_get_edges(const struct sdmmc_set *set, bool rx,
+    const uint8_t *data, uint32_t len, uint32_t *head, uint32_t *tail)
+{
+	const bool line_align = rx && set->bounce_cnt;
+	const uint32_t mask = line_align ? SDMMC_BOUNCE_SIZE - 1 : 0x3;
+	const uint32_t addr = (uint32_t)data;
+
+	*head = addr & mask ? min_u32(len, mask + 1 - (addr & mask)) : 0;
+	*tail = line_align && len > *head ? (addr + len) & mask : 0;
+}
+
+/**
+ * \brief Count the descriptor lines and the bounce buffers a data fragment
+ * requires.
+ */
+static uint32_t sdmmc_count_lines(const struct sdmmc_set *set, bool rx,
+    const uint8_t *data, uint32_t len, uint32_t *slot_cnt)
+{
+	uint32_t head, tail;
+
+	sdmmc_get_edges(set, rx, data, len, &head, &tail);
+	*slot_cnt = (head ? 1 : 0) + (tail ? 1 : 0);
+	return *slot_cnt + (len - head - tail + SDMMC_DMADL_TRAN_LEN_MAX - 1)
+	    / SDMMC_DMADL_TRAN_LEN_MAX;
+}
+
+/**
+ * \brief Reduce the block count of a single-buffer transfer, for it to fit
+ * into the descriptor table.
+ * \return SDMMC_CHANGED, or SDMMC_NOT_SUPPORTED if not even one block fits.
+ */
+static uint8_t sdmmc_shorten_transfer(const struct sdmmc_set *set,
+    sSdmmcCommand *cmd, bool rx, uint32_t *line_cnt, uint32_t *slot_cnt)
+{
+	uint32_t blocks;
+
+	blocks = min_u32(cmd->wNbBlocks,
+	    set->table_size * SDMMC_DMADL_TRAN_LEN_MAX / cmd->wBlockSize);
+	for (; blocks; blocks--) {
+		*line_cnt = sdmmc_count_lines(set, rx, cmd->pData,
+		    blocks * cmd->wBlockSize, slot_cnt);
+		if (*line_cnt <= set->table_size && *slot_cnt <= set->bounce_cnt)
+			break;
+	}
+	if (blocks == 0)
+		return SDMMC_NOT_SUPPORTED;
+	cmd->wNbBlocks = (uint16_t)blocks;
+	return SDMMC_CHANGED;
+}
+
+/**
+ * \brief Fill descriptor lines for the next part of the data, from where the
+ * previous call stopped.
+ * \param line  First line to fill.
+ * \param line_cnt  Max count of lines to fill.
+ * \param slot  First bounce buffer to use.
+ * \param slot_cnt  Max count of bounce buffers to use.
+ * \return The count of lines filled.
+ */
+static uint32_t sdmmc_fill_lines(struct sdmmc_set *set, sSdmmcCommand *cmd,
+    uint32_t *line, uint32_t line_cnt, uint8_t slot, uint8_t slot_cnt)
+{
+	const bool rx = cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_RX;
+	const uint16_t frag_cnt = cmd->pIoVec ? cmd->wIoVecCnt : 1;
+	uint32_t cnt = 0, len, head, tail, size;
+	uint8_t *data, *addr;
+
+	while (cnt < line_cnt && set->frag_ix < frag_cnt) {
+		sdmmc_get_frag(cmd, set->frag_ix, &data, &len);
+		if (len == 0) {
+			set->frag_ix++;
+			continue;
+		}
+		sdmmc_get_edges(set, rx, data, len, &head, &tail);
+		if (set->frag_off < head || set->frag_off >= len - tail) {
+			if (slot_cnt == 0)
+				break;
+			size = set->frag_off < head ? head : tail;
+			addr = set->bounce + slot * SDMMC_BOUNCE_SIZE;
+			if (rx) {
+				set->bounce_dst[slot] = data + set->frag_off;
+				set->bounce_len[slot] = (uint8_t)size;
+				cache_invalidate_region(addr,
+				    SDMMC_BOUNCE_SIZE);
+			}
+			else {
+				memcpy(addr, data + set->frag_off, size);
+				cache_clean_region(addr, SDMMC_BOUNCE_SIZE);
+			}
+			slot++;
+			slot_cnt--;
+		}
+		else {
+			size = min_u32(len - tail - set->frag_off,
+			    SDMMC_DMADL_TRAN_LEN_MAX);
+			addr = data + set->frag_off;
+		}
+		line[0] = SDMMC_DMA0DL_LEN(size) | SDMMC_DMA0DL_ATTR_ACT_TRAN
+		    | SDMMC_DMA0DL_ATTR_VALID;
+		line[1] = SDMMC_DMA1DL_ADDR((uint32_t)addr);
+#if 0
+		trace_debug("DMA descriptor: %luB @ 0x%lx\n\r", size, line[1]);
+#endif
+		line += SDMMC_DMADL_SIZE;
+		cnt++;
+		set->frag_off += size;
+		if (set->frag_off == len) {
+			set->frag_ix++;
+			set->frag_off = 0;
+		}
+	}
+	return cnt;
+}
+
+/**
+ * \brief Check if some data is still to be set up for DMA.
+ */
+static bool sdmmc_has_more(const struct sdmmc_set *set,
+    const sSdmmcCommand *cmd)
+{
+	const uint16_t frag_cnt = cmd->pIoVec ? cmd->wIoVecCnt : 1;
+	uint16_t ix;
+
+	for (ix = set->frag_ix; ix < frag_cnt; ix++)
+		if (!cmd->pIoVec || cmd->pIoVec[ix].dwLen != 0)
+			return true;
+	return false;
+}
+
+/**
+ * \brief Fill one half of a chained descriptor table, and link it to the
+ * other half.
+ * \param notify  Have the first data line raise the DMA interrupt. Once this
+ * line is complete, the ADMA is done with the other half, which the driver
+ * then refills while the ADMA runs the remaining lines of this half, at least
+ * SDMMC_CHAIN_MIN_LINES - 1 of them unless the data ends there.
+ * \param hold  Set the End attribute on the last data line, until the other
+ * half is refilled. Should the refill be late, the ADMA stops there and the
+ * command fails, instead of transferring stale data.
+ */
+static void sdmmc_fill_half(struct sdmmc_set *set, sSdmmcCommand *cmd,
+    uint8_t half, bool notify, bool hold)
+{
+	const uint32_t half_size = set->table_size / 2;
+	const uint8_t slot_cnt = set->bounce_cnt / 2;
+	uint32_t *first = set->table + half * half_size * SDMMC_DMADL_SIZE;
+	uint32_t *line;
+	uint32_t cnt;
+
+	cnt = sdmmc_fill_lines(set, cmd, first, half_size - 1,
+	    half * slot_cnt, slot_cnt);
+	assert(cnt);
+	if (notify)
+		first[0] |= SDMMC_DMA0DL_ATTR_INT;
+	set->chain_last[half] = half * half_size + cnt - 1;
+	line = first + (cnt - 1) * SDMMC_DMADL_SIZE;
+	if (hold || !sdmmc_has_more(set, cmd))
+		line[0] |= SDMMC_DMA0DL_ATTR_END;
+	line += SDMMC_DMADL_SIZE;
+	line[0] = SDMMC_DMA0DL_ATTR_ACT_LINK | SDMMC_DMA0DL_ATTR_VALID;
+	line[1] = SDMMC_DMA1DL_ADDR((uint32_t)(set->table
+	    + (half ^ 1) * half_size * SDMMC_DMADL_SIZE));
+	cache_clean_region(first, (cnt + 1) * SDMMC_DMADL_SIZE * 4);
+}
+
+/**
+ * \brief Copy the data received in bounce buffers to its destination.
+ */
+static void sdmmc_unbounce(struct sdmmc_set *set, uint8_t slot,
+    uint8_t slot_cnt)
+{
+	uint8_t *buf;
+
+	for (; slot_cnt; slot++, slot_cnt--) {
+		if (!set->bounce_dst[slot])
+			continue;
+		buf = set->bounce + slot * SDMMC_BOUNCE_SIZE;
+		cache_invalidate_region(buf, SDMMC_BOUNCE_SIZE);
+		memcpy(set->bounce_dst[slot], buf, set->bounce_len[slot]);
+		set->bounce_dst[slot] = NULL;
+	}
+}
+
+/**
+ * \brief Handle the DMA interrupt raised once the ADMA is done with one half
+ * of a chained descriptor table. Refill this half with the next part of the
+ * data, then let the ADMA proceed beyond the other half.
+ */
+static void sdmmc_chain_advance(struct sdmmc_set *set, sSdmmcCommand *cmd)
+{
+	const uint8_t done = set->chain_half;
+	uint32_t *line;
+
+	set->chain_half = done ^ 1;
+	sdmmc_unbounce(set, done * (set->bounce_cnt / 2), set->bounce_cnt / 2);
+	if (!sdmmc_has_more(set, cmd))
+		return;
+	sdmmc_fill_half(set, cmd, done, true, true);
+	line = set->table + set->chain_last[done ^ 1] * SDMMC_DMADL_SIZE;
+	line[0] &= ~SDMMC_DMA0DL_ATTR_END;
+	cache_clean_region(line, SDMMC_DMADL_SIZE * 4);
+}
+
 static uint8_t sdmmc_build_dma_table(struct sdmmc_set *set, sSdmmcCommand *cmd)
 {
 	assert(set);
 	assert(set->table);
 	assert(set->table_size);
-	assert(cmd->pData);
+	assert(cmd->pData || cmd->pIoVec);
 	assert(cmd->wBlockSize);
 	assert(cmd->wNbBlocks);
 
-	uint32_t *line = NULL;
-	uint32_t data_len = (uint32_t)cmd->wNbBlocks
+	const bool rx = cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_RX;
+	const uint16_t frag_cnt = cmd->pIoVec ? cmd->wIoVecCnt : 1;
+	const uint32_t data_len = (uint32_t)cmd->wNbBlocks
 	    * (uint32_t)cmd->wBlockSize;
-	uint32_t ram_addr = (uint32_t)cmd->pData;
-	uint32_t ram_bound = ram_addr + data_len;
-	uint32_t line_ix, line_cnt;
+	uint32_t *line = NULL;
+	uint32_t total = 0, line_cnt = 0, slot_cnt = 0, len, head, tail, slots;
+	uint8_t *data;
+	uint16_t ix;
 	uint8_t rc = SDMMC_OK;
 
 #if 0
-	trace_debug("Configuring DMA for a %luB transfer %s %p\n\r",
+	trace_debug("Configuring DMA for a %luB transfer %s %u fragment(s)\n\r",
 	    data_len, cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_TX ? "from" : "to",
-	    cmd->pData);
+	    frag_cnt);
 #endif
-	/* Verify that cmd->pData is word-aligned */
-	if ((uint32_t)cmd->pData & 0x3)
+	/* Verify the fragments, and count the descriptor lines and the bounce
+	 * buffers they require */
+	for (ix = 0; ix < frag_cnt; ix++) {
+		sdmmc_get_frag(cmd, ix, &data, &len);
+		if (len == 0)
+			continue;
+		if (!data || len > data_len - total)
+			return SDMMC_PARAM;
+		total += len;
+		line_cnt += sdmmc_count_lines(set, rx, data, len, &slots);
+		if (slots && !set->bounce_cnt)
+			return SDMMC_PARAM;
+		slot_cnt += slots;
+	}
+	if (total != data_len)
 		return SDMMC_PARAM;
-	/* Compute the size of the descriptor table for this transfer */
-	line_cnt = (data_len - 1 + SDMMC_DMADL_TRAN_LEN_MAX)
-	    / SDMMC_DMADL_TRAN_LEN_MAX;
-	/* If it won't fit into the allocated buffer, resize the transfer */
-	if (line_cnt > set->table_size) {
-		line_cnt = set->table_size;
-		data_len = line_cnt * SDMMC_DMADL_TRAN_LEN_MAX;
-		data_len /= cmd->wBlockSize;
-		if (data_len == 0)
+	if ((line_cnt > set->table_size || slot_cnt > set->bounce_cnt)
+	    && set->table_size < 2 * (SDMMC_CHAIN_MIN_LINES + 1)) {
+		/* The table is too small to be refilled while the transfer
+		 * proceeds: shorten the transfer to what the table holds */
+		if (cmd->pIoVec)
 			return SDMMC_NOT_SUPPORTED;
-		cmd->wNbBlocks = (uint16_t)data_len;
-		data_len *= cmd->wBlockSize;
-		ram_bound = ram_addr + data_len;
-		rc = SDMMC_CHANGED;
+		rc = sdmmc_shorten_transfer(set, cmd, rx, &line_cnt, &slot_cnt);
+		if (rc != SDMMC_CHANGED)
+			return rc;
 	}
-	/* Fill the table */
-	for (line_ix = 0, line = set->table; line_ix < line_cnt;
-	    line_ix++, line += SDMMC_DMADL_SIZE) {
-		if (line_ix + 1 < line_cnt) {
-			line[0] = SDMMC_DMA0DL_LEN_MAX
-			    | SDMMC_DMA0DL_ATTR_ACT_TRAN
-			    | SDMMC_DMA0DL_ATTR_VALID;
-			line[1] = SDMMC_DMA1DL_ADDR(ram_addr);
-			ram_addr += SDMMC_DMADL_TRAN_LEN_MAX;
-		}
-		else {
-			line[0] = ram_bound - ram_addr
-			    < SDMMC_DMADL_TRAN_LEN_MAX
-			    ? SDMMC_DMA0DL_LEN(ram_bound - ram_addr)
-			    : SDMMC_DMA0DL_LEN_MAX;
-			line[0] |= SDMMC_DMA0DL_ATTR_ACT_TRAN
-			    | SDMMC_DMA0DL_ATTR_END | SDMMC_DMA0DL_ATTR_VALID;
-			line[1] = SDMMC_DMA1DL_ADDR(ram_addr);
-		}
-#if 0
-		trace_debug("DMA descriptor: %luB @ 0x%lx%c\n\r",
-		    (line[0] & SDMMC_DMA0DL_LEN_Msk) >> SDMMC_DMA0DL_LEN_Pos,
-		    line[1], line[0] & SDMMC_DMA0DL_ATTR_END ? '.' : ' ');
-#endif
+
+	/* Prepare the data cache. Bounced edges are handled separately.
+	 * Ensure the outgoing data can be fetched directly from RAM.
+	 * Invalidate the data cache lines of incoming data now, so this buffer
+	 * is protected against a global cache clean operation, that concurrent
+	 * code may trigger.
+	 * Warning: until the command is reported as complete, no code should
+	 * read from this buffer. If such anticipated reading had to be
+	 * supported, the data cache lines would need to be invalidated twice:
+	 * both now and upon Transfer Complete. */
+	for (ix = 0; ix < frag_cnt; ix++) {
+		sdmmc_get_frag(cmd, ix, &data, &len);
+		if (len == 0)
+			continue;
+		sdmmc_get_edges(set, rx, data, len, &head, &tail);
+		if (!rx)
+			cache_clean_region(data, len);
+		else if (len > head + tail)
+			cache_invalidate_region(data + head, len - head - tail);
 	}
-	/* Clean the underlying cache lines, to ensure the DMA gets our table
-	 * when it reads from RAM.
-	 * CPU access to the table is write-only, peripheral/DMA access is read-
-	 * only, hence there is no need to invalidate. */
-	cache_clean_region(set->table, (uint32_t)line - (uint32_t)set->table);
 
-	return rc;
+	set->frag_ix = 0;
+	set->frag_off = 0;
+	for (ix = 0; ix < set->bounce_cnt; ix++)
+		set->bounce_dst[ix] = NULL;
+	if (line_cnt <= set->table_size && slot_cnt <= set->bounce_cnt) {
+		/* The whole transfer fits into the table */
+		set->chained = false;
+		line_cnt = sdmmc_fill_lines(set, cmd, set->table, line_cnt, 0,
+		    set->bounce_cnt);
+		assert(!sdmmc_has_more(set, cmd));
+		line = set->table + (line_cnt - 1) * SDMMC_DMADL_SIZE;
+		line[0] |= SDMMC_DMA0DL_ATTR_END;
+		/* Clean the underlying cache lines, to ensure the DMA gets our
+		 * table when it reads from RAM.
+		 * CPU access to the table is write-only, peripheral/DMA access
+		 * is read-only, hence there is no need to invalidate. */
+		cache_clean_region(set->table, line_cnt * SDMMC_DMADL_SIZE * 4);
+		return rc;
+	}
+	/* Use the table as a ring of two halves, and refill each half once the
+	 * ADMA is done with it */
+	set->chained = true;
+	set->chain_half = 0;
+	sdmmc_fill_half(set, cmd, 0, false, false);
+	if (sdmmc_has_more(set, cmd))
+		sdmmc_fill_half(set, cmd, 1, true, true);
+	return SDMMC_OK;
 }
 
 /**
@@ -777,6 +1033,7 @@ static void sdmmc_poll(struct sdmmc_set *set)
 	Sdmmc *regs = set->regs;
 	sSdmmcCommand *cmd = set->cmd;
 	uint16_t events, errors, acesr;
+	uint8_t ix;
 	bool has_data;
 
 	if (set->state != MCID_CMD)
@@ -897,6 +1154,15 @@ Fetch:
 			goto Succeed;
 	}
 
+	/* The ADMA is done with one half of the chained descriptor table */
+	if (events & SDMMC_NISTR_DMAINT) {
+		/* Clear this normal interrupt */
+		regs->SDMMC_NISTR = SDMMC_NISTR_DMAINT;
+		events &= ~SDMMC_NISTR_DMAINT;
+		if (set->chained)
+			sdmmc_chain_advance(set, cmd);
+	}
+
 	/* Expect the next incoming block of data */
 	if (events & SDMMC_NISTR_BRDRDY
 	    && cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_RX && !set->table) {
@@ -1080,6 +1346,8 @@ End:
 		regs->SDMMC_SRR |= SDMMC_SRR_SWRSTDAT | SDMMC_SRR_SWRSTCMD;
 		while (regs->SDMMC_SRR & (SDMMC_SRR_SWRSTDAT
 		    | SDMMC_SRR_SWRSTCMD)) ;
+		for (ix = 0; ix < set->bounce_cnt; ix++)
+			set->bounce_dst[ix] = NULL;
 	} else if (cmd->bCmd == 0 || (cmd->bCmd == 6
 	    && cmd->dwArg & 1ul << 31 && !cmd->cmdOp.bmBits.checkBsy)) {
 		/* Currently in the function switching period, wait for the
@@ -1087,8 +1355,12 @@ End:
 		set->timer->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
 		while (set->timer->TC_SR & TC_SR_CLKSTA) ;
 	}
+	/* Deliver the data received in bounce buffers, if any */
+	if (has_data && set->table && set->bounce_cnt)
+		sdmmc_unbounce(set, 0, set->bounce_cnt);
 	/* Release this command */
 	set->cmd = NULL;
+	set->chained = false;
 	set->resp_len = 0;
 	set->blk_index = 0;
 	set->cmd_line_released = false;
@@ -1567,7 +1839,7 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 	    && set->use_set_blk_cnt;
 	const bool stop_xfer_suffix = (cmd->bCmd == 18 || cmd->bCmd == 25)
 	    && !set->use_set_blk_cnt;
-	uint32_t eister, mask, len, cycles;
+	uint32_t eister, mask, cycles;
 	uint16_t cr, tmr;
 	uint8_t rc = SDMMC_OK, mc1r;
 
@@ -1594,7 +1866,7 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 	}
 
 	if (has_data && (cmd->wNbBlocks == 0 || cmd->wBlockSize == 0
-	    || cmd->pData == NULL)) {
+	    || (cmd->pData == NULL && cmd->pIoVec == NULL))) {
 		trace_error("Invalid data\n\r");
 		return SDMMC_ERROR_PARAM;
 	}
@@ -1602,27 +1874,9 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 		trace_error("%u-byte data block size not supported\n\r", cmd->wBlockSize);
 		return SDMMC_ERROR_PARAM;
 	}
-	if (has_data && use_dma) {
-		/* Using DMA. Prepare the descriptor table. */
-		rc = sdmmc_build_dma_table(set, cmd);
-		if (rc != SDMMC_OK && rc != SDMMC_CHANGED)
-			return rc;
-		len = (uint32_t)cmd->wNbBlocks * (uint32_t)cmd->wBlockSize;
-		if (cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_TX)
-			/* Ensure the outgoing data can be fetched directly from
-			 * RAM */
-			cache_clean_region(cmd->pData, len);
-		else if (cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_RX)
-			/* Invalidate the corresponding data cache lines now, so
-			 * this buffer is protected against a global cache clean
-			 * operation, that concurrent code may trigger.
-			 * Warning: until the command is reported as complete,
-			 * no code should read from this buffer, nor from
-			 * variables cached in the same lines. If such
-			 * anticipated reading had to be supported, the data
-			 * cache lines would need to be invalidated twice: both
-			 * now and upon Transfer Complete. */
-			cache_invalidate_region(cmd->pData, len);
+	if (has_data && cmd->pIoVec && !use_dma) {
+		trace_error("Fragmented data requires DMA\n\r");
+		return SDMMC_NOT_SUPPORTED;
 	}
 	if (multiple_xfer && !has_data)
 		trace_warning("Inconsistent data\n\r");
@@ -1630,6 +1884,15 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 		trace_error("Concurrent command\n\r");
 		return SDMMC_ERROR_BUSY;
 	}
+	set->chained = false;
+	if (has_data && use_dma) {
+		/* Using DMA. Prepare the descriptor table, and the data cache.
+		 * Done once the previous command has completed, since the
+		 * table may still be refilled on its behalf. */
+		rc = sdmmc_build_dma_table(set, cmd);
+		if (rc != SDMMC_OK && rc != SDMMC_CHANGED)
+			return rc;
+	}
 	set->state = MCID_CMD;
 	set->cmd = cmd;
 	set->resp_len = 0;
@@ -1716,9 +1979,11 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 		mask |= SDMMC_PSR_CMDINHD;
 	while (regs->SDMMC_PSR & mask) ;
 
-	/* Enable normal interrupts */
-	regs->SDMMC_NISTER |= SDMMC_NISTER_BRDRDY | SDMMC_NISTER_BWRRDY
-	    | SDMMC_NISTER_TRFC | SDMMC_NISTER_CMDC;
+	/* Enable normal interrupts. The DMA interrupt is only used to refill
+	 * a chained descriptor table. */
+	regs->SDMMC_NISTER = (regs->SDMMC_NISTER & ~SDMMC_NISTER_DMAINT)
+	    | SDMMC_NISTER_BRDRDY | SDMMC_NISTER_BWRRDY | SDMMC_NISTER_TRFC
+	    | SDMMC_NISTER_CMDC | (set->chained ? SDMMC_NISTER_DMAINT : 0);
 	assert(!(regs->SDMMC_NISTER & SDMMC_NISTR_CUSTOM_EVT));
 	/* Enable error interrupts */
 	
@@ -1744,7 +2009,8 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 	/* Issue the command */
 	if (has_data) {
 		if (blk_count_prefix)
-			regs->SDMMC_SSAR = SDMMC_SSAR_ARG2(cmd->wNbBlocks);
+			regs->SDMMC_SSAR = SDMMC_SSAR_ARG2(cmd->wNbBlocks
+			    | cmd->dwSetBlkCntFlags);
 		if (use_dma)
 			regs->SDMMC_ASA0R =
 			    SDMMC_ASA0R_ADMASA((uint32_t)set->table);
@@ -1792,7 +2058,8 @@ static uint32_t sdmmc_send_command(void *_set, sSdmmcCommand *cmd)
 	}
 	if (!set->use_polling) {
 		regs->SDMMC_NISIER |= SDMMC_NISIER_BRDRDY | SDMMC_NISIER_BWRRDY
-			| SDMMC_NISIER_TRFC | SDMMC_NISIER_CMDC | SDMMC_NISIER_CINT;
+			| SDMMC_NISIER_DMAINT | SDMMC_NISIER_TRFC
+			| SDMMC_NISIER_CMDC | SDMMC_NISIER_CINT;
 		regs->SDMMC_EISIER = eister;
 	}
 	return SDMMC_OK;
@@ -1850,6 +2117,17 @@ bool sdmmc_initialize(struct sdmmc_set *set, uint32_t periph_id,
 	set->regs = regs;
 	set->tc_id = tc_id;
 	set->timer = &tc_module->TC_CHANNEL[tc_ch];
+	/* Reserve the bounce buffers at the end of the DMA buffer, aligned on
+	 * cache lines, provided at least 8 descriptor lines remain */
+	if (dma_buf && dma_buf_size * 4 >= (SDMMC_BOUNCE_SLOTS + 1)
+	    * SDMMC_BOUNCE_SIZE + 8 * SDMMC_DMADL_SIZE * 4) {
+		val = ((uint32_t)(dma_buf + dma_buf_size)
+		    - SDMMC_BOUNCE_SLOTS * SDMMC_BOUNCE_SIZE)
+		    & ~(SDMMC_BOUNCE_SIZE - 1);
+		set->bounce = (uint8_t *)val;
+		set->bounce_cnt = SDMMC_BOUNCE_SLOTS;
+		dma_buf_size = (val - (uint32_t)dma_buf) / 4;
+	}
 	set->table_size = dma_buf ? dma_buf_size / SDMMC_DMADL_SIZE : 0;
 	set->table = set->table_size ? dma_buf : NULL;
 	set->is_cd = get_card_detect_status;
@@ -46,6 +46,23 @@ struct _SdmmcCommand;
  *         Definitions
  *----------------------------------------------------------------------------*/
 
+#ifndef SDMMC_BOUNCE_SLOTS
+/** Count of bounce buffers reserved at the end of the DMA buffer. They carry
+ * the misaligned edges of data fragments. Shall be even, and at least 2. */
+#define SDMMC_BOUNCE_SLOTS 8
+#endif
+
+/** Size of one bounce buffer, in bytes */
+#define SDMMC_BOUNCE_SIZE L1_CACHE_BYTES
+
+#ifndef SDMMC_CHAIN_MIN_LINES
+/** Minimum count of data lines in each half of the descriptor table, for
+ * transfers larger than the table to be carried out by refilling it. The
+ * ADMA runs the lines following the first one of a half while the driver
+ * refills the other half. Smaller tables shorten such transfers instead. */
+#define SDMMC_CHAIN_MIN_LINES 4
+#endif
+
 /* This structure is private to the SDMMC Driver.
  * Allocate it but ignore its members. */
 struct sdmmc_set
@@ -58,6 +75,19 @@ struct sdmmc_set
                                        * is not used */
 	uint32_t table_size;          /* Max size of the ADMA descriptor table,
                                        * in lines */
+	uint8_t *bounce;              /* bounce buffers, or NULL */
+	uint8_t bounce_cnt;           /* count of bounce buffers */
+	uint8_t *bounce_dst[SDMMC_BOUNCE_SLOTS]; /* where to copy the data
+				       * received in each bounce buffer, NULL
+				       * if none */
+	uint8_t bounce_len[SDMMC_BOUNCE_SLOTS]; /* size of the data received
+				       * in each bounce buffer */
+	uint16_t frag_ix;             /* next data fragment to set up DMA for */
+	uint32_t frag_off;            /* offset in this fragment, in bytes */
+	bool chained;                 /* the descriptor table is used as a ring
+				       * of two halves, refilled on the fly */
+	uint8_t chain_half;           /* half of the table being processed */
+	uint32_t chain_last[2];       /* last data line of each half */
 	bool (*is_cd)(uint32_t id);   /* Card detection platform routine */
 	bool use_polling;             /* polling mode */
 	bool use_set_blk_cnt;         /* implicit SET_BLOCK_COUNT command */
@@ -124,6 +154,14 @@ extern void sdmmc_set_capabilities(Sdmmc* regs,
  * used. This is where the DMA descriptor table will be set up. The larger
  * the buffer is, the greater throughput we achieve. Up to 4 KiB. Shall be
  * word-aligned. NULL to have the CPU read/write data, word by word.
+ * Unless the buffer is very small, its last SDMMC_BOUNCE_SLOTS *
+ * SDMMC_BOUNCE_SIZE bytes are reserved for bounce buffers. Data buffers that
+ * are not aligned on a cache line boundary are then accepted. Transfers that
+ * require more lines than the table holds are carried out by refilling the
+ * table while the transfer proceeds, provided the table holds at least
+ * 2 * (SDMMC_CHAIN_MIN_LINES + 1) lines. With a smaller table, such
+ * transfers are shortened and complete with SDMMC_CHANGED, or fail with
+ * SDMMC_NOT_SUPPORTED if they are fragmented.
  * \param dma_buf_size  Size of the dma_buf buffer, in words.
  * \param use_polling  Use interrupts if false, otherwise only use polling
  * \param get_card_detect_status  Optional card detection routine
@@ -43,6 +43,7 @@
 #ifdef CONFIG_HAVE_QSPI_DMA
 #include "barriers.h"
 #include "dma/dma.h"
+#include "irq/irq.h"
 #include "mm/cache.h"
 #endif
 
@@ -52,43 +53,194 @@
 
 //#define QSPI_VERBOSE_DEBUG
 
+#ifdef CONFIG_HAVE_QSPI_DMA
+/** Data phases shorter than this (in bytes) are copied by the CPU */
+#ifndef QSPI_DMA_THRESHOLD
+#define QSPI_DMA_THRESHOLD 64
+#endif
+
+/** DMA burst length, in data */
+#define QSPI_DMA_CHUNK_SIZE DMA_CHUNK_SIZE_16
+#define QSPI_DMA_CHUNK_LEN  16
+#endif
+
 /*----------------------------------------------------------------------------
  *        LOCAL FUNCTIONS
  *----------------------------------------------------------------------------*/
 
-static void * qspi_memcpy(union spi_flash_priv* priv, uint8_t *dst, const uint8_t *src, int count, bool use_dma)
+/**
+ * \brief Copy data with the CPU, using word accesses when both pointers allow
+ * it.
+ */
+static void qspi_cpu_copy(uint8_t *dst, const uint8_t *src, size_t count)
 {
+	if (((uint32_t)dst & 3) == 0 && ((uint32_t)src & 3) == 0) {
+		while (count >= 4) {
+			*(uint32_t*)dst = *(const uint32_t*)src;
+			dst += 4;
+			src += 4;
+			count -= 4;
+		}
+	}
+	while (count--)
+		*dst++ = *src++;
+}
+
+/**
+ * \brief Release the chip-select (if requested) and wait for the end of the
+ * current instruction.
+ */
+static int qspi_end_instruction(Qspi *qspi, uint32_t timeout, bool last_xfer)
+{
+	struct _timeout to;
+
+	if (last_xfer)
+		qspi->QSPI_CR = QSPI_CR_LASTXFER;
+
+	/* Wait for INSTRuction End */
+	timer_start_timeout(&to, timeout);
+	while (!(qspi->QSPI_SR & QSPI_SR_INSTRE)) {
+		if (timer_timeout_reached(&to)) {
+			trace_debug("qspi_exec timeout reached\r\n");
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
 #ifdef CONFIG_HAVE_QSPI_DMA
-	if (use_dma) {
-		uint32_t rc;
-		struct _dma_transfer_cfg cfg = {
-			.daddr = (void *)dst,
-			.saddr = (void *)src,
-			.len = count,
-		};
-		static struct _dma_cfg dma_cfg = {
+static int qspi_dma_callback(void *arg, void *arg2)
+{
+	union spi_flash_priv* priv = (union spi_flash_priv*)arg;
+
+	dma_reset_channel(priv->qspi.dma_ch);
+
+	if (priv->qspi.xfer.rx)
+		cache_invalidate_region(priv->qspi.xfer.body, priv->qspi.xfer.body_len);
+	dsb();
+
+	qspi_cpu_copy(priv->qspi.xfer.tail_dst, priv->qspi.xfer.tail_src, priv->qspi.xfer.tail_len);
+
+	if (!priv->qspi.xfer.callback.method) {
+		/* blocking transfer, qspi_exec() ends the instruction */
+		priv->qspi.xfer.busy = false;
+		return 0;
+	}
+
+	/* Release the chip-select without waiting in interrupt context: the
+	 * instruction end interrupt completes the transfer */
+	priv->qspi.addr->QSPI_CR = QSPI_CR_LASTXFER;
+	priv->qspi.addr->QSPI_IER = QSPI_IER_INSTRE;
+
+	return 0;
+}
+
+static void qspi_handler(uint32_t source, void* user_arg)
+{
+	union spi_flash_priv* priv = (union spi_flash_priv*)user_arg;
+	Qspi* qspi = priv->qspi.addr;
+	struct _callback cb;
+
+	/* INSTRE is cleared on read */
+	if (!(qspi->QSPI_SR & QSPI_SR_INSTRE))
+		return;
+	qspi->QSPI_IDR = QSPI_IDR_INSTRE;
+
+	callback_copy(&cb, &priv->qspi.xfer.callback);
+	priv->qspi.xfer.busy = false;
+	callback_call(&cb, (void*)0);
+}
+#endif /* CONFIG_HAVE_QSPI_DMA */
+
+/**
+ * \brief Copy the data phase of a command from/to the QSPI memory area.
+ *
+ * When DMA is allowed, the copy is split in three parts: a head copied by the
+ * CPU up to the first cache line of the system memory buffer, a body
+ * transferred by DMA in bursts of QSPI_DMA_CHUNK_LEN data, using word accesses
+ * when source and destination have the same alignment, and a tail copied by
+ * the CPU. The body only covers whole cache lines of the system memory buffer
+ * so that cache maintenance never touches data outside of it.
+ *
+ * \param priv     Pointer to the QSPI private data.
+ * \param dst      Destination address.
+ * \param src      Source address.
+ * \param count    Number of bytes to copy.
+ * \param rx       true if \a dst is in system memory (read command).
+ * \param use_dma  Allow use of the DMA.
+ * \param cb       Completion callback, NULL for a blocking copy.
+ * \return 0 if the copy is complete, -EINPROGRESS if the instruction end
+ * interrupt will invoke \a cb.
+ */
+static int qspi_memcpy(union spi_flash_priv* priv, uint8_t *dst, const uint8_t *src,
+		       size_t count, bool rx, bool use_dma, struct _callback *cb)
+{
+#ifdef CONFIG_HAVE_QSPI_DMA
+	if (use_dma && count >= QSPI_DMA_THRESHOLD) {
+		uint8_t *mem = rx ? dst : (uint8_t*)src;
+		size_t head, body, align;
+		struct _callback dma_cb;
+		struct _dma_transfer_cfg cfg;
+		struct _dma_cfg dma_cfg = {
 			.incr_saddr = true,
 			.incr_daddr = true,
-			.data_width = DMA_DATA_WIDTH_BYTE,
-			.chunk_size = DMA_CHUNK_SIZE_1,
+			.chunk_size = QSPI_DMA_CHUNK_SIZE,
 			.loop = false,
 		};
-		dma_configure_transfer(priv->qspi.dma_ch, &dma_cfg, &cfg, 1);
-		rc = dma_start_transfer(priv->qspi.dma_ch);
-		if (rc != 0)
-			trace_fatal("Couldn't start xDMA transfer\n\r");
-		while (!dma_is_transfer_done(priv->qspi.dma_ch))
-			dma_poll();
-		dma_reset_channel(priv->qspi.dma_ch);
-		dsb();
-
-		return dst;
+
+		if ((((uint32_t)dst ^ (uint32_t)src) & 3) == 0) {
+			dma_cfg.data_width = DMA_DATA_WIDTH_WORD;
+			align = 4 * QSPI_DMA_CHUNK_LEN;
+		} else {
+			dma_cfg.data_width = DMA_DATA_WIDTH_BYTE;
+			align = QSPI_DMA_CHUNK_LEN;
+		}
+		if (align < L1_CACHE_BYTES)
+			align = L1_CACHE_BYTES;
+
+		head = (L1_CACHE_BYTES - ((uint32_t)mem & (L1_CACHE_BYTES - 1))) & (L1_CACHE_BYTES - 1);
+		body = count > head ? (count - head) & ~(align - 1) : 0;
+
+		if (body >= QSPI_DMA_THRESHOLD) {
+			cfg.saddr = (void*)(src + head);
+			cfg.daddr = (void*)(dst + head);
+			cfg.len = dma_cfg.data_width == DMA_DATA_WIDTH_WORD ? body / 4 : body;
+			if (dma_configure_transfer(priv->qspi.dma_ch, &dma_cfg, &cfg, 1) == 0) {
+				priv->qspi.xfer.busy = true;
+				priv->qspi.xfer.rx = rx;
+				priv->qspi.xfer.body = mem + head;
+				priv->qspi.xfer.body_len = body;
+				priv->qspi.xfer.tail_dst = dst + head + body;
+				priv->qspi.xfer.tail_src = src + head + body;
+				priv->qspi.xfer.tail_len = count - head - body;
+				callback_copy(&priv->qspi.xfer.callback, cb);
+				callback_set(&dma_cb, qspi_dma_callback, priv);
+				dma_set_callback(priv->qspi.dma_ch, &dma_cb);
+
+				/* QSPI accesses must be sequential: copy the head
+				 * before starting the DMA */
+				qspi_cpu_copy(dst, src, head);
+				if (rx)
+					cache_invalidate_region(mem + head, body);
+				else
+					cache_clean_region(mem + head, body);
+				dsb();
+
+				if (dma_start_transfer(priv->qspi.dma_ch) != 0)
+					trace_fatal("Couldn't start xDMA transfer\n\r");
+
+				if (cb)
+					return -EINPROGRESS;
+
+				while (priv->qspi.xfer.busy)
+					dma_poll();
+				return 0;
+			}
+		}
 	}
 #endif
-	while (count--) {
-		*dst++ = *src;
-		src++;
-	}
+	qspi_cpu_copy(dst, src, count);
 	return 0;
 }
 
@@ -174,6 +326,11 @@ static int qspi_init(union spi_flash_priv* priv)
 	priv->qspi.dma_ch = dma_allocate_channel(DMA_PERIPH_MEMORY, DMA_PERIPH_MEMORY);
 	if (!priv->qspi.dma_ch)
 		trace_fatal("Couldn't allocate XDMA channel\n\r");
+
+	/* Instruction end of the non-blocking transfers */
+	qspi->QSPI_IDR = ~0u;
+	irq_add_handler(get_qspi_id_from_addr(qspi), qspi_handler, priv);
+	irq_enable(get_qspi_id_from_addr(qspi));
 #endif
 
 	return 0;
@@ -183,6 +340,11 @@ static int qspi_cleanup(union spi_flash_priv* priv)
 {
 	Qspi* qspi = priv->qspi.addr;
 
+#ifdef CONFIG_HAVE_QSPI_DMA
+	irq_disable(get_qspi_id_from_addr(qspi));
+	irq_remove_handler(get_qspi_id_from_addr(qspi), qspi_handler);
+#endif
+
 	qspi->QSPI_CR = QSPI_CR_QSPIDIS;
 	qspi->QSPI_CR = QSPI_CR_SWRST;
 
@@ -299,6 +461,7 @@ static int qspi_exec(union spi_flash_priv* priv, const struct spi_flash_command
 	uint32_t offset;
 	uint8_t *ptr;
 	bool use_dma = false;
+	int rc;
 	bool enable_data =
 		(((cmd->flags & SFLASH_TYPE_MASK) == SFLASH_TYPE_READ ) ||
 		 ((cmd->flags & SFLASH_TYPE_MASK) == SFLASH_TYPE_WRITE ) ||
@@ -309,6 +472,12 @@ static int qspi_exec(union spi_flash_priv* priv, const struct spi_flash_command
 	bool icr_write = false;
 #endif
 
+#ifdef CONFIG_HAVE_QSPI_DMA
+	/* A non-blocking data phase is still in progress */
+	if (priv->qspi.xfer.busy)
+		return -EBUSY;
+#endif
+
 	iar = 0;
 	icr = 0;
 
@@ -479,64 +648,43 @@ next:
 	(void)qspi->QSPI_IFR;
 
 #ifdef CONFIG_HAVE_QSPI_DMA
-	if (((cmd->flags == QSPI_IFR_TFRTYP_TRSFR_WRITE_MEMORY) &&
-	     IS_CACHE_ALIGNED(cmd->tx_data) &&
-	     IS_CACHE_ALIGNED(cmd->data_len)) ||
-	    ((cmd->flags == QSPI_IFR_TFRTYP_TRSFR_READ_MEMORY) &&
-	     IS_CACHE_ALIGNED(cmd->rx_data) &&
-	     IS_CACHE_ALIGNED(cmd->data_len)))
+	if (((cmd->flags & SFLASH_TYPE_MASK) == SFLASH_TYPE_WRITE) ||
+	    ((cmd->flags & SFLASH_TYPE_MASK) == SFLASH_TYPE_READ))
 		use_dma = true;
 #endif
 
-	/* Stop here for Continuous Read. */
-	if (cmd->tx_data) {
-		/* Write data */
 #ifdef CONFIG_HAVE_AESB
-		if (cmd->use_aesb)
-			ptr = priv->qspi.mem_aesb;
-		else
+	if (cmd->use_aesb)
+		ptr = priv->qspi.mem_aesb;
+	else
 #endif
-			ptr = priv->qspi.mem;
+		ptr = priv->qspi.mem;
 
-#ifdef CONFIG_HAVE_QSPI_DMA
-		if (use_dma)
-			cache_clean_region(cmd->tx_data, cmd->data_len);
-#endif
-		qspi_memcpy(priv, ptr + offset, cmd->tx_data, cmd->data_len, use_dma);
+	if (cmd->tx_data) {
+		/* Write data */
+		rc = qspi_memcpy(priv, ptr + offset, cmd->tx_data, cmd->data_len,
+				 false, use_dma, cmd->callback);
 	} else if (cmd->rx_data) {
 		/* Read data */
-#ifdef CONFIG_HAVE_AESB
-		if (cmd->use_aesb)
-			ptr = priv->qspi.mem_aesb;
-		else
-#endif
-			ptr = priv->qspi.mem;
-
-		qspi_memcpy(priv, cmd->rx_data, ptr + offset, cmd->data_len, use_dma);
-#ifdef CONFIG_HAVE_QSPI_DMA
-		if (use_dma)
-			cache_invalidate_region(cmd->rx_data, cmd->data_len);
-#endif
+		rc = qspi_memcpy(priv, cmd->rx_data, ptr + offset, cmd->data_len,
+				 true, use_dma, cmd->callback);
 	} else {
 		/* Stop here for continuous read */
+		callback_call(cmd->callback, (void*)0);
 		return 0;
 	}
 
-	/* Release the chip-select. */
-	qspi->QSPI_CR = QSPI_CR_LASTXFER;
+	/* The DMA completion releases the chip-select and the instruction end
+	 * interrupt invokes the callback */
+	if (rc == -EINPROGRESS)
+		return 0;
 
 no_data:
-	{
-		/* Wait for INSTRuction End */
-		struct _timeout timeout;
-		timer_start_timeout(&timeout, cmd->timeout);
-		while (!(qspi->QSPI_SR & QSPI_SR_INSTRE)) {
-			if (timer_timeout_reached(&timeout)) {
-				trace_debug("qspi_exec timeout reached\r\n");
-				return -ETIMEDOUT;
-			}
-		}
-	}
+	/* Release the chip-select (if any data) and wait for the end of the
+	 * instruction. */
+	rc = qspi_end_instruction(qspi, cmd->timeout, enable_data);
+	if (rc < 0)
+		return rc;
 
 #ifdef QSPI_VERBOSE_DEBUG
 	{
@@ -558,6 +706,8 @@ no_data:
 	}
 #endif /* QSPI_VERBOSE_DEBUG */
 
+	callback_call(cmd->callback, (void*)0);
+
 	return 0;
 }
 
@@ -29,6 +29,12 @@
 #ifndef	QSPI_H_
 #define	QSPI_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "callback.h"
+
 #ifdef CONFIG_HAVE_QSPI_DMA
 #include "dma/dma.h"
 #include "mm/cache.h"
@@ -50,6 +56,18 @@ struct qspi_priv {
 #endif
 #ifdef CONFIG_HAVE_QSPI_DMA
 	struct _dma_channel *dma_ch;
+
+	/* State of the current DMA data phase */
+	struct {
+		volatile bool busy;
+		bool rx;
+		uint8_t *body;		/* system memory side of the DMA block */
+		size_t body_len;
+		uint8_t *tail_dst;	/* remaining bytes copied by the CPU */
+		const uint8_t *tail_src;
+		size_t tail_len;
+		struct _callback callback;	/* non-blocking completion */
+	} xfer;
 #endif
 };
 
@@ -199,6 +199,9 @@ static void _display_menu(void)
 	printf("- DMA transfer type\n\r");
 	printf("    S: Single Block transfer\n\r");
 	printf("    L: Linked List transfer\n\r");
+#ifdef CONFIG_HAVE_DMA_STATS
+	printf("- P: Print DMA statistics\n\r");
+#endif
 	printf("- H: Display this menu\n\r");
 	printf("\n\r");
 }
@@ -350,6 +353,10 @@ extern int main(void)
 			configured = true;
 		} else if (key == 'H') {
 			_display_menu();
+#ifdef CONFIG_HAVE_DMA_STATS
+		} else if (key == 'P' || key == 'p') {
+			dma_dump_stats();
+#endif
 		} else if (configured && (key == 'T' || key == 't')) {
 			trace_info("Start DMA transfer\n\r");
 			_start_dma_transfer();
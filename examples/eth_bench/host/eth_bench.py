@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------------------------------
+#         SAM Software Package License
+# ----------------------------------------------------------------------------
+# Copyright (c) 2018, Atmel Corporation
+#
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the disclaimer below.
+#
+# Atmel's name may not be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+# IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+# DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+# LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+# EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+# ----------------------------------------------------------------------------
+
+"""Host side driver of the eth_bench example.
+
+Each test prints a single JSON object on stdout. The TCP/UDP tests only rely
+on plain sockets, so they can also be pointed at any discard/echo service
+(e.g. the uIP examples, or the lwIP stack running on a development host).
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+import time
+
+PORT_SINK = 5001
+PORT_SOURCE = 5002
+PORT_ECHO = 7
+ETHERTYPE = 0x88b5
+RAW_FRAME_SIZE = 60
+
+
+def report(result):
+    print(json.dumps(result, sort_keys=True))
+    sys.stdout.flush()
+
+
+def kbps(nbytes, seconds):
+    return int(nbytes * 8 / 1000 / seconds) if seconds > 0 else 0
+
+
+def tcp_rx(args):
+    """Send data to the device TCP sink (device receive throughput)"""
+    data = bytes(range(256)) * (args.size // 256 + 1)
+    data = data[:args.size]
+    sent = 0
+    with socket.create_connection((args.host, args.port or PORT_SINK)) as s:
+        start = time.perf_counter()
+        while time.perf_counter() - start < args.duration:
+            s.sendall(data)
+            sent += len(data)
+        s.shutdown(socket.SHUT_WR)
+        s.recv(1)
+        elapsed = time.perf_counter() - start
+    report({"test": "tcp_rx", "bytes": sent, "ms": int(elapsed * 1000),
+            "kbps": kbps(sent, elapsed)})
+
+
+def tcp_tx(args):
+    """Receive data from the device TCP source (device transmit throughput)"""
+    received = 0
+    with socket.create_connection((args.host, args.port or PORT_SOURCE)) as s:
+        start = time.perf_counter()
+        while True:
+            chunk = s.recv(65536)
+            if not chunk:
+                break
+            received += len(chunk)
+        elapsed = time.perf_counter() - start
+    report({"test": "tcp_tx", "bytes": received, "ms": int(elapsed * 1000),
+            "kbps": kbps(received, elapsed)})
+
+
+def udp_rx(args):
+    """Send sequenced datagrams to the device UDP sink, then get its counters"""
+    addr = (args.host, args.port or PORT_SINK)
+    payload = bytes(max(args.size - 4, 0))
+    interval = args.size * 8 / (args.rate * 1000) if args.rate else 0
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.sendto(b"RST", addr)
+        seq = 0
+        start = time.perf_counter()
+        deadline = start
+        while time.perf_counter() - start < args.duration:
+            s.sendto(struct.pack(">I", seq) + payload, addr)
+            seq += 1
+            if interval:
+                deadline += interval
+                while time.perf_counter() < deadline:
+                    pass
+        elapsed = time.perf_counter() - start
+        time.sleep(0.1)
+        s.settimeout(2)
+        s.sendto(b"END", addr)
+        try:
+            device = json.loads(s.recv(512).decode())
+        except (socket.timeout, ValueError):
+            device = None
+    result = {"test": "udp_rx", "sent": seq, "ms": int(elapsed * 1000),
+              "offered_kbps": kbps(seq * args.size, elapsed)}
+    if device:
+        result["device"] = device
+    report(result)
+
+
+def percentile(values, pct):
+    if not values:
+        return 0
+    return values[min(len(values) - 1, int(len(values) * pct / 100))]
+
+
+def rtt(args):
+    """UDP ping-pong with the device echo service"""
+    addr = (args.host, args.port or PORT_ECHO)
+    # Each probe starts with its sequence number, so that a reply arriving
+    # after its timeout is not taken for the reply to the next probe
+    padding = bytes(max(args.size - 4, 0))
+    timeout = args.timeout / 1000
+    samples = []
+    lost = 0
+    late = 0
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        for seq in range(args.count):
+            start = time.perf_counter()
+            deadline = start + timeout
+            s.sendto(struct.pack(">I", seq) + padding, addr)
+            while True:
+                remaining = deadline - time.perf_counter()
+                if remaining <= 0:
+                    lost += 1
+                    break
+                s.settimeout(remaining)
+                try:
+                    reply = s.recv(65536)
+                except socket.timeout:
+                    lost += 1
+                    break
+                if len(reply) >= 4 and struct.unpack(">I", reply[:4])[0] == seq:
+                    samples.append(int((time.perf_counter() - start) * 1e6))
+                    break
+                late += 1
+    samples.sort()
+    # Histogram with power of two buckets, as [upper bound (us), count]
+    histogram = {}
+    for us in samples:
+        bucket = 1 << max(us, 1).bit_length()
+        histogram[bucket] = histogram.get(bucket, 0) + 1
+    report({"test": "rtt", "count": args.count, "lost": lost, "late": late,
+            "size": len(padding) + 4,
+            "min_us": samples[0] if samples else 0,
+            "avg_us": sum(samples) // len(samples) if samples else 0,
+            "p50_us": percentile(samples, 50),
+            "p99_us": percentile(samples, 99),
+            "max_us": samples[-1] if samples else 0,
+            "histogram_us": [[k, v] for k, v in sorted(histogram.items())]})
+
+
+def raw_tx(args):
+    """Send minimum size frames to the device ('r' test), needs root"""
+    s = socket.socket(socket.AF_PACKET, socket.SOCK_RAW)
+    s.bind((args.iface, 0))
+    src = s.getsockname()[4]
+    dst = bytes.fromhex(args.mac.replace(":", "")) if args.mac else b"\xff" * 6
+    header = dst + src + struct.pack(">H", ETHERTYPE)
+    padding = bytes(RAW_FRAME_SIZE - len(header) - 4)
+    frames = 0
+    start = time.perf_counter()
+    while time.perf_counter() - start < args.duration:
+        s.send(header + struct.pack(">I", frames) + padding)
+        frames += 1
+    elapsed = time.perf_counter() - start
+    s.close()
+    report({"test": "raw_tx", "frame_size": RAW_FRAME_SIZE, "frames": frames,
+            "ms": int(elapsed * 1000), "fps": int(frames / elapsed)})
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="192.168.1.3", help="device address")
+    parser.add_argument("--port", type=int, default=0, help="override the test port")
+    parser.add_argument("--duration", type=float, default=10, help="test duration (s)")
+    sub = parser.add_subparsers(dest="test")
+    sub.required = True
+
+    p = sub.add_parser("tcp-rx", help=tcp_rx.__doc__)
+    p.add_argument("--size", type=int, default=8192, help="write size")
+    p.set_defaults(func=tcp_rx)
+
+    p = sub.add_parser("tcp-tx", help=tcp_tx.__doc__)
+    p.set_defaults(func=tcp_tx)
+
+    p = sub.add_parser("udp-rx", help=udp_rx.__doc__)
+    p.add_argument("--size", type=int, default=1470, help="datagram size")
+    p.add_argument("--rate", type=int, default=0, help="rate limit (kbit/s)")
+    p.set_defaults(func=udp_rx)
+
+    p = sub.add_parser("rtt", help=rtt.__doc__)
+    p.add_argument("--count", type=int, default=1000)
+    p.add_argument("--size", type=int, default=18, help="payload size (min 4)")
+    p.add_argument("--timeout", type=int, default=100, help="timeout (ms)")
+    p.set_defaults(func=rtt)
+
+    p = sub.add_parser("raw-tx", help=raw_tx.__doc__)
+    p.add_argument("--iface", required=True, help="host interface")
+    p.add_argument("--mac", help="device MAC address (default: broadcast)")
+    p.set_defaults(func=raw_tx)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,65 @@
+#if !defined LWIPOPTS_H
+#define LWIPOPTS_H
+
+#define NO_SYS                          1
+#define NO_SYS_NO_TIMERS                1
+
+#define LWIP_MPU_COMPATIBLE             0
+#define LWIP_TCPIP_CORE_LOCKING         0
+#define LWIP_TCPIP_CORE_LOCKING_INPUT   0
+#define SYS_LIGHTWEIGHT_PROT            0
+
+#define MEM_ALIGNMENT                   4
+#define MEM_SIZE                        (32 * 1024)
+#define PBUF_POOL_SIZE                  32
+
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+#define ETHIF_ZERO_COPY                 1
+
+/* Software checksums are disabled on the interfaces whose MAC handles them */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+
+#define LWIP_ARP                        1
+#define LWIP_ETHERNET                   LWIP_ARP
+
+#define LWIP_IPV4                       1
+#define IP_REASSEMBLY                   0
+#define IP_FRAG                         0
+
+#define LWIP_ICMP                       1
+
+#define LWIP_RAW                        0
+
+#define LWIP_DHCP                       0
+
+#define LWIP_AUTOIP                     0
+
+#define LWIP_IGMP                       0
+
+#define LWIP_DNS                        0
+
+#define LWIP_UDP                        1
+
+#define LWIP_TCP                        1
+#define TCP_MSS                         1460
+#define TCP_WND                         (8 * TCP_MSS)
+#define TCP_SND_BUF                     (8 * TCP_MSS)
+#define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF / TCP_MSS)
+#define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
+
+/* Loopback traffic (127.0.0.1), used to measure the stack alone. It goes
+ * through the ETH netif: a separate loop interface would be added first by
+ * lwip_init() and shift the netif number given to board_get_eth() by ethif */
+#define LWIP_NETIF_LOOPBACK             1
+#define LWIP_HAVE_LOOPIF                0
+
+#define LWIP_EVENT_API                  0
+#define LWIP_CALLBACK_API               1
+
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+#define LWIP_STATS                      1
+#define LWIP_IPV6                       0
+#define LWIP_PERF                       0
+
+#endif /* LWIPOPTS_H */
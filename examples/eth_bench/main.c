@@ -0,0 +1,671 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ *  \page eth_bench ETH Benchmark Example
+ *
+ *  \section Purpose
+ *
+ *  This project measures the network performance of the device: TCP/UDP
+ *  throughput and UDP round-trip time through the lwIP stack, and frame
+ *  rate of the raw ETH driver.
+ *
+ *  \section Requirements
+ *
+ * - On-board ethernet interface.
+ * - A computer running host/eth_bench.py, in the same network as the device.
+ *
+ *  \section Description
+ *
+ *  The device runs the following services:
+ *  - TCP port 5001: data sink, throughput is reported when the connection is
+ *    closed by the peer.
+ *  - TCP port 5002: data source, data is sent during BENCH_DURATION ms then
+ *    the connection is closed.
+ *  - UDP port 5001: datagram sink, datagrams start with a 32-bit big-endian
+ *    sequence number used to count losses. A datagram starting with "RST"
+ *    resets the counters, one starting with "END" returns the results.
+ *  - UDP port 7: echo, used to measure round-trip time.
+ *
+ *  The following tests are started from the console:
+ *  - 'l': TCP transfer to the loopback address (stack only).
+ *  - 't': raw transmission of minimum size frames with ethd_send().
+ *  - 'r': raw reception with ethd_poll().
+ *  - 's': driver and lwIP statistics.
+ *
+ *  Every result is printed as a single JSON object per line, so that logs can
+ *  be parsed by scripts.
+ *
+ *  \section Usage
+ *
+ *  -# Build the program and download it inside the evaluation board.
+ *  -# On the computer, open and configure a terminal application
+ *     (e.g. HyperTerminal on Microsoft Windows) with these settings:
+ *    - 115200 bauds
+ *    - 8 bits of data
+ *    - No parity
+ *    - 1 stop bit
+ *    - No flow control
+ *  -# Connect an Ethernet cable between the evaluation board and the network.
+ *  -# Start the application, then run host/eth_bench.py on the computer,
+ *     e.g.:
+ *    \code
+ *    ./eth_bench.py --host 192.168.1.3 tcp-rx
+ *    ./eth_bench.py --host 192.168.1.3 rtt --count 10000
+ *    \endcode
+ */
+
+/** \file
+ *
+ *  This file contains all the specific code for the eth_bench example.
+ *
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "board.h"
+#include "board_eth.h"
+#include "cpuidle.h"
+#include "irqflags.h"
+#include "timer.h"
+
+#include "mm/cache.h"
+#include "network/ethd.h"
+
+#include "serial/console.h"
+
+#include "liblwip.h"
+#include "lwip/stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Duration of the tests started by the device, in ms */
+#ifndef BENCH_DURATION
+#define BENCH_DURATION 10000
+#endif
+
+/** TCP/UDP sink port */
+#define BENCH_PORT_SINK   5001
+
+/** TCP source port */
+#define BENCH_PORT_SOURCE 5002
+
+/** UDP echo port */
+#define BENCH_PORT_ECHO   7
+
+/** EtherType of the raw frames (local experimental) */
+#define BENCH_ETHERTYPE   0x88b5
+
+/** Size of the raw frames, minimum Ethernet frame without FCS */
+#define BENCH_RAW_FRAME_SIZE 60
+
+/** Size of the JSON reports */
+#define BENCH_REPORT_SIZE 192
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** TCP benchmark connection */
+struct _bench_tcp {
+	const char* test;
+	struct tcp_pcb* pcb;
+	uint64_t start;
+	uint32_t bytes;
+};
+
+/** UDP sink counters */
+struct _bench_udp {
+	uint64_t start;
+	uint64_t last;
+	uint32_t datagrams;
+	uint32_t bytes;
+	uint32_t next_seq;
+	uint32_t lost;
+	uint32_t out_of_order;
+};
+
+/*---------------------------------------------------------------------------
+ *         Variables
+ *---------------------------------------------------------------------------*/
+
+/* The MAC address used for demo */
+static uint8_t _mac_addr[6];
+
+/* The IP address used for demo (ping ...) */
+static uint8_t _ip_addr[4] = {192, 168, 1, 3};
+
+/* Set the default router's IP address. */
+static const uint8_t _gw_ip_addr[4] = {192, 168, 1, 2};
+
+/* The NetMask address */
+static const uint8_t _netmask[4] = {255, 255, 255, 0};
+
+/* Data sent by the TCP sources */
+static uint8_t _pattern[TCP_MSS];
+
+/* TCP connections */
+static struct _bench_tcp _tcp_sink;
+static struct _bench_tcp _tcp_source;
+
+/* UDP sink counters */
+static struct _bench_udp _udp_sink;
+
+/* Raw frames buffer */
+CACHE_ALIGNED static uint8_t _raw_frame[ETH_MAX_FRAME_LENGTH];
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _bench_elapsed(uint64_t start)
+{
+	return (uint32_t)timer_get_interval(start, timer_get_tick());
+}
+
+static uint32_t _bench_kbps(uint32_t bytes, uint32_t ms)
+{
+	if (ms == 0)
+		return 0;
+	return (uint32_t)(((uint64_t)bytes * 8) / ms);
+}
+
+/*
+ * TCP
+ */
+
+static void _bench_tcp_report(struct _bench_tcp* conn)
+{
+	uint32_t ms = _bench_elapsed(conn->start);
+
+	printf("{\"test\":\"%s\",\"bytes\":%u,\"ms\":%u,\"kbps\":%u}\r\n",
+	       conn->test, (unsigned)conn->bytes, (unsigned)ms,
+	       (unsigned)_bench_kbps(conn->bytes, ms));
+}
+
+static void _bench_tcp_open(struct _bench_tcp* conn, struct tcp_pcb* pcb, const char* test)
+{
+	conn->test = test;
+	conn->pcb = pcb;
+	conn->start = timer_get_tick();
+	conn->bytes = 0;
+	tcp_arg(pcb, conn);
+}
+
+static void _bench_tcp_close(struct _bench_tcp* conn)
+{
+	struct tcp_pcb* pcb = conn->pcb;
+
+	conn->pcb = NULL;
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_sent(pcb, NULL);
+	tcp_poll(pcb, NULL, 0);
+	tcp_err(pcb, NULL);
+	if (tcp_close(pcb) != ERR_OK)
+		tcp_abort(pcb);
+}
+
+static void _bench_tcp_err(void* arg, err_t err)
+{
+	struct _bench_tcp* conn = (struct _bench_tcp*)arg;
+
+	if (conn) {
+		printf("{\"test\":\"%s\",\"error\":%d}\r\n", conn->test, (int)err);
+		conn->pcb = NULL;
+	}
+}
+
+static err_t _bench_tcp_sink_recv(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err)
+{
+	struct _bench_tcp* conn = (struct _bench_tcp*)arg;
+
+	if (p == NULL) {
+		/* Connection closed by the peer */
+		_bench_tcp_report(conn);
+		_bench_tcp_close(conn);
+		return ERR_OK;
+	}
+
+	conn->bytes += p->tot_len;
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static err_t _bench_tcp_sink_accept(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+
+	if (err != ERR_OK || _tcp_sink.pcb) {
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	_bench_tcp_open(&_tcp_sink, pcb,
+			ip_addr_isloopback(&pcb->local_ip) ? "tcp_loopback_rx" : "tcp_rx");
+	tcp_recv(pcb, _bench_tcp_sink_recv);
+	tcp_err(pcb, _bench_tcp_err);
+	return ERR_OK;
+}
+
+static void _bench_tcp_source_fill(struct _bench_tcp* conn)
+{
+	struct tcp_pcb* pcb = conn->pcb;
+	u16_t len;
+
+	while ((len = tcp_sndbuf(pcb)) > 0) {
+		if (len > sizeof(_pattern))
+			len = sizeof(_pattern);
+		if (tcp_write(pcb, _pattern, len, 0) != ERR_OK)
+			break;
+	}
+	tcp_output(pcb);
+}
+
+static err_t _bench_tcp_source_sent(void* arg, struct tcp_pcb* pcb, u16_t len)
+{
+	struct _bench_tcp* conn = (struct _bench_tcp*)arg;
+
+	conn->bytes += len;
+	if (_bench_elapsed(conn->start) >= BENCH_DURATION) {
+		_bench_tcp_report(conn);
+		_bench_tcp_close(conn);
+		return ERR_OK;
+	}
+
+	_bench_tcp_source_fill(conn);
+	return ERR_OK;
+}
+
+static err_t _bench_tcp_source_poll(void* arg, struct tcp_pcb* pcb)
+{
+	return _bench_tcp_source_sent(arg, pcb, 0);
+}
+
+static void _bench_tcp_source_start(struct tcp_pcb* pcb, const char* test)
+{
+	_bench_tcp_open(&_tcp_source, pcb, test);
+	tcp_sent(pcb, _bench_tcp_source_sent);
+	tcp_poll(pcb, _bench_tcp_source_poll, 2);
+	tcp_err(pcb, _bench_tcp_err);
+	_bench_tcp_source_fill(&_tcp_source);
+}
+
+static err_t _bench_tcp_source_accept(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+
+	if (err != ERR_OK || _tcp_source.pcb) {
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	_bench_tcp_source_start(pcb, "tcp_tx");
+	return ERR_OK;
+}
+
+static err_t _bench_tcp_loopback_connected(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+
+	if (err != ERR_OK)
+		return err;
+
+	_bench_tcp_source_start(pcb, "tcp_loopback_tx");
+	return ERR_OK;
+}
+
+/**
+ * Send data to the TCP sink through the loopback address, so that only
+ * the stack is measured
+ */
+static void _bench_tcp_loopback(void)
+{
+	struct tcp_pcb* pcb;
+	ip_addr_t addr;
+
+	if (_tcp_source.pcb) {
+		printf("{\"test\":\"tcp_loopback_tx\",\"error\":\"busy\"}\r\n");
+		return;
+	}
+
+	pcb = tcp_new();
+	if (!pcb) {
+		printf("{\"test\":\"tcp_loopback_tx\",\"error\":\"no memory\"}\r\n");
+		return;
+	}
+
+	/* Mark the connection as busy until it is established */
+	_bench_tcp_open(&_tcp_source, pcb, "tcp_loopback_tx");
+	tcp_err(pcb, _bench_tcp_err);
+	IP4_ADDR(&addr, 127, 0, 0, 1);
+	tcp_connect(pcb, &addr, BENCH_PORT_SINK, _bench_tcp_loopback_connected);
+}
+
+static void _bench_tcp_init(void)
+{
+	struct tcp_pcb* pcb;
+	uint32_t i;
+
+	for (i = 0; i < sizeof(_pattern); i++)
+		_pattern[i] = (uint8_t)i;
+
+	pcb = tcp_new();
+	tcp_bind(pcb, IP_ADDR_ANY, BENCH_PORT_SINK);
+	pcb = tcp_listen(pcb);
+	tcp_accept(pcb, _bench_tcp_sink_accept);
+
+	pcb = tcp_new();
+	tcp_bind(pcb, IP_ADDR_ANY, BENCH_PORT_SOURCE);
+	pcb = tcp_listen(pcb);
+	tcp_accept(pcb, _bench_tcp_source_accept);
+}
+
+/*
+ * UDP
+ */
+
+static void _bench_udp_sink_report(struct udp_pcb* pcb, const ip_addr_t* addr, u16_t port)
+{
+	struct _bench_udp* s = &_udp_sink;
+	char report[BENCH_REPORT_SIZE];
+	uint32_t ms;
+	struct pbuf* p;
+	int len;
+
+	ms = s->datagrams ? (uint32_t)timer_get_interval(s->start, s->last) : 0;
+	len = snprintf(report, sizeof(report),
+		"{\"test\":\"udp_rx\",\"datagrams\":%u,\"bytes\":%u,\"lost\":%u,"
+		"\"out_of_order\":%u,\"ms\":%u,\"kbps\":%u}",
+		(unsigned)s->datagrams, (unsigned)s->bytes, (unsigned)s->lost,
+		(unsigned)s->out_of_order, (unsigned)ms,
+		(unsigned)_bench_kbps(s->bytes, ms));
+	printf("%s\r\n", report);
+
+	/* Return the results to the sender */
+	p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+	if (p) {
+		pbuf_take(p, report, len);
+		udp_sendto(pcb, p, addr, port);
+		pbuf_free(p);
+	}
+}
+
+static void _bench_udp_sink_recv(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+		const ip_addr_t* addr, u16_t port)
+{
+	struct _bench_udp* s = &_udp_sink;
+	uint8_t hdr[4];
+	uint32_t seq;
+
+	if (pbuf_copy_partial(p, hdr, sizeof(hdr), 0) == sizeof(hdr)) {
+		if (!memcmp(hdr, "END", 3)) {
+			_bench_udp_sink_report(pcb, addr, port);
+			memset(s, 0, sizeof(*s));
+		} else if (!memcmp(hdr, "RST", 3)) {
+			memset(s, 0, sizeof(*s));
+		} else {
+			seq = ((uint32_t)hdr[0] << 24) | ((uint32_t)hdr[1] << 16) |
+			      ((uint32_t)hdr[2] << 8) | hdr[3];
+			s->last = timer_get_tick();
+			if (s->datagrams == 0)
+				s->start = s->last;
+			s->datagrams++;
+			s->bytes += p->tot_len;
+			if (seq >= s->next_seq) {
+				s->lost += seq - s->next_seq;
+				s->next_seq = seq + 1;
+			} else {
+				s->out_of_order++;
+				if (s->lost)
+					s->lost--;
+			}
+		}
+	}
+	pbuf_free(p);
+}
+
+static void _bench_udp_echo_recv(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+		const ip_addr_t* addr, u16_t port)
+{
+	udp_sendto(pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void _bench_udp_init(void)
+{
+	struct udp_pcb* pcb;
+
+	pcb = udp_new();
+	udp_bind(pcb, IP_ADDR_ANY, BENCH_PORT_SINK);
+	udp_recv(pcb, _bench_udp_sink_recv, NULL);
+
+	pcb = udp_new();
+	udp_bind(pcb, IP_ADDR_ANY, BENCH_PORT_ECHO);
+	udp_recv(pcb, _bench_udp_echo_recv, NULL);
+}
+
+/*
+ * Raw ETH driver
+ */
+
+/**
+ * Send minimum size broadcast frames with ethd_send() during BENCH_DURATION
+ */
+static void _bench_raw_tx(struct _ethd* ethd)
+{
+	uint32_t frames = 0, busy = 0, ms, seq = 0;
+	uint64_t start;
+
+	memset(_raw_frame, 0, BENCH_RAW_FRAME_SIZE);
+	memset(_raw_frame, 0xff, 6);
+	memcpy(&_raw_frame[6], _mac_addr, 6);
+	_raw_frame[12] = BENCH_ETHERTYPE >> 8;
+	_raw_frame[13] = BENCH_ETHERTYPE & 0xff;
+
+	start = timer_get_tick();
+	while (_bench_elapsed(start) < BENCH_DURATION) {
+		_raw_frame[14] = seq >> 24;
+		_raw_frame[15] = seq >> 16;
+		_raw_frame[16] = seq >> 8;
+		_raw_frame[17] = seq;
+		if (ethd_send(ethd, 0, _raw_frame, BENCH_RAW_FRAME_SIZE, NULL) == ETH_OK) {
+			frames++;
+			seq++;
+		} else {
+			busy++;
+		}
+	}
+	ms = _bench_elapsed(start);
+
+	/* Wait for the last frames to be sent */
+	while (ethd_get_tx_load(ethd, 0));
+
+	printf("{\"test\":\"raw_tx\",\"frame_size\":%u,\"frames\":%u,\"busy\":%u,"
+	       "\"ms\":%u,\"fps\":%u}\r\n",
+	       BENCH_RAW_FRAME_SIZE, (unsigned)frames, (unsigned)busy,
+	       (unsigned)ms, (unsigned)(ms ? (uint64_t)frames * 1000 / ms : 0));
+}
+
+/**
+ * Receive frames with ethd_poll() during BENCH_DURATION. lwIP is not polled
+ * meanwhile.
+ */
+static void _bench_raw_rx(struct _ethd* ethd)
+{
+	struct _ethd_rx_stats stats;
+	uint32_t frames = 0, bench_frames = 0, bytes = 0, size, ms;
+	uint64_t start;
+
+	ethd_get_rx_stats(ethd, 0, &stats, true);
+
+	start = timer_get_tick();
+	while (_bench_elapsed(start) < BENCH_DURATION) {
+		if (ethd_poll(ethd, 0, _raw_frame, sizeof(_raw_frame), &size) != ETH_OK)
+			continue;
+		frames++;
+		bytes += size;
+		if (size >= 14 && _raw_frame[12] == (BENCH_ETHERTYPE >> 8) &&
+		    _raw_frame[13] == (BENCH_ETHERTYPE & 0xff))
+			bench_frames++;
+	}
+	ms = _bench_elapsed(start);
+
+	ethd_get_rx_stats(ethd, 0, &stats, true);
+	printf("{\"test\":\"raw_rx\",\"frames\":%u,\"bench_frames\":%u,\"bytes\":%u,"
+	       "\"drops\":%u,\"overruns\":%u,\"no_buffers\":%u,\"ms\":%u,\"fps\":%u}\r\n",
+	       (unsigned)frames, (unsigned)bench_frames, (unsigned)bytes,
+	       (unsigned)stats.drops, (unsigned)stats.overruns,
+	       (unsigned)stats.no_buffers, (unsigned)ms,
+	       (unsigned)(ms ? (uint64_t)frames * 1000 / ms : 0));
+}
+
+static void _bench_stats(struct _ethd* ethd)
+{
+	struct _ethd_rx_stats stats;
+
+	ethd_get_rx_stats(ethd, 0, &stats, false);
+	printf("{\"test\":\"stats\",\"rx_frames\":%u,\"rx_drops\":%u,"
+	       "\"rx_overruns\":%u,\"rx_no_buffers\":%u,\"rx_budget_exhausted\":%u",
+	       (unsigned)stats.frames, (unsigned)stats.drops,
+	       (unsigned)stats.overruns, (unsigned)stats.no_buffers,
+	       (unsigned)stats.budget_exhausted);
+#if LINK_STATS
+	printf(",\"link_xmit\":%u,\"link_recv\":%u,\"link_drop\":%u,"
+	       "\"link_memerr\":%u,\"link_chkerr\":%u",
+	       (unsigned)lwip_stats.link.xmit, (unsigned)lwip_stats.link.recv,
+	       (unsigned)lwip_stats.link.drop, (unsigned)lwip_stats.link.memerr,
+	       (unsigned)lwip_stats.link.chkerr);
+#endif
+	printf("}\r\n");
+}
+
+static void _bench_print_menu(void)
+{
+	printf("\r\nTCP sink port %d, TCP source port %d, UDP sink port %d, UDP echo port %d\r\n",
+	       BENCH_PORT_SINK, BENCH_PORT_SOURCE, BENCH_PORT_SINK, BENCH_PORT_ECHO);
+	printf(" l: TCP loopback throughput\r\n");
+	printf(" t: raw TX frame rate (%d bytes frames)\r\n", BENCH_RAW_FRAME_SIZE);
+	printf(" r: raw RX frame rate\r\n");
+	printf(" s: statistics\r\n");
+	printf(" h: this menu\r\n");
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ *  \brief eth_bench example entry point.
+ *
+ *  \return Unused (ANSI-C compatibility).
+ */
+int main(void)
+{
+	ip_addr_t ipaddr, netmask, gw;
+	struct netif NetIf, *netif;
+	struct _ethd* ethd;
+	uint8_t eth_port = 0;
+
+	/* Output example information */
+	console_example_info("ETH Benchmark Example");
+
+	/* User select the port number for multiple eth */
+	eth_port = select_eth_port();
+	ethd = board_get_eth(eth_port);
+	ethd_get_mac_addr(ethd, 0, _mac_addr);
+
+	/* Display MAC & IP settings */
+	printf(" - MAC%d %02x:%02x:%02x:%02x:%02x:%02x\n\r", eth_port,
+	       _mac_addr[0], _mac_addr[1], _mac_addr[2],
+	       _mac_addr[3], _mac_addr[4], _mac_addr[5]);
+	printf(" - Host IP  %d.%d.%d.%d\n\r", _ip_addr[0], _ip_addr[1], _ip_addr[2], _ip_addr[3]);
+	printf(" - GateWay IP  %d.%d.%d.%d\n\r", _gw_ip_addr[0], _gw_ip_addr[1], _gw_ip_addr[2], _gw_ip_addr[3]);
+	printf(" - Net Mask  %d.%d.%d.%d\n\r", _netmask[0], _netmask[1], _netmask[2], _netmask[3]);
+
+	/* Initialize lwIP modules */
+	lwip_init();
+
+	IP4_ADDR(&gw, _gw_ip_addr[0], _gw_ip_addr[1], _gw_ip_addr[2], _gw_ip_addr[3]);
+	IP4_ADDR(&ipaddr, _ip_addr[0], _ip_addr[1], _ip_addr[2], _ip_addr[3]);
+	IP4_ADDR(&netmask, _netmask[0], _netmask[1], _netmask[2], _netmask[3]);
+
+	netif = netif_add(&NetIf, &ipaddr, &netmask, &gw, NULL, ethif_init, ip_input);
+	netif_set_default(netif);
+	netif_set_up(netif);
+
+	_bench_tcp_init();
+	_bench_udp_init();
+	_bench_print_menu();
+
+	while (1) {
+		/* Run polling tasks */
+		ethif_poll(netif);
+#if LWIP_NETIF_LOOPBACK
+		netif_poll_all();
+#endif
+
+		/* Sleep until the next interrupt unless a frame or a loopback
+		 * transfer is waiting to be processed */
+		arch_irq_disable();
+		if (!ethif_rx_pending(netif) && !_tcp_source.pcb &&
+		    !console_is_rx_ready())
+			cpu_idle();
+		arch_irq_enable();
+
+		if (!console_is_rx_ready())
+			continue;
+
+		switch (console_get_char()) {
+		case 'l':
+			_bench_tcp_loopback();
+			break;
+		case 't':
+			_bench_raw_tx(ethd);
+			break;
+		case 'r':
+			_bench_raw_rx(ethd);
+			break;
+		case 's':
+			_bench_stats(ethd);
+			break;
+		case 'h':
+			_bench_print_menu();
+			break;
+		}
+	}
+}
@@ -11,6 +11,12 @@
 
 #define MEM_ALIGNMENT                   4
 
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+#define ETHIF_ZERO_COPY                 1
+
+/* Software checksums are disabled on the interfaces whose MAC handles them */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+
 #define LWIP_ARP                        1
 #define LWIP_ETHERNET                   LWIP_ARP
 
@@ -108,6 +108,8 @@
 
 #include "board.h"
 #include "board_eth.h"
+#include "cpuidle.h"
+#include "irqflags.h"
 
 #include "network/ethd.h"
 
@@ -220,5 +222,11 @@ int main(void)
 	while (1) {
 		/* Run polling tasks */
 		ethif_poll(netif);
+
+		/* Sleep until the next interrupt if no frame is pending */
+		arch_irq_disable();
+		if (!ethif_rx_pending(netif))
+			cpu_idle();
+		arch_irq_enable();
 	}
 }
@@ -0,0 +1,468 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ *  \page FreeRTOS-fatfs FreeRTOS FatFs with sama5dx Microcontrollers
+ *
+ *  \section Purpose
+ *
+ *  The FreeRTOS FatFs example shows how several tasks can access FAT file
+ *  systems concurrently, with the FatFs module configured as reentrant on
+ *  top of FreeRTOS.
+ *
+ *  \section Requirements
+ *
+ *  This package can be used with SAMA5DX board.
+ *
+ *  \section Description
+ *
+ *  Two RAM disks are formatted and mounted as volumes 0: and 1:. FatFs
+ *  locks each volume with its own FreeRTOS mutex (see
+ *  lib/fatfs/src/option/syscall_freertos.c), so that tasks working on
+ *  different volumes never wait for each other:
+ *  - the log task appends fixed size lines to 0:log.txt, and rotates it to
+ *    0:log.old when it exceeds LOG_ROTATE_SIZE;
+ *  - the reader task reads random lines of 0:log.old, while the log task
+ *    keeps writing to the same volume;
+ *  - the upload task writes UPLOAD_FILE_SIZE bytes to 1:upload.bin, then
+ *    reads back random chunks of it.
+ *
+ *  The seeks in large files use the fast seek cluster link maps, managed by
+ *  the ff_fastseek_*() functions. The monitor task prints the progress of
+ *  the tasks and the disk I/O statistics of each volume every two seconds.
+ *
+ *  \section Usage
+ *
+ *  -# Build the program and download it inside the evaluation board. Please
+ *     refer to the
+ *     <a href="http://www.atmel.com/dyn/resources/prod_documents/6421B.pdf">
+ *     SAM-BA User Guide</a>, the
+ *     <a href="http://www.atmel.com/dyn/resources/prod_documents/doc6310.pdf">
+ *     GNU-Based Software Development</a>
+ *     application note or to the
+ *     <a href="ftp://ftp.iar.se/WWWfiles/arm/Guides/EWARM_UserGuide.ENU.pdf">
+ *     IAR EWARM User Guide</a>,
+ *     depending on your chosen solution.
+ *  -# On the computer, open and configure a terminal application
+ *     (e.g. HyperTerminal on Microsoft Windows) with these settings:
+ *    - 115200 bauds
+ *    - 8 bits of data
+ *    - No parity
+ *    - 1 stop bit
+ *    - No flow control
+ *  -# Start the application.
+ *  -# In the terminal window, the following text should appear (values
+ *     depend on the board and chip used):
+ *     \code
+ *      -- FreeRTOS FatFs Example xxx --
+ *      -- SAMxxxxx-xx
+ *      -- Compiled: xxx xx xxxx xx:xx:xx --
+ *      log: xxx lines, xx rotations | reader: xxx lines, 0 errors | upload: xx files, 0 errors
+ *      0: r xx/xxx w xx/xxx t xx/xxx s xx e 0
+ *      1: r xx/xxx w xx/xxx t xx/xxx s xx e 0
+ *     \endcode
+ *
+ *  \section References
+ *  - freertos_fatfs/main.c
+ *  - ff.h
+ *  - ff_fastseek.h
+ *  - media_ff.h
+ *  - media_ramdisk.h
+ */
+
+/** \file
+ *
+ *  This file contains all the specific code for the FreeRTOS-fatfs example.
+ *
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "board.h"
+#include "chip.h"
+#include "trace.h"
+#include "compiler.h"
+
+#include "serial/console.h"
+
+#include "libstoragemedia/media.h"
+#include "libstoragemedia/media_private.h"
+#include "libstoragemedia/media_ff.h"
+#include "libstoragemedia/media_ramdisk.h"
+
+#include "fatfs/src/ff.h"
+#include "fatfs/src/option/ff_fastseek.h"
+
+/* FreeRTOS files */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Size of the RAM disk blocks */
+#define BLOCK_SIZE 512
+
+/** Size of each RAM disk */
+#define RAMDISK_SIZE (4 * 1024 * 1024)
+
+/** Number of volumes */
+#define NUM_VOLUMES 2
+
+/** Size of the log lines, including the end of line */
+#define LOG_LINE_SIZE 32
+
+/** Number of lines appended by the log task before sleeping */
+#define LOG_BURST 16
+
+/** Size after which the log file is rotated */
+#define LOG_ROTATE_SIZE (512 * 1024)
+
+/** Size of the file written by the upload task */
+#define UPLOAD_FILE_SIZE (2 * 1024 * 1024)
+
+/** Size of the chunks written and read back by the upload task */
+#define UPLOAD_CHUNK_SIZE 4096
+
+/** Number of random chunks read back by the upload task */
+#define UPLOAD_CHECKS 256
+
+/** Stack size of the file system tasks, in words */
+#define mainFS_TASK_STACK_SIZE ( configMINIMAL_STACK_SIZE * 10 )
+
+/* Priorities at which the tasks are created. */
+#define mainMONITOR_TASK_PRIORITY ( tskIDLE_PRIORITY + 3 )
+#define mainLOG_TASK_PRIORITY     ( tskIDLE_PRIORITY + 2 )
+#define mainREADER_TASK_PRIORITY  ( tskIDLE_PRIORITY + 1 )
+#define mainUPLOAD_TASK_PRIORITY  ( tskIDLE_PRIORITY + 1 )
+
+/** Period of the monitor task */
+#define mainMONITOR_PERIOD_MS ( 2000 / portTICK_PERIOD_MS )
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+SECTION(".region_ddr")
+ALIGNED(BLOCK_SIZE)
+static uint8_t ramdisk_reserved[NUM_VOLUMES][RAMDISK_SIZE];
+
+static struct _media medias[NUM_VOLUMES];
+
+static FATFS fs[NUM_VOLUMES];
+
+static const TCHAR* volumes[NUM_VOLUMES] = { "0:", "1:" };
+
+/** File objects, with their sector buffer, are kept off the task stacks */
+static FIL log_file, reader_file, upload_file;
+
+static uint32_t upload_buffer[UPLOAD_CHUNK_SIZE / 4];
+
+/** Progress counters, displayed by the monitor task */
+static volatile uint32_t log_lines, log_rotations;
+static volatile uint32_t reader_lines, reader_errors;
+static volatile uint32_t upload_files, upload_errors;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Formats a log line, of LOG_LINE_SIZE characters.
+ */
+static void _format_log_line(char *line, uint32_t number)
+{
+	snprintf(line, LOG_LINE_SIZE + 1, "%010u tick %015u\n",
+			(unsigned)number, (unsigned)xTaskGetTickCount());
+}
+
+/**
+ * \brief Checks that a line read back from the log has the expected number.
+ */
+static bool _check_log_line(const char *line, uint32_t number)
+{
+	return line[LOG_LINE_SIZE - 1] == '\n' &&
+		strtoul(line, NULL, 10) == number;
+}
+
+/**
+ * \brief Fills or checks an upload chunk, made of its file offset in words.
+ */
+static bool _upload_pattern(uint32_t *buffer, uint32_t offset, bool check)
+{
+	uint32_t i;
+
+	for (i = 0; i < UPLOAD_CHUNK_SIZE / 4; i++) {
+		if (!check)
+			buffer[i] = offset / 4 + i;
+		else if (buffer[i] != offset / 4 + i)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Opens the log file and moves to its end.
+ */
+static FRESULT _open_log(uint32_t *first_line)
+{
+	FRESULT res;
+
+	res = f_open(&log_file, "0:log.txt", FA_OPEN_ALWAYS | FA_WRITE);
+	if (res != FR_OK)
+		return res;
+	*first_line = f_size(&log_file) / LOG_LINE_SIZE;
+	return ff_fastseek_lseek(&log_file, *first_line * LOG_LINE_SIZE);
+}
+
+/**
+ * \brief Renames the log file to log.old, waiting for the reader to close
+ * the previous one.
+ */
+static void _rotate_log(void)
+{
+	FRESULT res;
+
+	ff_fastseek_close(&log_file);
+	do {
+		res = f_unlink("0:log.old");
+		if (res == FR_LOCKED)
+			vTaskDelay(1);
+	} while (res == FR_LOCKED);
+	f_rename("0:log.txt", "0:log.old");
+	log_rotations++;
+}
+
+/**
+ * \brief Log task, appends bursts of lines to 0:log.txt.
+ */
+static void prvLogTask(void *pvParameters)
+{
+	char line[LOG_LINE_SIZE + 1];
+	uint32_t number = 0, i;
+	UINT written;
+
+	(void)pvParameters;
+
+	for (;;) {
+		if (_open_log(&number) != FR_OK) {
+			printf("-E- Cannot open the log file\n\r");
+			vTaskDelete(NULL);
+		}
+		while (f_size(&log_file) < LOG_ROTATE_SIZE) {
+			for (i = 0; i < LOG_BURST; i++) {
+				_format_log_line(line, number++);
+				if (ff_fastseek_write(&log_file, line, LOG_LINE_SIZE,
+						&written) != FR_OK || written != LOG_LINE_SIZE)
+					printf("-E- Log write failed\n\r");
+			}
+			f_sync(&log_file);
+			log_lines += LOG_BURST;
+			vTaskDelay(5 / portTICK_PERIOD_MS);
+		}
+		_rotate_log();
+	}
+}
+
+/**
+ * \brief Reader task, reads random lines of the rotated log 0:log.old.
+ */
+static void prvReaderTask(void *pvParameters)
+{
+	char line[LOG_LINE_SIZE];
+	uint32_t lines, first, number, i;
+	UINT read;
+
+	(void)pvParameters;
+
+	for (;;) {
+		if (f_open(&reader_file, "0:log.old", FA_READ) != FR_OK) {
+			vTaskDelay(100 / portTICK_PERIOD_MS);
+			continue;
+		}
+		lines = f_size(&reader_file) / LOG_LINE_SIZE;
+		f_read(&reader_file, line, LOG_LINE_SIZE, &read);
+		first = strtoul(line, NULL, 10);
+		for (i = 0; i < 64 && lines; i++) {
+			number = rand() % lines;
+			if (ff_fastseek_lseek(&reader_file, number * LOG_LINE_SIZE) != FR_OK ||
+			    f_read(&reader_file, line, LOG_LINE_SIZE, &read) != FR_OK ||
+			    read != LOG_LINE_SIZE ||
+			    !_check_log_line(line, first + number))
+				reader_errors++;
+			reader_lines++;
+		}
+		ff_fastseek_close(&reader_file);
+		vTaskDelay(20 / portTICK_PERIOD_MS);
+	}
+}
+
+/**
+ * \brief Upload task, writes 1:upload.bin and reads back random chunks.
+ */
+static void prvUploadTask(void *pvParameters)
+{
+	uint32_t offset, i;
+	UINT count;
+	FRESULT res;
+
+	(void)pvParameters;
+
+	for (;;) {
+		res = f_open(&upload_file, "1:upload.bin",
+				FA_CREATE_ALWAYS | FA_WRITE | FA_READ);
+		if (res != FR_OK) {
+			printf("-E- Cannot create the upload file\n\r");
+			vTaskDelete(NULL);
+		}
+		for (offset = 0; offset < UPLOAD_FILE_SIZE;
+		     offset += UPLOAD_CHUNK_SIZE) {
+			_upload_pattern(upload_buffer, offset, false);
+			res = ff_fastseek_write(&upload_file, upload_buffer,
+					UPLOAD_CHUNK_SIZE, &count);
+			if (res != FR_OK || count != UPLOAD_CHUNK_SIZE)
+				upload_errors++;
+		}
+		for (i = 0; i < UPLOAD_CHECKS; i++) {
+			offset = (rand() % (UPLOAD_FILE_SIZE / UPLOAD_CHUNK_SIZE)) *
+				UPLOAD_CHUNK_SIZE;
+			res = ff_fastseek_lseek(&upload_file, offset);
+			if (res == FR_OK)
+				res = f_read(&upload_file, upload_buffer,
+						UPLOAD_CHUNK_SIZE, &count);
+			if (res != FR_OK || count != UPLOAD_CHUNK_SIZE ||
+			    !_upload_pattern(upload_buffer, offset, true))
+				upload_errors++;
+		}
+		ff_fastseek_close(&upload_file);
+		upload_files++;
+	}
+}
+
+/**
+ * \brief Monitor task, prints the progress of the tasks and the disk I/O
+ * statistics.
+ */
+static void prvMonitorTask(void *pvParameters)
+{
+	struct _media_ff_stats stats;
+	uint8_t i;
+
+	(void)pvParameters;
+
+	for (;;) {
+		vTaskDelay(mainMONITOR_PERIOD_MS);
+		printf("log: %u lines, %u rotations | reader: %u lines, %u errors"
+		       " | upload: %u files, %u errors\n\r",
+		       (unsigned)log_lines, (unsigned)log_rotations,
+		       (unsigned)reader_lines, (unsigned)reader_errors,
+		       (unsigned)upload_files, (unsigned)upload_errors);
+		for (i = 0; i < NUM_VOLUMES; i++) {
+			media_ff_get_stats(i, &stats);
+			printf("%s r %u/%u w %u/%u t %u/%u s %u e %u\n\r",
+			       volumes[i],
+			       (unsigned)stats.reads, (unsigned)stats.read_sectors,
+			       (unsigned)stats.writes, (unsigned)stats.write_sectors,
+			       (unsigned)stats.trims, (unsigned)stats.trim_sectors,
+			       (unsigned)stats.syncs, (unsigned)stats.errors);
+		}
+	}
+}
+
+/**
+ * \brief Registers, formats and mounts the RAM disks.
+ */
+static bool _volumes_init(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < NUM_VOLUMES; i++) {
+		media_ramdisk_init(&medias[i],
+				(uint32_t)ramdisk_reserved[i] / BLOCK_SIZE,
+				RAMDISK_SIZE / BLOCK_SIZE, BLOCK_SIZE);
+		if (!media_ff_register(i, &medias[i]))
+			return false;
+		if (f_mount(&fs[i], volumes[i], 0) != FR_OK ||
+		    f_mkfs(volumes[i], 0, 0) != FR_OK ||
+		    f_mount(&fs[i], volumes[i], 1) != FR_OK)
+			return false;
+	}
+	return true;
+}
+
+/*----------------------------------------------------------------------------
+ *        Global functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Lets the other tasks run while the disk I/O layer waits for a media.
+ */
+void media_ff_yield(void)
+{
+	vTaskDelay(1);
+}
+
+/**
+ *  \brief FreeRTOS-fatfs Application entry point.
+ *
+ *  \return Unused (ANSI-C compatibility).
+ */
+int main(void)
+{
+	console_example_info("FreeRTOS FatFs Example");
+
+	if (!_volumes_init()) {
+		printf("-E- Cannot format the RAM disks\n\r");
+		for (;;);
+	}
+
+	xTaskCreate(prvLogTask, "Log", mainFS_TASK_STACK_SIZE, NULL,
+			mainLOG_TASK_PRIORITY, NULL);
+	xTaskCreate(prvReaderTask, "Reader", mainFS_TASK_STACK_SIZE, NULL,
+			mainREADER_TASK_PRIORITY, NULL);
+	xTaskCreate(prvUploadTask, "Upload", mainFS_TASK_STACK_SIZE, NULL,
+			mainUPLOAD_TASK_PRIORITY, NULL);
+	xTaskCreate(prvMonitorTask, "Monitor", configMINIMAL_STACK_SIZE * 4, NULL,
+			mainMONITOR_TASK_PRIORITY, NULL);
+
+	/* Start the tasks and timer running. */
+	vTaskStartScheduler();
+
+	/* If all is well, the scheduler will now be running, and the following
+	line will never be reached. */
+	for (;;);
+}
@@ -207,6 +207,10 @@ static void ethif_input_thread(void *pvParameters)
 	while (1) {
 		/* Run polling tasks */
 		ethif_poll(netif);
+
+		/* Let other tasks run until the next RX interrupt */
+		if (!ethif_rx_pending(netif))
+			vTaskDelay(1);
 	}
 }
 
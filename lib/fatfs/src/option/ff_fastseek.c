@@ -0,0 +1,184 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "compiler.h"
+
+#include "ff.h"
+#include "ff_fastseek.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+#if _USE_FASTSEEK
+/**
+ * \brief Creates the link map of a file, with a table large enough for all
+ * its fragments.
+ */
+static FRESULT _create_map(FIL *fp)
+{
+	DWORD size = FF_FASTSEEK_TABLE_SIZE;
+	DWORD *tbl;
+	FRESULT res;
+
+	while (true) {
+		tbl = (DWORD *)ff_memalloc(size * sizeof(DWORD));
+		if (!tbl)
+			return FR_NOT_ENOUGH_CORE;
+		tbl[0] = size;
+		fp->cltbl = tbl;
+		res = f_lseek(fp, CREATE_LINKMAP);
+		if (res == FR_OK)
+			return FR_OK;
+		fp->cltbl = NULL;
+		if (res != FR_NOT_ENOUGH_CORE || tbl[0] <= size) {
+			ff_memfree(tbl);
+			return res;
+		}
+		/* Retry with the size required by the fragments */
+		size = tbl[0];
+		ff_memfree(tbl);
+	}
+}
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Allocate a memory block. Uses the C library by default, RTOS
+ * builds re-implement it.
+ * \param msize  Number of bytes to allocate.
+ */
+WEAK void *ff_memalloc(UINT msize)
+{
+	return malloc(msize);
+}
+
+/**
+ * \brief Free a memory block allocated by ff_memalloc().
+ * \param mblock  Pointer to the memory block to free.
+ */
+WEAK void ff_memfree(void *mblock)
+{
+	free(mblock);
+}
+
+/**
+ * \brief Drops the link map of a file, its next seeks follow the FAT chain
+ * until the map is created again.
+ * \param fp  Pointer to an open file object.
+ */
+void ff_fastseek_release(FIL *fp)
+{
+#if _USE_FASTSEEK
+	if (fp->cltbl) {
+		ff_memfree(fp->cltbl);
+		fp->cltbl = NULL;
+	}
+#endif
+}
+
+/**
+ * \brief Moves the file pointer, through the link map of the file if the
+ * file is large enough. Seeks beyond the end of a file open for writing
+ * expand the file, without map.
+ * \param fp  Pointer to an open file object.
+ * \param ofs  File pointer from the top of the file.
+ * \return FatFs result code.
+ */
+#if _FS_MINIMIZE <= 2
+FRESULT ff_fastseek_lseek(FIL *fp, FSIZE_t ofs)
+{
+#if _USE_FASTSEEK
+	if (ofs > f_size(fp)) {
+		ff_fastseek_release(fp);
+	} else if (!fp->cltbl && f_size(fp) >= FF_FASTSEEK_MIN_SIZE) {
+		/* Seek through the FAT chain if the map cannot be created */
+		_create_map(fp);
+	}
+#endif
+	return f_lseek(fp, ofs);
+}
+#endif /* _FS_MINIMIZE <= 2 */
+
+/**
+ * \brief Writes to a file, dropping its link map first if the write extends
+ * the file.
+ * \param fp  Pointer to an open file object.
+ * \param buff  Pointer to the data to write.
+ * \param btw  Number of bytes to write.
+ * \param bw  Pointer to the number of bytes written.
+ * \return FatFs result code.
+ */
+#if !_FS_READONLY
+FRESULT ff_fastseek_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+#if _USE_FASTSEEK
+	if (f_tell(fp) + btw > f_size(fp))
+		ff_fastseek_release(fp);
+#endif
+	return f_write(fp, buff, btw, bw);
+}
+
+#if _FS_MINIMIZE == 0
+
+/**
+ * \brief Truncates a file at its file pointer, dropping its link map.
+ * \param fp  Pointer to an open file object.
+ * \return FatFs result code.
+ */
+FRESULT ff_fastseek_truncate(FIL *fp)
+{
+	ff_fastseek_release(fp);
+	return f_truncate(fp);
+}
+#endif /* _FS_MINIMIZE == 0 */
+#endif /* !_FS_READONLY */
+
+/**
+ * \brief Closes a file and frees its link map.
+ * \param fp  Pointer to an open file object.
+ * \return FatFs result code.
+ */
+FRESULT ff_fastseek_close(FIL *fp)
+{
+	ff_fastseek_release(fp);
+	return f_close(fp);
+}
@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ *  Automatic management of the FatFs fast seek cluster link maps.
+ *
+ *  Seeking in a file normally follows its FAT chain from the first cluster,
+ *  which gets slow for large files. With _USE_FASTSEEK, a cluster link map
+ *  (the list of the contiguous fragments of the file) makes the seeks
+ *  independent of the file size, but it must be allocated, created and
+ *  dropped whenever the file grows, which these wrappers do:
+ *  - ff_fastseek_lseek() creates the map of files larger than
+ *    FF_FASTSEEK_MIN_SIZE on their first seek, growing the table to the
+ *    number of fragments of the file;
+ *  - ff_fastseek_write() and ff_fastseek_truncate() drop the map before the
+ *    cluster chain of the file changes, it is created again on the next seek;
+ *  - ff_fastseek_close() closes the file and frees its map.
+ *
+ *  Without _USE_FASTSEEK, the wrappers only call the FatFs functions.
+ *  The maps are allocated with ff_memalloc(), which defaults to malloc().
+ */
+
+#ifndef _FF_FASTSEEK_H
+#define _FF_FASTSEEK_H
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "ff.h"
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Files smaller than this size (in bytes) are seeked through the FAT */
+#ifndef FF_FASTSEEK_MIN_SIZE
+#define FF_FASTSEEK_MIN_SIZE (256 * 1024)
+#endif
+
+/** Initial size of the link map tables, in DWORDs (two per fragment, plus
+ * two) */
+#ifndef FF_FASTSEEK_TABLE_SIZE
+#define FF_FASTSEEK_TABLE_SIZE 34
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+extern FRESULT ff_fastseek_lseek(FIL *fp, FSIZE_t ofs);
+
+extern FRESULT ff_fastseek_write(FIL *fp, const void *buff, UINT btw,
+		UINT *bw);
+
+extern FRESULT ff_fastseek_truncate(FIL *fp);
+
+extern FRESULT ff_fastseek_close(FIL *fp);
+
+extern void ff_fastseek_release(FIL *fp);
+
+extern void *ff_memalloc(UINT msize);
+
+extern void ff_memfree(void *mblock);
+
+#endif /* _FF_FASTSEEK_H */
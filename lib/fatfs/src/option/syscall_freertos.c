@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ *  FatFs OS dependent functions for FreeRTOS.
+ *
+ *  When _FS_REENTRANT is set, each mounted volume gets its own mutex, so
+ *  that tasks working on different volumes never wait for each other. Tasks
+ *  working on the same volume are serialized by its mutex, with priority
+ *  inheritance. The application configuration (ffconf.h) shall define
+ *  _SYNC_t as SemaphoreHandle_t, and _FS_TIMEOUT in ticks.
+ *
+ *  The memory functions, used by long file names on the heap (_USE_LFN 3)
+ *  and by the fast seek link maps, allocate from the FreeRTOS heap.
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "ff.h"
+#include "ff_fastseek.h"
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+#if _FS_REENTRANT
+/**
+ * \brief Create the synchronization object of a volume, called by f_mount().
+ * \param vol  Logical drive number.
+ * \param sobj  Pointer to return the created sync object.
+ * \return 1 on success, 0 if the mutex could not be created.
+ */
+int ff_cre_syncobj(BYTE vol, _SYNC_t *sobj)
+{
+	(void)vol;
+
+	*sobj = xSemaphoreCreateMutex();
+	return *sobj != NULL;
+}
+
+/**
+ * \brief Delete the synchronization object of a volume, called by f_mount().
+ * \param sobj  Sync object tied to the logical drive to be deleted.
+ * \return 1.
+ */
+int ff_del_syncobj(_SYNC_t sobj)
+{
+	vSemaphoreDelete(sobj);
+	return 1;
+}
+
+/**
+ * \brief Request grant to access a volume, on entering the file functions.
+ * \param sobj  Sync object of the volume.
+ * \return 1 if the grant was obtained, 0 after _FS_TIMEOUT ticks.
+ */
+int ff_req_grant(_SYNC_t sobj)
+{
+	return xSemaphoreTake(sobj, _FS_TIMEOUT) == pdTRUE;
+}
+
+/**
+ * \brief Release the grant to access a volume, on leaving the file
+ * functions.
+ * \param sobj  Sync object of the volume.
+ */
+void ff_rel_grant(_SYNC_t sobj)
+{
+	xSemaphoreGive(sobj);
+}
+#endif /* _FS_REENTRANT */
+
+/**
+ * \brief Allocate a memory block from the FreeRTOS heap.
+ * \param msize  Number of bytes to allocate.
+ * \return Pointer to the allocated block, NULL if the heap is exhausted.
+ */
+void *ff_memalloc(UINT msize)
+{
+	return pvPortMalloc(msize);
+}
+
+/**
+ * \brief Free a memory block allocated by ff_memalloc().
+ * \param mblock  Pointer to the memory block to free.
+ */
+void ff_memfree(void *mblock)
+{
+	vPortFree(mblock);
+}
@@ -70,6 +70,21 @@ struct stringEntry_s
 	const char *name;
 };
 
+/** Max count of write requests merged in a packed write command. The device
+ * may further limit this count, see MMC_EXT_MAX_PACKED_WRITES. */
+#ifndef MMC_PACKED_WR_MAX
+#define MMC_PACKED_WR_MAX 16
+#endif
+#if MMC_PACKED_WR_MAX < 2 || MMC_PACKED_WR_MAX > 63
+#error "The header of a packed command holds 2 to 63 entries"
+#endif
+
+/** Time-out of one erase command, in milliseconds, when the device does not
+ * specify a longer one. Also applies to devices that specify no erase time. */
+#ifndef SDMMC_ERASE_MIN_TIMEOUT
+#define SDMMC_ERASE_MIN_TIMEOUT 1000
+#endif
+
 /*----------------------------------------------------------------------------
  *         Global variables
  *----------------------------------------------------------------------------*/
@@ -168,8 +183,23 @@ struct stringEntry_s
                             /*| STATUS_STATE*/ \
                             /*| STATUS_READY_FOR_DATA*/ \
                             | STATUS_SWITCH_ERROR ))
+
+#define STATUS_ERASE ((uint32_t)( STATUS_ADDR_OUT_OR_RANGE \
+                        | STATUS_ERASE_SEQ_ERROR \
+                        | STATUS_ERASE_PARAM \
+                        | STATUS_WP_VIOLATION \
+                        | STATUS_CARD_IS_LOCKED \
+                        | STATUS_COM_CRC_ERROR \
+                        | STATUS_ILLEGAL_COMMAND \
+                        | STATUS_CC_ERROR \
+                        | STATUS_ERROR \
+                        | STATUS_WP_ERASE_SKIP \
+                        | STATUS_ERASE_RESET ))
 /**     @}*/
 
+/** MMC ERASE (CMD38) argument: TRIM, erase write blocks */
+#define MMC_ERASE_ARG_TRIM      (1UL << 0)
+
 /** \addtogroup sdio_status_bm SDIO Status definitions
  *      @{*/
 /** The CRC check of the previous command failed. */
@@ -190,6 +220,20 @@ struct stringEntry_s
 #define DATA_SDIO_R5(response)  ((response) & 0xffu)
 /**     @}*/
 
+/** \addtogroup mmc_cmdq_arg eMMC command queue and packed command arguments
+ *      @{*/
+#define MMC_CMD44_REL_WR        (1UL << 31) /**< Reliable write */
+#define MMC_CMD44_DIR_RD        (1UL << 30) /**< Read task */
+#define MMC_CMD44_PRIO          (1UL << 23) /**< High priority task */
+#define MMC_CMD44_TASK_ID(id)   (((uint32_t)(id) & 0x1f) << 16)
+#define MMC_CMD13_SQS           (1UL << 15) /**< Send Queue Status */
+#define MMC_CMD48_DISCARD_ALL   0x1         /**< Discard the entire queue */
+#define MMC_CMD48_DISCARD_TASK  0x2         /**< Discard the specified task */
+#define MMC_CMD23_PACKED        (1UL << 30) /**< Packed command */
+#define MMC_PACKED_HDR_VER      0x01        /**< Packed command header version */
+#define MMC_PACKED_HDR_WR       0x02        /**< Packed write */
+/**     @}*/
+
 /*----------------------------------------------------------------------------
  *         Macros
  *----------------------------------------------------------------------------*/
@@ -341,6 +385,11 @@ _SdParamReset(sSdCard * pSd)
 	pSd->bStatus = SDMMC_NOT_INITIALIZED;
 	pSd->bSetBlkCnt = 0;
 	pSd->bStopMultXfer = 0;
+	pSd->bCmdqDepth = 0;
+	pSd->bPackedWrDis = 0;
+	pSd->pTaskHead = NULL;
+	pSd->pTaskTail = NULL;
+	memset(pSd->pCmdqTask, 0, sizeof(pSd->pCmdqTask));
 
 	memset(&pSd->sdCmd, 0, sizeof(pSd->sdCmd));
 
@@ -1224,6 +1273,8 @@ Cmd19(sSdCard * pSd, uint8_t * pData, uint8_t len, uint32_t * pStatus)
  * \param nbBlocks  Number of blocks to send.
  * \param pData     Pointer to the buffer to be filled.
  * The buffer shall follow the peripheral and DMA alignment requirements.
+ * \param pIoVec    Optional list of buffer fragments, used instead of pData.
+ * \param wIoVecCnt Count of fragments in pIoVec.
  * \param address   Data Address on SD/MMC card.
  * \param pStatus   Pointer to the response status.
  * \param fCallback Pointer to optional callback invoked on command end.
@@ -1235,6 +1286,7 @@ static uint8_t
 Cmd18(sSdCard * pSd,
       uint16_t * nbBlock,
       uint8_t * pData,
+      const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt,
       uint32_t address, uint32_t * pStatus, fSdmmcCallback callback)
 {
 	sSdmmcCommand *pCmd = &pSd->sdCmd;
@@ -1250,6 +1302,8 @@ Cmd18(sSdCard * pSd,
 	pCmd->wBlockSize = BLOCK_SIZE(pSd);
 	pCmd->wNbBlocks = *nbBlock;
 	pCmd->pData = pData;
+	pCmd->pIoVec = pIoVec;
+	pCmd->wIoVecCnt = wIoVecCnt;
 	pCmd->fCallback = callback;
 	/* Send command */
 	bRc = _SendCmd(pSd, NULL, NULL);
@@ -1331,6 +1385,9 @@ Cmd24(sSdCard * pSd,
  * \param nbBlock   Number of blocks to send.
  * \param pData     Pointer to the buffer to be filled.
  * The buffer shall follow the peripheral and DMA alignment requirements.
+ * \param pIoVec    Optional list of buffer fragments, used instead of pData.
+ * \param wIoVecCnt Count of fragments in pIoVec.
+ * \param sbcFlags  Flags for the SET_BLOCK_COUNT command, if the driver sends it.
  * \param address   Data Address on SD/MMC card.
  * \param pStatus   Pointer to the response buffer as status.
  * \param fCallback Pointer to optional callback invoked on command end.
@@ -1342,6 +1399,7 @@ static uint8_t
 Cmd25(sSdCard * pSd,
       uint16_t * nbBlock,
       uint8_t * pData,
+      const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt, uint32_t sbcFlags,
       uint32_t address, uint32_t * pStatus, fSdmmcCallback callback)
 {
 	sSdmmcCommand *pCmd = &pSd->sdCmd;
@@ -1357,6 +1415,9 @@ Cmd25(sSdCard * pSd,
 	pCmd->wBlockSize = BLOCK_SIZE(pSd);
 	pCmd->wNbBlocks = *nbBlock;
 	pCmd->pData = pData;
+	pCmd->pIoVec = pIoVec;
+	pCmd->wIoVecCnt = wIoVecCnt;
+	pCmd->dwSetBlkCntFlags = sbcFlags;
 	pCmd->fCallback = callback;
 	/* Send command */
 	bRc = _SendCmd(pSd, NULL, NULL);
@@ -1365,6 +1426,190 @@ Cmd25(sSdCard * pSd,
 	return bRc;
 }
 
+/**
+ * Define the parameters of a task, the first step of queueing it in the
+ * device. QUEUED_TASK_PARAMS (CMD44), eMMC command queue only.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param dwArg    Task ID, direction, flags and count of blocks, see
+ *                 \ref mmc_cmdq_arg.
+ * \param pStatus  Pointer to the response buffer as status.
+ */
+static uint8_t
+MmcCmd44(sSdCard * pSd, uint32_t dwArg, uint32_t * pStatus)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1);
+	pCmd->bCmd = 44;
+	pCmd->dwArg = dwArg;
+	pCmd->pResp = pStatus;
+
+	/* Send command */
+	return _SendCmd(pSd, NULL, NULL);
+}
+
+/**
+ * Define the address of the task defined by the previous CMD44, and queue
+ * it in the device. QUEUED_TASK_ADDRESS (CMD45), eMMC command queue only.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param address  Data Address on the device.
+ * \param pStatus  Pointer to the response buffer as status.
+ */
+static uint8_t
+MmcCmd45(sSdCard * pSd, uint32_t address, uint32_t * pStatus)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1);
+	pCmd->bCmd = 45;
+	pCmd->dwArg = address;
+	pCmd->pResp = pStatus;
+
+	/* Send command */
+	return _SendCmd(pSd, NULL, NULL);
+}
+
+/**
+ * Read the Queue Status Register of the device, i.e. the bitmap of the tasks
+ * ready for execution. SEND_STATUS (CMD13) with the SQS bit set.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param pQsr     Pointer to the QSR value.
+ */
+static uint8_t
+MmcCmd13Qsr(sSdCard * pSd, uint32_t * pQsr)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->bCmd = 13;
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1);
+	pCmd->dwArg = CARD_ADDR(pSd) << 16 | MMC_CMD13_SQS;
+	pCmd->pResp = pQsr;
+
+	/* Send command */
+	return _SendCmd(pSd, NULL, NULL);
+}
+
+/**
+ * Execute a queued task the device reported ready.
+ * EXECUTE_READ_TASK (CMD46) or EXECUTE_WRITE_TASK (CMD47).
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param bTaskId  Task ID, as queued with CMD44.
+ * \param pTask    Pointer to the request, providing the data buffer.
+ * \param pStatus  Pointer to the response buffer as status.
+ */
+static uint8_t
+MmcCmdExecTask(sSdCard * pSd, uint8_t bTaskId, const sMmcTask * pTask,
+	       uint32_t * pStatus)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->cmdOp.wVal = pTask->bWrite ? SDMMC_CMD_CDATATX(1)
+	    : SDMMC_CMD_CDATARX(1);
+	pCmd->bCmd = pTask->bWrite ? 47 : 46;
+	pCmd->dwArg = MMC_CMD44_TASK_ID(bTaskId);
+	pCmd->pResp = pStatus;
+	pCmd->wBlockSize = BLOCK_SIZE(pSd);
+	pCmd->wNbBlocks = pTask->wNbBlocks;
+	pCmd->pData = pTask->pData;
+	pCmd->pIoVec = pTask->pIoVec;
+	pCmd->wIoVecCnt = pTask->wIoVecCnt;
+
+	/* Send command */
+	return _SendCmd(pSd, NULL, NULL);
+}
+
+/**
+ * Discard either one or all tasks queued in the device.
+ * CMDQ_TASK_MGMT (CMD48), eMMC command queue only.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param dwArg    Either MMC_CMD48_DISCARD_ALL, or MMC_CMD48_DISCARD_TASK
+ *                 ORed with the task ID.
+ * \param pStatus  Pointer to the response buffer as status.
+ */
+static uint8_t
+MmcCmd48(sSdCard * pSd, uint32_t dwArg, uint32_t * pStatus)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1) | SDMMC_CMD_bmBUSY;
+	pCmd->bCmd = 48;
+	pCmd->dwArg = dwArg;
+	pCmd->pResp = pStatus;
+
+	/* Send command */
+	return _SendCmd(pSd, NULL, NULL);
+}
+
+/**
+ * Set the address of the first or of the last block of an erase range.
+ * SD: ERASE_WR_BLK_START (CMD32) and ERASE_WR_BLK_END (CMD33).
+ * MMC: ERASE_GROUP_START (CMD35) and ERASE_GROUP_END (CMD36).
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param bCmd     Command index, 32, 33, 35 or 36.
+ * \param address  Data Address on SD/MMC card.
+ * \param pStatus  Pointer to the response buffer as status.
+ * \return the command transfer result (see SendCommand).
+ */
+static uint8_t
+CmdEraseAddr(sSdCard * pSd, uint8_t bCmd, uint32_t address, uint32_t * pStatus)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+	uint8_t bRc;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1);
+	pCmd->bCmd = bCmd;
+	pCmd->dwArg = address;
+	pCmd->pResp = pStatus;
+
+	/* Send command */
+	bRc = _SendCmd(pSd, NULL, NULL);
+	return bRc;
+}
+
+/**
+ * Erase the blocks selected by the previous erase start/end commands.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param arg      Erase type (MMC only, 0 for SD).
+ * \param pStatus  Pointer to the response buffer as status.
+ * \return the command transfer result (see SendCommand).
+ */
+static uint8_t
+Cmd38(sSdCard * pSd, uint32_t arg, uint32_t * pStatus)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+	uint8_t bRc;
+
+	_ResetCmd(pCmd);
+
+	/* Fill command */
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1) | SDMMC_CMD_bmBUSY;
+	pCmd->bCmd = 38;
+	pCmd->dwArg = arg;
+	pCmd->pResp = pStatus;
+
+	/* Send command */
+	bRc = _SendCmd(pSd, NULL, NULL);
+	return bRc;
+}
+
 /**
  * SDIO IO_RW_DIRECT command, response R5.
  * \return the command transfer result (see SendMciCommand).
@@ -1563,6 +1808,38 @@ End:
 	return error;
 }
 
+/**
+ * SD: SET_WR_BLK_ERASE_COUNT, set the number of write blocks to be
+ * pre-erased before writing. Used in front of a multiple block write command,
+ * it lets the card erase the blocks at once instead of block by block.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param blocks  Number of blocks to be pre-erased (23 bits).
+ * \param pResp  Pointer to where the response is returned.
+ * \return the command transfer result (see SendCommand).
+ */
+static uint8_t
+Acmd23(sSdCard * pSd, uint32_t blocks, uint32_t * pResp)
+{
+	sSdmmcCommand *pCmd = &pSd->sdCmd;
+	uint8_t error;
+
+	trace_debug("Acmd%u\n\r", 23);
+	error = Cmd55(pSd, CARD_ADDR(pSd));
+	if (error)
+		goto End;
+	_ResetCmd(pCmd);
+	pCmd->bCmd = 23;
+	pCmd->cmdOp.wVal = SDMMC_CMD_CNODATA(1);
+	pCmd->dwArg = blocks & 0x7ffffful;
+	pCmd->pResp = pResp;
+	error = _SendCmd(pSd, NULL, NULL);
+
+End:
+	if (error)
+		trace_error("Acmd%u %s\n\r", 23, SD_StringifyRetCode(error));
+	return error;
+}
+
 /**
  * Asks to all cards to send their operations conditions.
  * Returns the command transfer result (see SendCommand).
@@ -1802,13 +2079,21 @@ _StopCmd(sSdCard * pSd)
 	return SDMMC_ERROR_STATE;
 }
 
+/**
+ * Poll the device status until the device is ready for data, or the time-out
+ * elapses.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param last_dev_status  Device status returned by the last command.
+ * \param timeout  Time-out, in milliseconds.
+ * \return a \ref sdmmc_rc result code.
+ */
 static uint8_t
-_WaitUntilReady(sSdCard * pSd, uint32_t last_dev_status)
+_WaitUntilReadyFor(sSdCard * pSd, uint32_t last_dev_status, uint32_t timeout)
 {
-	uint32_t state, status = last_dev_status;
-	uint8_t err, count;
+	uint32_t state, status = last_dev_status, count;
+	uint8_t err;
 
-	for (count = 0; count < 51; count++) {
+	for (count = 0; count <= timeout / 10; count++) {
 		state = status & STATUS_STATE;
 		if (state == STATUS_TRAN && status & STATUS_READY_FOR_DATA)
 			return SDMMC_SUCCESS;
@@ -1827,6 +2112,12 @@ _WaitUntilReady(sSdCard * pSd, uint32_t last_dev_status)
 	return SDMMC_ERROR_BUSY;
 }
 
+static uint8_t
+_WaitUntilReady(sSdCard * pSd, uint32_t last_dev_status)
+{
+	return _WaitUntilReadyFor(pSd, last_dev_status, 500);
+}
+
 /**
  * Transfer a single data block.
  * The device shall be in its Transfer State already.
@@ -1843,6 +2134,9 @@ PerformSingleTransfer(sSdCard * pSd,
 	uint8_t result = SDMMC_OK, error;
 	uint32_t sdmmc_address, status;
 
+	/* Legacy block commands are illegal while the command queue is on */
+	if (pSd->bCmdqDepth)
+		return SDMMC_STATE;
 	/* Convert block address into device-expected unit */
 	if (pSd->bCardType & CARD_TYPE_bmHC)
 		sdmmc_address = address;
@@ -1893,12 +2187,17 @@ PerformSingleTransfer(sSdCard * pSd,
  * for infinite transfer. Upon return, points to the count of blocks actually
  * transferred.
  * \param pData    Data buffer whose size is at least the block size.
+ * \param pIoVec   Optional list of buffer fragments, used instead of pData.
+ * \param wIoVecCnt Count of fragments in pIoVec.
+ * \param sbcFlags Flags for the SET_BLOCK_COUNT command, e.g. packed write.
  * \param isRead   1 for read data and 0 for write data.
  */
 static uint8_t
 MoveToTransferState(sSdCard * pSd,
 		    uint32_t address,
-		    uint16_t * nbBlocks, uint8_t * pData, uint8_t isRead)
+		    uint16_t * nbBlocks, uint8_t * pData,
+		    const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt,
+		    uint32_t sbcFlags, uint8_t isRead)
 {
 	uint8_t result = SDMMC_OK, error;
 	uint32_t sdmmc_address, state, status;
@@ -1906,6 +2205,9 @@ MoveToTransferState(sSdCard * pSd,
 	assert(pSd != NULL);
 	assert(nbBlocks != NULL);
 
+	/* Legacy block commands are illegal while the command queue is on */
+	if (pSd->bCmdqDepth)
+		return SDMMC_STATE;
 	/* Convert block address into device-expected unit */
 	if (pSd->bCardType & CARD_TYPE_bmHC)
 		sdmmc_address = address;
@@ -1913,19 +2215,24 @@ MoveToTransferState(sSdCard * pSd,
 		sdmmc_address = address * pSd->wCurrBlockLen;
 	else
 		return SDMMC_PARAM;
+	/* Let SD cards pre-erase the whole range of a multiple block write.
+	 * This is only a hint, the write proceeds if the card rejects it. */
+	if (!isRead && *nbBlocks > 1
+	    && (pSd->bCardType & CARD_TYPE_bmSDMMC) == CARD_TYPE_bmSD)
+		Acmd23(pSd, *nbBlocks, &status);
 	if (pSd->bSetBlkCnt) {
-		error = Cmd23(pSd, 0, *nbBlocks, &status);
+		error = Cmd23(pSd, 0, *nbBlocks | sbcFlags, &status);
 		if (error)
 			return error;
 	}
 	if (isRead)
 		/* Move to Receiving data state */
-		error = Cmd18(pSd, nbBlocks, pData, sdmmc_address, &status,
-		    NULL);
+		error = Cmd18(pSd, nbBlocks, pData, pIoVec, wIoVecCnt,
+		    sdmmc_address, &status, NULL);
 	else
 		/* Move to Sending data state */
-		error = Cmd25(pSd, nbBlocks, pData, sdmmc_address, &status,
-		    NULL);
+		error = Cmd25(pSd, nbBlocks, pData, pIoVec, wIoVecCnt,
+		    sbcFlags, sdmmc_address, &status, NULL);
 	if (error == SDMMC_CHANGED)
 		error = SDMMC_OK;
 	if (!error) {
@@ -1994,6 +2301,410 @@ MoveToTransferState(sSdCard * pSd,
 	return result;
 }
 
+/**
+ * Transfer blocks of data between the device and a list of buffer fragments,
+ * using a single multiple block command.
+ */
+static uint8_t
+_TransferV(sSdCard * pSd,
+	   uint32_t address,
+	   const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt, uint8_t isRead)
+{
+	uint32_t len = 0;
+	uint16_t ix, blocks;
+	uint8_t error;
+
+	assert(pSd != NULL);
+	assert(pIoVec != NULL);
+
+	for (ix = 0; ix < wIoVecCnt; ix++) {
+		if (pIoVec[ix].dwLen > 65535ul * BLOCK_SIZE(pSd) - len)
+			return SDMMC_PARAM;
+		len += pIoVec[ix].dwLen;
+	}
+	if (len == 0 || len % BLOCK_SIZE(pSd))
+		return SDMMC_PARAM;
+	blocks = (uint16_t)(len / BLOCK_SIZE(pSd));
+	error = MoveToTransferState(pSd, address, &blocks, NULL, pIoVec,
+	    wIoVecCnt, 0, isRead);
+	trace_debug("SD%sv(%lu,%u) %s\n\r", isRead ? "rd" : "wr", address,
+	    blocks, SD_StringifyRetCode(error));
+	return error;
+}
+
+/**
+ * Convert a block address into the unit the device expects.
+ * \param pSd       Pointer to a SD card driver instance.
+ * \param address   Block address.
+ * \param pDevAddr  Pointer to the device address.
+ * \return SDMMC_OK, or SDMMC_PARAM if the address is out of range.
+ */
+static uint8_t
+_DeviceAddress(const sSdCard * pSd, uint32_t address, uint32_t * pDevAddr)
+{
+	if (pSd->bCardType & CARD_TYPE_bmHC)
+		*pDevAddr = address;
+	else if (address <= 0xfffffffful / pSd->wCurrBlockLen)
+		*pDevAddr = address * pSd->wCurrBlockLen;
+	else
+		return SDMMC_PARAM;
+	return SDMMC_OK;
+}
+
+/**
+ * Remove the first block request from the list of pending requests.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \return the request, or NULL if none is pending.
+ */
+static sMmcTask *
+_PopTask(sSdCard * pSd)
+{
+	sMmcTask *pTask = pSd->pTaskHead;
+
+	if (pTask) {
+		pSd->pTaskHead = pTask->pNext;
+		if (pSd->pTaskHead == NULL)
+			pSd->pTaskTail = NULL;
+		pTask->pNext = NULL;
+	}
+	return pTask;
+}
+
+/**
+ * Record the result of a block request, and notify its owner.
+ * \param pTask    Pointer to the request, no longer referenced by the queue.
+ * \param bStatus  Result of the request.
+ */
+static void
+_CompleteTask(sMmcTask * pTask, uint8_t bStatus)
+{
+	pTask->bStatus = bStatus;
+	if (pTask->fCallback)
+		pTask->fCallback(bStatus, pTask->pArg);
+}
+
+/**
+ * Process a block request on its own, using the legacy block commands.
+ * \param pSd    Pointer to a SD card driver instance.
+ * \param pTask  Pointer to the request.
+ * \return a \ref sdmmc_rc result code.
+ */
+static uint8_t
+_RunTask(sSdCard * pSd, const sMmcTask * pTask)
+{
+	if (pTask->pIoVec)
+		return _TransferV(pSd, pTask->dwAddr, pTask->pIoVec,
+		    pTask->wIoVecCnt, !pTask->bWrite);
+	if (pTask->bWrite)
+		return SD_Write(pSd, pTask->dwAddr, pTask->pData,
+		    pTask->wNbBlocks, NULL, NULL);
+	return SD_Read(pSd, pTask->dwAddr, pTask->pData, pTask->wNbBlocks,
+	    NULL, NULL);
+}
+
+/**
+ * Check whether the device accepts packed write commands.
+ * \param pSd  Pointer to a SD card driver instance.
+ */
+static bool
+_CanPackWrites(const sSdCard * pSd)
+{
+	return !pSd->bPackedWrDis
+	    && (pSd->bCardType & CARD_TYPE_bmSDMMC) == CARD_TYPE_bmMMC
+	    && MMC_EXT_EXT_CSD_REV(pSd->EXT) >= 6
+	    && MMC_EXT_DATA_SECTOR_SIZE(pSd->EXT) == MMC_EXT_DATA_SECT_512B
+	    && MMC_EXT_MAX_PACKED_WRITES(pSd->EXT) >= 2
+	    && BLOCK_SIZE(pSd) == 512;
+}
+
+/**
+ * Merge the write requests at the head of the pending list into a single
+ * packed write command. Should the packed write fail, write the merged
+ * requests one by one.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param pResult  Pointer to the first error met, updated on failure.
+ * \return the count of requests processed, 0 if less than two requests could
+ * be merged.
+ */
+static uint8_t
+_RunPackedWrite(sSdCard * pSd, uint8_t * pResult)
+{
+	sSdmmcIoVec vec[MMC_PACKED_WR_MAX + 1];
+	uint32_t *hdr = (uint32_t *)pSd->packed_hdr;
+	sMmcTask *pTask;
+	uint32_t dev_addr;
+	uint16_t total = 1, expected;
+	uint8_t max, cnt, ix, error;
+
+	max = (uint8_t)min_u32(MMC_EXT_MAX_PACKED_WRITES(pSd->EXT),
+	    MMC_PACKED_WR_MAX);
+	memset(pSd->packed_hdr, 0, 512);
+	for (cnt = 0, pTask = pSd->pTaskHead; pTask && cnt < max;
+	    pTask = pTask->pNext, cnt++) {
+		if (!pTask->bWrite || !pTask->pData
+		    || pTask->wNbBlocks > 0xffff - total
+		    || _DeviceAddress(pSd, pTask->dwAddr, &dev_addr))
+			break;
+		/* Entry #0 is the header itself, entries #1..N follow */
+		hdr[2 * cnt + 2] = pTask->wNbBlocks;
+		hdr[2 * cnt + 3] = dev_addr;
+		vec[cnt + 1].pData = pTask->pData;
+		vec[cnt + 1].dwLen = (uint32_t)pTask->wNbBlocks * 512;
+		total += pTask->wNbBlocks;
+	}
+	if (cnt < 2)
+		return 0;
+	hdr[0] = MMC_PACKED_HDR_VER | MMC_PACKED_HDR_WR << 8
+	    | (uint32_t)cnt << 16;
+	vec[0].pData = pSd->packed_hdr;
+	vec[0].dwLen = 512;
+
+	expected = total;
+	error = MoveToTransferState(pSd, pSd->pTaskHead->dwAddr, &total, NULL,
+	    vec, cnt + 1, MMC_CMD23_PACKED, 0);
+	if (!error && total != expected) {
+		/* The driver cut the transfer short, yet the device still
+		 * expects the rest of the announced blocks */
+		_StopCmd(pSd);
+		error = SDMMC_ERR;
+	}
+	trace_debug("MMCpw(%u,%u) %s\n\r", cnt, expected,
+	    SD_StringifyRetCode(error));
+	if (error == SDMMC_NOT_SUPPORTED)
+		pSd->bPackedWrDis = 1;
+	for (ix = 0; ix < cnt; ix++) {
+		pTask = _PopTask(pSd);
+		if (error) {
+			/* Rewriting the whole request is harmless */
+			pTask->bStatus = _RunTask(pSd, pTask);
+			if (pTask->bStatus && *pResult == SDMMC_OK)
+				*pResult = pTask->bStatus;
+			_CompleteTask(pTask, pTask->bStatus);
+		}
+		else
+			_CompleteTask(pTask, SDMMC_OK);
+	}
+	return cnt;
+}
+
+/**
+ * Process the pending block requests with the legacy block commands,
+ * merging consecutive write requests into packed write commands.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \return SDMMC_OK, or the first error met.
+ */
+static uint8_t
+_RunQueueLegacy(sSdCard * pSd)
+{
+	sMmcTask *pTask;
+	uint8_t error, result = SDMMC_OK;
+
+	while (pSd->pTaskHead) {
+		if (pSd->pTaskHead->bWrite && _CanPackWrites(pSd)
+		    && _RunPackedWrite(pSd, &result))
+			continue;
+		pTask = _PopTask(pSd);
+		error = _RunTask(pSd, pTask);
+		if (error && result == SDMMC_OK)
+			result = error;
+		_CompleteTask(pTask, error);
+	}
+	return result;
+}
+
+/**
+ * Discard all tasks queued in the device, and fail their requests.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param bStatus  Result to report for the discarded requests.
+ */
+static void
+_CmdqAbort(sSdCard * pSd, uint8_t bStatus)
+{
+	sMmcTask *pTask;
+	uint32_t status;
+	uint8_t id;
+
+	MmcCmd48(pSd, MMC_CMD48_DISCARD_ALL, &status);
+	for (id = 0; id < MMC_CMDQ_DEPTH_MAX; id++) {
+		pTask = pSd->pCmdqTask[id];
+		if (pTask == NULL)
+			continue;
+		pSd->pCmdqTask[id] = NULL;
+		_CompleteTask(pTask, bStatus);
+	}
+}
+
+/**
+ * Discard a task queued in the device. Stop its data transfer first, if the
+ * device is still sending or receiving data on its behalf.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param bTaskId  ID of the task.
+ * \return a \ref sdmmc_rc result code.
+ */
+static uint8_t
+_CmdqDiscardTask(sSdCard * pSd, uint8_t bTaskId)
+{
+	uint32_t status, state;
+	uint8_t error;
+
+	error = Cmd13(pSd, &status);
+	if (error)
+		return error;
+	state = status & STATUS_STATE;
+	if (state == STATUS_DATA || state == STATUS_RCV) {
+		error = Cmd12(pSd, &status);
+		if (error == SDMMC_OK || error == SDMMC_ERROR_NORESPONSE)
+			error = Cmd13(pSd, &status);
+		if (error)
+			return error;
+	}
+	error = _WaitUntilReady(pSd, status);
+	if (error)
+		return error;
+	error = MmcCmd48(pSd, MMC_CMD48_DISCARD_TASK
+	    | MMC_CMD44_TASK_ID(bTaskId), &status);
+	if (!error && status & (STATUS_COM_CRC_ERROR | STATUS_ILLEGAL_COMMAND
+	    | STATUS_CC_ERROR | STATUS_ERROR)) {
+		trace_error("st %lx\n\r", status);
+		error = SDMMC_ERROR;
+	}
+	return error;
+}
+
+/**
+ * Queue a block request in the device, with the specified task ID.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param bTaskId  Free task ID.
+ * \param pTask    Pointer to the request.
+ * \return a \ref sdmmc_rc result code.
+ */
+static uint8_t
+_CmdqQueueTask(sSdCard * pSd, uint8_t bTaskId, const sMmcTask * pTask)
+{
+	uint32_t dev_addr, status, arg;
+	uint8_t error;
+
+	error = _DeviceAddress(pSd, pTask->dwAddr, &dev_addr);
+	if (error)
+		return error;
+	arg = MMC_CMD44_TASK_ID(bTaskId) | pTask->wNbBlocks;
+	if (!pTask->bWrite)
+		arg |= MMC_CMD44_DIR_RD;
+	error = MmcCmd44(pSd, arg, &status);
+	if (!error && status & STATUS_WRITE & ~STATUS_READY_FOR_DATA
+	    & ~STATUS_STATE)
+		error = SDMMC_ERROR;
+	if (error)
+		return error;
+	error = MmcCmd45(pSd, dev_addr, &status);
+	if (!error && status & STATUS_WRITE & ~STATUS_READY_FOR_DATA
+	    & ~STATUS_STATE)
+		error = SDMMC_ERROR;
+	if (error) {
+		trace_error("st %lx\n\r", status);
+		/* Failing to discard the task, the queue of the device is
+		 * unknown */
+		if (_CmdqDiscardTask(pSd, bTaskId))
+			_CmdqAbort(pSd, error);
+	}
+	return error;
+}
+
+/**
+ * Execute a task the device reported ready, and complete its request.
+ * \param pSd      Pointer to a SD card driver instance.
+ * \param bTaskId  ID of the ready task.
+ * \return a \ref sdmmc_rc result code.
+ */
+static uint8_t
+_CmdqExecTask(sSdCard * pSd, uint8_t bTaskId)
+{
+	sMmcTask *pTask = pSd->pCmdqTask[bTaskId];
+	uint32_t status;
+	uint8_t error;
+
+	error = MmcCmdExecTask(pSd, bTaskId, pTask, &status);
+	if (error == SDMMC_CHANGED)
+		/* The device expects the whole task */
+		error = SDMMC_ERR;
+	if (!error) {
+		status = status & (pTask->bWrite ? STATUS_WRITE : STATUS_READ)
+		    & ~STATUS_READY_FOR_DATA & ~STATUS_STATE;
+		if (status) {
+			trace_error("st %lx\n\r", status);
+			error = SDMMC_ERROR;
+		}
+	}
+	pSd->pCmdqTask[bTaskId] = NULL;
+	_CompleteTask(pTask, error);
+	/* Failing to discard the task, the queue of the device is unknown */
+	if (error && _CmdqDiscardTask(pSd, bTaskId))
+		_CmdqAbort(pSd, error);
+	return error;
+}
+
+/**
+ * Process the pending block requests through the command queue of the
+ * device. Requests are queued as long as task IDs are free, and executed
+ * in the order the device reports them ready.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \return SDMMC_OK, or the first error met.
+ */
+static uint8_t
+_RunQueueCmdq(sSdCard * pSd)
+{
+	struct _timeout timeout;
+	sMmcTask *pTask;
+	uint32_t qsr;
+	uint8_t id, error, result = SDMMC_OK;
+	bool queued;
+
+	timer_start_timeout(&timeout, 30000);
+	for (;;) {
+		/* Fill the free task slots */
+		queued = false;
+		for (id = 0; id < pSd->bCmdqDepth; id++) {
+			if (pSd->pCmdqTask[id] == NULL && pSd->pTaskHead) {
+				pTask = _PopTask(pSd);
+				error = _CmdqQueueTask(pSd, id, pTask);
+				if (error) {
+					if (result == SDMMC_OK)
+						result = error;
+					_CompleteTask(pTask, error);
+					continue;
+				}
+				pSd->pCmdqTask[id] = pTask;
+			}
+			queued = queued || pSd->pCmdqTask[id] != NULL;
+		}
+		if (!queued) {
+			if (pSd->pTaskHead == NULL)
+				break;
+			continue;
+		}
+
+		error = MmcCmd13Qsr(pSd, &qsr);
+		if (!error && qsr == 0 && timer_timeout_reached(&timeout))
+			error = SDMMC_NO_RESPONSE;
+		if (error) {
+			/* Leave the requests not queued yet pending */
+			_CmdqAbort(pSd, error);
+			if (result == SDMMC_OK)
+				result = error;
+			break;
+		}
+		for (id = 0; id < pSd->bCmdqDepth; id++) {
+			if (!(qsr & 1ul << id) || pSd->pCmdqTask[id] == NULL)
+				continue;
+			error = _CmdqExecTask(pSd, id);
+			if (error && result == SDMMC_OK)
+				result = error;
+			timer_start_timeout(&timeout, 30000);
+		}
+	}
+	return result;
+}
+
 /**
  * Switch card state between STBY and TRAN (or CMD and TRAN)
  * \param pSd       Pointer to a SD card driver instance.
@@ -3206,7 +3917,8 @@ SD_Read(sSdCard * pSd,
 	    blk_no += limited, remaining -= limited,
 	    out += (uint32_t)limited * (uint32_t)BLOCK_SIZE(pSd)) {
 		limited = (uint16_t)min_u32(remaining, 65535);
-		error = MoveToTransferState(pSd, blk_no, &limited, out, 1);
+		error = MoveToTransferState(pSd, blk_no, &limited, out,
+		    NULL, 0, 0, 1);
 	}
 	trace_debug("SDrd(%lu,%lu) %s\n\r", address, length,
 	    SD_StringifyRetCode(error));
@@ -3246,13 +3958,50 @@ SD_Write(sSdCard * pSd,
 	    blk_no += limited, remaining -= limited,
 	    in += (uint32_t)limited * (uint32_t)BLOCK_SIZE(pSd)) {
 		limited = (uint16_t)min_u32(remaining, 65535);
-		error = MoveToTransferState(pSd, blk_no, &limited, in, 0);
+		error = MoveToTransferState(pSd, blk_no, &limited, in,
+		    NULL, 0, 0, 0);
 	}
 	trace_debug("SDwr(%lu,%lu) %s\n\r", address, length,
 	    SD_StringifyRetCode(error));
 	return error;
 }
 
+/**
+ * Read blocks of data into a list of buffer fragments, using a single
+ * multiple block read command. The fragments need not be aligned.
+ * Requires a driver that supports fragmented data buffers.
+ * \return 0 if successful; otherwise returns an \ref sdmmc_rc "error code".
+ * \param pSd       Pointer to a SD card driver instance.
+ * \param address   Address of the first block to read.
+ * \param pIoVec    List of buffer fragments. Their sizes shall add up to a
+ * multiple of the block size, up to 65535 blocks.
+ * \param wIoVecCnt Count of fragments in pIoVec.
+ */
+uint8_t
+SD_ReadV(sSdCard * pSd,
+	 uint32_t address, const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt)
+{
+	return _TransferV(pSd, address, pIoVec, wIoVecCnt, 1);
+}
+
+/**
+ * Write blocks of data from a list of buffer fragments, using a single
+ * multiple block write command. The fragments need not be aligned.
+ * Requires a driver that supports fragmented data buffers.
+ * \return 0 if successful; otherwise returns an \ref sdmmc_rc "error code".
+ * \param pSd       Pointer to a SD card driver instance.
+ * \param address   Address of the first block to write.
+ * \param pIoVec    List of buffer fragments. Their sizes shall add up to a
+ * multiple of the block size, up to 65535 blocks.
+ * \param wIoVecCnt Count of fragments in pIoVec.
+ */
+uint8_t
+SD_WriteV(sSdCard * pSd,
+	  uint32_t address, const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt)
+{
+	return _TransferV(pSd, address, pIoVec, wIoVecCnt, 0);
+}
+
 /**
  * Read Blocks of data in a buffer pointed by pData. The buffer size must be at
  * least 512 byte long. This function checks the SD card status register and
@@ -3319,6 +4068,142 @@ SD_WriteBlocks(sSdCard * pSd,
 	return error;
 }
 
+/**
+ * Compute how many blocks a single erase command shall cover, and how long
+ * the device may take to erase them.
+ * SD cards erase ERASE_SIZE Allocation Units within ERASE_TIMEOUT +
+ * ERASE_OFFSET seconds, according to the SD Status. MMC devices trim one
+ * high-capacity erase group within 300 ms * TRIM_MULT.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param timeout  Filled with the time-out of one batch, in milliseconds.
+ * \return the size of one batch, in blocks.
+ */
+static uint32_t
+_GetEraseBatch(const sSdCard * pSd, uint32_t * timeout)
+{
+	uint32_t unit = SD_GetEraseUnitSize(pSd), count = 1;
+
+	if ((pSd->bCardType & CARD_TYPE_bmSDMMC) == CARD_TYPE_bmMMC)
+		*timeout = 300ul * MMC_EXT_TRIM_MULT(pSd->EXT);
+	else if (SD_SSR_ERASE_SIZE(pSd->SSR)) {
+		count = SD_SSR_ERASE_SIZE(pSd->SSR);
+		*timeout = 1000ul * (SD_SSR_ERASE_TIMEOUT(pSd->SSR)
+		    + SD_SSR_ERASE_OFFSET(pSd->SSR));
+	} else
+		*timeout = 0;
+	/* Erase unit unknown: erase 4 MiB at once */
+	if (unit == 1)
+		unit = 8192;
+	*timeout = max_u32(*timeout, SDMMC_ERASE_MIN_TIMEOUT);
+	return unit * min_u32(count, 0xfffffffful / unit);
+}
+
+/**
+ * Erase a range of blocks with a single erase command, and wait for the
+ * device to complete the operation.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param cmd_start  Index of the ERASE_GROUP_START command.
+ * \param arg  Argument of the ERASE command.
+ * \param start  Address of the first block to erase.
+ * \param end  Address of the last block to erase.
+ * \param timeout  Time the device may take to erase the blocks, in ms.
+ * \return a \ref sdmmc_rc result code.
+ */
+static uint8_t
+_EraseRange(sSdCard * pSd, uint8_t cmd_start, uint32_t arg,
+	    uint32_t start, uint32_t end, uint32_t timeout)
+{
+	uint32_t status;
+	uint8_t error, err;
+
+	/* Convert block addresses into device-expected unit */
+	if (!(pSd->bCardType & CARD_TYPE_bmHC)) {
+		start *= pSd->wCurrBlockLen;
+		end *= pSd->wCurrBlockLen;
+	}
+
+	error = CmdEraseAddr(pSd, cmd_start, start, &status);
+	if (!error)
+		error = CmdEraseAddr(pSd, cmd_start + 1, end, &status);
+	if (!error) {
+		error = Cmd38(pSd, arg, &status);
+		/* The device may signal busy longer than the data time-out of
+		 * the host controller. Rely on the device status instead. */
+		if (error == SDMMC_ERR_IO)
+			error = SDMMC_OK;
+		else if (!error && (status & STATUS_ERASE)) {
+			trace_error("st %lx\n\r", status);
+			error = status & (STATUS_ADDR_OUT_OR_RANGE
+			    | STATUS_ERASE_PARAM | STATUS_WP_VIOLATION
+			    | STATUS_WP_ERASE_SKIP) ? SDMMC_PARAM : SDMMC_ERROR;
+		}
+	}
+	/* Wait for the end of the erase operation, in any case */
+	err = Cmd13(pSd, &status);
+	if (!err)
+		err = _WaitUntilReadyFor(pSd, status, timeout);
+	return error ? error : err;
+}
+
+/**
+ * Erase a range of blocks. The contents of the blocks are undefined
+ * afterwards. Used to let the device reclaim blocks which are no longer in
+ * use (TRIM), which speeds up later writes to them.
+ * MMC devices use the TRIM variant of the ERASE command, which works on write
+ * blocks instead of erase groups.
+ * The range is erased in batches aligned on the erase unit of the device,
+ * each of which the device completes within its specified erase time.
+ * \return 0 if successful; otherwise returns an \ref sdmmc_rc "error code".
+ * SDMMC_NOT_SUPPORTED if the device cannot erase single blocks.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \param address  Address of the first block to erase.
+ * \param nbBlocks Number of blocks to erase.
+ */
+uint8_t
+SD_Erase(sSdCard * pSd, uint32_t address, uint32_t nbBlocks)
+{
+	uint32_t start, end, last, arg = 0, batch, timeout;
+	uint8_t error = SDMMC_OK, type, cmd_start;
+
+	assert(pSd != NULL);
+
+	if (nbBlocks == 0)
+		return SDMMC_OK;
+	last = address + nbBlocks - 1;
+	if (last < address || last >= pSd->dwNbBlocks)
+		return SDMMC_PARAM;
+	type = pSd->bCardType & CARD_TYPE_bmSDMMC;
+	if (type == CARD_TYPE_bmMMC) {
+		if (!(MMC_EXT_SEC_FEATURE_SUPPORT(pSd->EXT)
+		    & MMC_EXT_SEC_GB_CL_EN))
+			return SDMMC_NOT_SUPPORTED;
+		cmd_start = 35;
+		arg = MMC_ERASE_ARG_TRIM;
+	} else if (type == CARD_TYPE_bmSD) {
+		/* Standard capacity cards may only erase whole sectors */
+		if (!(pSd->bCardType & CARD_TYPE_bmHC)
+		    && !SD_CSD_ERASE_BLK_EN(pSd->CSD))
+			return SDMMC_NOT_SUPPORTED;
+		cmd_start = 32;
+	} else
+		return SDMMC_NOT_SUPPORTED;
+
+	if (!(pSd->bCardType & CARD_TYPE_bmHC)
+	    && last > 0xfffffffful / pSd->wCurrBlockLen)
+		return SDMMC_PARAM;
+
+	batch = _GetEraseBatch(pSd, &timeout);
+	for (start = address; !error && start <= last; start = end + 1) {
+		end = start + (batch - start % batch) - 1;
+		if (end < start || end > last)
+			end = last;
+		error = _EraseRange(pSd, cmd_start, arg, start, end, timeout);
+	}
+	trace_debug("SDer(%lu,%lu) %s\n\r", address, nbBlocks,
+	    SD_StringifyRetCode(error));
+	return error;
+}
+
 /**
  * Initialize SD/MMC driver struct.
  * \param pSd   Pointer to a SD card driver instance.
@@ -3542,6 +4427,38 @@ SD_GetNumberBlocks(const sSdCard * pSd)
 	return pSd->dwNbBlocks;
 }
 
+/**
+ * Return the erase unit of the SD/MMC card, in blocks: the Allocation Unit
+ * of SD cards, or the high-capacity erase group of MMC devices. Writes
+ * aligned on this size perform best. Returns 1 if unknown.
+ * \param pSd Pointer to \ref sSdCard instance.
+ */
+uint32_t
+SD_GetEraseUnitSize(const sSdCard * pSd)
+{
+	/* SD AU sizes from 8 MB, in MB */
+	static const uint8_t au_mb[] = { 8, 12, 16, 24, 32, 64 };
+	uint8_t type, code;
+
+	assert(pSd != NULL);
+
+	type = pSd->bCardType & CARD_TYPE_bmSDMMC;
+	if (type == CARD_TYPE_bmSD) {
+		code = SD_SSR_AU_SIZE(pSd->SSR);
+		if (code == 0)
+			return 1;
+		if (code <= SD_SSR_AU_SIZE_4M)
+			return 32ul << (code - 1);
+		return (uint32_t)au_mb[code - SD_SSR_AU_SIZE_4M - 1] * 2048ul;
+	}
+	if (type == CARD_TYPE_bmMMC) {
+		code = MMC_EXT_HC_ERASE_GRP_SIZE(pSd->EXT);
+		if (code != 0)
+			return (uint32_t)code * 1024ul;
+	}
+	return 1;
+}
+
 /**
  * Read one or more bytes from SDIO card, using RW_DIRECT command.
  * \param pSd         Pointer to SdCard instance.
@@ -4506,4 +5423,119 @@ mmc_configure_boot_bus(sSdCard * pSd, uint32_t config)
 	return SDMMC_OK;
 }
 
+/**
+ * Enable or disable the command queue of an eMMC device.
+ * While the command queue is enabled, block requests shall be submitted with
+ * mmc_queue_submit(), and SD_Read(), SD_Write() and the like fail.
+ * \param pSd     Pointer to a SD card driver instance.
+ * \param enable  true to enable the command queue, false to disable it.
+ * \return a \ref sdmmc_rc result code.
+ */
+uint8_t
+mmc_cmdq_enable(sSdCard * pSd, bool enable)
+{
+	uint8_t error, depth = 0, id;
+	uint32_t status;
+
+	assert(pSd != NULL);
+
+	/* Check if MMC */
+	if ((pSd->bCardType & CARD_TYPE_bmSDMMC) != CARD_TYPE_bmMMC) {
+		trace_error("mmc_cmdq_enable: not an MMC\n\r");
+		return SDMMC_ERROR_NOT_SUPPORT;
+	}
+	if (enable == (pSd->bCmdqDepth != 0))
+		return SDMMC_OK;
+	if (enable) {
+		if (MMC_EXT_EXT_CSD_REV(pSd->EXT) < 8
+		    || !(MMC_EXT_CMDQ_SUPPORT(pSd->EXT) & MMC_EXT_CMDQ_SUPPORT_EN)) {
+			trace_error("mmc_cmdq_enable: no command queue\n\r");
+			return SDMMC_ERROR_NOT_SUPPORT;
+		}
+		depth = (MMC_EXT_CMDQ_DEPTH(pSd->EXT) & MMC_EXT_CMDQ_DEPTH_Msk)
+		    + 1;
+	}
+	else {
+		for (id = 0; id < MMC_CMDQ_DEPTH_MAX; id++) {
+			if (pSd->pCmdqTask[id])
+				return SDMMC_ERROR_BUSY;
+		}
+	}
+
+	MmcCmd6Arg cmd6Arg = {
+		.access = 0x3,                    /* Write byte in the EXT_CSD register */
+		.index = MMC_EXT_CMDQ_MODE_EN_I,  /* Target byte in EXT_CSD */
+		.value = enable ? 1 : 0,          /* Byte value */
+	};
+	error = MmcCmd6(pSd, &cmd6Arg, &status);
+	if (error) {
+		trace_error("mmc_cmdq_enable.Cmd6: %d\n\r", error);
+		return SDMMC_ERROR;
+	} else if (status & STATUS_MMC_SWITCH) {
+		trace_error("mmc_cmdq_enable: %x\n\r", (unsigned)status);
+		return SDMMC_ERROR_NOT_SUPPORT;
+	}
+	pSd->bCmdqDepth = depth;
+	trace_info("MMC command queue %s, depth %u\n\r",
+	    enable ? "on" : "off", depth);
+	return SDMMC_OK;
+}
+
+/**
+ * Append a block request to the list of pending requests. Nothing is sent
+ * to the device until mmc_queue_run() is called.
+ * \param pSd    Pointer to a SD card driver instance.
+ * \param pTask  Pointer to the request. It shall remain valid, and its data
+ * buffers untouched, until the request is complete.
+ * \return a \ref sdmmc_rc result code.
+ */
+uint8_t
+mmc_queue_submit(sSdCard * pSd, sMmcTask * pTask)
+{
+	uint32_t len = 0;
+	uint16_t ix;
+
+	assert(pSd != NULL);
+	assert(pTask != NULL);
+
+	if (pTask->wNbBlocks == 0 || (pTask->pData == NULL) == (pTask->pIoVec == NULL))
+		return SDMMC_PARAM;
+	if (pTask->pIoVec) {
+		for (ix = 0; ix < pTask->wIoVecCnt; ix++)
+			len += pTask->pIoVec[ix].dwLen;
+		if (len != (uint32_t)pTask->wNbBlocks * BLOCK_SIZE(pSd))
+			return SDMMC_PARAM;
+	}
+	pTask->bStatus = SDMMC_BUSY;
+	pTask->pNext = NULL;
+	if (pSd->pTaskTail)
+		pSd->pTaskTail->pNext = pTask;
+	else
+		pSd->pTaskHead = pTask;
+	pSd->pTaskTail = pTask;
+	return SDMMC_OK;
+}
+
+/**
+ * Process the pending block requests, until none is left. Each request
+ * completes with its own result in sMmcTask.bStatus, and its callback, if
+ * any, is then invoked. The callback may submit further requests.
+ * With the command queue enabled, requests are queued in the device as
+ * task IDs allow, and executed in the order the device chooses. Otherwise
+ * consecutive write requests are merged into packed write commands, when the
+ * device and the driver support it.
+ * \param pSd  Pointer to a SD card driver instance.
+ * \return SDMMC_OK, or the first error met. Should the device stop
+ * responding, the requests not queued yet remain pending.
+ */
+uint8_t
+mmc_queue_run(sSdCard * pSd)
+{
+	assert(pSd != NULL);
+
+	if (pSd->bCmdqDepth)
+		return _RunQueueCmdq(pSd);
+	return _RunQueueLegacy(pSd);
+}
+
 /**@}*/
@@ -47,10 +47,16 @@
  *  - SD/MMC Memory Card Operations
  *    -# SD_ReadBlocks() : Read blocks of data
  *    -# SD_WriteBlocks() : Write blocks of data
+ *    -# SD_Erase() : Erase (TRIM) blocks of data
  *    -# SD_Read() : Read blocks of data with multi-access command
  *                   (Optimized read, see \ref sdmmc_read_op).
  *    -# SD_Write() : Read blocks of data with multi-access command
  *                    (Optimized write, see \ref sdmmc_write_op).
+ *    -# SD_ReadV() : Read blocks of data into a list of buffer fragments
+ *    -# SD_WriteV() : Write blocks of data from a list of buffer fragments
+ *    -# mmc_queue_submit() : Queue a block request, see \ref sMmcTask
+ *    -# mmc_queue_run() : Process the queued block requests, either through
+ *       the eMMC command queue (see mmc_cmdq_enable()) or with packed writes
  *    -# SD_GetNumberBlocks() : Return SD/MMC card reported number of blocks.
  *    -# SD_GetBlockSize() : Return SD/MMC card reported block size.
  *    -# SD_GetTotalSizeKB() : Return size of SD/MMC card in Kibibytes (KiB).
@@ -100,6 +106,7 @@
  *  @{
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "sdmmc_hal.h"
 #include "sdio.h"
@@ -514,10 +521,25 @@
 #define MMC_EXT32(p, i)                 SD_U32(p, 512, i)
 #define MMC_EXT_S_CMD_SET_I             504 /**< Supported Command Sets slice */
 #define MMC_EXT_S_CMD_SET(p)            MMC_EXT8(p, MMC_EXT_S_CMD_SET_I)
+#define MMC_EXT_MAX_PACKED_READS_I      501 /**< Max packed read commands */
+#define MMC_EXT_MAX_PACKED_READS(p)     MMC_EXT8(p, MMC_EXT_MAX_PACKED_READS_I)
+#define MMC_EXT_MAX_PACKED_WRITES_I     500 /**< Max packed write commands */
+#define MMC_EXT_MAX_PACKED_WRITES(p)    MMC_EXT8(p, MMC_EXT_MAX_PACKED_WRITES_I)
+#define MMC_EXT_CMDQ_SUPPORT_I          308 /**< Command queuing support */
+#define MMC_EXT_CMDQ_SUPPORT(p)         MMC_EXT8(p, MMC_EXT_CMDQ_SUPPORT_I)
+#define     MMC_EXT_CMDQ_SUPPORT_EN     (1 << 0)
+#define MMC_EXT_CMDQ_DEPTH_I            307 /**< Command queue depth, minus one */
+#define MMC_EXT_CMDQ_DEPTH(p)           MMC_EXT8(p, MMC_EXT_CMDQ_DEPTH_I)
+#define     MMC_EXT_CMDQ_DEPTH_Msk      0x1f
 #define MMC_EXT_PWR_CL_DDR_52_360_I     239 /**< Power Class for 52MHz DDR @ 3.6V */
 #define MMC_EXT_PWR_CL_DDR_52_360(p)    MMC_EXT8(p, MMC_EXT_PWR_CL_DDR_52_360_I)
 #define MMC_EXT_PWR_CL_200_195_I        237 /**< Power Class for 200MHz HS200 @ VCCQ=1.95V VCC=3.6V */
 #define MMC_EXT_PWR_CL_200_195(p)       MMC_EXT8(p, MMC_EXT_PWR_CL_200_195_I)
+#define MMC_EXT_TRIM_MULT_I             232 /**< TRIM timeout multiplier slice */
+#define MMC_EXT_TRIM_MULT(p)            MMC_EXT8(p, MMC_EXT_TRIM_MULT_I)
+#define MMC_EXT_SEC_FEATURE_SUPPORT_I   231 /**< Secure Feature support slice */
+#define MMC_EXT_SEC_FEATURE_SUPPORT(p)  MMC_EXT8(p, MMC_EXT_SEC_FEATURE_SUPPORT_I)
+#define     MMC_EXT_SEC_GB_CL_EN        (1 << 4) /**< TRIM and garbage collection supported */
 #define MMC_EXT_BOOT_INFO_I             228 /**< Boot information  slice */
 #define MMC_EXT_BOOT_INFO(p)            MMC_EXT8(p, MMC_EXT_BOOT_INFO_I)
 #define MMC_EXT_BOOT_SIZE_MULTI_I       226 /**< Boot partition size  slice */
@@ -605,6 +627,8 @@
 #define MMC_EXT_DATA_SECTOR_SIZE(p)     MMC_EXT8(p, MMC_EXT_DATA_SECTOR_SIZE_I)
 #define     MMC_EXT_DATA_SECT_512B      0
 #define     MMC_EXT_DATA_SECT_4KIB      1
+#define MMC_EXT_CMDQ_MODE_EN_I          15  /**< Command queue mode enable */
+#define MMC_EXT_CMDQ_MODE_EN(p)         MMC_EXT8(p, MMC_EXT_CMDQ_MODE_EN_I)
 /**     @}*/
 
 /** \addtogroup sd_cmd8 SD CMD8 arguments
@@ -643,10 +667,14 @@ extern uint8_t SD_GetWpStatus(const sSdCard * pSd);
 extern uint8_t SD_GetCardType(const sSdCard * pSd);
 extern uint32_t SD_GetNumberBlocks(const sSdCard * pSd);
 extern uint32_t SD_GetBlockSize(const sSdCard * pSd);
+extern uint32_t SD_GetEraseUnitSize(const sSdCard * pSd);
 extern uint32_t SD_GetTotalSizeKB(const sSdCard * pSd);
 
 extern uint8_t mmc_configure_partition(sSdCard * pSd, uint32_t config);
 extern uint8_t mmc_configure_boot_bus(sSdCard * pSd, uint32_t config);
+extern uint8_t mmc_cmdq_enable(sSdCard * pSd, bool enable);
+extern uint8_t mmc_queue_submit(sSdCard * pSd, sMmcTask * pTask);
+extern uint8_t mmc_queue_run(sSdCard * pSd);
 
 extern uint8_t SD_ReadBlocks(sSdCard * pSd,
 			     uint32_t dwAddr, void *pData, uint32_t dwNbBlocks);
@@ -654,6 +682,9 @@ extern uint8_t SD_WriteBlocks(sSdCard * pSd,
 			      uint32_t dwAddr,
 			      const void *pData, uint32_t dwNbBlocks);
 
+extern uint8_t SD_Erase(sSdCard * pSd,
+			uint32_t dwAddr, uint32_t dwNbBlocks);
+
 extern uint8_t SD_Read(sSdCard * pSd,
 		       uint32_t dwAddr,
 		       void *pData,
@@ -664,6 +695,12 @@ extern uint8_t SD_Write(sSdCard * pSd,
 			const void *pData,
 			uint32_t dwNbBlocks,
 			fSdmmcCallback fCallback, void *pArg);
+extern uint8_t SD_ReadV(sSdCard * pSd,
+			uint32_t dwAddr,
+			const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt);
+extern uint8_t SD_WriteV(sSdCard * pSd,
+			 uint32_t dwAddr,
+			 const sSdmmcIoVec * pIoVec, uint16_t wIoVecCnt);
 
 extern uint8_t SDIO_ReadDirect(sSdCard * pSd,
 			       uint8_t bFunctionNum,
@@ -345,6 +345,17 @@ typedef union _SdmmcCmdOperation {
 		 checkBsy:1;	    /**< Busy check is ON */
 	} bmBits;
 } uSdmmcCmdOp;
+
+/**
+ * Data buffer fragment, one element of a scatter/gather list.
+ */
+typedef struct _SdmmcIoVec {
+	/** Start of the fragment. No alignment requirement. */
+	uint8_t *pData;
+	/** Size of the fragment in bytes. */
+	uint32_t dwLen;
+} sSdmmcIoVec;
+
 /**
  * Sdmmc command instance.
  */
@@ -358,6 +369,15 @@ typedef struct _SdmmcCommand {
 	/** Data buffer. It shall follow the peripheral and DMA alignment
 	 * requirements, which are peripheral and driver dependent. */
 	uint8_t *pData;
+	/** Optional scatter/gather list, used instead of pData when not NULL.
+	 * The fragments are transferred in order, their sizes shall add up
+	 * to wBlockSize * wNbBlocks. Only supported by DMA capable drivers. */
+	const sSdmmcIoVec *pIoVec;
+	/** Count of elements in pIoVec. */
+	uint16_t wIoVecCnt;
+	/** Flags ORed into the argument of the SET_BLOCK_COUNT command, when
+	 * the driver issues it on its own. E.g. packed or reliable write. */
+	uint32_t dwSetBlkCntFlags;
 	/** Size of data block in bytes. */
 	uint16_t wBlockSize;
 	/** Number of blocks to be transfered */
@@ -404,6 +424,36 @@ typedef struct _SdHalFunctions {
 	fSdmmcIOCtrl fIOCtrl;	    /**< Pointer to IO control function */
 } sSdHalFunctions;
 
+/** Max depth of the eMMC command queue */
+#define MMC_CMDQ_DEPTH_MAX      32
+
+/**
+ * eMMC block request, processed by mmc_queue_run().
+ */
+typedef struct _MmcTask {
+	/** Optional callback invoked once the request is complete, with the
+	 * status of the request and pArg. */
+	fSdmmcCallback fCallback;
+	/** Optional argument to the callback function. */
+	void *pArg;
+	/** Data buffer. */
+	uint8_t *pData;
+	/** Optional list of buffer fragments, used instead of pData. */
+	const sSdmmcIoVec *pIoVec;
+	/** Count of elements in pIoVec. */
+	uint16_t wIoVecCnt;
+	/** Count of blocks to transfer. */
+	uint16_t wNbBlocks;
+	/** Address of the first block. */
+	uint32_t dwAddr;
+	/** 1 to write to the device, 0 to read. */
+	uint8_t bWrite;
+	/** Status of the request, once complete. */
+	uint8_t bStatus;
+	/** Private, next request in the queue. */
+	struct _MmcTask *pNext;
+} sMmcTask;
+
 /**
  * \brief SD/MMC card driver structure.
  * It holds the current command being processed and the SD/MMC card address.
@@ -432,6 +482,10 @@ typedef struct _SdCard {
 				/**< Multi-purpose temporary buffer.
 				 * This member may have to follow the DMA
 				 * alignment requirements. */
+	uint8_t packed_hdr[ROUND_UP_MULT(512, L1_CACHE_BYTES)];
+				/**< Header block of packed commands.
+				 * This member may have to follow the DMA
+				 * alignment requirements. */
 
 	uint32_t CID[128 / 8 / 4];
 				/**< Card Identification (CID register) */
@@ -461,6 +515,15 @@ typedef struct _SdCard {
 	uint8_t bStatus;	/**< Unrecovered error */
 	uint8_t bSetBlkCnt;	/**< Explicit SET_BLOCK_COUNT command used */
 	uint8_t bStopMultXfer;	/**< Explicit STOP_TRANSMISSION command used */
+	uint8_t bCmdqDepth;	/**< Depth of the command queue, 0 if disabled */
+	uint8_t bPackedWrDis;	/**< Packed write commands not supported */
+	sMmcTask *pTaskHead;	/**< First block request waiting to be
+				 * processed */
+	sMmcTask *pTaskTail;	/**< Last block request waiting to be
+				 * processed */
+	sMmcTask *pCmdqTask[MMC_CMDQ_DEPTH_MAX];
+				/**< Requests queued in the device, by task
+				 * ID */
 } sSdCard;
 
 /** \addtogroup sdmmc_struct_cmdarg SD/MMC command arguments
@@ -221,7 +221,8 @@ DRESULT disk_ioctl(BYTE slot, BYTE cmd, void* buff)
 	DRESULT res;
 	DWORD *param_u32 = (DWORD *)buff;
 	WORD *param_u16 = (WORD *)buff;
-	uint32_t blk_size, blk_count;
+	uint32_t blk_size, blk_count, ratio;
+	uint8_t rc;
 
 	if (!SD_GetInstance(slot, &lib))
 		return RES_PARERR;
@@ -265,17 +266,36 @@ DRESULT disk_ioctl(BYTE slot, BYTE cmd, void* buff)
 	case GET_BLOCK_SIZE:
 		if (!buff)
 			return RES_PARERR;
-		/* On SD/MMC devices, erase block size is the same as write
-		 * block size.
-		 * Hence, erasing as little as one sector is allowed. */
-		*param_u32 = 1;
+		/* Report the Allocation Unit (SD) or erase group (MMC), so
+		 * that f_mkfs() aligns the data area on it. Writes within an
+		 * erase unit perform best. */
+		blk_size = SD_GetBlockSize(lib);
+		if (blk_size == 0)
+			return RES_NOTRDY;
+		ratio = blk_size < _MIN_SS ? _MIN_SS / blk_size : 1;
+		*param_u32 = SD_GetEraseUnitSize(lib) / ratio;
+		if (*param_u32 == 0)
+			*param_u32 = 1;
 		res = RES_OK;
 		break;
 
 	case CTRL_TRIM:
-		/* This TRIM-like command is not implemented.
-		 * It would be required if _USE_TRIM was enabled. */
-		res = RES_PARERR;
+		/* buff holds the first and the last sectors to erase. Devices
+		 * which cannot erase single blocks ignore the request. */
+		if (!buff || param_u32[1] < param_u32[0])
+			return RES_PARERR;
+		blk_size = SD_GetBlockSize(lib);
+		if (blk_size == 0)
+			return RES_NOTRDY;
+		ratio = blk_size < _MIN_SS ? _MIN_SS / blk_size : 1;
+		rc = SD_Erase(lib, param_u32[0] * ratio,
+		    (param_u32[1] - param_u32[0] + 1) * ratio);
+		if (rc == SDMMC_OK || rc == SDMMC_NOT_SUPPORTED)
+			res = RES_OK;
+		else if (rc == SDMMC_PARAM)
+			res = RES_PARERR;
+		else
+			res = RES_ERROR;
 		break;
 
 	default:
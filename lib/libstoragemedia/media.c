@@ -137,6 +137,25 @@ uint8_t media_flush(struct _media* media)
 	}
 }
 
+/**
+ *  \brief Informs the media that the data of a range of blocks is no longer
+ *  used, so that it can be discarded ahead of the next writes. The data read
+ *  from trimmed blocks is undefined.
+ *  \param media Pointer to the media instance to use
+ *  \param address Address of the first block
+ *  \param length Number of blocks
+ *  \return Operation result code, MEDIA_STATUS_SUCCESS if the media does
+ *  not support trimming
+ */
+uint8_t media_trim(struct _media* media, uint32_t address, uint32_t length)
+{
+	if (media->trim) {
+		return media->trim(media, address, length);
+	} else {
+		return MEDIA_STATUS_SUCCESS;
+	}
+}
+
 /**
  *  \brief Invokes the interrupt handler of the specified media
  *  \param media Pointer to the media instance to use
@@ -229,6 +248,18 @@ uint32_t media_get_size(struct _media *media)
 	return media->size;
 }
 
+/**
+ *  \brief Return the preferred transfer length in number of blocks.
+ *  Transfers of a multiple of this length, starting on a multiple of it,
+ *  are the most efficient.
+ *  \param media Pointer to the media instance to use
+ *  \return Preferred length, or 1 if the media has no preference
+ */
+uint32_t media_get_optimal_length(struct _media *media)
+{
+	return media->optimal_length ? media->optimal_length : 1;
+}
+
 /**
  *  \brief Return mapped memory address for a block on media.
  *  \param media Pointer to the media instance to use
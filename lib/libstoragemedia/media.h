@@ -89,6 +89,7 @@ extern uint8_t media_read(struct _media *media, uint32_t address, void *data, ui
 extern uint8_t media_lock(struct _media *media, uint32_t start, uint32_t end, uint32_t *actual_start, uint32_t *actual_end);
 extern uint8_t media_unlock(struct _media *media, uint32_t start, uint32_t end, uint32_t *actual_start, uint32_t *actual_end);
 extern uint8_t media_flush(struct _media *media);
+extern uint8_t media_trim(struct _media *media, uint32_t address, uint32_t length);
 extern void media_handler(struct _media *media);
 extern void media_deinit(struct _media *media);
 
@@ -101,6 +102,7 @@ extern bool media_is_write_protected(struct _media *media);
 extern uint8_t media_get_state(struct _media *media);
 extern uint32_t media_get_block_size(struct _media *media);
 extern uint32_t media_get_size(struct _media *media);
+extern uint32_t media_get_optimal_length(struct _media *media);
 extern uint32_t media_get_mapped_address(struct _media *media, uint32_t block);
 
 extern void media_handle_all(struct _media *medias, int num_media);
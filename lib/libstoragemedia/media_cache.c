@@ -0,0 +1,680 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*---------------------------------------------------------------------------
+ *         Headers
+ *---------------------------------------------------------------------------*/
+
+#include "media.h"
+#include "media_cache.h"
+#include "media_private.h"
+
+#include "mm/cache.h"
+
+#include "intmath.h"
+#include "trace.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------
+ *         Definitions
+ *---------------------------------------------------------------------------*/
+
+/** Address of the unused lines */
+#define NO_ADDRESS 0xffffffff
+
+/*---------------------------------------------------------------------------
+ *         Local functions
+ *---------------------------------------------------------------------------*/
+
+/**
+ * \brief Returns the mask of count blocks starting at block first of a line
+ */
+static uint32_t _mask(uint8_t first, uint8_t count)
+{
+	if (count >= 32)
+		return 0xffffffff;
+	return ((1u << count) - 1) << first;
+}
+
+/**
+ * \brief Returns the number of blocks in a mask
+ */
+static uint8_t _count(uint32_t mask)
+{
+	uint8_t count = 0;
+
+	while (mask) {
+		mask &= mask - 1;
+		count++;
+	}
+	return count;
+}
+
+/**
+ * \brief Finds the next run of consecutive blocks in a mask.
+ * \param mask Mask of blocks
+ * \param first Block from which to search, updated with the first block of
+ *        the run
+ * \param count Updated with the number of blocks of the run
+ * \return true if a run was found
+ */
+static bool _next_run(uint32_t mask, uint8_t *first, uint8_t *count)
+{
+	uint8_t i = *first;
+
+	while (i < 32 && !(mask & (1u << i)))
+		i++;
+	if (i >= 32)
+		return false;
+	*first = i;
+	while (i < 32 && (mask & (1u << i)))
+		i++;
+	*count = i - *first;
+	return true;
+}
+
+/**
+ * \brief Returns the data buffer of a line
+ */
+static uint8_t *_line_data(struct _media_cache *cache,
+		struct _media_cache_line *line)
+{
+	return cache->buffer + (line - cache->lines) * cache->line_size;
+}
+
+/**
+ * \brief Returns the mask of the blocks of a line which are inside the
+ * media (the last line of the media may be partial)
+ */
+static uint32_t _line_mask(struct _media_cache *cache,
+		struct _media_cache_line *line)
+{
+	return _mask(0, min_u32(cache->blocks_per_line,
+				cache->backend->size - line->address));
+}
+
+/**
+ * \brief Looks for the line caching the given line address
+ * \return Pointer to the line, or NULL if the line is not cached
+ */
+static struct _media_cache_line *_find(struct _media_cache *cache,
+		uint32_t address)
+{
+	uint16_t i;
+
+	for (i = 0; i < cache->num_lines; i++)
+		if (cache->lines[i].address == address)
+			return &cache->lines[i];
+	return NULL;
+}
+
+/**
+ * \brief Reads blocks of a line from the backend, one request per run of
+ * consecutive blocks.
+ * \param cache Pointer to a cache instance
+ * \param line Pointer to the line to fill
+ * \param mask Mask of the blocks to read
+ * \return Operation result code
+ */
+static uint8_t _fill(struct _media_cache *cache,
+		struct _media_cache_line *line, uint32_t mask)
+{
+	uint32_t block_size = cache->backend->block_size;
+	uint8_t *data = _line_data(cache, line);
+	uint8_t first, count;
+	uint8_t status;
+
+	for (first = 0; _next_run(mask, &first, &count); first += count) {
+		cache->stats.backend_reads++;
+		status = media_read(cache->backend, line->address + first,
+				data + first * block_size, count, NULL, NULL);
+		if (status != MEDIA_STATUS_SUCCESS)
+			return status;
+		line->valid |= _mask(first, count);
+	}
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Writes the dirty blocks of a line to the backend, one request per
+ * run of consecutive blocks.
+ * \param cache Pointer to a cache instance
+ * \param line Pointer to the line to write back
+ * \return Operation result code
+ */
+static uint8_t _write_back(struct _media_cache *cache,
+		struct _media_cache_line *line)
+{
+	uint32_t block_size = cache->backend->block_size;
+	uint8_t *data = _line_data(cache, line);
+	uint32_t dirty = line->dirty;
+	uint8_t first, count;
+	uint8_t status;
+
+	for (first = 0; _next_run(dirty, &first, &count); first += count) {
+		cache->stats.backend_writes++;
+		status = media_write(cache->backend, line->address + first,
+				data + first * block_size, count, NULL, NULL);
+		if (status != MEDIA_STATUS_SUCCESS)
+			return status;
+		line->dirty &= ~_mask(first, count);
+		cache->stats.written_back += count;
+	}
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Writes back all the dirty lines, in ascending address order.
+ * \param cache Pointer to a cache instance
+ * \return Operation result code
+ */
+static uint8_t _write_back_all(struct _media_cache *cache)
+{
+	struct _media_cache_line *line;
+	uint16_t i;
+	uint8_t status;
+
+	while (true) {
+		line = NULL;
+		for (i = 0; i < cache->num_lines; i++) {
+			if (!cache->lines[i].dirty)
+				continue;
+			if (!line || cache->lines[i].address < line->address)
+				line = &cache->lines[i];
+		}
+		if (!line)
+			return MEDIA_STATUS_SUCCESS;
+
+		status = _write_back(cache, line);
+		if (status != MEDIA_STATUS_SUCCESS)
+			return status;
+	}
+}
+
+/**
+ * \brief Allocates a line for the given line address, evicting the least
+ * recently used line if no line is free.
+ * \param cache Pointer to a cache instance
+ * \param address Address of the first block of the line
+ * \param clean_only Only evict lines without dirty blocks
+ * \param line Updated with the allocated line
+ * \return Operation result code, MEDIA_STATUS_BUSY if all the lines are
+ * dirty and clean_only is set
+ */
+static uint8_t _allocate(struct _media_cache *cache, uint32_t address,
+		bool clean_only, struct _media_cache_line **line)
+{
+	struct _media_cache_line *victim = NULL;
+	uint16_t i;
+	uint8_t status;
+
+	for (i = 0; i < cache->num_lines; i++) {
+		struct _media_cache_line *l = &cache->lines[i];
+		if (l->address == NO_ADDRESS) {
+			victim = l;
+			break;
+		}
+		if (clean_only && l->dirty)
+			continue;
+		if (!victim || l->last_use < victim->last_use)
+			victim = l;
+	}
+	if (!victim)
+		return MEDIA_STATUS_BUSY;
+
+	if (victim->address != NO_ADDRESS) {
+		if (victim->dirty) {
+			status = _write_back(cache, victim);
+			if (status != MEDIA_STATUS_SUCCESS)
+				return status;
+		}
+		if (victim->prefetched) {
+			/* Read ahead too far for the cache size or the access
+			 * pattern, shrink the window */
+			cache->stats.readahead_unused += _count(victim->prefetched);
+			cache->readahead /= 2;
+		}
+		cache->stats.evictions++;
+	}
+
+	victim->address = address;
+	victim->last_use = ++cache->clock;
+	victim->valid = 0;
+	victim->dirty = 0;
+	victim->prefetched = 0;
+	*line = victim;
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Reads ahead the lines following a sequential read. Lines already
+ * cached are skipped, and only clean lines are evicted.
+ * \param cache Pointer to a cache instance
+ * \param address Block following the sequential read
+ */
+static void _read_ahead(struct _media_cache *cache, uint32_t address)
+{
+	struct _media_cache_line *line;
+	uint32_t mask;
+	uint8_t i;
+
+	/* Start at the line following the last line read */
+	if (address % cache->blocks_per_line)
+		address += cache->blocks_per_line - address % cache->blocks_per_line;
+
+	for (i = 0; i < cache->readahead; i++) {
+		if (address >= cache->backend->size)
+			break;
+		if (!_find(cache, address)) {
+			if (_allocate(cache, address, true, &line) != MEDIA_STATUS_SUCCESS)
+				break;
+			mask = _line_mask(cache, line);
+			if (_fill(cache, line, mask) != MEDIA_STATUS_SUCCESS) {
+				line->address = NO_ADDRESS;
+				break;
+			}
+			line->prefetched = mask;
+			cache->stats.readahead += _count(mask);
+		}
+		address += cache->blocks_per_line;
+	}
+}
+
+/**
+ * \brief Reads a specified amount of data through the cache
+ * \param media Pointer to a Media instance
+ * \param address Address of the data to read
+ * \param data Pointer to the buffer in which to store the retrieved data
+ * \param length Length of the buffer
+ * \param callback Optional pointer to a callback function to invoke when
+ *                 the operation is finished
+ * \param callback_arg Optional pointer to an argument for the callback
+ * \return Operation result code
+ */
+static uint8_t media_cache_read(struct _media *media,
+		uint32_t address, void *data, uint32_t length,
+		media_callback_t callback, void *callback_arg)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+	uint8_t *dest = (uint8_t*)data;
+	uint8_t status = MEDIA_STATUS_SUCCESS;
+	bool sequential, trigger = false;
+
+	// Check that the media is ready
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	// Check that the data to read is not too big
+	if ((address + length) > media->size)
+		return MEDIA_STATUS_ERROR;
+
+	// Enter Busy state
+	media->state = MEDIA_STATE_BUSY;
+
+	sequential = address == cache->next_address;
+	if (!sequential)
+		cache->readahead = 0;
+	cache->next_address = address + length;
+
+	while (length) {
+		struct _media_cache_line *line;
+		uint32_t line_address = address - address % cache->blocks_per_line;
+		uint8_t first = address - line_address;
+		uint8_t count = min_u32(cache->blocks_per_line - first, length);
+		uint32_t mask = _mask(first, count);
+		uint32_t missing;
+
+		line = _find(cache, line_address);
+		if (!line) {
+			status = _allocate(cache, line_address, false, &line);
+			if (status != MEDIA_STATUS_SUCCESS)
+				break;
+		}
+		line->last_use = ++cache->clock;
+
+		missing = mask & ~line->valid;
+		if (missing) {
+			uint32_t fill = missing;
+			/* Sequential access, also read the end of the line */
+			if (sequential)
+				fill |= _line_mask(cache, line) & ~_mask(0, first)
+					& ~line->valid;
+			status = _fill(cache, line, fill);
+			if (status != MEDIA_STATUS_SUCCESS)
+				break;
+			line->prefetched |= fill & ~mask;
+			cache->stats.read_misses += _count(missing);
+			cache->stats.readahead += _count(fill & ~mask);
+			trigger = sequential;
+		}
+
+		/* Entering a line read ahead, keep the window ahead */
+		if (line->prefetched & mask & 1)
+			trigger = sequential;
+		line->prefetched &= ~mask;
+		cache->stats.read_hits += _count(mask & ~missing);
+
+		memcpy(dest, _line_data(cache, line) + first * media->block_size,
+				count * media->block_size);
+
+		dest += count * media->block_size;
+		address += count;
+		length -= count;
+	}
+
+	if (status == MEDIA_STATUS_SUCCESS && trigger) {
+		if (cache->readahead)
+			cache->readahead = min_u32(2 * cache->readahead,
+					cache->max_readahead);
+		else
+			cache->readahead = min_u32(1, cache->max_readahead);
+		_read_ahead(cache, address);
+	}
+
+	// Leave the Busy state
+	media->state = MEDIA_STATE_READY;
+
+	// Invoke callback
+	if (callback)
+		callback(callback_arg, status, 0, length);
+
+	return status;
+}
+
+/**
+ *  \brief Writes data through the cache. The data is written to the backend
+ *  when its line is evicted or when the cache is flushed.
+ *  \param media Pointer to a Media instance
+ *  \param address Address at which to write
+ *  \param data Pointer to the data to write
+ *  \param length Size of the data buffer
+ *  \param callback Optional pointer to a callback function to invoke when
+ *                  the write operation terminates
+ *  \param callback_arg Optional argument for the callback function
+ *  \return Operation result code
+ */
+static uint8_t media_cache_write(struct _media *media,
+		uint32_t address, void *data, uint32_t length,
+		media_callback_t callback, void *callback_arg)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+	const uint8_t *src = (const uint8_t*)data;
+	uint8_t status = MEDIA_STATUS_SUCCESS;
+
+	// Check that the media is ready
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	// Check that the data to write is not too big
+	if ((address + length) > media->size)
+		return MEDIA_STATUS_ERROR;
+
+	// Put the media in Busy state
+	media->state = MEDIA_STATE_BUSY;
+
+	while (length) {
+		struct _media_cache_line *line;
+		uint32_t line_address = address - address % cache->blocks_per_line;
+		uint8_t first = address - line_address;
+		uint8_t count = min_u32(cache->blocks_per_line - first, length);
+		uint32_t mask = _mask(first, count);
+
+		line = _find(cache, line_address);
+		if (line) {
+			cache->stats.write_hits += count;
+		} else {
+			status = _allocate(cache, line_address, false, &line);
+			if (status != MEDIA_STATUS_SUCCESS)
+				break;
+			cache->stats.write_misses += count;
+		}
+		line->last_use = ++cache->clock;
+
+		memcpy(_line_data(cache, line) + first * media->block_size, src,
+				count * media->block_size);
+		line->valid |= mask;
+		line->dirty |= mask;
+		line->prefetched &= ~mask;
+
+		src += count * media->block_size;
+		address += count;
+		length -= count;
+	}
+
+	// Leave the Busy state
+	media->state = MEDIA_STATE_READY;
+
+	// Invoke the callback if it exists
+	if (callback)
+		callback(callback_arg, status, 0, length);
+
+	return status;
+}
+
+/**
+ * \brief Writes back all the dirty blocks, then flushes the backend.
+ * \param media Pointer to a Media instance
+ * \return Operation result code
+ */
+static uint8_t media_cache_flush(struct _media *media)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+	uint8_t status;
+
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	media->state = MEDIA_STATE_BUSY;
+	status = _write_back_all(cache);
+	media->state = MEDIA_STATE_READY;
+
+	if (status != MEDIA_STATUS_SUCCESS)
+		return status;
+	return media_flush(cache->backend);
+}
+
+/**
+ * \brief Drops the trimmed blocks from the cached lines, without writing
+ * them back, then forwards the trim to the backend.
+ * \param media Pointer to a Media instance
+ * \param address Address of the first block
+ * \param length Number of blocks
+ * \return Operation result code
+ */
+static uint8_t media_cache_trim(struct _media *media,
+		uint32_t address, uint32_t length)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+	uint16_t i;
+
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	if ((address + length) > media->size)
+		return MEDIA_STATUS_ERROR;
+
+	for (i = 0; i < cache->num_lines; i++) {
+		struct _media_cache_line *line = &cache->lines[i];
+		uint32_t first, last, mask;
+
+		if (line->address == NO_ADDRESS ||
+		    line->address >= address + length ||
+		    line->address + cache->blocks_per_line <= address)
+			continue;
+		first = max_u32(address, line->address) - line->address;
+		last = min_u32(address + length,
+				line->address + cache->blocks_per_line) - line->address;
+		mask = ~_mask(first, last - first);
+		line->valid &= mask;
+		line->dirty &= mask;
+		line->prefetched &= mask;
+	}
+
+	return media_trim(cache->backend, address, length);
+}
+
+/**
+ * \brief Forwards the interrupt handler call to the backend.
+ * \param media Pointer to a Media instance
+ */
+static void media_cache_handler(struct _media *media)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+
+	media_handler(cache->backend);
+}
+
+/*---------------------------------------------------------------------------
+ *      Exported Functions
+ *---------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes a cache media on top of a backend media.
+ * \param media Pointer to the Media instance to initialize
+ * \param cache Pointer to the cache instance
+ * \param backend Pointer to an initialized Media instance to cache
+ * \param buffer Cache aligned buffer for the cached data, of
+ *        MEDIA_CACHE_BUFFER_SIZE(num_lines, blocks_per_line, block size)
+ *        bytes
+ * \param num_lines Number of cache lines, up to MEDIA_CACHE_MAX_LINES
+ * \param blocks_per_line Number of blocks per line, up to
+ *        MEDIA_CACHE_MAX_BLOCKS_PER_LINE. The line size must be a multiple
+ *        of the L1 cache line size.
+ * \param max_readahead Maximum read-ahead window in lines, 0 to disable read
+ *        ahead. Limited to half the number of lines.
+ * \return MEDIA_STATUS_SUCCESS if the media is ready
+ */
+uint8_t media_cache_initialize(struct _media *media,
+		struct _media_cache *cache, struct _media *backend,
+		void *buffer, uint16_t num_lines, uint8_t blocks_per_line,
+		uint8_t max_readahead)
+{
+	uint16_t i;
+
+	memset(media, 0, sizeof(*media));
+	memset(cache, 0, sizeof(*cache));
+	media->state = MEDIA_STATE_NOT_READY;
+
+	if (num_lines == 0 || num_lines > MEDIA_CACHE_MAX_LINES ||
+	    blocks_per_line == 0 ||
+	    blocks_per_line > MEDIA_CACHE_MAX_BLOCKS_PER_LINE) {
+		trace_error("media_cache: invalid geometry\r\n");
+		return MEDIA_STATUS_ERROR;
+	}
+
+	cache->backend = backend;
+	cache->buffer = (uint8_t*)buffer;
+	cache->line_size = blocks_per_line * backend->block_size;
+	cache->num_lines = num_lines;
+	cache->blocks_per_line = blocks_per_line;
+	cache->max_readahead = min_u32(max_readahead, num_lines / 2);
+	cache->next_address = NO_ADDRESS;
+	for (i = 0; i < num_lines; i++)
+		cache->lines[i].address = NO_ADDRESS;
+
+	if (!IS_CACHE_ALIGNED(buffer) || !IS_CACHE_ALIGNED(cache->line_size)) {
+		trace_error("media_cache: buffer or line size not cache aligned\r\n");
+		return MEDIA_STATUS_ERROR;
+	}
+
+	media->write = media_cache_write;
+	media->read = media_cache_read;
+	media->flush = media_cache_flush;
+	media->trim = media_cache_trim;
+	media->handler = media_cache_handler;
+
+	media->interface = cache;
+	media->block_size = backend->block_size;
+	media->base_address = 0;
+	media->size = backend->size;
+	media->optimal_length = blocks_per_line;
+
+	media->mapped_read = false;
+	media->mapped_write = false;
+	media->write_protected = backend->write_protected;
+	media->removable = backend->removable;
+	media->state = MEDIA_STATE_READY;
+
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Writes back the dirty blocks and drops all the cached lines, e.g.
+ * before the backend media is removed or accessed directly.
+ * \param media Pointer to a cache Media instance
+ * \return Operation result code
+ */
+uint8_t media_cache_invalidate(struct _media *media)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+	uint16_t i;
+	uint8_t status;
+
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	media->state = MEDIA_STATE_BUSY;
+	status = _write_back_all(cache);
+	if (status == MEDIA_STATUS_SUCCESS) {
+		for (i = 0; i < cache->num_lines; i++)
+			cache->lines[i].address = NO_ADDRESS;
+		cache->next_address = NO_ADDRESS;
+		cache->readahead = 0;
+	}
+	media->state = MEDIA_STATE_READY;
+
+	return status;
+}
+
+/**
+ * \brief Retrieves the cache statistics.
+ * \param media Pointer to a cache Media instance
+ * \param stats Pointer to the structure filled with the statistics
+ */
+void media_cache_get_stats(struct _media *media,
+		struct _media_cache_stats *stats)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+
+	*stats = cache->stats;
+}
+
+/**
+ * \brief Clears the cache statistics.
+ * \param media Pointer to a cache Media instance
+ */
+void media_cache_reset_stats(struct _media *media)
+{
+	struct _media_cache *cache = (struct _media_cache *)media->interface;
+
+	memset(&cache->stats, 0, sizeof(cache->stats));
+}
@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+  *  \file
+  *
+  *  Block cache layer for the media interface.
+  *
+  *  A cache media is stacked on another (backend) media and exposes the
+  *  same blocks. The cache is made of lines of consecutive blocks, aligned
+  *  on the line size, replaced in least recently used order:
+  *  - reads are served from the cached lines; sequential reads are
+  *    detected and the following lines are read ahead, with a window which
+  *    doubles up to a configurable maximum and shrinks when lines read
+  *    ahead are evicted unused;
+  *  - writes are kept in the cache (write-back) until the line is evicted
+  *    or media_flush() is called, the dirty blocks of a line being written
+  *    to the backend in as few multi-block writes as possible, lines being
+  *    written back in ascending address order.
+  *
+  *  The backend must be synchronous (complete the transfer before
+  *  returning), as all the media of this library are.
+  */
+
+#ifndef _MEDIA_CACHE_H
+#define _MEDIA_CACHE_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include "libstoragemedia/media.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Maximum number of cache lines */
+#ifndef MEDIA_CACHE_MAX_LINES
+#define MEDIA_CACHE_MAX_LINES 32
+#endif
+
+/** Maximum number of blocks per cache line */
+#define MEDIA_CACHE_MAX_BLOCKS_PER_LINE 32
+
+/** Size in bytes of the buffer needed by a cache */
+#define MEDIA_CACHE_BUFFER_SIZE(num_lines, blocks_per_line, block_size) \
+	((num_lines) * (blocks_per_line) * (block_size))
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+/** Cache statistics, in blocks unless otherwise noted */
+struct _media_cache_stats {
+	uint32_t read_hits;        /**< Blocks read from the cache */
+	uint32_t read_misses;      /**< Blocks read from the backend on demand */
+	uint32_t write_hits;       /**< Blocks written to an already cached line */
+	uint32_t write_misses;     /**< Blocks written to a newly allocated line */
+	uint32_t readahead;        /**< Blocks read ahead */
+	uint32_t readahead_unused; /**< Blocks read ahead and evicted unused */
+	uint32_t written_back;     /**< Blocks written back to the backend */
+	uint32_t backend_reads;    /**< Read requests sent to the backend */
+	uint32_t backend_writes;   /**< Write requests sent to the backend */
+	uint32_t evictions;        /**< Lines evicted */
+};
+
+/** Cache line, the fields are private */
+struct _media_cache_line {
+	uint32_t address;    /**< First block of the line, or unused line */
+	uint32_t last_use;   /**< Least recently used order stamp */
+	uint32_t valid;      /**< Mask of the blocks holding data */
+	uint32_t dirty;      /**< Mask of the blocks to write back */
+	uint32_t prefetched; /**< Mask of the blocks read ahead, not yet used */
+};
+
+/** Cache instance, the fields are private */
+struct _media_cache {
+	struct _media *backend;
+	uint8_t *buffer;
+	uint32_t line_size;       /**< Size of a line in bytes */
+	uint16_t num_lines;
+	uint8_t blocks_per_line;
+	uint8_t max_readahead;    /**< Maximum read-ahead window, in lines */
+	uint8_t readahead;        /**< Current read-ahead window, in lines */
+	uint32_t next_address;    /**< Block following the last read */
+	uint32_t clock;           /**< Least recently used order counter */
+	struct _media_cache_line lines[MEDIA_CACHE_MAX_LINES];
+	struct _media_cache_stats stats;
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported functions
+ *------------------------------------------------------------------------------*/
+
+extern uint8_t media_cache_initialize(struct _media *media,
+		struct _media_cache *cache, struct _media *backend,
+		void *buffer, uint16_t num_lines, uint8_t blocks_per_line,
+		uint8_t max_readahead);
+
+extern uint8_t media_cache_invalidate(struct _media *media);
+
+extern void media_cache_get_stats(struct _media *media,
+		struct _media_cache_stats *stats);
+
+extern void media_cache_reset_stats(struct _media *media);
+
+#endif /* _MEDIA_CACHE_H */
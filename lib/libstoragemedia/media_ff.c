@@ -0,0 +1,358 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*---------------------------------------------------------------------------
+ *         Headers
+ *---------------------------------------------------------------------------*/
+
+#include "compiler.h"
+#include "trace.h"
+
+#include "media.h"
+#include "media_ff.h"
+#include "media_private.h"
+
+#include "ffconf.h"
+#include "fatfs/src/diskio.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------
+ *         Types
+ *---------------------------------------------------------------------------*/
+
+struct _media_ff_drive {
+	struct _media *media;
+	uint32_t ratio;          /**< Number of media blocks per sector */
+	struct _media_ff_stats stats;
+#if MEDIA_FF_ASYNC
+	volatile bool done;      /**< Transfer completed */
+	volatile uint8_t status; /**< Status of the completed transfer */
+#endif
+};
+
+/*---------------------------------------------------------------------------
+ *         Local variables
+ *---------------------------------------------------------------------------*/
+
+static struct _media_ff_drive drives[_VOLUMES];
+
+/*---------------------------------------------------------------------------
+ *         Local functions
+ *---------------------------------------------------------------------------*/
+
+/**
+ * \brief Returns the drive bound to a media, or NULL
+ */
+static struct _media_ff_drive *_get_drive(BYTE pdrv)
+{
+	if (pdrv >= _VOLUMES || !drives[pdrv].media)
+		return NULL;
+	return &drives[pdrv];
+}
+
+/**
+ * \brief Converts a media status to a FatFs result
+ */
+static DRESULT _result(struct _media_ff_drive *drive, uint8_t status)
+{
+	if (status == MEDIA_STATUS_SUCCESS)
+		return RES_OK;
+	drive->stats.errors++;
+	if (status == MEDIA_STATUS_BUSY)
+		return RES_NOTRDY;
+	if (status == MEDIA_STATUS_PROTECTED)
+		return RES_WRPRT;
+	return RES_ERROR;
+}
+
+#if MEDIA_FF_ASYNC
+/**
+ * \brief Media transfer completion callback
+ */
+static void _complete(void *arg, uint8_t status, uint32_t transferred,
+		uint32_t remaining)
+{
+	struct _media_ff_drive *drive = (struct _media_ff_drive *)arg;
+
+	drive->status = status;
+	drive->done = true;
+}
+#endif
+
+/**
+ * \brief Transfers blocks from/to the media of a drive, in one request.
+ * \param drive Pointer to the drive
+ * \param write true to write, false to read
+ * \param address Address of the first media block
+ * \param data Pointer to the data buffer
+ * \param length Number of media blocks
+ * \return Media operation result code
+ */
+static uint8_t _transfer(struct _media_ff_drive *drive, bool write,
+		uint32_t address, void *data, uint32_t length)
+{
+	uint8_t status;
+#if MEDIA_FF_ASYNC
+	uint32_t retries = 0;
+
+	while (true) {
+		drive->done = false;
+		if (write)
+			status = media_write(drive->media, address, data, length,
+					_complete, drive);
+		else
+			status = media_read(drive->media, address, data, length,
+					_complete, drive);
+		if (status != MEDIA_STATUS_BUSY ||
+		    retries++ >= MEDIA_FF_BUSY_RETRIES)
+			break;
+		/* Media used by another task or function, wait */
+		drive->stats.busy_waits++;
+		media_ff_yield();
+	}
+	if (status == MEDIA_STATUS_SUCCESS) {
+		while (!drive->done) {
+			media_handler(drive->media);
+			media_ff_yield();
+		}
+		status = drive->status;
+	}
+#else
+	if (write)
+		status = media_write(drive->media, address, data, length,
+				NULL, NULL);
+	else
+		status = media_read(drive->media, address, data, length,
+				NULL, NULL);
+#endif
+	return status;
+}
+
+/*---------------------------------------------------------------------------
+ *         Exported functions
+ *---------------------------------------------------------------------------*/
+
+/**
+ * \brief Binds a FatFs physical drive to a media.
+ * \param pdrv Physical drive number (0.._VOLUMES-1)
+ * \param media Pointer to an initialized media, NULL to unbind the drive
+ * \return true on success, false if the drive number or the media block
+ * size is not supported
+ */
+bool media_ff_register(uint8_t pdrv, struct _media *media)
+{
+	uint32_t block_size;
+
+	if (pdrv >= _VOLUMES)
+		return false;
+
+	if (media) {
+		block_size = media_get_block_size(media);
+		if (block_size == 0 || block_size > _MAX_SS ||
+		    (block_size < _MIN_SS && _MIN_SS % block_size)) {
+			trace_error("media_ff: unsupported block size %u\r\n",
+					(unsigned)block_size);
+			return false;
+		}
+		drives[pdrv].ratio = block_size < _MIN_SS ?
+			_MIN_SS / block_size : 1;
+	}
+	drives[pdrv].media = media;
+	memset(&drives[pdrv].stats, 0, sizeof(drives[pdrv].stats));
+	return true;
+}
+
+/**
+ * \brief Retrieves the I/O statistics of a drive.
+ * \param pdrv Physical drive number
+ * \param stats Pointer to the structure filled with the statistics
+ */
+void media_ff_get_stats(uint8_t pdrv, struct _media_ff_stats *stats)
+{
+	if (pdrv < _VOLUMES)
+		*stats = drives[pdrv].stats;
+	else
+		memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ * \brief Clears the I/O statistics of a drive.
+ * \param pdrv Physical drive number
+ */
+void media_ff_reset_stats(uint8_t pdrv)
+{
+	if (pdrv < _VOLUMES)
+		memset(&drives[pdrv].stats, 0, sizeof(drives[pdrv].stats));
+}
+
+/**
+ * \brief Invoked while waiting for a transfer or for a busy media, when
+ * MEDIA_FF_ASYNC is set. Does nothing by default, RTOS builds re-implement
+ * it to yield to other tasks.
+ */
+WEAK void media_ff_yield(void)
+{
+}
+
+/**
+ * \brief Initialize a Drive. The media is initialized by the application
+ * before being registered, only its state is checked.
+ * \param pdrv  Physical drive number (0..).
+ * \return Drive status flags.
+ */
+DSTATUS disk_initialize(BYTE pdrv)
+{
+	return disk_status(pdrv);
+}
+
+/**
+ * \brief Get Drive Status.
+ * \param pdrv  Physical drive number (0..).
+ * \return Drive status flags; STA_NOINIT if no ready media is bound to the
+ * drive.
+ */
+DSTATUS disk_status(BYTE pdrv)
+{
+	struct _media_ff_drive *drive = _get_drive(pdrv);
+
+	if (!drive)
+		return STA_NODISK | STA_NOINIT;
+	if (!media_is_initialized(drive->media))
+		return STA_NOINIT;
+	return media_is_write_protected(drive->media) ? STA_PROTECT : 0;
+}
+
+/**
+ * \brief Read Sector(s), in one media transfer.
+ * \param pdrv  Physical drive number (0..).
+ * \param buff  Data buffer to store read data.
+ * \param sector  Sector address in LBA.
+ * \param count  Number of sectors to read.
+ * \return Result code; RES_OK if successful.
+ */
+DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	struct _media_ff_drive *drive = _get_drive(pdrv);
+
+	if (!drive || count == 0)
+		return RES_PARERR;
+
+	drive->stats.reads++;
+	drive->stats.read_sectors += count;
+	return _result(drive, _transfer(drive, false, sector * drive->ratio,
+				buff, count * drive->ratio));
+}
+
+#if !_FS_READONLY
+/**
+ * \brief Write Sector(s), in one media transfer.
+ * \param pdrv  Physical drive number (0..).
+ * \param buff  Data to be written.
+ * \param sector  Sector address in LBA.
+ * \param count  Number of sectors to write.
+ * \return Result code; RES_OK if successful.
+ */
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	struct _media_ff_drive *drive = _get_drive(pdrv);
+
+	if (!drive || count == 0)
+		return RES_PARERR;
+	if (media_is_write_protected(drive->media))
+		return RES_WRPRT;
+
+	drive->stats.writes++;
+	drive->stats.write_sectors += count;
+	return _result(drive, _transfer(drive, true, sector * drive->ratio,
+				(void *)buff, count * drive->ratio));
+}
+#endif /* _FS_READONLY */
+
+/**
+ * \brief Miscellaneous Functions.
+ * \param pdrv  Physical drive number (0..).
+ * \param cmd  Control code.
+ * \param buff  Buffer to send/receive control data.
+ * \return Result code; RES_OK if successful.
+ */
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff)
+{
+	struct _media_ff_drive *drive = _get_drive(pdrv);
+	DWORD *param_u32 = (DWORD *)buff;
+	WORD *param_u16 = (WORD *)buff;
+	uint32_t length;
+
+	if (!drive)
+		return RES_PARERR;
+
+	switch (cmd) {
+	case CTRL_SYNC:
+		/* Write back the data cached by the media, if any */
+		drive->stats.syncs++;
+		return _result(drive, media_flush(drive->media));
+
+	case GET_SECTOR_COUNT:
+		if (!buff)
+			return RES_PARERR;
+		*param_u32 = media_get_size(drive->media) / drive->ratio;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE:
+		if (!buff)
+			return RES_PARERR;
+		*param_u16 = media_get_block_size(drive->media) * drive->ratio;
+		return RES_OK;
+
+	case GET_BLOCK_SIZE:
+		/* Preferred write unit of the media, in sectors, used by
+		 * f_mkfs() to align the data area */
+		if (!buff)
+			return RES_PARERR;
+		length = media_get_optimal_length(drive->media) / drive->ratio;
+		*param_u32 = length ? length : 1;
+		return RES_OK;
+
+	case CTRL_TRIM:
+		/* buff holds the first and the last sectors of the range */
+		if (!buff || param_u32[1] < param_u32[0])
+			return RES_PARERR;
+		length = param_u32[1] - param_u32[0] + 1;
+		drive->stats.trims++;
+		drive->stats.trim_sectors += length;
+		return _result(drive, media_trim(drive->media,
+					param_u32[0] * drive->ratio,
+					length * drive->ratio));
+
+	default:
+		return RES_PARERR;
+	}
+}
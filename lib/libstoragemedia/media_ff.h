@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+  *  \file
+  *
+  *  FatFs disk I/O layer on top of the media interface.
+  *
+  *  Each FatFs physical drive is bound to a media with media_ff_register().
+  *  Multiple sector requests are passed to the media in one transfer (on
+  *  SD/MMC cards, one READ/WRITE_MULTIPLE_BLOCK command, with a pre-erase
+  *  hint for writes), CTRL_SYNC flushes the media and CTRL_TRIM trims the
+  *  sectors of the media.
+  *
+  *  When MEDIA_FF_ASYNC is set, the transfers are started with a completion
+  *  callback and media_ff_yield() is called while waiting for their
+  *  completion, or while the media is busy with another user (e.g. the USB
+  *  Mass Storage function). RTOS builds implement media_ff_yield() to let
+  *  other tasks run.
+  *
+  *  Applications select this layer with CONFIG_LIB_MEDIA_FF, in place of the
+  *  SD/MMC one of libsdmmc.
+  */
+
+#ifndef _MEDIA_FF_H
+#define _MEDIA_FF_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include "libstoragemedia/media.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Wait for the completion of the transfers, yielding to other tasks */
+#ifndef MEDIA_FF_ASYNC
+#define MEDIA_FF_ASYNC 0
+#endif
+
+/** Number of media_ff_yield() calls after which a busy media is reported
+ * as not ready */
+#ifndef MEDIA_FF_BUSY_RETRIES
+#define MEDIA_FF_BUSY_RETRIES 1000
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+/** Per drive I/O statistics */
+struct _media_ff_stats {
+	uint32_t reads;         /**< Read requests */
+	uint32_t read_sectors;  /**< Sectors read */
+	uint32_t writes;        /**< Write requests */
+	uint32_t write_sectors; /**< Sectors written */
+	uint32_t trims;         /**< Trim requests */
+	uint32_t trim_sectors;  /**< Sectors trimmed */
+	uint32_t syncs;         /**< Sync requests */
+	uint32_t errors;        /**< Failed requests */
+	uint32_t busy_waits;    /**< Retries of requests on a busy media */
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported functions
+ *------------------------------------------------------------------------------*/
+
+extern bool media_ff_register(uint8_t pdrv, struct _media *media);
+
+extern void media_ff_get_stats(uint8_t pdrv, struct _media_ff_stats *stats);
+
+extern void media_ff_reset_stats(uint8_t pdrv);
+
+extern void media_ff_yield(void);
+
+#endif /* _MEDIA_FF_H */
@@ -0,0 +1,1309 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*---------------------------------------------------------------------------
+ *         Headers
+ *---------------------------------------------------------------------------*/
+
+#include "media.h"
+#include "media_nandflash.h"
+#include "media_private.h"
+
+#include "mm/cache.h"
+#include "nvm/nand/nand_flash_common.h"
+#include "nvm/nand/nand_flash_ecc.h"
+#include "nvm/nand/nand_flash_model.h"
+#include "nvm/nand/nand_flash_raw.h"
+#include "nvm/nand/nand_flash_skip_block.h"
+
+#include "intmath.h"
+#include "trace.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------
+ *         Definitions
+ *---------------------------------------------------------------------------*/
+
+/** Percentage of the blocks kept out of the logical space (bad blocks,
+ * garbage collection efficiency) */
+#ifndef MEDIA_NANDFLASH_OVERPROVISIONING
+#define MEDIA_NANDFLASH_OVERPROVISIONING 5
+#endif
+
+/** Number of free blocks below which garbage collection is started */
+#ifndef MEDIA_NANDFLASH_GC_THRESHOLD
+#define MEDIA_NANDFLASH_GC_THRESHOLD 2
+#endif
+
+/** Erase count difference between the most and the least worn blocks
+ * which triggers the move of the least worn (cold) data block */
+#ifndef MEDIA_NANDFLASH_WL_THRESHOLD
+#define MEDIA_NANDFLASH_WL_THRESHOLD 64
+#endif
+
+/** Number of data blocks allocated between two mapping checkpoints */
+#ifndef MEDIA_NANDFLASH_CHECKPOINT_INTERVAL
+#define MEDIA_NANDFLASH_CHECKPOINT_INTERVAL 64
+#endif
+
+#define NO_BLOCK        0xffff
+#define UNMAPPED        0xffffffff
+
+/** Mapping of a logical page whose data could not be corrected while being
+ * moved: reading it fails until it is written again */
+#define LOST_PAGE       0xfffffffe
+
+/** Whether a mapping entry points to a physical page */
+#define IS_MAPPED(entry) ((entry) < LOST_PAGE)
+
+/** Block states */
+#define BLOCK_FREE      0
+#define BLOCK_DATA      1
+#define BLOCK_CHECKPOINT 2
+#define BLOCK_BAD       3
+
+/** Size of the tag stored in the spare area of each page:
+ * logical page (4 bytes), block sequence number (4 bytes), block erase
+ * count (3 bytes) and CRC-8 of the previous bytes */
+#define TAG_SIZE        12
+
+/** Logical page field of the tag of checkpoint pages (ORed with the page
+ * index inside the checkpoint) */
+#define TAG_CHECKPOINT  0x80000000
+
+/** Result of the tag decoding */
+#define TAG_VALID       0
+#define TAG_ERASED      1
+#define TAG_INVALID     2
+
+#define CHECKPOINT_MAGIC   0x4c54464e
+#define CHECKPOINT_COMMIT  0x54494d43
+#define CHECKPOINT_VERSION 1
+
+/** Number of words of the checkpoint header and trailer */
+#define CHECKPOINT_HEADER_WORDS  8
+#define CHECKPOINT_TRAILER_WORDS 2
+
+/*---------------------------------------------------------------------------
+ *         Types
+ *---------------------------------------------------------------------------*/
+
+struct _media_nandflash_block {
+	uint32_t seq;         /**< Sequence number of the block allocation */
+	uint32_t erase_count; /**< Number of erase cycles */
+	uint16_t valid;       /**< Number of valid pages */
+	uint8_t  state;       /**< BLOCK_xxx */
+	bool     erased;      /**< Free block erased since the initialization */
+	bool     tag_error;   /**< First page tag unreadable at initialization */
+};
+
+struct _tag {
+	uint32_t lpage;
+	uint32_t seq;
+	uint32_t erase_count;
+};
+
+/** Page stream used to write/read a checkpoint */
+struct _checkpoint_stream {
+	struct _media_nandflash *ftl;
+	uint32_t seq;         /**< Sequence number of the first block */
+	uint32_t page;        /**< Page index inside the checkpoint */
+	uint32_t offset;      /**< Word offset inside the current page */
+	uint32_t crc;
+	uint16_t block;       /**< Current block */
+	uint16_t bad_block;   /**< Block which failed to program */
+};
+
+/*---------------------------------------------------------------------------
+ *         Local variables
+ *---------------------------------------------------------------------------*/
+
+/* Page buffer, large enough for the PMECC reads which also store the ECC */
+CACHE_ALIGNED static uint8_t page_buf[NAND_MAX_PAGE_DATA_SIZE + NAND_MAX_PAGE_SPARE_SIZE];
+
+CACHE_ALIGNED static uint8_t spare_buf[NAND_MAX_PAGE_SPARE_SIZE];
+
+static const uint32_t crc32_table[16] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+/*---------------------------------------------------------------------------
+ *      Internal Functions
+ *---------------------------------------------------------------------------*/
+
+static uint32_t _crc32_word(uint32_t crc, uint32_t word)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		crc = crc32_table[(crc ^ word) & 0xf] ^ (crc >> 4);
+		word >>= 4;
+	}
+	return crc;
+}
+
+static uint8_t _crc8(const uint8_t *data, uint32_t len)
+{
+	uint8_t crc = 0xff;
+	int i;
+
+	while (len--) {
+		crc ^= *data++;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+	}
+	return crc;
+}
+
+static void _put_u32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+	buf[2] = value >> 16;
+	buf[3] = value >> 24;
+}
+
+static uint32_t _get_u32(const uint8_t *buf)
+{
+	return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+/**
+ * \brief Fills the spare buffer with the tag of a page
+ */
+static void _tag_encode(struct _media_nandflash *ftl, const struct _tag *tag)
+{
+	uint8_t *t = spare_buf + ftl->tag_offset;
+
+	memset(spare_buf, 0xff, sizeof(spare_buf));
+	_put_u32(t, tag->lpage);
+	_put_u32(t + 4, tag->seq);
+	t[8] = tag->erase_count;
+	t[9] = tag->erase_count >> 8;
+	t[10] = tag->erase_count >> 16;
+	t[11] = _crc8(t, TAG_SIZE - 1);
+}
+
+/**
+ * \brief Reads the spare area of a page and decodes its tag
+ * \return TAG_VALID, TAG_ERASED or TAG_INVALID
+ */
+static uint8_t _tag_read(struct _media_nandflash *ftl, uint16_t block,
+		uint16_t page, struct _tag *tag)
+{
+	const uint8_t *t = spare_buf + ftl->tag_offset;
+	int i;
+
+	if (nand_raw_read_page(ftl->nand, block, page, NULL, spare_buf))
+		return TAG_INVALID;
+
+	for (i = 0; i < TAG_SIZE; i++)
+		if (t[i] != 0xff)
+			break;
+	if (i == TAG_SIZE)
+		return TAG_ERASED;
+
+	if (_crc8(t, TAG_SIZE - 1) != t[TAG_SIZE - 1])
+		return TAG_INVALID;
+
+	tag->lpage = _get_u32(t);
+	tag->seq = _get_u32(t + 4);
+	tag->erase_count = t[8] | (t[9] << 8) | (t[10] << 16);
+	return TAG_VALID;
+}
+
+static uint32_t _ppage(struct _media_nandflash *ftl, uint16_t block, uint16_t page)
+{
+	return (uint32_t)block * ftl->pages_per_block + page;
+}
+
+/**
+ * \brief Reads the data area of a physical page in the page buffer
+ */
+static uint8_t _read_page(struct _media_nandflash *ftl, uint32_t ppage)
+{
+	uint8_t error;
+
+	ftl->stats.page_reads++;
+	error = nand_ecc_read_page(ftl->nand, ppage / ftl->pages_per_block,
+			ppage % ftl->pages_per_block, page_buf, NULL);
+	if (error) {
+		trace_error("media_nandflash: cannot read page %u (%u)\r\n",
+				(unsigned)ppage, error);
+		ftl->stats.ecc_errors++;
+	}
+	return error;
+}
+
+/**
+ * \brief Programs a page from the page buffer, with its tag
+ */
+static uint8_t _write_page(struct _media_nandflash *ftl, uint16_t block,
+		uint16_t page, uint32_t lpage)
+{
+	struct _tag tag;
+
+	tag.lpage = lpage;
+	tag.seq = ftl->blocks[block].seq;
+	tag.erase_count = ftl->blocks[block].erase_count;
+	_tag_encode(ftl, &tag);
+
+	ftl->stats.page_writes++;
+	return nand_ecc_write_page(ftl->nand, block, page, page_buf, spare_buf);
+}
+
+/**
+ * \brief Retires a block: it will never be used again
+ */
+static void _retire_block(struct _media_nandflash *ftl, uint16_t block)
+{
+	trace_warning("media_nandflash: retiring block %u\r\n", block);
+
+	if (ftl->blocks[block].state == BLOCK_FREE)
+		ftl->free_blocks--;
+	ftl->blocks[block].state = BLOCK_BAD;
+	ftl->blocks[block].valid = 0;
+	ftl->stats.bad_blocks++;
+	nand_skipblock_tag_block(ftl->nand, block, true);
+}
+
+/**
+ * \brief Erases a block and puts it in the free pool
+ */
+static void _erase_block(struct _media_nandflash *ftl, uint16_t block)
+{
+	struct _media_nandflash_block *b = &ftl->blocks[block];
+
+	ftl->stats.erases++;
+	if (nand_raw_erase_block(ftl->nand, block)) {
+		if (b->state == BLOCK_FREE)
+			ftl->free_blocks--;
+		b->state = BLOCK_DATA;
+		_retire_block(ftl, block);
+		return;
+	}
+
+	if (b->state != BLOCK_FREE)
+		ftl->free_blocks++;
+	b->erase_count++;
+	b->seq = 0;
+	b->valid = 0;
+	b->state = BLOCK_FREE;
+	b->erased = true;
+	b->tag_error = false;
+}
+
+/**
+ * \brief Takes the least worn block out of the free pool
+ * \return block number, or NO_BLOCK if the free pool is empty
+ */
+static uint16_t _alloc_block(struct _media_nandflash *ftl, uint8_t state)
+{
+	uint16_t i, block;
+
+	do {
+		block = NO_BLOCK;
+		for (i = 0; i < ftl->num_blocks; i++) {
+			if (ftl->blocks[i].state != BLOCK_FREE)
+				continue;
+			if (block == NO_BLOCK ||
+			    ftl->blocks[i].erase_count < ftl->blocks[block].erase_count)
+				block = i;
+		}
+		if (block == NO_BLOCK)
+			return NO_BLOCK;
+
+		/* A block found erased at initialization may come from an
+		 * interrupted erase: erase it again before use */
+		if (!ftl->blocks[block].erased)
+			_erase_block(ftl, block);
+	} while (ftl->blocks[block].state != BLOCK_FREE);
+
+	ftl->free_blocks--;
+	ftl->blocks[block].state = state;
+	ftl->blocks[block].seq = ++ftl->seq;
+	ftl->blocks[block].valid = 0;
+	if (state == BLOCK_DATA)
+		ftl->ckpt_allocs++;
+	return block;
+}
+
+/**
+ * \brief Writes the page buffer as the new content of a logical page, in the
+ * open block. A block failing to program is closed and retired.
+ */
+static uint8_t _program(struct _media_nandflash *ftl, uint32_t lpage)
+{
+	uint32_t old;
+
+	while (true) {
+		uint16_t block = ftl->open_block;
+		uint16_t page = ftl->open_page;
+
+		if (block == NO_BLOCK) {
+			block = _alloc_block(ftl, BLOCK_DATA);
+			if (block == NO_BLOCK) {
+				trace_error("media_nandflash: no free block\r\n");
+				return MEDIA_STATUS_ERROR;
+			}
+			ftl->open_block = block;
+			ftl->open_page = page = 0;
+		}
+
+		if (++ftl->open_page == ftl->pages_per_block)
+			ftl->open_block = NO_BLOCK;
+
+		if (_write_page(ftl, block, page, lpage)) {
+			/* close the block, it will be retired once its valid
+			 * pages are moved */
+			ftl->open_block = NO_BLOCK;
+			if (ftl->retire_block == NO_BLOCK)
+				ftl->retire_block = block;
+			continue;
+		}
+
+		old = ftl->l2p[lpage];
+		if (IS_MAPPED(old))
+			ftl->blocks[old / ftl->pages_per_block].valid--;
+		ftl->l2p[lpage] = _ppage(ftl, block, page);
+		ftl->blocks[block].valid++;
+		return MEDIA_STATUS_SUCCESS;
+	}
+}
+
+/**
+ * \brief Moves a logical page to the open block. Data which cannot be
+ * corrected is not moved, as it would be programmed again with a fresh ECC:
+ * the logical page is marked lost instead, so that reading it fails.
+ * \return MEDIA_STATUS_ERROR if the page could not be programmed
+ */
+static uint8_t _relocate_page(struct _media_nandflash *ftl, uint32_t lpage)
+{
+	uint32_t ppage = ftl->l2p[lpage];
+
+	if (_read_page(ftl, ppage)) {
+		trace_error("media_nandflash: logical page %u lost\r\n",
+				(unsigned)lpage);
+		ftl->blocks[ppage / ftl->pages_per_block].valid--;
+		ftl->l2p[lpage] = LOST_PAGE;
+		ftl->stats.lost_pages++;
+		return MEDIA_STATUS_SUCCESS;
+	}
+
+	return _program(ftl, lpage);
+}
+
+/**
+ * \brief Moves the valid pages of a block to the open block. Whether a page
+ * is valid is decided by the mapping, the tags only tell which logical page
+ * a physical page is likely to hold.
+ */
+static uint8_t _relocate_block(struct _media_nandflash *ftl, uint16_t block)
+{
+	struct _tag tag;
+	uint16_t page;
+	uint32_t ppage, lpage;
+
+	for (page = 0; page < ftl->pages_per_block; page++) {
+		if (ftl->blocks[block].valid == 0)
+			return MEDIA_STATUS_SUCCESS;
+
+		if (_tag_read(ftl, block, page, &tag) != TAG_VALID)
+			continue;
+		ppage = _ppage(ftl, block, page);
+		if (tag.lpage >= ftl->num_lpages || ftl->l2p[tag.lpage] != ppage)
+			continue;
+
+		if (_relocate_page(ftl, tag.lpage) != MEDIA_STATUS_SUCCESS)
+			return MEDIA_STATUS_ERROR;
+	}
+
+	/* Valid pages with an unreadable tag are left: look them up in the
+	 * mapping */
+	for (lpage = 0; lpage < ftl->num_lpages; lpage++) {
+		if (ftl->blocks[block].valid == 0)
+			break;
+
+		ppage = ftl->l2p[lpage];
+		if (!IS_MAPPED(ppage) || ppage / ftl->pages_per_block != block)
+			continue;
+
+		if (_relocate_page(ftl, lpage) != MEDIA_STATUS_SUCCESS)
+			return MEDIA_STATUS_ERROR;
+	}
+
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Reclaims the data block having the fewest valid pages
+ */
+static uint8_t _garbage_collect(struct _media_nandflash *ftl)
+{
+	uint16_t i, victim = NO_BLOCK;
+
+	for (i = 0; i < ftl->num_blocks; i++) {
+		if (ftl->blocks[i].state != BLOCK_DATA || i == ftl->open_block ||
+		    i == ftl->retire_block)
+			continue;
+		if (victim == NO_BLOCK ||
+		    ftl->blocks[i].valid < ftl->blocks[victim].valid)
+			victim = i;
+	}
+
+	if (victim == NO_BLOCK ||
+	    ftl->blocks[victim].valid == ftl->pages_per_block) {
+		trace_error("media_nandflash: nothing to reclaim\r\n");
+		return MEDIA_STATUS_ERROR;
+	}
+
+	if (_relocate_block(ftl, victim) != MEDIA_STATUS_SUCCESS)
+		return MEDIA_STATUS_ERROR;
+	_erase_block(ftl, victim);
+	ftl->stats.gc_runs++;
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Static wear leveling: when the least worn data block is far behind
+ * the most worn block, its (cold) data is moved so that the block goes back
+ * to the free pool.
+ */
+static uint8_t _wear_level(struct _media_nandflash *ftl)
+{
+	uint16_t i, cold = NO_BLOCK;
+	uint32_t max_ec = 0;
+
+	for (i = 0; i < ftl->num_blocks; i++) {
+		struct _media_nandflash_block *b = &ftl->blocks[i];
+
+		if (b->state == BLOCK_BAD)
+			continue;
+		max_ec = max_u32(max_ec, b->erase_count);
+		if (b->state != BLOCK_DATA || i == ftl->open_block ||
+		    i == ftl->retire_block)
+			continue;
+		if (cold == NO_BLOCK ||
+		    b->erase_count < ftl->blocks[cold].erase_count)
+			cold = i;
+	}
+
+	if (cold == NO_BLOCK ||
+	    max_ec - ftl->blocks[cold].erase_count <= MEDIA_NANDFLASH_WL_THRESHOLD)
+		return MEDIA_STATUS_SUCCESS;
+
+	if (_relocate_block(ftl, cold) != MEDIA_STATUS_SUCCESS)
+		return MEDIA_STATUS_ERROR;
+	_erase_block(ftl, cold);
+	ftl->stats.wl_moves++;
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Pads and writes the current page of a checkpoint being written
+ */
+static uint8_t _checkpoint_flush(struct _checkpoint_stream *s)
+{
+	struct _media_nandflash *ftl = s->ftl;
+	uint32_t words_per_page = ftl->page_size / 4;
+
+	if (s->offset == 0)
+		return 0;
+
+	memset((uint32_t*)page_buf + s->offset, 0xff,
+			(words_per_page - s->offset) * 4);
+	s->offset = 0;
+	if (_write_page(ftl, s->block, s->page % ftl->pages_per_block,
+			TAG_CHECKPOINT | s->page)) {
+		s->bad_block = s->block;
+		return NAND_ERROR_CANNOTWRITE;
+	}
+	s->page++;
+	return 0;
+}
+
+/**
+ * \brief Appends a word to a checkpoint being written
+ */
+static uint8_t _checkpoint_put(struct _checkpoint_stream *s, uint32_t word)
+{
+	struct _media_nandflash *ftl = s->ftl;
+	uint32_t words_per_page = ftl->page_size / 4;
+
+	if (s->offset == 0 && (s->page % ftl->pages_per_block) == 0) {
+		s->block = _alloc_block(ftl, BLOCK_CHECKPOINT);
+		if (s->block == NO_BLOCK)
+			return NAND_ERROR_NOMOREBLOCKS;
+		if (s->page == 0)
+			s->seq = ftl->blocks[s->block].seq;
+	}
+
+	((uint32_t*)page_buf)[s->offset++] = word;
+	s->crc = _crc32_word(s->crc, word);
+	if (s->offset < words_per_page)
+		return 0;
+
+	return _checkpoint_flush(s);
+}
+
+/**
+ * \brief Reads the next word of a checkpoint
+ */
+static uint8_t _checkpoint_get(struct _checkpoint_stream *s, uint32_t *word)
+{
+	struct _media_nandflash *ftl = s->ftl;
+	uint32_t words_per_page = ftl->page_size / 4;
+	uint16_t i;
+
+	if (s->offset == 0) {
+		if ((s->page % ftl->pages_per_block) == 0) {
+			/* the blocks of a checkpoint have consecutive sequence
+			 * numbers */
+			uint32_t seq = s->seq + s->page / ftl->pages_per_block;
+			for (i = 0; i < ftl->num_blocks; i++)
+				if (ftl->blocks[i].state == BLOCK_CHECKPOINT &&
+				    ftl->blocks[i].seq == seq)
+					break;
+			if (i == ftl->num_blocks)
+				return NAND_ERROR_NOBLOCKFOUND;
+			s->block = i;
+		}
+		if (_read_page(ftl, _ppage(ftl, s->block,
+				s->page % ftl->pages_per_block)))
+			return NAND_ERROR_CORRUPTEDDATA;
+	}
+
+	*word = ((uint32_t*)page_buf)[s->offset++];
+	s->crc = _crc32_word(s->crc, *word);
+	if (s->offset == words_per_page) {
+		s->offset = 0;
+		s->page++;
+	}
+	return 0;
+}
+
+/**
+ * \brief Writes a checkpoint of the mapping and of the erase counts, then
+ * releases the previous checkpoint.
+ */
+static uint8_t _checkpoint(struct _media_nandflash *ftl)
+{
+	struct _checkpoint_stream s;
+	uint32_t i;
+	uint8_t error;
+
+	while (ftl->free_blocks < ftl->ckpt_blocks + MEDIA_NANDFLASH_GC_THRESHOLD)
+		if (_garbage_collect(ftl) != MEDIA_STATUS_SUCCESS)
+			return MEDIA_STATUS_ERROR;
+
+	memset(&s, 0, sizeof(s));
+	s.ftl = ftl;
+	s.crc = 0xffffffff;
+	s.bad_block = NO_BLOCK;
+
+	error = _checkpoint_put(&s, CHECKPOINT_MAGIC);
+	if (!error)
+		error = _checkpoint_put(&s, CHECKPOINT_VERSION);
+	if (!error)
+		error = _checkpoint_put(&s, ftl->num_blocks);
+	if (!error)
+		error = _checkpoint_put(&s, ftl->pages_per_block);
+	if (!error)
+		error = _checkpoint_put(&s, ftl->num_lpages);
+	if (!error)
+		error = _checkpoint_put(&s, ftl->open_block);
+	if (!error)
+		error = _checkpoint_put(&s, ftl->open_page);
+	if (!error)
+		error = _checkpoint_put(&s, 0);
+	for (i = 0; !error && i < ftl->num_blocks; i++)
+		error = _checkpoint_put(&s, ftl->blocks[i].erase_count);
+	for (i = 0; !error && i < ftl->num_lpages; i++)
+		error = _checkpoint_put(&s, ftl->l2p[i]);
+	if (!error)
+		error = _checkpoint_put(&s, CHECKPOINT_COMMIT);
+	if (!error)
+		error = _checkpoint_put(&s, s.crc);
+	if (!error)
+		error = _checkpoint_flush(&s);
+
+	/* Release the blocks of the previous checkpoint, or of this one if
+	 * it could not be written */
+	for (i = 0; s.seq && i < ftl->num_blocks; i++) {
+		struct _media_nandflash_block *b = &ftl->blocks[i];
+		if (b->state != BLOCK_CHECKPOINT)
+			continue;
+		if ((b->seq >= s.seq) == !error)
+			continue;
+		if (i == s.bad_block)
+			_retire_block(ftl, i);
+		else
+			_erase_block(ftl, i);
+	}
+
+	if (error) {
+		trace_error("media_nandflash: checkpoint failed (%u)\r\n", error);
+		return MEDIA_STATUS_ERROR;
+	}
+
+	ftl->ckpt_seq = s.seq;
+	ftl->ckpt_allocs = 0;
+	ftl->stats.checkpoints++;
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Loads the checkpoint starting in block 'first'
+ * \return 0 if the checkpoint is valid
+ */
+static uint8_t _checkpoint_load(struct _media_nandflash *ftl, uint16_t first,
+		uint16_t *open_block, uint16_t *open_page)
+{
+	struct _checkpoint_stream s;
+	uint32_t i, word, crc;
+	uint32_t header[CHECKPOINT_HEADER_WORDS];
+	uint8_t error = 0;
+
+	memset(&s, 0, sizeof(s));
+	s.ftl = ftl;
+	s.crc = 0xffffffff;
+	s.seq = ftl->blocks[first].seq;
+
+	for (i = 0; !error && i < CHECKPOINT_HEADER_WORDS; i++)
+		error = _checkpoint_get(&s, &header[i]);
+	if (error)
+		return error;
+	if (header[0] != CHECKPOINT_MAGIC || header[1] != CHECKPOINT_VERSION ||
+	    header[2] != ftl->num_blocks || header[3] != ftl->pages_per_block ||
+	    header[4] != ftl->num_lpages)
+		return NAND_ERROR_MAPPINGNOTFOUND;
+
+	for (i = 0; !error && i < ftl->num_blocks; i++) {
+		error = _checkpoint_get(&s, &word);
+		/* blocks written since the checkpoint have a more recent
+		 * erase count in their tags */
+		if (ftl->blocks[i].state == BLOCK_FREE)
+			ftl->blocks[i].erase_count = word;
+	}
+	for (i = 0; !error && i < ftl->num_lpages; i++)
+		error = _checkpoint_get(&s, &ftl->l2p[i]);
+	if (!error)
+		error = _checkpoint_get(&s, &word);
+	if (!error && word != CHECKPOINT_COMMIT)
+		error = NAND_ERROR_MAPPINGNOTFOUND;
+	crc = s.crc;
+	if (!error)
+		error = _checkpoint_get(&s, &word);
+	if (!error && word != crc)
+		error = NAND_ERROR_MAPPINGNOTFOUND;
+	if (error)
+		return error;
+
+	*open_block = header[5];
+	*open_page = header[6];
+	return 0;
+}
+
+/**
+ * \brief Updates the mapping with the pages of a block written after the
+ * checkpoint, starting at a given page. The most recent copy of a logical
+ * page is the one from the block with the highest sequence number, and from
+ * the highest page in a given block.
+ */
+static void _replay_block(struct _media_nandflash *ftl, uint16_t block,
+		uint16_t first_page)
+{
+	struct _media_nandflash_block *b = &ftl->blocks[block];
+	struct _tag tag;
+	uint16_t page;
+	uint32_t cur;
+	uint8_t status;
+
+	for (page = first_page; page < ftl->pages_per_block; page++) {
+		status = _tag_read(ftl, block, page, &tag);
+		if (status == TAG_ERASED)
+			break;
+		if (status != TAG_VALID || tag.seq != b->seq ||
+		    tag.lpage >= ftl->num_lpages)
+			continue;
+
+		cur = ftl->l2p[tag.lpage];
+		if (IS_MAPPED(cur)) {
+			struct _media_nandflash_block *cb =
+				&ftl->blocks[cur / ftl->pages_per_block];
+			if (cb->seq > b->seq ||
+			    (cb == b && (cur % ftl->pages_per_block) > page))
+				continue;
+		}
+		ftl->l2p[tag.lpage] = _ppage(ftl, block, page);
+	}
+}
+
+/**
+ * \brief Identifies a block whose first page tag is unreadable from the tag
+ * of another page. Pages are programmed in order, so the scan stops at the
+ * first erased page. An unidentified block keeps a null sequence number:
+ * it is older than any checkpoint, and only the mapping may refer to it.
+ */
+static void _identify_block(struct _media_nandflash *ftl, uint16_t block)
+{
+	struct _media_nandflash_block *b = &ftl->blocks[block];
+	struct _tag tag;
+	uint16_t page;
+	uint8_t status;
+
+	for (page = 1; page < ftl->pages_per_block; page++) {
+		status = _tag_read(ftl, block, page, &tag);
+		if (status == TAG_ERASED)
+			break;
+		if (status != TAG_VALID)
+			continue;
+		b->seq = tag.seq;
+		b->erase_count = tag.erase_count;
+		if (tag.lpage & TAG_CHECKPOINT)
+			b->state = BLOCK_CHECKPOINT;
+		ftl->seq = max_u32(ftl->seq, tag.seq);
+		break;
+	}
+	trace_warning("media_nandflash: block %u has an unreadable tag\r\n",
+			block);
+}
+
+/**
+ * \brief Rebuilds the FTL state from the device content
+ */
+static uint8_t _mount(struct _media_nandflash *ftl)
+{
+	struct _tag tag;
+	uint16_t i, ckpt, open_block = NO_BLOCK, open_page = 0;
+	uint32_t lpage, ckpt_seq, last_seq;
+	uint8_t status;
+
+	memset(&ftl->stats, 0, sizeof(ftl->stats));
+	ftl->free_blocks = 0;
+	ftl->seq = 0;
+
+	/* Scan the first page of all blocks */
+	for (i = 0; i < ftl->num_blocks; i++) {
+		struct _media_nandflash_block *b = &ftl->blocks[i];
+
+		b->seq = 0;
+		b->erase_count = 0;
+		b->valid = 0;
+		b->state = BLOCK_FREE;
+		b->erased = false;
+		b->tag_error = false;
+
+		if (nand_skipblock_check_block(ftl->nand, i) != GOODBLOCK) {
+			b->state = BLOCK_BAD;
+			ftl->stats.bad_blocks++;
+			continue;
+		}
+
+		status = _tag_read(ftl, i, 0, &tag);
+		if (status == TAG_ERASED) {
+			ftl->free_blocks++;
+		} else if (status == TAG_VALID) {
+			b->seq = tag.seq;
+			b->erase_count = tag.erase_count;
+			b->state = (tag.lpage & TAG_CHECKPOINT) ?
+				BLOCK_CHECKPOINT : BLOCK_DATA;
+			ftl->seq = max_u32(ftl->seq, tag.seq);
+		} else {
+			/* A bitflip, an interrupted program or erase: the block
+			 * may still hold valid data, it is not erased before
+			 * garbage collection has moved it */
+			b->state = BLOCK_DATA;
+			b->tag_error = true;
+			_identify_block(ftl, i);
+		}
+	}
+
+	/* Load the most recent valid checkpoint */
+	ckpt_seq = 0;
+	last_seq = UNMAPPED;
+	while (true) {
+		ckpt = NO_BLOCK;
+		for (i = 0; i < ftl->num_blocks; i++) {
+			struct _media_nandflash_block *b = &ftl->blocks[i];
+			if (b->state != BLOCK_CHECKPOINT || b->seq >= last_seq)
+				continue;
+			if (_tag_read(ftl, i, 0, &tag) != TAG_VALID ||
+			    tag.lpage != TAG_CHECKPOINT)
+				continue;
+			if (ckpt == NO_BLOCK || b->seq > ftl->blocks[ckpt].seq)
+				ckpt = i;
+		}
+		if (ckpt == NO_BLOCK)
+			break;
+
+		last_seq = ftl->blocks[ckpt].seq;
+		if (!_checkpoint_load(ftl, ckpt, &open_block, &open_page)) {
+			ckpt_seq = last_seq;
+			break;
+		}
+		trace_warning("media_nandflash: invalid checkpoint %u\r\n",
+				(unsigned)last_seq);
+		open_block = NO_BLOCK;
+	}
+
+	if (ckpt_seq) {
+		/* Drop the entries pointing to blocks erased since the
+		 * checkpoint, the data has been written again later */
+		for (lpage = 0; lpage < ftl->num_lpages; lpage++) {
+			struct _media_nandflash_block *b;
+			if (!IS_MAPPED(ftl->l2p[lpage]))
+				continue;
+			b = &ftl->blocks[ftl->l2p[lpage] / ftl->pages_per_block];
+			if (b->state != BLOCK_DATA || b->seq > ckpt_seq)
+				ftl->l2p[lpage] = UNMAPPED;
+		}
+		if (open_block < ftl->num_blocks &&
+		    ftl->blocks[open_block].state == BLOCK_DATA &&
+		    ftl->blocks[open_block].seq < ckpt_seq)
+			_replay_block(ftl, open_block, open_page);
+	} else {
+		for (lpage = 0; lpage < ftl->num_lpages; lpage++)
+			ftl->l2p[lpage] = UNMAPPED;
+		/* the erase counts of the free blocks are lost */
+		for (i = 0; i < ftl->num_blocks; i++)
+			if (ftl->blocks[i].state == BLOCK_FREE)
+				ftl->blocks[i].erase_count = 0;
+		ftl->ckpt_allocs = MEDIA_NANDFLASH_CHECKPOINT_INTERVAL;
+		trace_info("media_nandflash: no checkpoint, full scan\r\n");
+	}
+
+	/* Replay the blocks written after the checkpoint, release the
+	 * other checkpoints */
+	for (i = 0; i < ftl->num_blocks; i++) {
+		struct _media_nandflash_block *b = &ftl->blocks[i];
+		if (b->state == BLOCK_DATA && b->seq > ckpt_seq)
+			_replay_block(ftl, i, 0);
+		else if (b->state == BLOCK_CHECKPOINT && !b->tag_error && (!ckpt_seq ||
+			 b->seq < ckpt_seq || b->seq >= ckpt_seq + ftl->ckpt_blocks))
+			_erase_block(ftl, i);
+	}
+
+	for (lpage = 0; lpage < ftl->num_lpages; lpage++)
+		if (IS_MAPPED(ftl->l2p[lpage]))
+			ftl->blocks[ftl->l2p[lpage] / ftl->pages_per_block].valid++;
+
+	/* Data blocks without any valid page can be reused right away. The
+	 * blocks with an unreadable tag are left to garbage collection, once
+	 * the mapping has been used to move anything they still hold. */
+	for (i = 0; i < ftl->num_blocks; i++)
+		if (ftl->blocks[i].state == BLOCK_DATA && !ftl->blocks[i].valid &&
+		    !ftl->blocks[i].tag_error)
+			_erase_block(ftl, i);
+
+	ftl->ckpt_seq = ckpt_seq;
+	ftl->open_block = NO_BLOCK;
+	ftl->open_page = 0;
+	ftl->retire_block = NO_BLOCK;
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Background work done before writing a page: retires the blocks
+ * which failed to program, keeps the free pool above its threshold, levels
+ * wear and writes the periodic checkpoints.
+ */
+static uint8_t _maintain(struct _media_nandflash *ftl)
+{
+	if (ftl->retire_block != NO_BLOCK) {
+		uint16_t block = ftl->retire_block;
+		if (_relocate_block(ftl, block) != MEDIA_STATUS_SUCCESS)
+			return MEDIA_STATUS_ERROR;
+		ftl->retire_block = NO_BLOCK;
+		_retire_block(ftl, block);
+	}
+
+	while (ftl->free_blocks < MEDIA_NANDFLASH_GC_THRESHOLD)
+		if (_garbage_collect(ftl) != MEDIA_STATUS_SUCCESS)
+			return MEDIA_STATUS_ERROR;
+
+	if (ftl->ckpt_allocs >= MEDIA_NANDFLASH_CHECKPOINT_INTERVAL) {
+		if (_wear_level(ftl) != MEDIA_STATUS_SUCCESS)
+			return MEDIA_STATUS_ERROR;
+		/* The mapping can always be rebuilt from the tags, a failed
+		 * checkpoint is only retried later */
+		_checkpoint(ftl);
+	}
+
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Computes the FTL geometry
+ * \return true if the device can be handled
+ */
+static bool _setup_geometry(struct _media_nandflash *ftl,
+		const struct _nand_flash *nand)
+{
+	uint32_t reserved, ckpt_pages;
+
+	ftl->num_blocks = nand_model_get_device_size_in_blocks(&nand->model);
+	ftl->pages_per_block = nand_model_get_block_size_in_pages(&nand->model);
+	ftl->page_size = nand_model_get_page_data_size(&nand->model);
+	ftl->tag_offset = nand_ecc_get_spare_free_offset(nand);
+
+	if (ftl->tag_offset + TAG_SIZE > nand_model_get_page_spare_size(&nand->model)) {
+		trace_error("media_nandflash: no room for tags in the spare area\r\n");
+		return false;
+	}
+	if (ftl->page_size % MEDIA_NANDFLASH_BLOCK_SIZE) {
+		trace_error("media_nandflash: unsupported page size\r\n");
+		return false;
+	}
+
+	/* Upper bound of the checkpoint size, from the physical size */
+	ckpt_pages = CEIL_INT_DIV(4 * (CHECKPOINT_HEADER_WORDS + CHECKPOINT_TRAILER_WORDS +
+			ftl->num_blocks * (1 + ftl->pages_per_block)), ftl->page_size);
+	ftl->ckpt_blocks = CEIL_INT_DIV(ckpt_pages, ftl->pages_per_block);
+
+	/* over-provisioning, two checkpoints, GC reserve and the open block */
+	reserved = ftl->num_blocks * MEDIA_NANDFLASH_OVERPROVISIONING / 100 +
+		2 * ftl->ckpt_blocks + MEDIA_NANDFLASH_GC_THRESHOLD + 1;
+	if (reserved >= ftl->num_blocks) {
+		trace_error("media_nandflash: device too small\r\n");
+		return false;
+	}
+	ftl->num_lpages = (ftl->num_blocks - reserved) * ftl->pages_per_block;
+
+	/* Actual checkpoint size */
+	ckpt_pages = CEIL_INT_DIV(4 * (CHECKPOINT_HEADER_WORDS + CHECKPOINT_TRAILER_WORDS +
+			ftl->num_blocks + ftl->num_lpages), ftl->page_size);
+	ftl->ckpt_blocks = CEIL_INT_DIV(ckpt_pages, ftl->pages_per_block);
+	return true;
+}
+
+/**
+ * \brief Reads a specified amount of data from a NAND flash media
+ * \param media Pointer to a Media instance
+ * \param address Address of the data to read
+ * \param data Pointer to the buffer in which to store the retrieved data
+ * \param length Length of the buffer
+ * \param callback Optional pointer to a callback function to invoke when
+ *                 the operation is finished
+ * \param callback_arg Optional pointer to an argument for the callback
+ * \return Operation result code
+ */
+static uint8_t media_nandflash_read(struct _media *media,
+		uint32_t address, void *data, uint32_t length,
+		media_callback_t callback, void *callback_arg)
+{
+	struct _media_nandflash *ftl = (struct _media_nandflash *)media->interface;
+	uint32_t blocks_per_page = ftl->page_size / MEDIA_NANDFLASH_BLOCK_SIZE;
+	uint8_t *dest = (uint8_t*)data;
+	uint8_t status = MEDIA_STATUS_SUCCESS;
+
+	// Check that the media is ready
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	// Check that the data to read is not too big
+	if ((address + length) > media->size)
+		return MEDIA_STATUS_ERROR;
+
+	// Enter Busy state
+	media->state = MEDIA_STATE_BUSY;
+
+	while (length) {
+		uint32_t lpage = address / blocks_per_page;
+		uint32_t first = address % blocks_per_page;
+		uint32_t count = min_u32(blocks_per_page - first, length);
+		uint32_t size = count * MEDIA_NANDFLASH_BLOCK_SIZE;
+
+		if (ftl->l2p[lpage] == UNMAPPED) {
+			memset(dest, 0xff, size);
+		} else {
+			if (ftl->l2p[lpage] == LOST_PAGE ||
+			    _read_page(ftl, ftl->l2p[lpage])) {
+				status = MEDIA_STATUS_ERROR;
+				break;
+			}
+			memcpy(dest, page_buf + first * MEDIA_NANDFLASH_BLOCK_SIZE, size);
+		}
+
+		dest += size;
+		address += count;
+		length -= count;
+	}
+
+	// Leave the Busy state
+	media->state = MEDIA_STATE_READY;
+
+	// Invoke callback
+	if (callback)
+		callback(callback_arg, status, 0, length);
+
+	return status;
+}
+
+/**
+ *  \brief Writes data on a NAND flash media
+ *  \param media Pointer to a Media instance
+ *  \param address Address at which to write
+ *  \param data Pointer to the data to write
+ *  \param length Size of the data buffer
+ *  \param callback Optional pointer to a callback function to invoke when
+ *                  the write operation terminates
+ *  \param callback_arg Optional argument for the callback function
+ *  \return Operation result code
+ */
+static uint8_t media_nandflash_write(struct _media *media,
+		uint32_t address, void *data, uint32_t length,
+		media_callback_t callback, void *callback_arg)
+{
+	struct _media_nandflash *ftl = (struct _media_nandflash *)media->interface;
+	uint32_t blocks_per_page = ftl->page_size / MEDIA_NANDFLASH_BLOCK_SIZE;
+	const uint8_t *src = (const uint8_t*)data;
+	uint8_t status = MEDIA_STATUS_SUCCESS;
+
+	// Check that the media if ready
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	// Check that the data to write is not too big
+	if ((address + length) > media->size)
+		return MEDIA_STATUS_ERROR;
+
+	// Put the media in Busy state
+	media->state = MEDIA_STATE_BUSY;
+
+	while (length) {
+		uint32_t lpage = address / blocks_per_page;
+		uint32_t first = address % blocks_per_page;
+		uint32_t count = min_u32(blocks_per_page - first, length);
+		uint32_t size = count * MEDIA_NANDFLASH_BLOCK_SIZE;
+
+		/* Done first, as it uses the page buffer */
+		status = _maintain(ftl);
+		if (status != MEDIA_STATUS_SUCCESS)
+			break;
+
+		/* Partial page: read-modify-write. The rest of a page which
+		 * cannot be read is not merged in the new page. */
+		if (count != blocks_per_page) {
+			if (ftl->l2p[lpage] == UNMAPPED) {
+				memset(page_buf, 0xff, ftl->page_size);
+			} else if (ftl->l2p[lpage] == LOST_PAGE ||
+				   _read_page(ftl, ftl->l2p[lpage])) {
+				status = MEDIA_STATUS_ERROR;
+				break;
+			}
+		}
+		memcpy(page_buf + first * MEDIA_NANDFLASH_BLOCK_SIZE, src, size);
+
+		status = _program(ftl, lpage);
+		if (status != MEDIA_STATUS_SUCCESS)
+			break;
+		ftl->stats.host_writes++;
+
+		src += size;
+		address += count;
+		length -= count;
+	}
+
+	// Leave the Busy state
+	media->state = MEDIA_STATE_READY;
+
+	// Invoke the callback if it exists
+	if (callback)
+		callback(callback_arg, status, 0, length);
+
+	return status;
+}
+
+/**
+ *  \brief Unmaps the logical pages entirely inside a range of blocks, so that
+ *  garbage collection does not move their data any more. Unmapped pages read
+ *  as erased. The mapping of a page trimmed since the last checkpoint may be
+ *  restored at the next initialization, which is allowed for a trim.
+ *  \param media Pointer to a Media instance
+ *  \param address Address of the first block
+ *  \param length Number of blocks
+ *  \return Operation result code
+ */
+static uint8_t media_nandflash_trim(struct _media *media,
+		uint32_t address, uint32_t length)
+{
+	struct _media_nandflash *ftl = (struct _media_nandflash *)media->interface;
+	uint32_t blocks_per_page = ftl->page_size / MEDIA_NANDFLASH_BLOCK_SIZE;
+	uint32_t lpage, end;
+
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	if ((address + length) > media->size)
+		return MEDIA_STATUS_ERROR;
+
+	/* Partial pages at both ends are kept */
+	lpage = (address + blocks_per_page - 1) / blocks_per_page;
+	end = (address + length) / blocks_per_page;
+	for (; lpage < end; lpage++) {
+		uint32_t old = ftl->l2p[lpage];
+		if (old == UNMAPPED)
+			continue;
+		if (IS_MAPPED(old))
+			ftl->blocks[old / ftl->pages_per_block].valid--;
+		ftl->l2p[lpage] = UNMAPPED;
+		ftl->stats.host_trims++;
+	}
+
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ *      Exported Functions
+ *---------------------------------------------------------------------------*/
+
+/**
+ * \brief Returns the size of the workspace needed by the FTL for the given
+ * NAND flash device.
+ * \param nand Pointer to an initialized NAND flash instance, with ECC setup
+ * \return workspace size in bytes, 0 if the device cannot be handled
+ */
+uint32_t media_nandflash_get_workspace_size(const struct _nand_flash *nand)
+{
+	struct _media_nandflash ftl;
+
+	if (!_setup_geometry(&ftl, nand))
+		return 0;
+
+	return ftl.num_lpages * sizeof(uint32_t) +
+		ftl.num_blocks * sizeof(struct _media_nandflash_block);
+}
+
+/**
+ * \brief Initializes a Media instance on top of a NAND flash device, and
+ * rebuilds the FTL mapping from the device content.
+ * \param media Pointer to the Media instance to initialize
+ * \param ftl Pointer to the FTL instance
+ * \param nand Pointer to an initialized NAND flash instance, with ECC setup
+ * \param workspace Word aligned workspace for the FTL tables
+ * \param workspace_size Size of the workspace, see
+ *        media_nandflash_get_workspace_size()
+ * \return MEDIA_STATUS_SUCCESS if the media is ready
+ */
+uint8_t media_nandflash_initialize(struct _media *media,
+		struct _media_nandflash *ftl, struct _nand_flash *nand,
+		void *workspace, uint32_t workspace_size)
+{
+	memset(media, 0, sizeof(*media));
+	memset(ftl, 0, sizeof(*ftl));
+	media->state = MEDIA_STATE_NOT_READY;
+
+	if (!_setup_geometry(ftl, nand))
+		return MEDIA_STATUS_ERROR;
+
+	if (workspace_size < media_nandflash_get_workspace_size(nand)) {
+		trace_error("media_nandflash: workspace too small\r\n");
+		return MEDIA_STATUS_ERROR;
+	}
+
+	ftl->nand = nand;
+	ftl->l2p = (uint32_t*)workspace;
+	ftl->blocks = (struct _media_nandflash_block*)(ftl->l2p + ftl->num_lpages);
+
+	if (_mount(ftl) != MEDIA_STATUS_SUCCESS)
+		return MEDIA_STATUS_ERROR;
+
+	trace_info("media_nandflash: %u logical pages, %u bad blocks\r\n",
+			(unsigned)ftl->num_lpages, (unsigned)ftl->stats.bad_blocks);
+
+	media->write = media_nandflash_write;
+	media->read = media_nandflash_read;
+	media->trim = media_nandflash_trim;
+
+	media->interface = ftl;
+	media->block_size = MEDIA_NANDFLASH_BLOCK_SIZE;
+	media->base_address = 0;
+	media->size = ftl->num_lpages * (ftl->page_size / MEDIA_NANDFLASH_BLOCK_SIZE);
+	media->optimal_length = ftl->page_size / MEDIA_NANDFLASH_BLOCK_SIZE;
+
+	media->mapped_read = false;
+	media->mapped_write = false;
+	media->removable = false;
+	media->state = MEDIA_STATE_READY;
+
+	return MEDIA_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Writes a checkpoint of the mapping, which shortens the next
+ * initialization. Checkpoints are also written periodically while writing.
+ * \param media Pointer to a NAND flash Media instance
+ * \return Operation result code
+ */
+uint8_t media_nandflash_checkpoint(struct _media *media)
+{
+	struct _media_nandflash *ftl = (struct _media_nandflash *)media->interface;
+	uint8_t status;
+
+	if (media->state != MEDIA_STATE_READY)
+		return MEDIA_STATUS_BUSY;
+
+	media->state = MEDIA_STATE_BUSY;
+	status = _checkpoint(ftl);
+	media->state = MEDIA_STATE_READY;
+
+	return status;
+}
+
+/**
+ * \brief Retrieves the FTL statistics.
+ * \param media Pointer to a NAND flash Media instance
+ * \param stats Pointer to the structure filled with the statistics
+ */
+void media_nandflash_get_stats(struct _media *media,
+		struct _media_nandflash_stats *stats)
+{
+	struct _media_nandflash *ftl = (struct _media_nandflash *)media->interface;
+	uint16_t i;
+	bool first = true;
+
+	*stats = ftl->stats;
+	for (i = 0; i < ftl->num_blocks; i++) {
+		uint32_t ec = ftl->blocks[i].erase_count;
+		if (ftl->blocks[i].state == BLOCK_BAD)
+			continue;
+		if (first || ec < stats->min_erase_count)
+			stats->min_erase_count = ec;
+		if (first || ec > stats->max_erase_count)
+			stats->max_erase_count = ec;
+		first = false;
+	}
+}
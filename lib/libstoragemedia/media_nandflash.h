@@ -0,0 +1,134 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+  *  \file
+  *
+  *  Media layer interface for NAND flash, through a page mapping flash
+  *  translation layer (FTL).
+  *
+  *  Each logical page is written out of place in the block currently open
+  *  for writing, with a tag (logical page, block sequence number, erase
+  *  count) in the free bytes of the spare area. The logical to physical
+  *  mapping is kept in RAM, in a workspace provided by the application
+  *  (see media_nandflash_get_workspace_size()). It is rebuilt at
+  *  initialization from the last checkpoint and the tags of the blocks
+  *  written after it, or from the tags of all blocks when no valid
+  *  checkpoint is found, so that an interrupted write never corrupts the
+  *  mapping.
+  *
+  *  The media exposes 512-byte blocks; partial page writes are handled by
+  *  read-modify-write of the logical page.
+  */
+
+#ifndef _MEDIA_NANDFLASH_H
+#define _MEDIA_NANDFLASH_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include "libstoragemedia/media.h"
+
+#include "nvm/nand/nand_flash.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Size of the blocks exposed by the media, in bytes */
+#define MEDIA_NANDFLASH_BLOCK_SIZE 512
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+/** FTL statistics */
+struct _media_nandflash_stats {
+	uint32_t host_writes;   /**< Logical pages written by the host */
+	uint32_t host_trims;    /**< Logical pages discarded by the host */
+	uint32_t page_writes;   /**< Pages programmed (including GC/WL/checkpoints) */
+	uint32_t page_reads;    /**< Pages read */
+	uint32_t erases;        /**< Blocks erased */
+	uint32_t gc_runs;       /**< Blocks reclaimed by garbage collection */
+	uint32_t wl_moves;      /**< Blocks moved by static wear leveling */
+	uint32_t checkpoints;   /**< Mapping checkpoints written */
+	uint32_t ecc_errors;    /**< Pages with uncorrectable data */
+	uint32_t lost_pages;    /**< Logical pages lost while being moved */
+	uint32_t bad_blocks;    /**< Blocks retired (factory and grown) */
+	uint32_t min_erase_count; /**< Lowest erase count of the good blocks */
+	uint32_t max_erase_count; /**< Highest erase count of the good blocks */
+};
+
+struct _media_nandflash_block;
+
+/** FTL instance, the fields are private */
+struct _media_nandflash {
+	struct _nand_flash *nand;
+
+	uint16_t num_blocks;      /**< Number of physical blocks */
+	uint16_t pages_per_block; /**< Number of pages per block */
+	uint32_t page_size;       /**< Size of the data area of a page */
+	uint16_t tag_offset;      /**< Offset of the FTL tag in the spare area */
+	uint16_t ckpt_blocks;     /**< Number of blocks used by a checkpoint */
+	uint32_t num_lpages;      /**< Number of logical pages */
+
+	uint32_t *l2p;            /**< Logical to physical page table */
+	struct _media_nandflash_block *blocks; /**< Physical block table */
+
+	uint16_t free_blocks;     /**< Number of blocks in the free pool */
+	uint16_t open_block;      /**< Block currently written */
+	uint16_t open_page;       /**< Next page to write in the open block */
+	uint32_t seq;             /**< Last block sequence number */
+	uint32_t ckpt_seq;        /**< Sequence number of the current checkpoint */
+	uint16_t ckpt_allocs;     /**< Blocks allocated since the checkpoint */
+	uint16_t retire_block;    /**< Block to retire after a program error */
+
+	struct _media_nandflash_stats stats;
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported functions
+ *------------------------------------------------------------------------------*/
+
+extern uint32_t media_nandflash_get_workspace_size(const struct _nand_flash *nand);
+
+extern uint8_t media_nandflash_initialize(struct _media *media,
+		struct _media_nandflash *ftl, struct _nand_flash *nand,
+		void *workspace, uint32_t workspace_size);
+
+extern uint8_t media_nandflash_checkpoint(struct _media *media);
+
+extern void media_nandflash_get_stats(struct _media *media,
+		struct _media_nandflash_stats *stats);
+
+#endif /* _MEDIA_NANDFLASH_H */
@@ -75,6 +75,9 @@ struct _media {
 	/** Flush method */
 	uint8_t (*flush)(struct _media* media);
 
+	/** Trim method */
+	uint8_t (*trim)(struct _media* media, uint32_t address, uint32_t length);
+
 	/** Interrupt handler */
 	void (*handler)(struct _media* media);
 
@@ -84,6 +87,7 @@ struct _media {
 	uint32_t block_size;     /**< Block size in bytes (1, 512, 1K, 2K ...) */
 	uint32_t base_address;   /**< Base address of media in number of blocks */
 	uint32_t size;           /**< Size of media in number of blocks */
+	uint32_t optimal_length; /**< Preferred transfer length in blocks, 0 if none */
 	void    *interface;      /**< Pointer to the physical interface used */
 	bool     mapped_read;    /**< Mapped to memory space to read */
 	bool     mapped_write;   /**< Mapped to memory space to write */
@@ -47,6 +47,6 @@
  *------------------------------------------------------------------------------*/
 
 extern void media_ramdisk_init(struct _media *media,
-		uint32_t block_size, uint32_t base_address, uint32_t size);
+		uint32_t base_address, uint32_t size, uint32_t block_size);
 
 #endif /* MEDIA_RAMDISK_H */
@@ -90,7 +90,13 @@ static uint8_t media_sdcard_read(struct _media *media,
 	/* Enter Busy state */
 	media->state = MEDIA_STATE_BUSY;
 
-	error = SD_ReadBlocks((sSdCard *)media->interface, address, data, length);
+	/* Keep multiple block requests in one READ_MULTIPLE_BLOCK command */
+	if (length > 1)
+		error = SD_Read((sSdCard *)media->interface, address, data,
+				length, NULL, NULL);
+	else
+		error = SD_ReadBlocks((sSdCard *)media->interface, address,
+				data, length);
 
 	/* Leave the Busy state */
 	media->state = MEDIA_STATE_READY;
@@ -142,8 +148,14 @@ static uint8_t media_sdcard_write(struct _media *media,
 	/* Put the media in Busy state */
 	media->state = MEDIA_STATE_BUSY;
 
-	//error = SD_Write((sSdCard*)media->interface, address,data,length,NULL,NULL);
-	error = SD_WriteBlocks((sSdCard *)media->interface, address, data, length);
+	/* Keep multiple block requests in one WRITE_MULTIPLE_BLOCK command,
+	 * which lets the card pre-erase the whole range */
+	if (length > 1)
+		error = SD_Write((sSdCard *)media->interface, address, data,
+				length, NULL, NULL);
+	else
+		error = SD_WriteBlocks((sSdCard *)media->interface, address,
+				data, length);
 
 	/* Leave the Busy state */
 	media->state = MEDIA_STATE_READY;
@@ -249,6 +261,39 @@ static uint8_t media_sdusb_write(struct _media *media,
 
 }
 
+/**
+ * \brief  Erases a range of blocks of a SD/MMC card which are no longer used.
+ * Cards which cannot erase single blocks ignore the request.
+ * \param  media    Pointer to a Media instance
+ * \param  address  Address of the first block
+ * \param  length   Number of blocks
+ * \return Operation result code
+ */
+static uint8_t media_sdcard_trim(struct _media *media,
+								uint32_t address,
+								uint32_t length)
+{
+	uint8_t error;
+
+	if (media->state != MEDIA_STATE_READY) {
+		trace_info("MEDSdcard_Trim: Busy\n\r");
+		return MEDIA_STATUS_BUSY;
+	}
+
+	if ((length + address) > media->size) {
+		trace_warning("MEDSdcard_Trim: Data too big\n\r");
+		return MEDIA_STATUS_ERROR;
+	}
+
+	media->state = MEDIA_STATE_BUSY;
+	error = SD_Erase((sSdCard *)media->interface, address, length);
+	media->state = MEDIA_STATE_READY;
+
+	if (error == SDMMC_NOT_SUPPORTED)
+		return MEDIA_STATUS_SUCCESS;
+	return error ? MEDIA_STATUS_ERROR : MEDIA_STATUS_SUCCESS;
+}
+
 /**
  * \brief  Initializes a Media instance
  * \param  media Pointer to the Media instance to initialize
@@ -270,10 +315,12 @@ uint8_t media_sdcard_initialize(struct _media *media, sSdCard *sd_drv)
 	media->unlock = 0;
 	media->handler = 0;
 	media->flush = 0;
+	media->trim = media_sdcard_trim;
 
 	media->block_size = SD_BLOCK_SIZE;
 	media->base_address = 0;
 	media->size = sd_drv->dwNbBlocks;
+	media->optimal_length = 0;
 
 	media->mapped_read  = 0;
 	media->mapped_write  = 0;
@@ -308,10 +355,12 @@ uint8_t media_sdusb_initialize(struct _media *media, sSdCard *sd_drv)
 	media->unlock = 0;
 	media->handler = 0;
 	media->flush = 0;
+	media->trim = media_sdcard_trim;
 
 	media->block_size = SD_BLOCK_SIZE;
 	media->base_address = 0;
 	media->size = sd_drv->dwNbBlocks;
+	media->optimal_length = 0;
 
 	media->mapped_read  = 0;
 	media->mapped_write  = 0;
@@ -34,17 +34,31 @@
  *        Headers
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "lwip/netif.h"
 #include "lwip/ip_addr.h"
 #include "lwip/err.h"
 #include "netif/etharp.h"
 
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/* Hook invoked for each frame received on a RX queue, returns true if the
+ * frame has been consumed */
+typedef bool (*ethif_rx_hook_t)(struct netif * netif, uint8_t queue, struct pbuf * p);
+
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
 
 err_t ethif_init(struct netif * netif);
 void ethif_poll(struct netif * netif);
+bool ethif_rx_pending(struct netif * netif);
+void ethif_set_rx_budget(struct netif * netif, uint8_t queue, uint32_t budget);
+void ethif_set_rx_hook(struct netif * netif, uint8_t queue, ethif_rx_hook_t hook);
 
 #endif  /* _ETHIF_H */
 
@@ -55,12 +55,18 @@
 #if LWIP_DHCP
 #include "lwip/dhcp.h"
 #endif
+#include "lwip/inet_chksum.h"
 #include "lwip/mem.h"
 #include "lwip/pbuf.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
 #include "lwip/priv/tcp_priv.h"
 #include "lwip/stats.h"
 #include "lwip/sys.h"
+#include "mm/cache.h"
+#include "ring.h"
 #include "timer.h"
+#include "trace.h"
 
 /*----------------------------------------------------------------------------
  *        Definitions
@@ -70,6 +76,101 @@
 #define IFNAME0 'e'
 #define IFNAME1 'n'
 
+/* Default maximum number of frames processed on each RX queue by each
+ * ethif_poll() call, see ethif_set_rx_budget() */
+#ifndef ETHIF_RX_BUDGET
+#define ETHIF_RX_BUDGET 8
+#endif
+
+/* Number of RX queues polled, frames are steered to the priority queues by
+ * the MAC screeners (see gmacd_add_screen()) */
+#ifndef ETHIF_RX_QUEUES
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+#define ETHIF_RX_QUEUES GMAC_QUEUE_COUNT
+#else
+#define ETHIF_RX_QUEUES 1
+#endif
+#endif
+
+#if ETHIF_RX_QUEUES > ETH_QUEUE_COUNT
+#error ETHIF_RX_QUEUES is larger than ETH_QUEUE_COUNT
+#endif
+
+/* Zero-copy mode: RX frames are handed to lwIP in the buffers filled by the
+ * MAC, and TX pbuf chains are given to the MAC as scatter-gather lists.
+ * Requires LWIP_SUPPORT_CUSTOM_PBUF. */
+#ifndef ETHIF_ZERO_COPY
+#define ETHIF_ZERO_COPY 0
+#endif
+
+#if ETHIF_ZERO_COPY
+
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error ETHIF_ZERO_COPY requires LWIP_SUPPORT_CUSTOM_PBUF
+#endif
+
+#if ETH_PAD_SIZE
+#error ETHIF_ZERO_COPY does not support ETH_PAD_SIZE
+#endif
+
+/* Maximum number of RX buffers holding a single frame */
+#define ETHIF_RX_FRAME_BUFFERS \
+	((ETH_MAX_FRAME_LENGTH + ETH_RX_UNITSIZE - 1) / ETH_RX_UNITSIZE)
+
+#if LWIP_TCP
+/* Number of RX buffers holding a TCP segment of maximum size, and number of
+ * segments in a TCP window */
+#define ETHIF_RX_SEGMENT_BUFFERS \
+	((TCP_MSS + 40 + PBUF_LINK_HLEN + ETH_RX_UNITSIZE - 1) / ETH_RX_UNITSIZE)
+#define ETHIF_RX_WND_SEGMENTS ((TCP_WND + TCP_MSS - 1) / TCP_MSS)
+#endif
+
+/* Number of spare RX buffers, shared by all interfaces. lwIP holds them
+ * until the application reads the data: by default, there are enough for a
+ * whole TCP window and a frame of maximum size. When they are all held,
+ * frames are copied into pbufs from PBUF_POOL. */
+#ifndef ETHIF_RX_BUFFERS
+#if LWIP_TCP
+#define ETHIF_RX_BUFFERS \
+	(ETHIF_RX_WND_SEGMENTS * ETHIF_RX_SEGMENT_BUFFERS + ETHIF_RX_FRAME_BUFFERS)
+#else
+#define ETHIF_RX_BUFFERS (2 * ETHIF_RX_FRAME_BUFFERS)
+#endif
+#endif
+
+#if ETHIF_RX_BUFFERS < ETHIF_RX_FRAME_BUFFERS
+#error ETHIF_RX_BUFFERS is too small to hold a whole frame
+#endif
+
+#if LWIP_TCP && ETHIF_RX_BUFFERS < ETHIF_RX_WND_SEGMENTS * ETHIF_RX_SEGMENT_BUFFERS
+#warning ETHIF_RX_BUFFERS cannot hold a TCP window, received segments will be copied
+#endif
+
+/* Number of frames that can be in flight on TX, per interface */
+#ifndef ETHIF_TX_FRAMES
+#define ETHIF_TX_FRAMES 16
+#endif
+
+/* Maximum number of pbufs sent without copy in a single frame */
+#ifndef ETHIF_TX_SG_ENTRIES
+#define ETHIF_TX_SG_ENTRIES 4
+#endif
+
+#endif /* ETHIF_ZERO_COPY */
+
+/* The frames are copied into pbufs from PBUF_POOL, in zero-copy mode when
+ * the spare RX buffers are all held by lwIP */
+#if PBUF_POOL_SIZE * PBUF_POOL_BUFSIZE < ETH_MAX_FRAME_LENGTH
+#error PBUF_POOL is too small to hold a whole frame
+#endif
+
+/* Tells whether lwIP checks a checksum of the frames received on a netif */
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+#define ETHIF_SW_CHECK(netif, flag, check) (((netif)->chksum_flags & (flag)) != 0)
+#else
+#define ETHIF_SW_CHECK(netif, flag, check) (check)
+#endif
+
 /*----------------------------------------------------------------------------
  *        Types
  *----------------------------------------------------------------------------*/
@@ -81,6 +182,23 @@ typedef struct _timers_info {
 	void (*timer_func)(void);
 } timers_info;
 
+#if ETHIF_ZERO_COPY
+/* RX buffer handed to lwIP */
+struct _ethif_rx_pbuf {
+	struct pbuf_custom pc;
+	uint8_t* buffer;
+};
+
+/* Frames being sent without copy */
+struct _ethif_tx {
+	struct pbuf* pbufs[ETHIF_TX_FRAMES];
+	uint8_t descs[ETHIF_TX_FRAMES];
+	uint16_t head;
+	uint16_t tail;
+	uint32_t pending;
+};
+#endif
+
 /*---------------------------------------------------------------------------
  *         Variables
  *---------------------------------------------------------------------------*/
@@ -103,6 +221,35 @@ static timers_info timers_table[] = {
 #endif
 };
 
+/** Frames processed per RX queue by each ethif_poll() call */
+static uint32_t _rx_budgets[ETH_IFACE_COUNT][ETHIF_RX_QUEUES];
+
+/** Per RX queue hooks */
+static ethif_rx_hook_t _rx_hooks[ETH_IFACE_COUNT][ETHIF_RX_QUEUES];
+
+/** RX queues signaled by the RX interrupt and not drained yet */
+static volatile bool _rx_pending[ETH_IFACE_COUNT][ETHIF_RX_QUEUES];
+
+#if ETHIF_ZERO_COPY
+/** Spare RX buffers */
+CACHE_ALIGNED_DDR
+static uint8_t _rx_buffers[ETHIF_RX_BUFFERS][ETH_RX_UNITSIZE];
+
+/** Stack of free RX buffers */
+static uint8_t* _rx_free_buffers[ETHIF_RX_BUFFERS];
+static uint32_t _rx_free_buffer_count;
+
+/** Custom pbufs wrapping RX buffers */
+static struct _ethif_rx_pbuf _rx_pbufs[ETHIF_RX_BUFFERS];
+
+/** Stack of free custom pbufs */
+static struct _ethif_rx_pbuf* _rx_free_pbufs[ETHIF_RX_BUFFERS];
+static uint32_t _rx_free_pbuf_count;
+
+/** In-flight TX frames */
+static struct _ethif_tx _ethif_tx[ETH_IFACE_COUNT];
+#endif
+
 /*----------------------------------------------------------------------------
  *        Local functions
  *----------------------------------------------------------------------------*/
@@ -138,10 +285,187 @@ static void timers_update(void)
 	}
 }
 
+/**
+ * Verify the checksums of a received IPv4 frame which have neither been
+ * checked by the MAC nor will be checked by lwIP.
+ *
+ * @param netif the lwip network interface structure for this ethif
+ * @param p the received frame (including MAC header)
+ * @param status the RX descriptor status of the frame
+ * @return false if the frame must be dropped
+ */
+static bool _ethif_rx_checksum_ok(struct netif *netif, struct pbuf *p, uint32_t status)
+{
+	struct eth_hdr *ethhdr = p->payload;
+	struct ip_hdr *iphdr;
+	ip4_addr_t src, dest;
+	uint32_t csum = ETH_RX_STATUS_CSUM_NONE;
+	u16_t hlen, len, sum;
+	u8_t proto;
+
+	if (ethd_get_caps(board_get_eth(netif->num)) & ETH_CAPS_RX_CHECKSUM)
+		csum = status & ETH_RX_STATUS_CSUM_MASK;
+	if (csum == ETH_RX_STATUS_CSUM_IP_TCP || csum == ETH_RX_STATUS_CSUM_IP_UDP)
+		return true;
+
+	/* Malformed frames are left to lwIP */
+	if (ethhdr->type != PP_HTONS(ETHTYPE_IP) ||
+	    p->len < SIZEOF_ETH_HDR + IP_HLEN)
+		return true;
+	iphdr = (struct ip_hdr *)((u8_t *)p->payload + SIZEOF_ETH_HDR);
+	hlen = IPH_HL(iphdr) * 4;
+	len = lwip_ntohs(IPH_LEN(iphdr));
+	if (hlen < IP_HLEN || p->len < SIZEOF_ETH_HDR + hlen ||
+	    len < hlen || p->tot_len < SIZEOF_ETH_HDR + len)
+		return true;
+
+	if (csum == ETH_RX_STATUS_CSUM_NONE &&
+	    !ETHIF_SW_CHECK(netif, NETIF_CHECKSUM_CHECK_IP, CHECKSUM_CHECK_IP) &&
+	    inet_chksum(iphdr, hlen) != 0)
+		return false;
+
+	/* The transport header of fragments can't be checked here */
+	if (IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF))
+		return true;
+
+	proto = IPH_PROTO(iphdr);
+	if (proto == IP_PROTO_TCP) {
+		if (ETHIF_SW_CHECK(netif, NETIF_CHECKSUM_CHECK_TCP, CHECKSUM_CHECK_TCP))
+			return true;
+	} else if (proto == IP_PROTO_UDP) {
+		if (ETHIF_SW_CHECK(netif, NETIF_CHECKSUM_CHECK_UDP, CHECKSUM_CHECK_UDP))
+			return true;
+		/* No checksum sent */
+		if (len - hlen >= UDP_HLEN &&
+		    p->len >= SIZEOF_ETH_HDR + hlen + UDP_HLEN &&
+		    ((struct udp_hdr *)((u8_t *)iphdr + hlen))->chksum == 0)
+			return true;
+	} else {
+		return true;
+	}
+
+	ip4_addr_copy(src, iphdr->src);
+	ip4_addr_copy(dest, iphdr->dest);
+	pbuf_header(p, -(s16_t)(SIZEOF_ETH_HDR + hlen));
+	sum = inet_chksum_pseudo_partial(p, proto, len - hlen, len - hlen,
+			&src, &dest);
+	pbuf_header(p, (s16_t)(SIZEOF_ETH_HDR + hlen));
+	return sum == 0;
+}
+
 /* Forward declarations. */
-static void  ethif_input(struct netif *netif);
+static void  ethif_input(struct netif *netif, uint8_t queue, struct pbuf *p);
 static err_t ethif_output(struct netif *netif, struct pbuf *p, ip4_addr_t *ipaddr);
 
+#if ETHIF_ZERO_COPY
+/**
+ * Give a RX buffer back to the pool once lwIP has released its pbuf
+ */
+static void _ethif_rx_pbuf_free(struct pbuf *p)
+{
+	struct _ethif_rx_pbuf* rp = (struct _ethif_rx_pbuf*)p;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	_rx_free_buffers[_rx_free_buffer_count++] = rp->buffer;
+	_rx_free_pbufs[_rx_free_pbuf_count++] = rp;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+static void _ethif_rx_pool_init(void)
+{
+	static bool initialized = false;
+	uint32_t i;
+
+	if (initialized)
+		return;
+
+	for (i = 0; i < ETHIF_RX_BUFFERS; i++) {
+		_rx_free_buffers[i] = _rx_buffers[i];
+		_rx_pbufs[i].pc.custom_free_function = _ethif_rx_pbuf_free;
+		_rx_free_pbufs[i] = &_rx_pbufs[i];
+	}
+	_rx_free_buffer_count = ETHIF_RX_BUFFERS;
+	_rx_free_pbuf_count = ETHIF_RX_BUFFERS;
+	initialized = true;
+}
+
+/**
+ * Exchange the RX buffers of a received IP frame with spare buffers, and
+ * wrap them into a chain of custom pbufs. Other frames are left to the copy:
+ * lwIP builds the ARP replies in the request pbuf, and custom pbufs have no
+ * room for the Ethernet header in front of their payload.
+ *
+ * @param frame the RX buffers holding the frame
+ * @return the pbuf, NULL if there are not enough spare buffers or the frame
+ *         is not an IP one
+ */
+static struct pbuf *_ethif_rx_swap(struct _eth_sg_list *frame)
+{
+	struct _ethif_rx_pbuf* rp;
+	struct _eth_sg* sg;
+	struct pbuf *p, *q;
+	uint32_t i;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	if (frame->entries[0].size < SIZEOF_ETH_HDR ||
+	    ((struct eth_hdr *)frame->entries[0].buffer)->type != PP_HTONS(ETHTYPE_IP))
+		return NULL;
+
+	SYS_ARCH_PROTECT(lev);
+	if (_rx_free_buffer_count < frame->size) {
+		SYS_ARCH_UNPROTECT(lev);
+		return NULL;
+	}
+
+	p = NULL;
+	for (i = 0; i < frame->size; i++) {
+		sg = &frame->entries[i];
+		rp = _rx_free_pbufs[--_rx_free_pbuf_count];
+		rp->buffer = sg->buffer;
+		sg->buffer = _rx_free_buffers[--_rx_free_buffer_count];
+		q = pbuf_alloced_custom(PBUF_RAW, sg->size, PBUF_REF, &rp->pc,
+				rp->buffer, ETH_RX_UNITSIZE);
+		if (p)
+			pbuf_cat(p, q);
+		else
+			p = q;
+	}
+	SYS_ARCH_UNPROTECT(lev);
+
+	return p;
+}
+
+/**
+ * Release the pbufs of the frames whose buffer descriptors have been
+ * processed by the MAC. Frames complete in order, so the oldest frame is done
+ * as soon as the descriptors still in use fit in the newer frames.
+ */
+static void _ethif_tx_reclaim(struct netif *netif)
+{
+	struct _ethd* ethd = board_get_eth(netif->num);
+	struct _ethif_tx* tx = &_ethif_tx[netif->num];
+	struct pbuf* p;
+	uint32_t load;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	do {
+		p = NULL;
+		SYS_ARCH_PROTECT(lev);
+		load = ethd_get_tx_load(ethd, 0);
+		if (!RING_EMPTY(tx->head, tx->tail) &&
+		    (tx->pending - tx->descs[tx->tail]) >= load) {
+			p = tx->pbufs[tx->tail];
+			tx->pending -= tx->descs[tx->tail];
+			RING_INC(tx->tail, ETHIF_TX_FRAMES);
+		}
+		SYS_ARCH_UNPROTECT(lev);
+		if (p)
+			pbuf_free(p);
+	} while (p);
+}
+#endif /* ETHIF_ZERO_COPY */
+
 static void glow_level_init(struct netif *netif, struct _ethd* ethd)
 {
 	uint8_t _mac_addr[6];
@@ -155,8 +479,115 @@ static void glow_level_init(struct netif *netif, struct _ethd* ethd)
 	netif->mtu = 1500;
 	/* device capabilities */
 	netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET| NETIF_FLAG_LINK_UP;
+
+	/* Let the MAC generate/check the checksums it supports */
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+	{
+		uint32_t caps = ethd_get_caps(ethd);
+		u16_t flags = NETIF_CHECKSUM_ENABLE_ALL;
+		if (caps & ETH_CAPS_TX_CHECKSUM)
+			flags &= ~(NETIF_CHECKSUM_GEN_IP | NETIF_CHECKSUM_GEN_UDP | NETIF_CHECKSUM_GEN_TCP);
+		if (caps & ETH_CAPS_RX_CHECKSUM)
+			flags &= ~(NETIF_CHECKSUM_CHECK_IP | NETIF_CHECKSUM_CHECK_UDP | NETIF_CHECKSUM_CHECK_TCP);
+		NETIF_SET_CHECKSUM_CTRL(netif, flags);
+	}
+#elif !CHECKSUM_GEN_IP || !CHECKSUM_GEN_UDP || !CHECKSUM_GEN_TCP
+	if (!(ethd_get_caps(ethd) & ETH_CAPS_TX_CHECKSUM))
+		trace_error("ethif: TX checksums disabled but not generated by the MAC\r\n");
+#endif
+}
+
+#if ETHIF_ZERO_COPY
+
+/**
+ * This function should do the actual transmission of the packet. The packet is
+ * contained in the pbuf that is passed to the function. This pbuf
+ * might be chained.
+ *
+ * The pbufs of the chain are given to the MAC as a scatter-gather list and
+ * a reference is kept on the chain until the frame has been sent.
+ *
+ * @param netif the lwip network interface structure for this ethif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK if the packet could be sent
+ *         an err_t value if the packet couldn't be sent
+ */
+static err_t glow_level_output(struct netif *netif, struct pbuf *p)
+{
+	struct _ethif_tx* tx = &_ethif_tx[netif->num];
+	struct _eth_sg sg[ETHIF_TX_SG_ENTRIES];
+	struct _eth_sg_list sgl;
+	struct pbuf *q, *frame;
+	uint32_t count;
+	uint8_t rc;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	_ethif_tx_reclaim(netif);
+
+	if (RING_SPACE(tx->head, tx->tail, ETHIF_TX_FRAMES) == 0) {
+		LINK_STATS_INC(link.drop);
+		return ERR_BUF;
+	}
+
+	/* Build the scatter-gather list from the pbuf chain */
+	frame = p;
+	count = 0;
+	for (q = p; q != NULL; q = q->next) {
+		if (q->len == 0)
+			continue;
+		if (count == ETHIF_TX_SG_ENTRIES)
+			break;
+		sg[count].size = q->len;
+		sg[count].buffer = q->payload;
+		sg[count].next = NULL;
+		sg[count].release = NULL;
+		sg[count].release_arg = NULL;
+		count++;
+	}
+
+	if (q != NULL) {
+		/* Chain is too fragmented: flatten it into a single pbuf */
+		frame = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+		if (frame == NULL) {
+			LINK_STATS_INC(link.memerr);
+			LINK_STATS_INC(link.drop);
+			return ERR_MEM;
+		}
+		pbuf_copy(frame, p);
+		sg[0].size = frame->len;
+		sg[0].buffer = frame->payload;
+		sg[0].next = NULL;
+		sg[0].release = NULL;
+		sg[0].release_arg = NULL;
+		count = 1;
+	} else {
+		pbuf_ref(frame);
+	}
+
+	sgl.size = count;
+	sgl.entries = sg;
+
+	SYS_ARCH_PROTECT(lev);
+	rc = ethd_send_sg_nocopy(board_get_eth(netif->num), 0, &sgl, NULL);
+	if (rc == ETH_OK) {
+		tx->pbufs[tx->head] = frame;
+		tx->descs[tx->head] = count;
+		tx->pending += count;
+		RING_INC(tx->head, ETHIF_TX_FRAMES);
+	}
+	SYS_ARCH_UNPROTECT(lev);
+
+	if (rc != ETH_OK) {
+		pbuf_free(frame);
+		return ERR_BUF;
+	}
+
+	LINK_STATS_INC(link.xmit);
+	return ERR_OK;
 }
 
+#else /* !ETHIF_ZERO_COPY */
+
 /**
  * This function should do the actual transmission of the packet. The packet is
  * contained in the pbuf that is passed to the function. This pbuf
@@ -203,66 +634,131 @@ static err_t glow_level_output(struct netif *netif, struct pbuf *p)
 
 }
 
+#endif /* !ETHIF_ZERO_COPY */
+
 /**
- * Should allocate a pbuf and transfer the bytes of the incoming
- * packet from the interface into the pbuf.
+ * Copy a received frame into a pbuf chain allocated from the pool
  *
- * @param netif the lwip network interface structure for this ethif
- * @return a pbuf filled with the received packet (including MAC header)
- *         NULL on memory error
+ * @param frame the RX buffers holding the frame
+ * @param size the size of the frame
+ * @return the pbuf, NULL on memory error
  */
-static struct pbuf *glow_level_input(struct netif *netif)
+static struct pbuf *_ethif_rx_copy(const struct _eth_sg_list *frame, uint32_t size)
 {
-    struct pbuf *p, *q;
-    u16_t len;
-    uint8_t buf[1514];
-    uint8_t *bufptr = &buf[0];
-
-    uint32_t frmlen;
-    uint8_t rc;
+	struct pbuf *p;
+	u16_t offset;
+	uint32_t i;
 
-    /* Obtain the size of the packet and put it into the "len"
-       variable. */
-    rc = ethd_poll(board_get_eth(netif->num), 0, buf, (uint32_t)sizeof(buf), (uint32_t*)&frmlen);
-    if (rc != ETH_OK)
-    {
-      return NULL;
-    }
-    len = frmlen;
+	/* We allocate a pbuf chain of pbufs from the pool. */
+	p = pbuf_alloc(PBUF_RAW, size + ETH_PAD_SIZE, PBUF_POOL);
+	if (p == NULL)
+		return NULL;
 
 #if ETH_PAD_SIZE
-    len += ETH_PAD_SIZE;      /* allow room for Ethernet padding */
+	pbuf_header(p, -ETH_PAD_SIZE);          /* drop the padding word */
 #endif
 
-    /* We allocate a pbuf chain of pbufs from the pool. */
-    p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+	offset = 0;
+	for (i = 0; i < frame->size; i++) {
+		pbuf_take_at(p, frame->entries[i].buffer,
+				frame->entries[i].size, offset);
+		offset += frame->entries[i].size;
+	}
 
-    if (p != NULL) {
 #if ETH_PAD_SIZE
-        pbuf_header(p, -ETH_PAD_SIZE);          /* drop the padding word */
-#endif
-        /* We iterate over the pbuf chain until we have read the entire
-         * packet into the pbuf. */
-        for(q = p; q != NULL; q = q->next) {
-            /* Read enough bytes to fill this pbuf in the chain. The
-             * available data in the pbuf is given by the q->len
-             * variable. */
-            /* read data into(q->payload, q->len); */
-            memcpy(q->payload, bufptr, q->len);
-            bufptr += q->len;
-        }
-        /* acknowledge that packet has been read(); */
+	pbuf_header(p, ETH_PAD_SIZE);           /* reclaim the padding word */
+#endif
 
-#if ETH_PAD_SIZE
-        pbuf_header(p, ETH_PAD_SIZE);           /* reclaim the padding word */
+	return p;
+}
+
+/**
+ * Should allocate a pbuf and transfer the bytes of the incoming
+ * packet from the interface into the pbuf.
+ *
+ * Invoked by ethd_rx_poll() for each received frame. In zero-copy mode, the
+ * RX buffers holding an IP frame are exchanged with spare buffers and
+ * wrapped into custom pbufs. Otherwise, or when lwIP still holds too many
+ * spare buffers, the data is copied from the RX buffers into pbufs from the
+ * pool, so that the RX ring never waits for the application.
+ *
+ * @param arg the lwip network interface structure for this ethif
+ * @param queue the RX queue
+ * @param frame the RX buffers holding the frame
+ * @param size the size of the frame
+ */
+static void glow_level_input(void *arg, uint8_t queue, struct _eth_sg_list *frame, uint32_t size)
+{
+	struct netif *netif = (struct netif *)arg;
+	struct pbuf *p = NULL;
+
+#if ETHIF_ZERO_COPY
+	p = _ethif_rx_swap(frame);
 #endif
-        LINK_STATS_INC(link.recv);
-    } else {
-        /* drop packet(); */
-        LINK_STATS_INC(link.memerr);
-        LINK_STATS_INC(link.drop);
-    }
-    return p;
+	if (p == NULL)
+		p = _ethif_rx_copy(frame, size);
+	if (p == NULL) {
+		/* drop packet(); */
+		LINK_STATS_INC(link.memerr);
+		LINK_STATS_INC(link.drop);
+		return;
+	}
+
+	if (!_ethif_rx_checksum_ok(netif, p,
+			ethd_get_rx_status(board_get_eth(netif->num), queue))) {
+		LINK_STATS_INC(link.chkerr);
+		LINK_STATS_INC(link.drop);
+		pbuf_free(p);
+		return;
+	}
+	LINK_STATS_INC(link.recv);
+
+	ethif_input(netif, queue, p);
+}
+
+/**
+ * RX interrupt callbacks, one per interface. The RX queues are in polling
+ * mode: the RX interrupt stays masked until ethd_rx_poll() finds the queue
+ * empty.
+ */
+static void _ethif_rx_callback0(uint8_t queue, uint32_t status)
+{
+	_rx_pending[0][queue] = true;
+}
+
+#if ETH_IFACE_COUNT > 1
+static void _ethif_rx_callback1(uint8_t queue, uint32_t status)
+{
+	_rx_pending[1][queue] = true;
+}
+#endif
+
+#if ETH_IFACE_COUNT > 2
+#error ethif only provides RX callbacks for two interfaces
+#endif
+
+static const ethd_callback_t _rx_callbacks[ETH_IFACE_COUNT] = {
+	_ethif_rx_callback0,
+#if ETH_IFACE_COUNT > 1
+	_ethif_rx_callback1,
+#endif
+};
+
+/**
+ * Process up to the budget of received frames on a RX queue signaled by the
+ * RX interrupt. The queue stays pending while the budget is exhausted.
+ */
+static void glow_level_poll(struct netif *netif, uint8_t queue)
+{
+	uint32_t budget = _rx_budgets[netif->num][queue];
+
+	if (!_rx_pending[netif->num][queue])
+		return;
+
+	_rx_pending[netif->num][queue] = false;
+	if (ethd_rx_poll(board_get_eth(netif->num), queue, budget,
+			glow_level_input, netif) == budget)
+		_rx_pending[netif->num][queue] = true;
 }
 
 /**
@@ -277,24 +773,26 @@ static err_t ethif_output(struct netif *netif, struct pbuf *p, ip4_addr_t *ipadd
     return etharp_output(netif, p, ipaddr);
 }
 /**
- * This function should be called when a packet is ready to be read
- * from the interface. It uses the function low_level_input() that
- * should handle the actual reception of bytes from the network
- * interface. Then the type of the received packet is determined and
+ * This function should be called when a packet has been read
+ * from the interface. The type of the received packet is determined and
  * the appropriate input function is called.
  *
+ * Frames received on a queue with a hook registered are first given to
+ * the hook, which may consume them.
+ *
  * @param netif the lwip network interface structure for this ethif
+ * @param queue the RX queue the packet has been received on
+ * @param p the received packet
  */
 
-static void ethif_input(struct netif *netif)
+static void ethif_input(struct netif *netif, uint8_t queue, struct pbuf *p)
 {
     struct eth_hdr *ethhdr;
-    struct pbuf *p;
+    ethif_rx_hook_t hook = _rx_hooks[netif->num][queue];
+
+    if (hook && hook(netif, queue, p))
+        return;
 
-    /* move received packet into a new pbuf */
-    p = glow_level_input(netif);
-    /* no packet could be read, silently ignore this */
-    if (p == NULL) return;
     /* points to packet payload, which starts with an Ethernet header */
     ethhdr = p->payload;
 
@@ -331,24 +829,98 @@ static void ethif_input(struct netif *netif)
  */
 err_t ethif_init(struct netif *netif)
 {
+	struct _ethd* ethd = board_get_eth(netif->num);
+	int i;
+
 	netif->name[0] = IFNAME0;
 	netif->name[1] = IFNAME1;
 	netif->output = (netif_output_fn) ethif_output;
 	netif->linkoutput = glow_level_output;
-	glow_level_init(netif, board_get_eth(netif->num));
+	glow_level_init(netif, ethd);
+#if ETHIF_ZERO_COPY
+	_ethif_rx_pool_init();
+#endif
 	etharp_init();
+
+	/* Serve the RX queues when the RX interrupt signals them, starting
+	 * with the frames received before the interrupt is enabled */
+	for (i = 0; i < ETHIF_RX_QUEUES; i++) {
+		_rx_budgets[netif->num][i] = ETHIF_RX_BUDGET;
+		_rx_pending[netif->num][i] = true;
+		ethd_set_rx_polling(ethd, i, true);
+		ethd_set_rx_callback(ethd, i, _rx_callbacks[netif->num]);
+	}
 	return ERR_OK;
 }
 
 /**
  * Polling task
- * Should be called periodically
+ * Should be called periodically. Runs the lwIP timers and processes the
+ * frames of the RX queues signaled by the RX interrupt, see
+ * ethif_rx_pending().
  *
  */
 void ethif_poll(struct netif *netif)
 {
+	int queue;
+
 	/* Run periodic tasks */
 	timers_update();
 
-	ethif_input(netif);
+#if ETHIF_ZERO_COPY
+	/* Release the frames sent since the last call */
+	_ethif_tx_reclaim(netif);
+#endif
+
+	/* Serve the priority queues first so that the frames steered to them
+	 * are not delayed by the bulk traffic received on queue 0 */
+	for (queue = ETHIF_RX_QUEUES - 1; queue >= 0; queue--)
+		glow_level_poll(netif, queue);
+}
+
+/**
+ * Tell whether received frames are waiting for ethif_poll(). Once it returns
+ * false, the caller may sleep until the next interrupt: the RX interrupt is
+ * re-armed and signals the next frame.
+ *
+ * @param netif the lwip network interface structure for this ethif
+ * @return true if a RX queue must be polled
+ */
+bool ethif_rx_pending(struct netif *netif)
+{
+	int queue;
+
+	for (queue = 0; queue < ETHIF_RX_QUEUES; queue++)
+		if (_rx_pending[netif->num][queue])
+			return true;
+	return false;
+}
+
+/**
+ * Set the maximum number of frames processed on a RX queue by each
+ * ethif_poll() call
+ *
+ * @param netif the lwip network interface structure for this ethif
+ * @param queue the RX queue
+ * @param budget the number of frames
+ */
+void ethif_set_rx_budget(struct netif *netif, uint8_t queue, uint32_t budget)
+{
+	if (queue < ETHIF_RX_QUEUES)
+		_rx_budgets[netif->num][queue] = budget;
+}
+
+/**
+ * Register a hook invoked for each frame received on a RX queue, before the
+ * frame is given to lwIP. If the hook returns true, it takes ownership of the
+ * pbuf and the frame is not processed further.
+ *
+ * @param netif the lwip network interface structure for this ethif
+ * @param queue the RX queue
+ * @param hook the hook, or NULL to remove it
+ */
+void ethif_set_rx_hook(struct netif *netif, uint8_t queue, ethif_rx_hook_t hook)
+{
+	if (queue < ETHIF_RX_QUEUES)
+		_rx_hooks[netif->num][queue] = hook;
 }
@@ -38,6 +38,8 @@
 
 #include "usb/device/msd/msd_io_fifo.h"
 
+#include "intmath.h"
+
 /*------------------------------------------------------------------------------
  *         Internal variables
  *------------------------------------------------------------------------------*/
@@ -72,4 +74,49 @@ void msd_io_fifo_init(MSDIOFifo *p_fifo,
 	p_fifo->nullCnt = 0;
 }
 
+/**
+ * \brief  Splits the buffer of a MSDIOFifo instance in chunks for a new
+ *         command, and resets its indexes and statistics.
+ *
+ *         The buffer is split in MSDIO_FIFO_SLOTS chunks (or more, for short
+ *         commands), so that the media transfer of one chunk overlaps the
+ *         USB transfer of another one. The chunk size is a multiple of the
+ *         preferred transfer size of the media.
+ * \param  p_fifo         Pointer to a MSDIOFifo instance, with dataTotal and
+ *                        blockSize set for the command
+ * \param  max_chunk_size Maximum size of a chunk in bytes
+ * \param  unit_size      Preferred media transfer size in bytes
+ */
+void msd_io_fifo_setup(MSDIOFifo *p_fifo,
+					unsigned int max_chunk_size, unsigned int unit_size)
+{
+	unsigned int block_size = p_fifo->blockSize;
+	unsigned int unit, chunk;
+
+	/* Transfer unit, in whole blocks */
+	unit = max_u32(unit_size, block_size);
+	unit = ((unit + block_size - 1) / block_size) * block_size;
+	if (unit > p_fifo->bufferSize)
+		unit = block_size;
+
+	chunk = min_u32(p_fifo->bufferSize / MSDIO_FIFO_SLOTS, max_chunk_size);
+	/* Keep at least two chunks per command, unless too small */
+	chunk = min_u32(chunk, max_u32(p_fifo->dataTotal / 2,
+				MSDIO_MIN_CHUNK_SIZE));
+	chunk -= chunk % unit;
+	if (chunk < unit)
+		chunk = unit;
+
+	p_fifo->chunkSize = chunk;
+	p_fifo->numSlots = p_fifo->bufferSize / chunk;
+
+	p_fifo->inputNdx = 0;
+	p_fifo->outputNdx = 0;
+	p_fifo->inputTotal = 0;
+	p_fifo->outputTotal = 0;
+
+	p_fifo->fullCnt = 0;
+	p_fifo->nullCnt = 0;
+}
+
 /**@}*/
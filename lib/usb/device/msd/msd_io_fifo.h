@@ -64,12 +64,25 @@
 /*#define MSDIO_FIFO_OFFSET   (4*512) */
 
 
-/** FIFO trunk size (in each transfer, large amount of data) */
-#if !defined(MSD_OP_BUFFER)
+/** Number of slots of the FIFO ring buffer: the media side loads or
+ * stores a slot while the USB side transfers another one */
+#ifndef MSDIO_FIFO_SLOTS
+#define MSDIO_FIFO_SLOTS            4
+#endif
+
+/** Maximum FIFO chunk size (one media or USB transfer) */
+#ifndef MSDIO_READ10_CHUNK_SIZE
 #define MSDIO_READ10_CHUNK_SIZE     (128 * 512)
+#endif
+#ifndef MSDIO_WRITE10_CHUNK_SIZE
 #define MSDIO_WRITE10_CHUNK_SIZE    (128 * 512)
 #endif
 
+/** Minimum FIFO chunk size when a command is split over several slots */
+#ifndef MSDIO_MIN_CHUNK_SIZE
+#define MSDIO_MIN_CHUNK_SIZE        (16 * 512)
+#endif
+
 /*------------------------------------------------------------------------------
  *         Types
  *------------------------------------------------------------------------------*/
@@ -98,11 +111,10 @@ typedef struct _MSDIOFifo {
 	unsigned int    dataTotal;
 	/** The size of the block in bytes */
 	unsigned short  blockSize;
-#if  defined(MSDIO_READ10_CHUNK_SIZE) || defined(MSDIO_WRITE10_CHUNK_SIZE)
-	/** The size of one chunk */
-	/** (1 block, or several blocks for large amount data R/W) */
+	/** The size of one chunk (slot of the ring, several blocks) */
 	unsigned int    chunkSize;
-#endif
+	/** The number of chunks in the ring */
+	unsigned int    numSlots;
 	/** State of input & output */
 	unsigned char   inputState;
 	unsigned char   outputState;
@@ -129,6 +141,21 @@ typedef struct _MSDIOFifo {
 	if ((ndx) >= (bufSize) - (sectSize)) (ndx) = 0; \
 	else (ndx) += (sectSize)
 
+/*------------------------------------------------------------------------------
+ * Size of the part of the ring buffer used by the chunks
+ * \param fifo         Pointer to the MSDIOFifo instance
+ *------------------------------------------------------------------------------*/
+#define MSDIOFifo_RingSize(fifo) ((fifo)->numSlots * (fifo)->chunkSize)
+
+/*------------------------------------------------------------------------------
+ * Size of the next chunk to transfer
+ * \param fifo         Pointer to the MSDIOFifo instance
+ * \param total        Size already transferred (inputTotal or outputTotal)
+ *------------------------------------------------------------------------------*/
+#define MSDIOFifo_ChunkSize(fifo, total) \
+	(((fifo)->dataTotal - (total)) < (fifo)->chunkSize ? \
+	 ((fifo)->dataTotal - (total)) : (fifo)->chunkSize)
+
 
 /*------------------------------------------------------------------------------
  *         Exported Functions
@@ -138,6 +165,9 @@ typedef struct _MSDIOFifo {
 extern void msd_io_fifo_init(MSDIOFifo *pFifo,
 						   void * pBuffer, unsigned int bufferSize);
 
+extern void msd_io_fifo_setup(MSDIOFifo *pFifo,
+						   unsigned int maxChunkSize, unsigned int unitSize);
+
 /**@}*/
 
 #endif /* _MSDIOFIFO_H */
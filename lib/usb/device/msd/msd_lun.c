@@ -36,6 +36,7 @@
  *------------------------------------------------------------------------------*/
 
 #include "trace.h"
+#include "intmath.h"
 
 #include "libstoragemedia/media.h"
 
@@ -183,6 +184,13 @@ void lun_init(MSDLun    *lun,
 	STORE_DWORDB(0, lun->readCapacityData->pLogicalBlockAddress);
 	STORE_DWORDB(0, lun->readCapacityData->pLogicalBlockLength);
 
+	/* Initialize background operations and statistics */
+
+	lun->bgState = LUN_BG_IDLE;
+	lun->bgError = 0;
+	lun->nextReadAddress = 0;
+	memset(&lun->stats, 0, sizeof(lun->stats));
+
 	/* Initialize LUN */
 
 	lun->media = media;
@@ -249,6 +257,10 @@ uint32_t lun_eject(MSDLun *lun)
 			return USBD_STATUS_LOCKED;
 		}
 
+		if (lun->bgState == LUN_BG_WRITE)
+			trace_warning("lun_eject: Background write lost\n\r");
+		lun->bgState = LUN_BG_IDLE;
+
 		/* Remove the link of the media */
 		lun->media = 0;
 	}
@@ -412,4 +424,147 @@ uint32_t lun_read(MSDLun        *lun,
 	return status;
 }
 
+/**
+ * \brief  Starts reading ahead data in the LUN FIFO buffer, in background
+ *         (see lun_background). The data is used by a READ (10) starting at
+ *         the same block address, see lun_prefetch_claim.
+ * \param  lun          Pointer to a MSDLun instance
+ * \param  block_address First block address to read
+ * \param  size         Number of bytes to read (limited to the FIFO buffer)
+ */
+void lun_prefetch(MSDLun *lun, uint32_t block_address, uint32_t size)
+{
+	MSDIOFifo *fifo = &lun->ioFifo;
+	const uint32_t lun_blk_cnt = lun->size / lun->blockSize;
+
+	if (lun->bgState != LUN_BG_IDLE || lun->media == 0
+	    || media_is_mapped_read_supported(lun->media)
+	    || block_address >= lun_blk_cnt)
+		return;
+
+	size = min_u32(size, fifo->bufferSize);
+	size = min_u32(size, (lun_blk_cnt - block_address) * fifo->blockSize);
+	size -= size % fifo->blockSize;
+	if (size == 0)
+		return;
+
+	lun->bgState = LUN_BG_PREFETCH;
+	lun->bgAddress = block_address;
+	lun->bgTotal = 0;
+	lun->bgTarget = size;
+}
+
+/**
+ * \brief  Stops the read ahead of a LUN and returns the number of bytes
+ *         already read if they start at the given block address.
+ * \param  lun          Pointer to a MSDLun instance
+ * \param  block_address First block address of the READ (10) command, or
+ *                      0xFFFFFFFF to discard the data read ahead
+ * \return Number of bytes available at the start of the FIFO buffer
+ */
+uint32_t lun_prefetch_claim(MSDLun *lun, uint32_t block_address)
+{
+	uint32_t size = 0;
+
+	if (lun->bgState != LUN_BG_PREFETCH && lun->bgState != LUN_BG_PREFETCHED)
+		return 0;
+
+	if (lun->bgAddress == block_address) {
+		size = lun->bgTotal;
+		lun->stats.prefetchHits += size;
+	}
+	lun->bgState = LUN_BG_IDLE;
+
+	return size;
+}
+
+/**
+ * \brief  Hands the end of a WRITE (10) command over to the background
+ *         operations: the FIFO data not written yet is written by
+ *         lun_background.
+ * \param  lun          Pointer to a MSDLun instance
+ * \param  block_address Block address of the next data to write
+ */
+void lun_write_behind(MSDLun *lun, uint32_t block_address)
+{
+	MSDIOFifo *fifo = &lun->ioFifo;
+
+	if (fifo->outputTotal >= fifo->dataTotal)
+		return;
+
+	lun->bgState = LUN_BG_WRITE;
+	lun->bgAddress = block_address;
+}
+
+/**
+ * \brief  Performs one step of the background operation of a LUN, i.e.
+ *         transfers one FIFO chunk between the FIFO buffer and the media.
+ *         Must not be invoked while a command is processed on the LUN, or on
+ *         a LUN sharing its FIFO buffer.
+ * \param  lun          Pointer to a MSDLun instance
+ * \return true if a media transfer was done
+ */
+bool lun_background(MSDLun *lun)
+{
+	MSDIOFifo *fifo = &lun->ioFifo;
+	uint32_t size;
+
+	switch (lun->bgState) {
+	case LUN_BG_PREFETCH:
+		size = min_u32(fifo->chunkSize, lun->bgTarget - lun->bgTotal);
+		if (lun_read(lun, lun->bgAddress + lun->bgTotal / fifo->blockSize,
+				&fifo->pBuffer[lun->bgTotal], size / fifo->blockSize,
+				NULL, NULL) != USBD_STATUS_SUCCESS) {
+			/* Keep the data already read */
+			lun->bgState = LUN_BG_PREFETCHED;
+			return true;
+		}
+		lun->bgTotal += size;
+		lun->stats.prefetchBytes += size;
+		if (lun->bgTotal >= lun->bgTarget)
+			lun->bgState = LUN_BG_PREFETCHED;
+		return true;
+
+	case LUN_BG_WRITE:
+		size = MSDIOFifo_ChunkSize(fifo, fifo->outputTotal);
+		if (lun_write(lun, lun->bgAddress, &fifo->pBuffer[fifo->outputNdx],
+				size / fifo->blockSize, NULL, NULL) != USBD_STATUS_SUCCESS) {
+			trace_warning("lun_background: Failed to write\n\r");
+			lun->bgError = 1;
+			lun->bgState = LUN_BG_IDLE;
+			return true;
+		}
+		lun->bgAddress += size / fifo->blockSize;
+		MSDIOFifo_IncNdx(fifo->outputNdx, fifo->chunkSize,
+				MSDIOFifo_RingSize(fifo));
+		fifo->outputTotal += size;
+		lun->stats.deferredBytes += size;
+		if (fifo->outputTotal >= fifo->dataTotal)
+			lun->bgState = LUN_BG_IDLE;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * \brief  Retrieves the LUN statistics.
+ * \param  lun          Pointer to a MSDLun instance
+ * \param  stats        Pointer to the structure filled with the statistics
+ */
+void lun_get_stats(MSDLun *lun, MSDLunStats *stats)
+{
+	*stats = lun->stats;
+}
+
+/**
+ * \brief  Clears the LUN statistics.
+ * \param  lun          Pointer to a MSDLun instance
+ */
+void lun_reset_stats(MSDLun *lun)
+{
+	memset(&lun->stats, 0, sizeof(lun->stats));
+}
+
 /**@}*/
@@ -53,6 +53,7 @@
  *         Headers
  *------------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "chip.h"
@@ -81,6 +82,28 @@
 /** Media of LUN is ready */
 #define LUN_READY                   0x11
 
+/** LUN background operation: none */
+#define LUN_BG_IDLE                 0x00
+/** LUN background operation: reading ahead after sequential READ (10) */
+#define LUN_BG_PREFETCH             0x01
+/** LUN background operation: data read ahead, waiting for READ (10) */
+#define LUN_BG_PREFETCHED           0x02
+/** LUN background operation: writing the end of a WRITE (10) */
+#define LUN_BG_WRITE                0x03
+
+/** Read ahead the data following sequential READ (10) commands in the LUN
+ * FIFO, while the driver is idle or serves another LUN */
+#ifndef MSD_LUN_PREFETCH
+#define MSD_LUN_PREFETCH            1
+#endif
+
+/** Complete WRITE (10) commands once all their data is received, the end of
+ * the media write being done in background. A write error is then reported
+ * by the next command of the LUN. */
+#ifndef MSD_LUN_WRITE_BEHIND
+#define MSD_LUN_WRITE_BEHIND        0
+#endif
+
 #define MSD_LUN_DATA_BUFFER_SIZE (L1_CACHE_BYTES +\
 	ROUND_UP_MULT(sizeof(SBCRequestSenseData), L1_CACHE_BYTES) +\
 	ROUND_UP_MULT(sizeof(SBCReadCapacity10Data), L1_CACHE_BYTES) +\
@@ -106,6 +129,24 @@ typedef void(*MSDLunDataMonitorFunction)(uint8_t  flowDirection,
  *      Structures
  *------------------------------------------------------------------------------*/
 
+/** \brief LUN statistics, to compute the LUN throughput */
+typedef struct {
+	/** Number of READ (10) commands completed */
+	uint32_t readCommands;
+	/** Number of WRITE (10) commands completed */
+	uint32_t writeCommands;
+	/** Bytes sent to the host */
+	uint32_t bytesRead;
+	/** Bytes received from the host */
+	uint32_t bytesWritten;
+	/** Bytes read ahead in background */
+	uint32_t prefetchBytes;
+	/** Bytes read ahead and sent to the host */
+	uint32_t prefetchHits;
+	/** Bytes written to the media in background */
+	uint32_t deferredBytes;
+} MSDLunStats;
+
 /** \brief LUN structure */
 typedef struct {
 	/** Fifo for USB transfer, must be assigned. */
@@ -133,6 +174,20 @@ typedef struct {
 	uint8_t               readonly;
 	/** The LUN status (Ejected/Changed/) */
 	uint8_t               status;
+	/** Background operation on the LUN FIFO (LUN_BG_xxx) */
+	uint8_t               bgState;
+	/** A background write failed, to report on the next command */
+	uint8_t               bgError;
+	/** Next block address of the background operation */
+	uint32_t              bgAddress;
+	/** Prefetch: bytes loaded at the start of the FIFO buffer */
+	uint32_t              bgTotal;
+	/** Prefetch: bytes to load */
+	uint32_t              bgTarget;
+	/** Block address following the last READ (10) */
+	uint32_t              nextReadAddress;
+	/** Statistics */
+	MSDLunStats           stats;
 
 	uint8_t               dataBuffer[MSD_LUN_DATA_BUFFER_SIZE];
 	/** Pointer to a SBCRequestSenseData instance. */
@@ -181,6 +236,19 @@ extern uint32_t lun_read(MSDLun             *lun,
 					  usbd_xfer_cb_t   callback,
 					  void               *argument);
 
+extern void lun_prefetch(MSDLun *lun, uint32_t block_address,
+					 uint32_t size);
+
+extern uint32_t lun_prefetch_claim(MSDLun *lun, uint32_t block_address);
+
+extern void lun_write_behind(MSDLun *lun, uint32_t block_address);
+
+extern bool lun_background(MSDLun *lun);
+
+extern void lun_get_stats(MSDLun *lun, MSDLunStats *stats);
+
+extern void lun_reset_stats(MSDLun *lun);
+
 /**@}*/
 
 #endif /*#ifndef MSDLUN_H */
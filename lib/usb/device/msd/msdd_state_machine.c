@@ -249,6 +249,35 @@ static bool msdd_postprocess_command(MSDDriver *driver)
 	return has_halted;
 }
 
+/**
+ * Stops the background operations of the other LUNs sharing the FIFO buffer
+ * of a LUN, before a command on this LUN overwrites the buffer: their write
+ * behind is finished, one chunk per call, and their data read ahead is
+ * discarded.
+ * \param  driver Pointer to a MSDDriver instance
+ * \param  lun    Pointer to the MSDLun instance of the command
+ * \return true if a background write is still in progress
+ */
+static bool msdd_release_shared_buffer(MSDDriver *driver, MSDLun *lun)
+{
+	MSDLun *other;
+	uint8_t i;
+
+	for (i = 0; i <= driver->maxLun; i++) {
+		other = &(driver->luns[i]);
+		if (other == lun || other->ioFifo.pBuffer != lun->ioFifo.pBuffer)
+			continue;
+
+		if (other->bgState == LUN_BG_WRITE) {
+			lun_background(other);
+			return true;
+		}
+		lun_prefetch_claim(other, 0xFFFFFFFF);
+	}
+
+	return false;
+}
+
 /**
  * Processes the latest command received by the %device.
  * \param  driver Pointer to a MSDDriver instance
@@ -274,7 +303,29 @@ static unsigned char msdd_process_command(MSDDriver * driver)
 			LIBUSB_TRACE("LUN%d ", cbw->bCBWLUN);
 		}
 
-		status = sbc_process_command(lun, command_state);
+		if (command_state->state == 0
+		    && msdd_release_shared_buffer(driver, lun))
+			return false;
+
+		if (command_state->state == 0 && lun->bgState == LUN_BG_WRITE) {
+			/* Finish the background write before a new command */
+			lun_background(lun);
+			return false;
+		}
+
+		if (command_state->state == 0 && lun->bgError) {
+			/* Report the failure of the background write */
+			lun->bgError = 0;
+			sbc_update_sense_data(lun->requestSenseData,
+					SBC_SENSE_KEY_MEDIUM_ERROR,
+					SBC_ASC_WRITE_ERROR, 0);
+			if (cbw->pCommand[0] != SBC_REQUEST_SENSE)
+				status = MSDD_STATUS_RW;
+			else
+				status = sbc_process_command(lun, command_state);
+		} else {
+			status = sbc_process_command(lun, command_state);
+		}
 	}
 
 	/* Check command result code */
@@ -366,6 +417,40 @@ static unsigned char msdd_process_command(MSDDriver * driver)
 	return command_complete;
 }
 
+/**
+ * Runs one step of the background operations of the LUNs (read ahead,
+ * write behind), in round robin order. The LUN of the command being
+ * processed, and the LUNs sharing its FIFO buffer, are skipped, so that
+ * the media of the other LUNs work while the command waits for USB.
+ * \param  driver Pointer to a MSDDriver instance
+ */
+static void msdd_run_background(MSDDriver *driver)
+{
+	MSDCommandState *command_state = &(driver->commandState);
+	MSCbw           *cbw = &(command_state->cbw);
+	MSDLun          *busy = NULL;
+	MSDLun          *lun;
+	uint8_t         i, lun_ix;
+
+	if (driver->state == MSDD_STATE_PROCESS_CBW
+	    && cbw->bCBWLUN <= driver->maxLun)
+		busy = &(driver->luns[(uint8_t)cbw->bCBWLUN]);
+
+	for (i = 1; i <= driver->maxLun + 1; i++) {
+		lun_ix = (driver->backgroundLun + i) % (driver->maxLun + 1);
+		lun = &(driver->luns[lun_ix]);
+
+		if (busy && (lun == busy
+		    || lun->ioFifo.pBuffer == busy->ioFifo.pBuffer))
+			continue;
+
+		if (lun_background(lun)) {
+			driver->backgroundLun = lun_ix;
+			break;
+		}
+	}
+}
+
 /**
  * State machine for the MSD %device driver
  * \param  driver Pointer to a MSDDriver instance
@@ -520,6 +605,9 @@ void msdd_state_machine(MSDDriver * driver)
 		}
 		break;
 	}
+
+	/* Let the other LUNs work while waiting for the host */
+	msdd_run_background(driver);
 }
 
 /**@}*/
@@ -215,6 +215,8 @@ typedef struct _MSDDriver {
 	uint8_t state;
 	/** Indicates if the driver is waiting for a reset recovery */
 	uint8_t waitResetRecovery;
+	/** Index of the LUN which last ran a background operation */
+	uint8_t backgroundLun;
 } MSDDriver;
 
 /*-----------------------------------------------------------------------------
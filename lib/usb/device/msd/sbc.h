@@ -271,6 +271,7 @@
  *
  * \section Additional Codes
  * - SBC_ASC_LOGICAL_UNIT_NOT_READY
+ * - SBC_ASC_WRITE_ERROR
  * - SBC_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE
  * - SBC_ASC_INVALID_FIELD_IN_CDB
  * - SBC_ASC_WRITE_PROTECTED
@@ -282,6 +283,7 @@
  */
 
 #define SBC_ASC_LOGICAL_UNIT_NOT_READY                0x04
+#define SBC_ASC_WRITE_ERROR                           0x0C
 #define SBC_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE    0x21
 #define SBC_ASC_INVALID_FIELD_IN_CDB                  0x24
 #define SBC_ASC_WRITE_PROTECTED                       0x27
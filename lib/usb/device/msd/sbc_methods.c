@@ -161,7 +161,7 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 	MSDTransfer *transfer = &(command_state->transfer);
 	MSDTransfer *disktransfer = &(command_state->disktransfer);
 	MSDIOFifo *fifo = &lun->ioFifo;
-	uint32_t lba, old_chunk_size, new_chunk_size;
+	uint32_t lba, size;
 
 	/* Init command state */
 	if (command_state->state == 0) {
@@ -176,28 +176,27 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 			fifo->dataTotal = command_state->length;
 			fifo->blockSize = lun->blockSize *
 				media_get_block_size(lun->media);
-#ifdef MSDIO_WRITE10_CHUNK_SIZE
-			fifo->chunkSize = max_u32(fifo->blockSize,
-						  MSDIO_WRITE10_CHUNK_SIZE);
-#endif
-			fifo->fullCnt = 0;
-			fifo->nullCnt = 0;
+			msd_io_fifo_setup(fifo, MSDIO_WRITE10_CHUNK_SIZE,
+					media_get_optimal_length(lun->media) *
+					media_get_block_size(lun->media));
+
+			/* Discard the data read ahead in the FIFO */
+			lun_prefetch_claim(lun, 0xFFFFFFFF);
 
 			/* Initialize FIFO output (Disk) */
-			fifo->outputNdx = 0;
-			fifo->outputTotal = 0;
 			fifo->outputState = MSDIO_IDLE;
 			transfer->semaphore = 0;
 
 			/* Initialize FIFO input (USB) */
-			fifo->inputNdx = 0;
-			fifo->inputTotal = 0;
 			fifo->inputState = MSDIO_START;
 			disktransfer->semaphore = 0;
 		}
 	}
 
 	if (command_state->length == 0) {
+		lun->stats.writeCommands++;
+		lun->stats.bytesWritten += fifo->dataTotal;
+
 		/* Perform the callback! */
 		if (lun->dataMonitor) {
 			lun->dataMonitor(0, fifo->dataTotal, fifo->nullCnt, fifo->fullCnt);
@@ -205,17 +204,12 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 		return MSDD_STATUS_SUCCESS;
 	}
 
-	old_chunk_size = fifo->chunkSize;
-	if ((fifo->dataTotal - fifo->inputTotal) < fifo->chunkSize) {
-		new_chunk_size = fifo->dataTotal - fifo->inputTotal;
-		fifo->chunkSize = new_chunk_size;
-	}
-
 	/* USB receive task */
 	switch(fifo->inputState) {
 	case MSDIO_IDLE:
 		if (fifo->inputTotal < fifo->dataTotal &&
-				fifo->inputTotal - fifo->outputTotal < fifo->bufferSize) {
+				fifo->inputTotal - fifo->outputTotal <
+				MSDIOFifo_RingSize(fifo)) {
 			fifo->inputState = MSDIO_START;
 		}
 		break;
@@ -248,16 +242,11 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 						msd_driver_callback, transfer);
 			}
 		} else {
-			/* Read block to buffer */
-#ifdef MSDIO_WRITE10_CHUNK_SIZE
+			/* Read chunk to buffer */
 			status = usbd_read(command_state->pipeOUT,
-					&fifo->pBuffer[fifo->inputNdx], fifo->chunkSize,
-					msd_driver_callback, transfer);
-#else
-			status = usbd_read(command_state->pipeOUT,
-					&fifo->pBuffer[fifo->inputNdx], fifo->blockSize,
+					&fifo->pBuffer[fifo->inputNdx],
+					MSDIOFifo_ChunkSize(fifo, fifo->inputTotal),
 					msd_driver_callback, transfer);
-#endif
 		}
 
 		/* Check operation result code */
@@ -300,15 +289,10 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 				fifo->inputState = MSDIO_IDLE;
 			} else {
 				/* Update input index */
-#ifdef MSDIO_WRITE10_CHUNK_SIZE
+				size = MSDIOFifo_ChunkSize(fifo, fifo->inputTotal);
 				MSDIOFifo_IncNdx(fifo->inputNdx, fifo->chunkSize,
-						fifo->bufferSize);
-				fifo->inputTotal += fifo->chunkSize;
-#else
-				MSDIOFifo_IncNdx(fifo->inputNdx, fifo->blockSize,
-						fifo->bufferSize);
-				fifo->inputTotal += fifo->blockSize;
-#endif
+						MSDIOFifo_RingSize(fifo));
+				fifo->inputTotal += size;
 
 				/* Start Next block */
 
@@ -317,7 +301,8 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 					fifo->inputState = MSDIO_IDLE;
 				}
 				/* - Buffer full? */
-				else if (fifo->inputNdx == fifo->outputNdx) {
+				else if (fifo->inputTotal - fifo->outputTotal >=
+						MSDIOFifo_RingSize(fifo)) {
 					fifo->inputState = MSDIO_IDLE;
 					fifo->fullCnt++;
 					LIBUSB_TRACE("ufFull%d ", fifo->inputNdx);
@@ -338,11 +323,17 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 	}
 
 	/* Disk write task */
-	fifo->chunkSize = old_chunk_size;
-	if ((fifo->dataTotal - fifo->outputTotal) < fifo->chunkSize) {
-		new_chunk_size = fifo->dataTotal - fifo->outputTotal;
-		fifo->chunkSize = new_chunk_size;
+#if MSD_LUN_WRITE_BEHIND
+	/* All data received, finish writing the media in background */
+	if (fifo->inputTotal >= fifo->dataTotal &&
+	    !media_is_mapped_write_supported(lun->media) &&
+	    (fifo->outputState == MSDIO_IDLE ||
+	     fifo->outputState == MSDIO_START)) {
+		lun_write_behind(lun, DWORDB(command->pLogicalBlockAddress));
+		command_state->length = 0;
+		return result;
 	}
+#endif
 
 	switch(fifo->outputState) {
 	case MSDIO_IDLE:
@@ -357,16 +348,11 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 			msd_driver_callback(disktransfer, MEDIA_STATUS_SUCCESS, 0, 0);
 			status = LUN_STATUS_SUCCESS;
 		} else {
-#ifdef MSDIO_WRITE10_CHUNK_SIZE
 			status = lun_write(lun, DWORDB(command->pLogicalBlockAddress),
 					&fifo->pBuffer[fifo->outputNdx],
-					fifo->chunkSize / fifo->blockSize,
-					msd_driver_callback, disktransfer);
-#else
-			status = lun_write(lun, DWORDB(command->pLogicalBlockAddress),
-					&fifo->pBuffer[fifo->outputNdx], 1,
+					MSDIOFifo_ChunkSize(fifo, fifo->outputTotal)
+					/ fifo->blockSize,
 					msd_driver_callback, disktransfer);
-#endif
 		}
 
 		/* Check operation result code */
@@ -398,7 +384,7 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 
 	case MSDIO_NEXT:
 		/* Check operation result code */
-		if (transfer->status != USBD_STATUS_SUCCESS) {
+		if (disktransfer->status != USBD_STATUS_SUCCESS) {
 			trace_warning("RBC_Write10: Failed to write\n\r");
 			sbc_update_sense_data(lun->requestSenseData,
 					SBC_SENSE_KEY_RECOVERED_ERROR,
@@ -416,18 +402,12 @@ static uint8_t sbc_write10(MSDLun *lun, MSDCommandState *command_state)
 				fifo->outputState = MSDIO_IDLE;
 			} else {
 				/* Update output index */
+				size = MSDIOFifo_ChunkSize(fifo, fifo->outputTotal);
 				lba = DWORDB(command->pLogicalBlockAddress);
-#ifdef MSDIO_WRITE10_CHUNK_SIZE
-				lba += fifo->chunkSize / fifo->blockSize;
+				lba += size / fifo->blockSize;
 				MSDIOFifo_IncNdx(fifo->outputNdx, fifo->chunkSize,
-						fifo->bufferSize);
-				fifo->outputTotal += fifo->chunkSize;
-#else
-				lba++;
-				MSDIOFifo_IncNdx(fifo->outputNdx, fifo->blockSize,
-						fifo->bufferSize);
-				fifo->outputTotal += fifo->blockSize;
-#endif
+						MSDIOFifo_RingSize(fifo));
+				fifo->outputTotal += size;
 				STORE_DWORDB(lba, command->pLogicalBlockAddress);
 
 				/* Start Next block */
@@ -481,7 +461,7 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 	MSDTransfer *transfer = &(command_state->transfer);
 	MSDTransfer *disktransfer = &(command_state->disktransfer);
 	MSDIOFifo   *fifo = &lun->ioFifo;
-	uint32_t lba, old_chunk_size, new_chunk_size;
+	uint32_t lba, size;
 
 	/* Init command state */
 	if (command_state->state == 0) {
@@ -496,12 +476,9 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 			fifo->dataTotal = command_state->length;
 			fifo->blockSize = lun->blockSize *
 				media_get_block_size(lun->media);
-#ifdef MSDIO_READ10_CHUNK_SIZE
-			fifo->chunkSize = max_u32(fifo->blockSize,
-						  MSDIO_READ10_CHUNK_SIZE);
-#endif
-			fifo->fullCnt = 0;
-			fifo->nullCnt = 0;
+			msd_io_fifo_setup(fifo, MSDIO_READ10_CHUNK_SIZE,
+					media_get_optimal_length(lun->media) *
+					media_get_block_size(lun->media));
 
 #ifdef MSDIO_FIFO_OFFSET
 			/* Enable offset if total size >= 2*bufferSize */
@@ -512,21 +489,47 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 #endif
 
 			/* Initialize FIFO output (USB) */
-			fifo->outputNdx = 0;
-			fifo->outputTotal = 0;
 			fifo->outputState = MSDIO_IDLE;
 			transfer->semaphore = 0;
 
 			/* Initialize FIFO input (Disk) */
-			fifo->inputNdx = 0;
-			fifo->inputTotal = 0;
 			fifo->inputState = MSDIO_START;
 			disktransfer->semaphore = 0;
+
+			/* Use the data read ahead, by whole chunks */
+			lba = DWORDB(command->pLogicalBlockAddress);
+			size = min_u32(lun_prefetch_claim(lun, lba),
+					MSDIOFifo_RingSize(fifo));
+			if (size >= fifo->dataTotal)
+				size = fifo->dataTotal;
+			else
+				size -= size % fifo->chunkSize;
+			if (size) {
+				LIBUSB_TRACE("dPre%u ", (unsigned)size);
+				fifo->inputTotal = size;
+				fifo->inputNdx = (size / fifo->chunkSize) %
+					fifo->numSlots * fifo->chunkSize;
+				STORE_DWORDB(lba + size / fifo->blockSize,
+						command->pLogicalBlockAddress);
+				if (size >= fifo->dataTotal)
+					fifo->inputState = MSDIO_IDLE;
+			}
 		}
 	}
 
 	/* Check length */
 	if (command_state->length == 0) {
+		lun->stats.readCommands++;
+		lun->stats.bytesRead += fifo->dataTotal;
+
+		/* Read ahead after two sequential commands */
+		lba = DWORDB(command->pLogicalBlockAddress);
+#if MSD_LUN_PREFETCH
+		if (lba - fifo->dataTotal / fifo->blockSize == lun->nextReadAddress)
+			lun_prefetch(lun, lba, fifo->dataTotal);
+#endif
+		lun->nextReadAddress = lba;
+
 		/* Perform the callback! */
 		if (lun->dataMonitor) {
 			lun->dataMonitor(1, fifo->dataTotal, fifo->nullCnt, fifo->fullCnt);
@@ -535,16 +538,11 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 	}
 
 	/* Disk reading task */
-	old_chunk_size = fifo->chunkSize;
-	if ((fifo->dataTotal - fifo->inputTotal) < fifo->chunkSize) {
-		new_chunk_size = fifo->dataTotal - fifo->inputTotal;
-		fifo->chunkSize = new_chunk_size;
-	}
-
 	switch(fifo->inputState) {
 	case MSDIO_IDLE:
 		if (fifo->inputTotal < fifo->dataTotal &&
-				fifo->inputTotal - fifo->outputTotal < fifo->bufferSize) {
+				fifo->inputTotal - fifo->outputTotal <
+				MSDIOFifo_RingSize(fifo)) {
 			fifo->inputState = MSDIO_START;
 		}
 		break;
@@ -562,16 +560,11 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 					? MEDIA_STATUS_SUCCESS
 					: MEDIA_STATUS_ERROR, 0, 0);
 		} else {
-#ifdef MSDIO_READ10_CHUNK_SIZE
 			status = lun_read(lun, DWORDB(command->pLogicalBlockAddress),
 					&fifo->pBuffer[fifo->inputNdx],
-					fifo->chunkSize / fifo->blockSize,
+					MSDIOFifo_ChunkSize(fifo, fifo->inputTotal)
+					/ fifo->blockSize,
 					msd_driver_callback, disktransfer);
-#else
-			status = lun_read(lun, DWORDB(command->pLogicalBlockAddress),
-					&fifo->pBuffer[fifo->inputNdx], 1,
-					msd_driver_callback, disktransfer);
-#endif
 		}
 
 		/* Check operation result code */
@@ -620,18 +613,12 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 				fifo->inputTotal = fifo->dataTotal;
 			} else {
 				/* Update block address, and input index */
+				size = MSDIOFifo_ChunkSize(fifo, fifo->inputTotal);
 				lba = DWORDB(command->pLogicalBlockAddress);
-#ifdef MSDIO_READ10_CHUNK_SIZE
-				lba += fifo->chunkSize / fifo->blockSize;
+				lba += size / fifo->blockSize;
 				MSDIOFifo_IncNdx(fifo->inputNdx, fifo->chunkSize,
-						fifo->bufferSize);
-				fifo->inputTotal += fifo->chunkSize;
-#else
-				lba++;
-				MSDIOFifo_IncNdx(fifo->inputNdx, fifo->blockSize,
-						fifo->bufferSize);
-				fifo->inputTotal += fifo->blockSize;
-#endif
+						MSDIOFifo_RingSize(fifo));
+				fifo->inputTotal += size;
 				STORE_DWORDB(lba, command->pLogicalBlockAddress);
 
 				/* Start Next block */
@@ -642,7 +629,8 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 					fifo->inputState = MSDIO_IDLE;
 				}
 				/* - Buffer full? */
-				else if (fifo->inputNdx == fifo->outputNdx) {
+				else if (fifo->inputTotal - fifo->outputTotal >=
+						MSDIOFifo_RingSize(fifo)) {
 					LIBUSB_TRACE("dfFull%d ", (int)fifo->inputNdx);
 					fifo->inputState = MSDIO_IDLE;
 					fifo->fullCnt ++;
@@ -660,14 +648,7 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 		break;
 	}
 
-	fifo->chunkSize = old_chunk_size;
-
 	/* USB sending task */
-	if ((fifo->dataTotal - fifo->outputTotal) < fifo->chunkSize) {
-		new_chunk_size = fifo->dataTotal - fifo->outputTotal;
-		fifo->chunkSize = new_chunk_size;
-	}
-
 	switch(fifo->outputState) {
 	case MSDIO_IDLE:
 		if (fifo->outputTotal < fifo->inputTotal) {
@@ -699,15 +680,10 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 					(void*)mappedAddr, command_state->length,
 					msd_driver_callback, transfer);
 		} else {
-#ifdef MSDIO_READ10_CHUNK_SIZE
 			status = usbd_write(command_state->pipeIN,
-					&fifo->pBuffer[fifo->outputNdx], fifo->chunkSize,
-					msd_driver_callback, transfer);
-#else
-			status = usbd_write(command_state->pipeIN,
-					&fifo->pBuffer[fifo->outputNdx], fifo->blockSize,
+					&fifo->pBuffer[fifo->outputNdx],
+					MSDIOFifo_ChunkSize(fifo, fifo->outputTotal),
 					msd_driver_callback, transfer);
-#endif
 		}
 
 		/* Check operation result code */
@@ -747,15 +723,10 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 				command_state->length = 0;
 			} else {
 				/* Update output index */
-#ifdef MSDIO_READ10_CHUNK_SIZE
+				size = MSDIOFifo_ChunkSize(fifo, fifo->outputTotal);
 				MSDIOFifo_IncNdx(fifo->outputNdx, fifo->chunkSize,
-						fifo->bufferSize);
-				fifo->outputTotal += fifo->chunkSize;
-#else
-				MSDIOFifo_IncNdx(fifo->outputNdx, fifo->blockSize,
-						fifo->bufferSize);
-				fifo->outputTotal += fifo->blockSize;
-#endif
+						MSDIOFifo_RingSize(fifo));
+				fifo->outputTotal += size;
 
 				/* Start Next block */
 
@@ -766,7 +737,7 @@ static uint8_t sbc_read10(MSDLun *lun, MSDCommandState *command_state)
 					LIBUSB_TRACE("uDone ");
 				}
 				/* - Buffer Null? */
-				else if (fifo->inputNdx == fifo->outputNdx) {
+				else if (fifo->outputTotal >= fifo->inputTotal) {
 					LIBUSB_TRACE("ufNull%d ", (int)fifo->outputNdx);
 					fifo->outputState = MSDIO_IDLE;
 					fifo->nullCnt ++;
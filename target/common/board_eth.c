@@ -62,6 +62,17 @@
 /* Number of buffer for TX */
 #define ETH_TX_BUFFERS  8
 
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+/* Number of priority queues (queue 0 excluded) */
+#define ETH_PRIO_QUEUES (GMAC_QUEUE_COUNT - 1)
+
+/* Number of buffer for RX on priority queues */
+#define ETH_PRIO_RX_BUFFERS  16
+
+/* Number of buffer for TX on priority queues */
+#define ETH_PRIO_TX_BUFFERS  2
+#endif
+
 #ifndef BOARD_ETH0_PHY_IDLE_TIMEOUT
 #define BOARD_ETH0_PHY_IDLE_TIMEOUT PHY_DEFAULT_TIMEOUT_IDLE
 #endif
@@ -140,6 +151,35 @@ static uint8_t eth_rx_buffer[ETH_IFACE_COUNT][ETH_RX_BUFFERS * ETH_RX_UNITSIZE];
 /** TX callbacks list */
 static ethd_callback_t eth_tx_callback[ETH_IFACE_COUNT][ETH_TX_BUFFERS];
 
+/** TX buffer release list */
+static struct _eth_tx_release eth_tx_release[ETH_IFACE_COUNT][ETH_TX_BUFFERS];
+
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+
+/** Priority queues TX descriptors list */
+ALIGNED(8) NOT_CACHED
+static struct _eth_desc eth_prio_txd[ETH_IFACE_COUNT][ETH_PRIO_QUEUES][ETH_PRIO_TX_BUFFERS];
+
+/** Priority queues RX descriptors list */
+ALIGNED(8) NOT_CACHED
+static struct _eth_desc eth_prio_rxd[ETH_IFACE_COUNT][ETH_PRIO_QUEUES][ETH_PRIO_RX_BUFFERS];
+
+/** Priority queues TX Buffers */
+CACHE_ALIGNED_DDR
+static uint8_t eth_prio_tx_buffer[ETH_IFACE_COUNT][ETH_PRIO_QUEUES][ETH_PRIO_TX_BUFFERS * ETH_TX_UNITSIZE];
+
+/** Priority queues RX Buffers */
+CACHE_ALIGNED_DDR
+static uint8_t eth_prio_rx_buffer[ETH_IFACE_COUNT][ETH_PRIO_QUEUES][ETH_PRIO_RX_BUFFERS * ETH_RX_UNITSIZE];
+
+/** Priority queues TX callbacks list */
+static ethd_callback_t eth_prio_tx_callback[ETH_IFACE_COUNT][ETH_PRIO_QUEUES][ETH_PRIO_TX_BUFFERS];
+
+/** Priority queues TX buffer release list */
+static struct _eth_tx_release eth_prio_tx_release[ETH_IFACE_COUNT][ETH_PRIO_QUEUES][ETH_PRIO_TX_BUFFERS];
+
+#endif /* CONFIG_HAVE_GMAC_QUEUES */
+
 /*----------------------------------------------------------------------------
  *        Local functions
  *----------------------------------------------------------------------------*/
@@ -243,7 +283,23 @@ void board_cfg_net(uint8_t iface, uint8_t* mac_addr, bool block)
 
 	ethd_setup_queue(&_ethd[iface], 0, ETH_RX_BUFFERS, eth_rx_buffer[iface], eth_rxd[iface],
 			 ETH_TX_BUFFERS, eth_tx_buffer[iface], eth_txd[iface], eth_tx_callback[iface]);
+	ethd_set_tx_releases(&_ethd[iface], 0, eth_tx_release[iface]);
 	ethd_set_rx_callback(&_ethd[iface], 0, _eth_rx_callback);
+#ifdef CONFIG_HAVE_GMAC_QUEUES
+	/* Priority queues only receive frames steered by the screeners
+	 * (see gmacd_add_screen()), give them real buffers so that such
+	 * frames are not lost. */
+	{
+		int q;
+		for (q = 1; q <= ETH_PRIO_QUEUES; q++) {
+			ethd_setup_queue(&_ethd[iface], q,
+					 ETH_PRIO_RX_BUFFERS, eth_prio_rx_buffer[iface][q - 1], eth_prio_rxd[iface][q - 1],
+					 ETH_PRIO_TX_BUFFERS, eth_prio_tx_buffer[iface][q - 1], eth_prio_txd[iface][q - 1],
+					 eth_prio_tx_callback[iface][q - 1]);
+			ethd_set_tx_releases(&_ethd[iface], q, eth_prio_tx_release[iface][q - 1]);
+		}
+	}
+#endif
 	ethd_set_mac_addr(&_ethd[iface], 0, _eth_mac_addr);
 	ethd_start(&_ethd[iface]);
 
@@ -0,0 +1,276 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the DMA transfer planner. The descriptors queued by
+ * dma_memcpy() and dma_memset() are recorded by a stub of the descriptor
+ * ring, then run by a model of the controller which moves the data as
+ * described by each descriptor.
+ */
+
+#include "host.h"
+
+#include "dma/dma_plan.h"
+#include "errno.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Descriptor ring stub
+ *----------------------------------------------------------------------------*/
+
+#define RING_SIZE 32
+
+struct _recorded {
+	struct _dma_transfer_cfg xfer;
+	struct _dma_cfg cfg;
+	bool callback;
+};
+
+static struct _recorded chain[RING_SIZE];
+static int chain_len;
+
+uint16_t dma_ring_space(struct _dma_ring* ring)
+{
+	return ring->mask - ((ring->head - ring->tail) & ring->mask);
+}
+
+int dma_ring_submit(struct _dma_ring* ring, struct _dma_transfer_cfg* xfer,
+		    struct _dma_cfg* cfg, struct _callback* cb)
+{
+	CHECK(dma_ring_space(ring) > 0);
+	CHECK(chain_len < RING_SIZE);
+	chain[chain_len].xfer = *xfer;
+	chain[chain_len].cfg = *cfg;
+	chain[chain_len].callback = cb != NULL;
+	chain_len++;
+	ring->head = (ring->head + 1) & ring->mask;
+	return 0;
+}
+
+/** Moves the data as the controller would for the recorded chain */
+static void run_chain(void)
+{
+	const uint8_t* src;
+	uint8_t* dst;
+	uint32_t width, i;
+	int d;
+
+	for (d = 0; d < chain_len; d++) {
+		src = chain[d].xfer.saddr;
+		dst = chain[d].xfer.daddr;
+		width = DMA_DATA_WIDTH_IN_BYTE(chain[d].cfg.data_width);
+		CHECK(!((uintptr_t)src & (width - 1)));
+		CHECK(!((uintptr_t)dst & (width - 1)));
+		for (i = 0; i < chain[d].xfer.len; i++) {
+			memcpy(dst, src, width);
+			if (chain[d].cfg.incr_saddr)
+				src += width;
+			if (chain[d].cfg.incr_daddr)
+				dst += width;
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *        Planner
+ *----------------------------------------------------------------------------*/
+
+/** Plans a transfer and checks its descriptors: contiguous, aligned on their
+ * data width, whole chunks, within the controller limits */
+static int check_plan(uint32_t saddr, uint32_t daddr, uint32_t len,
+		      bool incr_saddr, bool incr_daddr,
+		      uint8_t max_width, uint8_t max_chunk)
+{
+	struct _dma_plan_req req = {
+		.saddr = (const void*)(uintptr_t)saddr,
+		.daddr = (void*)(uintptr_t)daddr,
+		.len = len,
+		.incr_saddr = incr_saddr,
+		.incr_daddr = incr_daddr,
+		.max_width = max_width,
+		.max_chunk = max_chunk,
+	};
+	struct _dma_plan_seg seg[64];
+	uint32_t src = saddr, dst = daddr, total = 0, width, chunk;
+	int count, i;
+
+	count = dma_plan_transfer(&req, seg, 64);
+	CHECK(count > 0);
+	for (i = 0; i < count; i++) {
+		width = DMA_DATA_WIDTH_IN_BYTE(seg[i].cfg.data_width);
+#if defined(CONFIG_HAVE_XDMAC)
+		chunk = 1 << seg[i].cfg.chunk_size;
+#else
+		chunk = seg[i].cfg.chunk_size ? 2 << seg[i].cfg.chunk_size : 1;
+#endif
+		CHECK((uint32_t)(uintptr_t)seg[i].xfer.saddr == src);
+		CHECK((uint32_t)(uintptr_t)seg[i].xfer.daddr == dst);
+		CHECK(!((src | dst) & (width - 1)));
+		CHECK(seg[i].xfer.len > 0);
+		CHECK(seg[i].xfer.len <= DMA_MAX_BT_SIZE);
+		CHECK(seg[i].xfer.len % chunk == 0);
+		CHECK(seg[i].cfg.data_width <= max_width);
+		CHECK(seg[i].cfg.chunk_size <= max_chunk);
+		CHECK(seg[i].cfg.incr_saddr == incr_saddr);
+		CHECK(seg[i].cfg.incr_daddr == incr_daddr);
+		if (incr_saddr)
+			src += seg[i].xfer.len * width;
+		if (incr_daddr)
+			dst += seg[i].xfer.len * width;
+		total += seg[i].xfer.len * width;
+	}
+	CHECK(total == len);
+	return count;
+}
+
+static void test_plan_alignments(void)
+{
+	uint32_t s, d, len;
+
+	for (s = 0; s < 16; s++) {
+		for (d = 0; d < 16; d++) {
+			for (len = 1; len < 300; len++) {
+				check_plan(0x20000000 + s, 0x30000000 + d, len,
+				    true, true, DMA_PLAN_MAX_WIDTH,
+				    DMA_PLAN_MAX_CHUNK);
+				/* Memory to peripheral register */
+				check_plan(0x20000000 + s,
+				    0x30000000 + (d & ~3), len, true, false,
+				    DMA_DATA_WIDTH_WORD, DMA_CHUNK_SIZE_4);
+				/* Fill from a fixed pattern */
+				check_plan(0x20000000 + (s & ~1),
+				    0x30000000 + d, len, false, true,
+				    DMA_PLAN_MAX_WIDTH, DMA_PLAN_MAX_CHUNK);
+			}
+		}
+	}
+}
+
+static void test_plan_shapes(void)
+{
+	struct _dma_plan_seg seg[8];
+	struct _dma_plan_req req = {
+		.saddr = (const void*)0x20000000,
+		.daddr = (void*)0x30000000,
+		.len = 4096,
+		.incr_saddr = true,
+		.incr_daddr = true,
+		.max_width = DMA_PLAN_MAX_WIDTH,
+		.max_chunk = DMA_PLAN_MAX_CHUNK,
+	};
+
+	/* Aligned buffers: a single descriptor of the widest data */
+	CHECK(dma_plan_transfer(&req, seg, 8) == 1);
+	CHECK(seg[0].cfg.data_width == DMA_PLAN_MAX_WIDTH);
+	CHECK(seg[0].cfg.chunk_size == DMA_PLAN_MAX_CHUNK);
+	CHECK(seg[0].xfer.len == 4096 / DMA_DATA_WIDTH_IN_BYTE(DMA_PLAN_MAX_WIDTH));
+
+	/* Head, body and tail */
+	req.saddr = (const void*)0x20000001;
+	req.daddr = (void*)0x30000001;
+	req.len = 4096;
+	CHECK(dma_plan_transfer(&req, seg, 8) == 4);
+	CHECK(seg[0].cfg.chunk_size == DMA_CHUNK_SIZE_1);
+	CHECK(seg[1].cfg.data_width == DMA_PLAN_MAX_WIDTH);
+	CHECK(seg[3].cfg.chunk_size == DMA_CHUNK_SIZE_1);
+
+	/* Long bodies are split at DMA_MAX_BT_SIZE data */
+	check_plan(0x20000001, 0x30000001, 200u << 20, true, true,
+	    DMA_PLAN_MAX_WIDTH, DMA_PLAN_MAX_CHUNK);
+
+	req.len = 0;
+	CHECK(dma_plan_transfer(&req, seg, 8) == -EINVAL);
+	req.len = 4096;
+	CHECK(dma_plan_transfer(&req, seg, 2) == -ENOSPC);
+}
+
+/*----------------------------------------------------------------------------
+ *        Copy and fill
+ *----------------------------------------------------------------------------*/
+
+static uint8_t mem[1 << 16] __attribute__((aligned(64)));
+static uint8_t ref[1 << 16];
+static struct _dma_ring_desc desc[RING_SIZE] __attribute__((aligned(32)));
+
+static void test_memcpy_memset(void)
+{
+	struct _dma_ring ring = { .desc = desc, .mask = RING_SIZE - 1 };
+	struct _callback cb = { NULL, NULL };
+	uint32_t s, d, len, i;
+	uint8_t value;
+	int iter;
+
+	srand(3);
+	for (iter = 0; iter < 20000; iter++) {
+		for (i = 0; i < sizeof(mem); i++)
+			mem[i] = ref[i] = rand();
+		s = rand() % 20000;
+		d = 32768 + rand() % 20000;
+		len = 1 + rand() % (rand() % 2 ? 64 : 12000);
+		chain_len = 0;
+		ring.head = ring.tail = 0;
+		if (rand() % 2) {
+			CHECK(!dma_memcpy(&ring, mem + d, mem + s, len, &cb));
+			memcpy(ref + d, ref + s, len);
+		} else {
+			value = rand();
+			CHECK(!dma_memset(&ring, mem + d, value, len, &cb));
+			memset(ref + d, value, len);
+			/* Each descriptor reads the pattern of its own slot */
+			for (i = 0; i < chain_len; i++)
+				CHECK(chain[i].xfer.saddr == &desc[i].pattern);
+		}
+		CHECK(chain_len > 0 && chain_len <= DMA_PLAN_MAX_SEGS);
+		/* Only the last descriptor calls back */
+		for (i = 0; i < chain_len; i++)
+			CHECK(chain[i].callback == (i == chain_len - 1));
+		run_chain();
+		CHECK(!memcmp(mem, ref, sizeof(mem)));
+	}
+
+	/* Nothing is queued if the ring cannot take the whole plan */
+	chain_len = 0;
+	ring.head = 0;
+	ring.tail = 3;
+	CHECK(dma_memcpy(&ring, mem + 32769, mem + 1, 4096, &cb) == -ENOSPC);
+	CHECK(chain_len == 0);
+}
+
+int main(void)
+{
+	test_plan_alignments();
+	test_plan_shapes();
+	test_memcpy_memset();
+	printf("dma_plan: OK\n");
+	return 0;
+}
@@ -0,0 +1,490 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the DMA descriptor rings. The ring driver runs on a model of
+ * an XDMAC channel which fetches the linked descriptors one at a time, as
+ * the controller does: a link written after the fetch of a descriptor is
+ * not seen, and the channel stops at the end of the list it fetched.
+ *
+ * Submissions, controller steps, interrupts and stops are interleaved at
+ * random. Each transfer must be executed at most once, in submission order,
+ * with its own address, length and data width, and must complete exactly
+ * once, in order: successfully if and only if it was executed.
+ */
+
+#include "host.h"
+
+#include "dma/dma.h"
+#include "dma/dma_ring.h"
+#include "dma/xdmac.h"
+#include "errno.h"
+#include "irq/irq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+#define RING_SIZE 16
+
+#define MAX_TRANSFERS (1 << 20)
+
+/** Source buffer, the offset of a transfer identifies it */
+#define SRC_SIZE 4096
+
+/*----------------------------------------------------------------------------
+ *        XDMAC channel model
+ *----------------------------------------------------------------------------*/
+
+static struct {
+	bool enabled;
+	bool busy;         /* A microblock is fetched and not complete */
+	bool bus_error;    /* The current microblock is stuck on a bus error */
+	uint32_t cnda;     /* Next descriptor address */
+	uint32_t cndc;     /* Next descriptor control */
+	uint32_t cc;       /* Channel configuration */
+	uint32_t ubc;      /* Control of the current microblock */
+	uint32_t cubc;     /* Remaining length of the current microblock */
+	const void* sa;
+	void* da;
+	uint32_t cis;      /* Interrupt status not reported yet */
+	bool masked;       /* Interrupt disabled by the ring */
+} xdmac;
+
+/** Paths exercised by the test */
+static struct {
+	uint32_t executed;
+	uint32_t completed;
+	uint32_t canceled;
+	uint32_t failed;
+	uint32_t starts;
+	uint32_t chained;        /* Descriptors fetched through a link */
+	uint32_t late_links;     /* End of list reached with transfers queued */
+	uint32_t from_callback;  /* Submissions from a completion callback */
+	uint32_t stops_busy;     /* Stops in the middle of a microblock */
+	uint32_t stops_between;  /* Stops between two microblocks, the last one
+	                           * not reported yet */
+} stats;
+
+static Xdmac host_xdmac;
+
+uint32_t get_xdmac_id_from_addr(const Xdmac* addr)
+{
+	CHECK(addr == &host_xdmac);
+	return ID_XDMAC0;
+}
+
+void irq_disable(uint32_t source)
+{
+	CHECK(!xdmac.masked);
+	xdmac.masked = true;
+}
+
+void irq_enable(uint32_t source)
+{
+	CHECK(xdmac.masked);
+	xdmac.masked = false;
+}
+
+bool dma_is_polling(void)
+{
+	return false;
+}
+
+uint32_t xdmac_get_global_channel_status(Xdmac *xdmac_hw)
+{
+	return xdmac.enabled ? 1 : 0;
+}
+
+uint32_t xdmac_get_microblock_control(Xdmac *xdmac_hw, uint8_t channel)
+{
+	return xdmac.cubc;
+}
+
+uint32_t xdmac_get_descriptor_addr(Xdmac *xdmac_hw, uint8_t channel)
+{
+	return xdmac.cnda;
+}
+
+void xdmac_set_descriptor_addr(Xdmac *xdmac_hw, uint8_t channel, void *addr,
+			       uint32_t ndaif)
+{
+	CHECK(!xdmac.enabled);
+	xdmac.cnda = (uint32_t)addr;
+}
+
+void xdmac_set_src_addr(Xdmac *xdmac_hw, uint8_t channel, const void *addr)
+{
+	CHECK(!xdmac.enabled);
+	xdmac.sa = addr;
+}
+
+void xdmac_set_dest_addr(Xdmac *xdmac_hw, uint8_t channel, void *addr)
+{
+	CHECK(!xdmac.enabled);
+	xdmac.da = addr;
+}
+
+void xdmac_enable_channel_it(Xdmac *xdmac_hw, uint8_t channel,
+			     uint32_t int_mask)
+{
+	CHECK(int_mask & XDMAC_CIE_RBIE);
+}
+
+int xdmacd_configure_transfer(struct _dma_channel* channel,
+			      struct _xdmacd_cfg* cfg, uint32_t desc_ctrl,
+			      void* desc_addr)
+{
+	CHECK(!xdmac.enabled);
+	CHECK(channel->state != DMA_STATE_STARTED);
+	CHECK(desc_ctrl & XDMAC_CNDC_NDE);
+	xdmac.cc = cfg->cfg;
+	xdmac.cndc = desc_ctrl;
+	xdmac.cnda = (uint32_t)desc_addr;
+	return 0;
+}
+
+int dma_start_transfer(struct _dma_channel* channel)
+{
+	CHECK(!xdmac.enabled);
+	CHECK(channel->state != DMA_STATE_STARTED);
+	channel->state = DMA_STATE_STARTED;
+	xdmac.enabled = true;
+	xdmac.busy = false;
+	xdmac.cubc = 0;
+	stats.starts++;
+	return 0;
+}
+
+int dma_stop_transfer(struct _dma_channel* channel)
+{
+	xdmac.enabled = false;
+	xdmac.busy = false;
+	xdmac.bus_error = false;
+	channel->state = DMA_STATE_ALLOCATED;
+	return 0;
+}
+
+/** Fetches the next descriptor, with the view and the updates of CNDC */
+static void xdmac_fetch(void)
+{
+	struct _dma_ring_desc* desc = (struct _dma_ring_desc*)xdmac.cnda;
+	uint32_t view = (xdmac.cndc & XDMAC_CNDC_NDVIEW_Msk) >> XDMAC_CNDC_NDVIEW_Pos;
+
+	xdmac.ubc = desc->hw.view1.mbr_ubc;
+	if (view == 0) {
+		if (xdmac.cndc & XDMAC_CNDC_NDSUP)
+			xdmac.sa = desc->hw.view0.mbr_ta;
+		if (xdmac.cndc & XDMAC_CNDC_NDDUP)
+			xdmac.da = desc->hw.view0.mbr_ta;
+	} else {
+		if (xdmac.cndc & XDMAC_CNDC_NDSUP)
+			xdmac.sa = desc->hw.view1.mbr_sa;
+		if (xdmac.cndc & XDMAC_CNDC_NDDUP)
+			xdmac.da = desc->hw.view1.mbr_da;
+		if (view == 2)
+			xdmac.cc = desc->hw.view2.mbr_cfg;
+	}
+	xdmac.cnda = (uint32_t)desc->hw.view1.mbr_nda;
+	xdmac.cubc = xdmac.ubc & XDMA_UBC_UBLEN_Msk;
+	xdmac.busy = true;
+}
+
+/** Ends the current microblock, then follows or ends the list */
+static void xdmac_end_microblock(void)
+{
+	xdmac.cubc = 0;
+	xdmac.busy = false;
+	xdmac.cis |= XDMAC_CIS_BIS;
+	if (xdmac.ubc & XDMA_UBC_NDE) {
+		stats.chained++;
+		xdmac.cndc = XDMAC_CNDC_NDE_DSCR_FETCH_EN
+			| XDMAC_CNDC_NDVIEW((xdmac.ubc & XDMA_UBC_NVIEW_Msk) >> XDMA_UBC_NVIEW_Pos)
+			| ((xdmac.ubc & XDMA_UBC_NSEN) ? XDMAC_CNDC_NDSUP : 0)
+			| ((xdmac.ubc & XDMA_UBC_NDEN) ? XDMAC_CNDC_NDDUP : 0);
+	} else {
+		xdmac.enabled = false;
+		xdmac.cis |= XDMAC_CIS_LIS;
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *        Transfers
+ *----------------------------------------------------------------------------*/
+
+struct _transfer {
+	uint32_t len;
+	uint8_t data_width;
+	void* daddr;
+	bool executed;
+	bool failed;       /* A bus error was injected on its execution */
+};
+
+static struct _transfer transfers[MAX_TRANSFERS];
+static uint32_t submitted;   /* Number of accepted submissions */
+static uint32_t next_exec;   /* Next transfer the controller may execute */
+static uint32_t next_cb;     /* Next transfer to complete */
+
+static struct _dma_ring ring;
+static struct _dma_ring_desc desc[RING_SIZE] __attribute__((aligned(32)));
+static struct _dma_channel channel;
+static uint8_t src[SRC_SIZE];
+static uint32_t periph[2];
+static bool two_periph_addr;
+
+static struct _dma_cfg cfg_byte = {
+	.data_width = DMA_DATA_WIDTH_BYTE,
+	.chunk_size = DMA_CHUNK_SIZE_1,
+	.incr_saddr = true,
+	.incr_daddr = false,
+};
+
+static struct _dma_cfg cfg_word = {
+	.data_width = DMA_DATA_WIDTH_WORD,
+	.chunk_size = DMA_CHUNK_SIZE_1,
+	.incr_saddr = true,
+	.incr_daddr = false,
+};
+
+static int submit(void);
+
+/** Index of the transfer the controller must execute next */
+static uint32_t expected_exec(void)
+{
+	return next_exec > next_cb ? next_exec : next_cb;
+}
+
+/** Checks the microblock being executed against its transfer */
+static uint32_t check_microblock(void)
+{
+	uint32_t index = expected_exec();
+	struct _transfer* t = &transfers[index];
+
+	CHECK(index < submitted);
+	CHECK((const uint8_t*)xdmac.sa == &src[index % SRC_SIZE]);
+	CHECK(xdmac.da == t->daddr);
+	CHECK((xdmac.ubc & XDMA_UBC_UBLEN_Msk) == t->len);
+	CHECK(((xdmac.cc & XDMAC_CC_DWIDTH_Msk) >> XDMAC_CC_DWIDTH_Pos) == t->data_width);
+	return index;
+}
+
+/** Runs one step of the controller: fetch, or end of microblock */
+static void xdmac_step(void)
+{
+	uint32_t index;
+
+	if (!xdmac.enabled || xdmac.bus_error)
+		return;
+	if (!xdmac.busy) {
+		xdmac_fetch();
+		return;
+	}
+
+	index = check_microblock();
+	if (rand() % 200 == 0) {
+		/* The channel stays stuck on the microblock until stopped */
+		xdmac.bus_error = true;
+		xdmac.cis |= XDMAC_CIS_RBEIS;
+		transfers[index].failed = true;
+		return;
+	}
+
+	CHECK(!transfers[index].executed);
+	transfers[index].executed = true;
+	next_exec = index + 1;
+	stats.executed++;
+	xdmac_end_microblock();
+	if (!xdmac.enabled && next_exec < submitted)
+		stats.late_links++;
+}
+
+/** Checks that the channel runs while transfers wait for their execution */
+static void check_running(void)
+{
+	if (expected_exec() < submitted)
+		CHECK(xdmac.enabled);
+}
+
+static void xdmac_interrupt(void)
+{
+	uint32_t status = xdmac.cis;
+
+	if (!status || xdmac.masked)
+		return;
+	xdmac.cis = 0;
+	dma_ring_irq_handler(&ring, status);
+	check_running();
+}
+
+static int transfer_callback(void* arg, void* arg2)
+{
+	uint32_t index = (uint32_t)(uintptr_t)arg;
+	int status = (int)(intptr_t)arg2;
+
+	CHECK(index == next_cb);
+	next_cb++;
+	if (status == 0) {
+		CHECK(transfers[index].executed);
+		stats.completed++;
+	} else if (status == -ECANCELED) {
+		CHECK(!transfers[index].executed);
+		stats.canceled++;
+	} else {
+		CHECK(status == -EIO);
+		CHECK(!transfers[index].executed);
+		CHECK(transfers[index].failed);
+		stats.failed++;
+	}
+
+	if (rand() % 8 == 0 && submit() == 0)
+		stats.from_callback++;
+	return 0;
+}
+
+static int submit(void)
+{
+	struct _transfer* t = &transfers[submitted];
+	struct _dma_cfg* cfg = rand() % 16 == 0 ? &cfg_word : NULL;
+	struct _dma_transfer_cfg xfer;
+	struct _callback cb;
+	int err;
+
+	if (submitted == MAX_TRANSFERS)
+		return -ENOSPC;
+
+	memset(t, 0, sizeof(*t));
+	t->len = 1 + rand() % 100;
+	t->data_width = (cfg ? cfg : &cfg_byte)->data_width;
+	t->daddr = &periph[two_periph_addr ? rand() % 2 : 0];
+
+	xfer.saddr = &src[submitted % SRC_SIZE];
+	xfer.daddr = t->daddr;
+	xfer.len = t->len;
+	callback_set(&cb, transfer_callback, (void*)(uintptr_t)submitted);
+	err = dma_ring_submit(&ring, &xfer, cfg, &cb);
+	if (err == 0)
+		submitted++;
+	else
+		CHECK(err == -ENOSPC && dma_ring_space(&ring) == 0);
+	return err;
+}
+
+static void stop(void)
+{
+	if (xdmac.enabled && xdmac.busy)
+		stats.stops_busy++;
+	else if (xdmac.enabled && next_exec > next_cb)
+		stats.stops_between++;
+	dma_ring_stop(&ring);
+	xdmac.cis = 0;
+	CHECK(!xdmac.enabled);
+	CHECK(next_cb == submitted || dma_ring_pending(&ring) > 0);
+}
+
+/*----------------------------------------------------------------------------
+ *        Tests
+ *----------------------------------------------------------------------------*/
+
+/** Runs random interleavings, then drains the ring */
+static void test_interleavings(unsigned seed, uint32_t steps, bool moved)
+{
+	uint32_t i;
+	int action;
+
+	srand(seed);
+	memset(&xdmac, 0, sizeof(xdmac));
+	memset(&channel, 0, sizeof(channel));
+	submitted = next_exec = next_cb = 0;
+	two_periph_addr = moved;
+
+	channel.hw = &host_xdmac;
+	channel.state = DMA_STATE_ALLOCATED;
+	channel.src_txif = channel.src_rxif = 0xff;
+	channel.dest_txif = 5;
+	channel.dest_rxif = 6;
+	CHECK(dma_ring_init(&ring, &channel, &cfg_byte, desc, RING_SIZE) == 0);
+
+	for (i = 0; i < steps; i++) {
+		action = rand() % 1000;
+		if (action < 300) {
+			submit();
+			check_running();
+		} else if (action < 750) {
+			xdmac_step();
+		} else if (action < 998) {
+			xdmac_interrupt();
+		} else {
+			stop();
+		}
+	}
+
+	/* Without further submissions, everything completes */
+	for (i = 0; i < 100000 && dma_ring_pending(&ring); i++) {
+		xdmac_step();
+		xdmac_interrupt();
+	}
+	CHECK(dma_ring_pending(&ring) == 0);
+	CHECK(next_cb == submitted);
+	CHECK(!xdmac.enabled);
+}
+
+int main(void)
+{
+	test_interleavings(1, 2000000, false);
+	test_interleavings(2, 2000000, true);
+
+	printf("dma_ring: %u transfers, %u completed, %u canceled, %u failed, "
+	       "%u restarts, %u chained, %u late links, %u from callbacks, "
+	       "%u stops (%u busy)\n",
+	       (unsigned)(stats.completed + stats.canceled + stats.failed),
+	       (unsigned)stats.completed, (unsigned)stats.canceled,
+	       (unsigned)stats.failed, (unsigned)stats.starts, (unsigned)stats.chained,
+	       (unsigned)stats.late_links, (unsigned)stats.from_callback,
+	       (unsigned)(stats.stops_busy + stats.stops_between),
+	       (unsigned)stats.stops_busy);
+
+	/* Each path of the ring is exercised */
+	CHECK(stats.executed == stats.completed);
+	CHECK(stats.completed > 0);
+	CHECK(stats.canceled > 0);
+	CHECK(stats.failed > 0);
+	CHECK(stats.chained > 0);
+	CHECK(stats.late_links > 0);
+	CHECK(stats.from_callback > 0);
+	CHECK(stats.stops_busy > 0);
+	CHECK(stats.stops_between > 0);
+
+	printf("dma_ring: OK\n");
+	return 0;
+}
@@ -0,0 +1,82 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Forced include of the eth_bench host test: the memory barriers, the IRQ
+ * flags and the idle state of the target are replaced by host versions, and
+ * lwIP is given a routing hook so that the traffic between the two netifs of
+ * the test goes through the emulated ETH link.
+ */
+
+#ifndef _ETH_BENCH_HOST_H
+#define _ETH_BENCH_HOST_H
+
+/* Skip arch/barriers.h, arch/arm/cpuidle.h and arch/arm/irqflags.h */
+#define BARRIERS_H_
+#define ARM_CPUIDLE_H_
+#define ARM_IRQFLAGS_H_
+
+static inline void dmb(void)
+{
+	__sync_synchronize();
+}
+
+static inline void dsb(void)
+{
+	__sync_synchronize();
+}
+
+static inline void isb(void)
+{
+	__sync_synchronize();
+}
+
+static inline void cpu_idle(void)
+{
+}
+
+static inline void arch_irq_enable(void)
+{
+}
+
+static inline void arch_irq_disable(void)
+{
+}
+
+struct netif;
+struct ip4_addr;
+
+/* Route the datagrams of a netif address through this netif */
+extern struct netif* host_route_src(const struct ip4_addr* dest,
+		const struct ip4_addr* src);
+
+#define LWIP_HOOK_IP4_ROUTE_SRC(dest, src) host_route_src(dest, src)
+
+#endif /* _ETH_BENCH_HOST_H */
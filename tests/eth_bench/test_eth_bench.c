@@ -0,0 +1,738 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host build of the eth_bench example. The lwIP core, the ethif netif and
+ * the benchmark services of the example run on two ETH ports linked back to
+ * back: the ETH driver is replaced by a model which hands the frames sent on
+ * one port to the RX queue of the other one, split into RX buffers of
+ * ETH_RX_UNITSIZE bytes, and which signals them with the RX interrupt
+ * callback as the driver does in polling mode.
+ *
+ * The first netif runs the services of the example, the second one is the
+ * peer usually played by host/eth_bench.py. The TCP and UDP benchmarks are
+ * run through the loopback address, then through the link, and print the
+ * same JSON reports as on the board.
+ */
+
+#include "host.h"
+
+/* The example, its entry point is replaced by the one of the test */
+#define main eth_bench_main
+#include "main.c"
+#undef main
+
+#include "lwip/ip.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+#if ETH_IFACE_COUNT < 2
+#error The test links two ETH ports
+#endif
+
+#define PORTS 2
+
+/** Frames in flight on each direction of the link */
+#define LINK_FRAMES 32
+
+/** Buffers of a frame sent with ethd_send_sg_nocopy() */
+#define LINK_SG_ENTRIES 8
+
+/** RX buffers holding a frame of maximum size */
+#define RX_FRAME_BUFFERS \
+	((ETH_MAX_FRAME_LENGTH + ETH_RX_UNITSIZE - 1) / ETH_RX_UNITSIZE)
+
+/** Address of the peer */
+#define PEER_IP_ADDR(addr) IP4_ADDR(addr, 192, 168, 1, 4)
+
+/** Data sent by the peer to the TCP sink */
+#define TCP_RX_BYTES (1024 * 1024)
+
+/** UDP datagrams sent by the peer to the UDP sink */
+#define UDP_DATAGRAMS 1000
+#define UDP_SIZE 1024
+
+/** Longest benchmark run, in ms */
+#define POLL_TIMEOUT (10 * BENCH_DURATION)
+
+/*----------------------------------------------------------------------------
+ *        ETH link model
+ *----------------------------------------------------------------------------*/
+
+/** Frame sent by a port and not received by its peer yet */
+struct _link_frame {
+	struct _eth_sg sg[LINK_SG_ENTRIES];
+	uint32_t count;
+	uint32_t hash;     /* The buffers must not change until received */
+	uint8_t copy[ETH_MAX_FRAME_LENGTH]; /* Data given to ethd_send() */
+};
+
+static struct _port {
+	struct _link_frame tx[LINK_FRAMES];
+	uint32_t tx_head;
+	uint32_t tx_count;
+	uint32_t tx_load;       /* Buffers of the frames in flight */
+	uint8_t* rx_buffers[RX_FRAME_BUFFERS];
+	ethd_callback_t rx_callback;
+	bool rx_polling;
+	bool rx_irq;            /* RX interrupt unmasked */
+} ports[PORTS];
+
+static uint8_t rx_memory[PORTS][RX_FRAME_BUFFERS][ETH_RX_UNITSIZE];
+
+static struct _ethd host_ethd[PORTS];
+
+static struct netif netifs[PORTS];
+
+/** Paths exercised by the test */
+static struct {
+	uint32_t frames;            /* Frames sent on the link */
+	uint32_t sg_frames;         /* Frames sent from several buffers */
+	uint32_t rx_swaps;          /* RX buffers exchanged by ethif */
+	uint32_t rx_irqs;
+	uint32_t budget_exhausted;  /* ethd_rx_poll() calls stopped by the
+	                             * budget */
+} stats;
+
+static uint8_t _port_of(struct _ethd* ethd)
+{
+	CHECK(ethd >= host_ethd && ethd < host_ethd + PORTS);
+	return ethd - host_ethd;
+}
+
+static void _port_rx_signal(struct _port* port)
+{
+	if (!port->rx_callback)
+		return;
+	if (port->rx_polling) {
+		if (!port->rx_irq)
+			return;
+		/* Masked until ethd_rx_poll() finds the queue empty */
+		port->rx_irq = false;
+	}
+	stats.rx_irqs++;
+	port->rx_callback(0, 0);
+}
+
+static uint32_t _frame_hash(const struct _link_frame* frame)
+{
+	uint32_t i, j, hash = 2166136261u;
+
+	for (i = 0; i < frame->count; i++)
+		for (j = 0; j < frame->sg[i].size; j++)
+			hash = (hash ^ ((const uint8_t*)frame->sg[i].buffer)[j]) * 16777619u;
+	return hash;
+}
+
+static struct _link_frame* _port_tx_alloc(struct _port* port)
+{
+	if (port->tx_count == LINK_FRAMES)
+		return NULL;
+	return &port->tx[(port->tx_head + port->tx_count) % LINK_FRAMES];
+}
+
+static void _port_tx_commit(uint8_t index, struct _link_frame* frame)
+{
+	struct _port* port = &ports[index];
+	uint32_t i, size = 0;
+
+	for (i = 0; i < frame->count; i++)
+		size += frame->sg[i].size;
+	CHECK(size >= 14 && size <= ETH_MAX_FRAME_LENGTH);
+	frame->hash = _frame_hash(frame);
+
+	port->tx_count++;
+	port->tx_load += frame->count;
+	stats.frames++;
+	if (frame->count > 1)
+		stats.sg_frames++;
+	_port_rx_signal(&ports[index ^ 1]);
+}
+
+/**
+ * Receive the oldest frame sent by the peer: it is copied into the RX
+ * buffers, which the handler may exchange with its own ones
+ */
+static void _port_rx_frame(struct _port* port, struct _port* peer,
+		ethd_rx_handler_t handler, void* arg)
+{
+	struct _link_frame* frame = &peer->tx[peer->tx_head];
+	struct _eth_sg entries[RX_FRAME_BUFFERS];
+	struct _eth_sg_list list;
+	uint8_t data[ETH_MAX_FRAME_LENGTH];
+	uint32_t i, size = 0, count;
+
+	CHECK(_frame_hash(frame) == frame->hash);
+	for (i = 0; i < frame->count; i++) {
+		memcpy(&data[size], frame->sg[i].buffer, frame->sg[i].size);
+		size += frame->sg[i].size;
+	}
+
+	count = (size + ETH_RX_UNITSIZE - 1) / ETH_RX_UNITSIZE;
+	for (i = 0; i < count; i++) {
+		entries[i].size = size - i * ETH_RX_UNITSIZE;
+		if (entries[i].size > ETH_RX_UNITSIZE)
+			entries[i].size = ETH_RX_UNITSIZE;
+		entries[i].buffer = port->rx_buffers[i];
+		entries[i].next = NULL;
+		entries[i].release = NULL;
+		entries[i].release_arg = NULL;
+		memcpy(entries[i].buffer, &data[i * ETH_RX_UNITSIZE],
+				entries[i].size);
+	}
+	list.size = count;
+	list.entries = entries;
+
+	/* The buffers are sent, the peer may release them */
+	peer->tx_head = (peer->tx_head + 1) % LINK_FRAMES;
+	peer->tx_count--;
+	peer->tx_load -= frame->count;
+
+	handler(arg, 0, &list, size);
+
+	for (i = 0; i < count; i++) {
+		if (entries[i].buffer != port->rx_buffers[i]) {
+			port->rx_buffers[i] = entries[i].buffer;
+			stats.rx_swaps++;
+		}
+	}
+}
+
+struct _ethd* board_get_eth(uint8_t index)
+{
+	CHECK(index < PORTS);
+	return &host_ethd[index];
+}
+
+uint8_t select_eth_port(void)
+{
+	return 0;
+}
+
+void ethd_get_mac_addr(struct _ethd* ethd, uint8_t sa_idx, uint8_t* mac)
+{
+	static const uint8_t addr[6] = { 0x3a, 0x1f, 0x34, 0x08, 0x54, 0x00 };
+
+	memcpy(mac, addr, sizeof(addr));
+	mac[5] += _port_of(ethd);
+}
+
+uint32_t ethd_get_caps(struct _ethd* ethd)
+{
+	/* Checksums are generated and checked by lwIP */
+	return 0;
+}
+
+uint32_t ethd_get_rx_status(struct _ethd* ethd, uint8_t queue)
+{
+	return 0;
+}
+
+void ethd_set_rx_callback(struct _ethd* ethd, uint8_t queue, ethd_callback_t callback)
+{
+	CHECK(queue == 0);
+	ports[_port_of(ethd)].rx_callback = callback;
+}
+
+void ethd_set_rx_polling(struct _ethd* ethd, uint8_t queue, bool enable)
+{
+	CHECK(queue == 0);
+	ports[_port_of(ethd)].rx_polling = enable;
+	ports[_port_of(ethd)].rx_irq = true;
+}
+
+uint32_t ethd_rx_poll(struct _ethd* ethd, uint8_t queue, uint32_t budget,
+		ethd_rx_handler_t handler, void* arg)
+{
+	uint8_t index = _port_of(ethd);
+	struct _port* port = &ports[index];
+	struct _port* peer = &ports[index ^ 1];
+	uint32_t frames = 0;
+
+	CHECK(queue == 0);
+	while (frames < budget && peer->tx_count) {
+		_port_rx_frame(port, peer, handler, arg);
+		frames++;
+	}
+
+	if (frames < budget)
+		port->rx_irq = true;
+	else
+		stats.budget_exhausted++;
+	return frames;
+}
+
+uint8_t ethd_send_sg_nocopy(struct _ethd* ethd, uint8_t queue,
+		const struct _eth_sg_list* sgl, ethd_callback_t callback)
+{
+	uint8_t index = _port_of(ethd);
+	struct _link_frame* frame = _port_tx_alloc(&ports[index]);
+
+	CHECK(queue == 0);
+	CHECK(sgl->size > 0 && sgl->size <= LINK_SG_ENTRIES);
+	if (!frame)
+		return ETH_TX_BUSY;
+
+	memcpy(frame->sg, sgl->entries, sgl->size * sizeof(frame->sg[0]));
+	frame->count = sgl->size;
+	_port_tx_commit(index, frame);
+	return ETH_OK;
+}
+
+uint8_t ethd_send(struct _ethd* ethd, uint8_t queue, void* buffer,
+		uint32_t size, ethd_callback_t callback)
+{
+	uint8_t index = _port_of(ethd);
+	struct _link_frame* frame = _port_tx_alloc(&ports[index]);
+
+	CHECK(queue == 0);
+	CHECK(size <= ETH_MAX_FRAME_LENGTH);
+	if (!frame)
+		return ETH_TX_BUSY;
+
+	memcpy(frame->copy, buffer, size);
+	frame->sg[0].size = size;
+	frame->sg[0].buffer = frame->copy;
+	frame->count = 1;
+	_port_tx_commit(index, frame);
+	return ETH_OK;
+}
+
+uint32_t ethd_get_tx_load(struct _ethd* ethd, uint8_t queue)
+{
+	CHECK(queue == 0);
+	return ports[_port_of(ethd)].tx_load;
+}
+
+uint8_t ethd_poll(struct _ethd* ethd, uint8_t queue, uint8_t* buffer,
+		uint32_t size, uint32_t* frame_size)
+{
+	return ETH_RX_NULL;
+}
+
+void ethd_get_rx_stats(struct _ethd* ethd, uint8_t queue,
+		struct _ethd_rx_stats* rx_stats, bool reset)
+{
+	memset(rx_stats, 0, sizeof(*rx_stats));
+}
+
+/*----------------------------------------------------------------------------
+ *        Host services
+ *----------------------------------------------------------------------------*/
+
+uint64_t timer_get_tick(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+void console_example_info(const char *example_name)
+{
+}
+
+bool console_is_rx_ready(void)
+{
+	return false;
+}
+
+char console_get_char(void)
+{
+	return 0;
+}
+
+struct netif* host_route_src(const ip4_addr_t* dest, const ip4_addr_t* src)
+{
+	struct netif* netif;
+
+	if (src == NULL)
+		return NULL;
+
+	/* Datagrams leave through the netif of their source address, or the
+	 * one which received the request they reply to */
+	for (netif = netif_list; netif != NULL; netif = netif->next)
+		if (ip4_addr_cmp(src, netif_ip4_addr(netif)))
+			return netif;
+	if (ip_current_input_netif())
+		return ip_current_input_netif();
+
+	/* Datagrams to a netif address are looped back by this netif */
+	for (netif = netif_list; netif != NULL; netif = netif->next)
+		if (ip4_addr_cmp(dest, netif_ip4_addr(netif)))
+			return netif;
+	return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ *        Peer
+ *----------------------------------------------------------------------------*/
+
+static struct {
+	struct tcp_pcb* pcb;
+	uint32_t bytes;
+	bool closed;
+	char report[BENCH_REPORT_SIZE];
+	uint32_t echoes;
+} peer;
+
+static void _host_poll(void)
+{
+	int i;
+
+	for (i = 0; i < PORTS; i++)
+		ethif_poll(&netifs[i]);
+	netif_poll_all();
+}
+
+static bool _host_idle(void)
+{
+	int i;
+
+	for (i = 0; i < PORTS; i++)
+		if (ports[i].tx_count || ethif_rx_pending(&netifs[i]) ||
+		    netifs[i].loop_first)
+			return false;
+	return true;
+}
+
+static void _host_poll_until(bool (*done)(void))
+{
+	uint64_t start = timer_get_tick();
+
+	do {
+		CHECK(_bench_elapsed(start) < POLL_TIMEOUT);
+		_host_poll();
+	} while (!done());
+}
+
+static void _peer_tcp_err(void* arg, err_t err)
+{
+	CHECK(false);
+}
+
+static err_t _peer_tcp_recv(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err)
+{
+	if (p == NULL) {
+		tcp_close(pcb);
+		peer.pcb = NULL;
+		peer.closed = true;
+		return ERR_OK;
+	}
+
+	peer.bytes += p->tot_len;
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static void _peer_tcp_fill(struct tcp_pcb* pcb)
+{
+	u16_t len;
+
+	while (peer.bytes < TCP_RX_BYTES && (len = tcp_sndbuf(pcb)) > 0) {
+		if (len > sizeof(_pattern))
+			len = sizeof(_pattern);
+		if (len > TCP_RX_BYTES - peer.bytes)
+			len = TCP_RX_BYTES - peer.bytes;
+		if (tcp_write(pcb, _pattern, len, 0) != ERR_OK)
+			break;
+		peer.bytes += len;
+	}
+	tcp_output(pcb);
+
+	if (peer.bytes == TCP_RX_BYTES && !peer.closed) {
+		tcp_sent(pcb, NULL);
+		CHECK(tcp_close(pcb) == ERR_OK);
+		peer.pcb = NULL;
+		peer.closed = true;
+	}
+}
+
+static err_t _peer_tcp_sent(void* arg, struct tcp_pcb* pcb, u16_t len)
+{
+	_peer_tcp_fill(pcb);
+	return ERR_OK;
+}
+
+static err_t _peer_tcp_connected(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	CHECK(err == ERR_OK);
+	if (arg)
+		_peer_tcp_fill(pcb);
+	return ERR_OK;
+}
+
+/** Connect the peer to a TCP port of the example, as a sender or receiver */
+static void _peer_tcp_connect(u16_t port, bool sender)
+{
+	ip_addr_t local, remote;
+
+	memset(&peer, 0, sizeof(peer));
+	PEER_IP_ADDR(&local);
+	IP4_ADDR(&remote, _ip_addr[0], _ip_addr[1], _ip_addr[2], _ip_addr[3]);
+
+	peer.pcb = tcp_new();
+	CHECK(peer.pcb != NULL);
+	CHECK(tcp_bind(peer.pcb, &local, 0) == ERR_OK);
+	tcp_arg(peer.pcb, sender ? &peer : NULL);
+	tcp_err(peer.pcb, _peer_tcp_err);
+	if (sender)
+		tcp_sent(peer.pcb, _peer_tcp_sent);
+	else
+		tcp_recv(peer.pcb, _peer_tcp_recv);
+	CHECK(tcp_connect(peer.pcb, &remote, port, _peer_tcp_connected) == ERR_OK);
+}
+
+static void _peer_udp_recv(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+		const ip_addr_t* addr, u16_t port)
+{
+	if (port == BENCH_PORT_ECHO) {
+		CHECK(p->tot_len == sizeof(_pattern));
+		CHECK(pbuf_memcmp(p, 0, _pattern, sizeof(_pattern)) == 0);
+		peer.echoes++;
+	} else {
+		CHECK(p->tot_len < sizeof(peer.report));
+		pbuf_copy_partial(p, peer.report, p->tot_len, 0);
+		peer.report[p->tot_len] = '\0';
+	}
+	pbuf_free(p);
+}
+
+static void _peer_udp_send(struct udp_pcb* pcb, const ip_addr_t* addr,
+		u16_t port, const void* data, u16_t size)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+
+	CHECK(p != NULL);
+	pbuf_take(p, data, size);
+	CHECK(udp_sendto(pcb, p, addr, port) == ERR_OK);
+	pbuf_free(p);
+	_host_poll_until(_host_idle);
+}
+
+static uint32_t _report_value(const char* report, const char* name)
+{
+	char key[32];
+	const char* value;
+
+	snprintf(key, sizeof(key), "\"%s\":", name);
+	value = strstr(report, key);
+	CHECK(value != NULL);
+	return strtoul(value + strlen(key), NULL, 10);
+}
+
+/*----------------------------------------------------------------------------
+ *        Benchmarks
+ *----------------------------------------------------------------------------*/
+
+static bool _tcp_loopback_done(void)
+{
+	return !_tcp_source.pcb && !_tcp_sink.pcb;
+}
+
+static bool _tcp_tx_done(void)
+{
+	return peer.closed && !_tcp_source.pcb;
+}
+
+static bool _tcp_rx_done(void)
+{
+	return peer.closed && _tcp_sink.test && !_tcp_sink.pcb;
+}
+
+static bool _udp_report_received(void)
+{
+	return peer.report[0] != '\0';
+}
+
+static void test_tcp_loopback(void)
+{
+	uint32_t frames = stats.frames;
+
+	memset(&_tcp_sink, 0, sizeof(_tcp_sink));
+	_bench_tcp_loopback();
+	_host_poll_until(_tcp_loopback_done);
+
+	CHECK(!strcmp(_tcp_source.test, "tcp_loopback_tx"));
+	CHECK(!strcmp(_tcp_sink.test, "tcp_loopback_rx"));
+	CHECK(_tcp_source.bytes > 0);
+	CHECK(_tcp_sink.bytes >= _tcp_source.bytes);
+
+	/* The ETH link is not used */
+	CHECK(stats.frames == frames);
+}
+
+static void test_tcp_tx(void)
+{
+	_peer_tcp_connect(BENCH_PORT_SOURCE, false);
+	_host_poll_until(_tcp_tx_done);
+
+	CHECK(!strcmp(_tcp_source.test, "tcp_tx"));
+	CHECK(_tcp_source.bytes > 0);
+	CHECK(peer.bytes >= _tcp_source.bytes);
+}
+
+static void test_tcp_rx(void)
+{
+	memset(&_tcp_sink, 0, sizeof(_tcp_sink));
+	_peer_tcp_connect(BENCH_PORT_SINK, true);
+	_host_poll_until(_tcp_rx_done);
+
+	CHECK(!strcmp(_tcp_sink.test, "tcp_rx"));
+	CHECK(_tcp_sink.bytes == TCP_RX_BYTES);
+}
+
+/**
+ * Send datagrams to the UDP sink, through the link if the peer address is
+ * used, and check the report returned by the sink
+ */
+static void test_udp(bool link)
+{
+	struct udp_pcb* pcb = udp_new();
+	uint8_t data[UDP_SIZE];
+	ip_addr_t local, remote;
+	uint32_t seq;
+
+	memset(&peer, 0, sizeof(peer));
+	if (link) {
+		PEER_IP_ADDR(&local);
+		IP4_ADDR(&remote, _ip_addr[0], _ip_addr[1], _ip_addr[2], _ip_addr[3]);
+	} else {
+		ip_addr_set_any(false, &local);
+		IP4_ADDR(&remote, 127, 0, 0, 1);
+	}
+	CHECK(pcb != NULL);
+	CHECK(udp_bind(pcb, &local, 0) == ERR_OK);
+	udp_recv(pcb, _peer_udp_recv, NULL);
+
+	_peer_udp_send(pcb, &remote, BENCH_PORT_SINK, "RST", 4);
+	memset(data, 0x5a, sizeof(data));
+	for (seq = 0; seq < UDP_DATAGRAMS; seq++) {
+		data[0] = seq >> 24;
+		data[1] = seq >> 16;
+		data[2] = seq >> 8;
+		data[3] = seq;
+		_peer_udp_send(pcb, &remote, BENCH_PORT_SINK, data, sizeof(data));
+	}
+	_peer_udp_send(pcb, &remote, BENCH_PORT_SINK, "END", 4);
+	_host_poll_until(_udp_report_received);
+
+	CHECK(_report_value(peer.report, "datagrams") == UDP_DATAGRAMS);
+	CHECK(_report_value(peer.report, "bytes") == UDP_DATAGRAMS * UDP_SIZE);
+	CHECK(_report_value(peer.report, "lost") == 0);
+	CHECK(_report_value(peer.report, "out_of_order") == 0);
+
+	/* Round trip through the echo service */
+	_peer_udp_send(pcb, &remote, BENCH_PORT_ECHO, _pattern, sizeof(_pattern));
+	CHECK(peer.echoes == 1);
+
+	udp_remove(pcb);
+}
+
+int main(void)
+{
+	ip_addr_t ipaddr, netmask, gw;
+	int i, j;
+
+	for (i = 0; i < PORTS; i++)
+		for (j = 0; j < RX_FRAME_BUFFERS; j++)
+			ports[i].rx_buffers[j] = rx_memory[i][j];
+
+	lwip_init();
+
+	IP4_ADDR(&gw, _gw_ip_addr[0], _gw_ip_addr[1], _gw_ip_addr[2], _gw_ip_addr[3]);
+	IP4_ADDR(&ipaddr, _ip_addr[0], _ip_addr[1], _ip_addr[2], _ip_addr[3]);
+	IP4_ADDR(&netmask, _netmask[0], _netmask[1], _netmask[2], _netmask[3]);
+	CHECK(netif_add(&netifs[0], &ipaddr, &netmask, &gw, NULL, ethif_init,
+			ip_input) == &netifs[0]);
+	PEER_IP_ADDR(&ipaddr);
+	CHECK(netif_add(&netifs[1], &ipaddr, &netmask, &gw, NULL, ethif_init,
+			ip_input) == &netifs[1]);
+	netif_set_default(&netifs[0]);
+	for (i = 0; i < PORTS; i++) {
+		/* The netif number selects the ETH port */
+		CHECK(netifs[i].num == i);
+		netif_set_up(&netifs[i]);
+	}
+
+	/* ethif serves the RX queues in polling mode, starting with the
+	 * frames received before its RX interrupt callback was set */
+	for (i = 0; i < PORTS; i++) {
+		CHECK(ports[i].rx_polling);
+		CHECK(ports[i].rx_callback != NULL);
+		CHECK(ethif_rx_pending(&netifs[i]));
+	}
+	_host_poll();
+	for (i = 0; i < PORTS; i++) {
+		CHECK(!ethif_rx_pending(&netifs[i]));
+		CHECK(ports[i].rx_irq);
+	}
+
+	_bench_tcp_init();
+	_bench_udp_init();
+
+	test_tcp_loopback();
+	test_udp(false);
+	test_udp(true);
+	test_tcp_tx();
+	test_tcp_rx();
+
+	_host_poll_until(_host_idle);
+
+	printf("eth_bench: %u frames (%u scatter-gather), %u RX buffers swapped, "
+	       "%u RX interrupts, %u budgets exhausted\n",
+	       (unsigned)stats.frames, (unsigned)stats.sg_frames,
+	       (unsigned)stats.rx_swaps, (unsigned)stats.rx_irqs,
+	       (unsigned)stats.budget_exhausted);
+
+	/* Each path of ethif is exercised, no frame is dropped */
+	CHECK(stats.sg_frames > 0);
+	CHECK(stats.rx_swaps > 0);
+	CHECK(stats.rx_irqs > 0);
+	CHECK(stats.budget_exhausted > 0);
+	CHECK(lwip_stats.link.drop == 0);
+	CHECK(lwip_stats.link.memerr == 0);
+	CHECK(lwip_stats.link.chkerr == 0);
+
+	printf("eth_bench: OK\n");
+	return 0;
+}
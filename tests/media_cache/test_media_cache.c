@@ -0,0 +1,330 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the block cache media, on top of a RAM disk whose requests
+ * are counted. The data read through the cache must always match a
+ * reference copy, and the backend requests must show the line replacement,
+ * read-ahead and write-back behaviour.
+ */
+
+#include "host.h"
+#include "intmath.h"
+
+#include "libstoragemedia/media.h"
+#include "libstoragemedia/media_private.h"
+#include "libstoragemedia/media_cache.h"
+#include "libstoragemedia/media_ramdisk.h"
+
+#include "mm/cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Counting RAM disk
+ *----------------------------------------------------------------------------*/
+
+#define BLOCK_SIZE      512
+#define NUM_BLOCKS      1000
+#define NUM_LINES       16
+#define BLOCKS_PER_LINE 8
+#define MAX_READAHEAD   8
+
+static uint8_t disk[NUM_BLOCKS * BLOCK_SIZE] ALIGNED(BLOCK_SIZE);
+static uint8_t ref[NUM_BLOCKS * BLOCK_SIZE];
+static uint8_t buffer[MEDIA_CACHE_BUFFER_SIZE(NUM_LINES, BLOCKS_PER_LINE,
+		BLOCK_SIZE)] ALIGNED(L1_CACHE_BYTES);
+static uint8_t data[32 * BLOCK_SIZE];
+
+static struct _media ramdisk;
+static struct _media media;
+static struct _media_cache cache;
+
+static uint8_t (*ramdisk_read)(struct _media *, uint32_t, void *, uint32_t,
+		media_callback_t, void *);
+static uint8_t (*ramdisk_write)(struct _media *, uint32_t, void *, uint32_t,
+		media_callback_t, void *);
+
+static uint32_t backend_reads;
+static uint32_t backend_writes;
+static uint32_t backend_written;
+
+static uint8_t counting_read(struct _media *m, uint32_t address, void *buf,
+		uint32_t length, media_callback_t callback, void *arg)
+{
+	backend_reads++;
+	return ramdisk_read(m, address, buf, length, callback, arg);
+}
+
+static uint8_t counting_write(struct _media *m, uint32_t address, void *buf,
+		uint32_t length, media_callback_t callback, void *arg)
+{
+	backend_writes++;
+	backend_written += length;
+	return ramdisk_write(m, address, buf, length, callback, arg);
+}
+
+static void setup(uint16_t num_lines, uint8_t max_readahead)
+{
+	uint32_t i;
+
+	for (i = 0; i < sizeof(disk); i++)
+		disk[i] = ref[i] = rand();
+
+	/* the RAM disk base address is given in blocks */
+	media_ramdisk_init(&ramdisk, (uint32_t)disk / BLOCK_SIZE, NUM_BLOCKS,
+			BLOCK_SIZE);
+	ramdisk_read = ramdisk.read;
+	ramdisk_write = ramdisk.write;
+	ramdisk.read = counting_read;
+	ramdisk.write = counting_write;
+
+	CHECK(media_cache_initialize(&media, &cache, &ramdisk, buffer,
+				num_lines, BLOCKS_PER_LINE, max_readahead)
+			== MEDIA_STATUS_SUCCESS);
+	backend_reads = backend_writes = backend_written = 0;
+}
+
+static void check_stats_match_backend(void)
+{
+	struct _media_cache_stats stats;
+
+	media_cache_get_stats(&media, &stats);
+	CHECK(stats.backend_reads == backend_reads);
+	CHECK(stats.backend_writes == backend_writes);
+	CHECK(stats.written_back == backend_written);
+}
+
+static void read_and_check(uint32_t address, uint32_t length)
+{
+	CHECK(media_read(&media, address, data, length, NULL, NULL)
+			== MEDIA_STATUS_SUCCESS);
+	CHECK(memcmp(data, ref + address * BLOCK_SIZE,
+				length * BLOCK_SIZE) == 0);
+}
+
+static void write_random(uint32_t address, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length * BLOCK_SIZE; i++)
+		data[i] = rand();
+	memcpy(ref + address * BLOCK_SIZE, data, length * BLOCK_SIZE);
+	CHECK(media_write(&media, address, data, length, NULL, NULL)
+			== MEDIA_STATUS_SUCCESS);
+}
+
+/*----------------------------------------------------------------------------
+ *        Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_initialize(void)
+{
+	static uint8_t unaligned[BLOCK_SIZE * 2] ALIGNED(L1_CACHE_BYTES);
+
+	setup(NUM_LINES, MAX_READAHEAD);
+	CHECK(media_cache_initialize(&media, &cache, &ramdisk, buffer,
+				0, BLOCKS_PER_LINE, 0) != MEDIA_STATUS_SUCCESS);
+	CHECK(media_cache_initialize(&media, &cache, &ramdisk, buffer,
+				MEDIA_CACHE_MAX_LINES + 1, BLOCKS_PER_LINE, 0)
+			!= MEDIA_STATUS_SUCCESS);
+	CHECK(media_cache_initialize(&media, &cache, &ramdisk, buffer,
+				NUM_LINES, MEDIA_CACHE_MAX_BLOCKS_PER_LINE + 1, 0)
+			!= MEDIA_STATUS_SUCCESS);
+	CHECK(media_cache_initialize(&media, &cache, &ramdisk, unaligned + 4,
+				1, 1, 0) != MEDIA_STATUS_SUCCESS);
+	CHECK(media_cache_initialize(&media, &cache, &ramdisk, buffer,
+				NUM_LINES, BLOCKS_PER_LINE, MAX_READAHEAD)
+			== MEDIA_STATUS_SUCCESS);
+	CHECK(media.size == NUM_BLOCKS);
+	CHECK(media.block_size == BLOCK_SIZE);
+	CHECK(media_read(&media, NUM_BLOCKS - 1, data, 2, NULL, NULL)
+			== MEDIA_STATUS_ERROR);
+}
+
+static void test_lru(void)
+{
+	uint32_t reads;
+	int i;
+
+	/* 4 lines, no read-ahead */
+	setup(4, 0);
+
+	for (i = 0; i < 4; i++)
+		read_and_check(i * 2 * BLOCKS_PER_LINE, 1);
+	CHECK(backend_reads == 4);
+
+	/* use the first line again, the second becomes the oldest */
+	read_and_check(0, 1);
+	CHECK(backend_reads == 4);
+
+	read_and_check(8 * BLOCKS_PER_LINE, 1);
+	CHECK(backend_reads == 5);
+
+	reads = backend_reads;
+	read_and_check(0, 1);
+	CHECK(backend_reads == reads);
+	read_and_check(2 * BLOCKS_PER_LINE, 1);
+	CHECK(backend_reads == reads + 1);
+
+	check_stats_match_backend();
+}
+
+static void test_sequential_read(void)
+{
+	struct _media_cache_stats stats;
+	uint32_t i;
+
+	setup(NUM_LINES, MAX_READAHEAD);
+
+	for (i = 0; i < NUM_BLOCKS; i++)
+		read_and_check(i, 1);
+
+	/* whole lines are read, ahead of the reader */
+	media_cache_get_stats(&media, &stats);
+	CHECK(backend_reads <= CEIL_INT_DIV(NUM_BLOCKS, BLOCKS_PER_LINE) + 1);
+	CHECK(stats.read_hits + stats.read_misses == NUM_BLOCKS);
+	CHECK(stats.read_misses <= BLOCKS_PER_LINE);
+	CHECK(stats.readahead > NUM_BLOCKS / 2);
+	CHECK(stats.readahead_unused == 0);
+	check_stats_match_backend();
+
+	/* random reads shrink the read-ahead window back */
+	media_cache_reset_stats(&media);
+	backend_reads = backend_writes = backend_written = 0;
+	for (i = 0; i < 200; i++)
+		read_and_check(rand() % NUM_BLOCKS, 1);
+	media_cache_get_stats(&media, &stats);
+	CHECK(stats.readahead <= 2 * BLOCKS_PER_LINE * MAX_READAHEAD);
+	check_stats_match_backend();
+}
+
+static void test_write_back(void)
+{
+	struct _media_cache_stats stats;
+	uint32_t i;
+
+	setup(NUM_LINES, MAX_READAHEAD);
+
+	/* single block writes stay in the cache */
+	write_random(0, 1);
+	CHECK(backend_writes == 0);
+	CHECK(memcmp(disk, ref, BLOCK_SIZE) != 0);
+	read_and_check(0, 1);
+
+	/* and are coalesced into one write per line */
+	for (i = 1; i < NUM_BLOCKS; i++)
+		write_random(i, 1);
+	CHECK(media_flush(&media) == MEDIA_STATUS_SUCCESS);
+	CHECK(backend_writes == CEIL_INT_DIV(NUM_BLOCKS, BLOCKS_PER_LINE));
+	CHECK(backend_written == NUM_BLOCKS);
+	CHECK(backend_reads == 0);
+	CHECK(memcmp(disk, ref, sizeof(disk)) == 0);
+
+	media_cache_get_stats(&media, &stats);
+	CHECK(stats.write_hits + stats.write_misses == NUM_BLOCKS);
+	check_stats_match_backend();
+
+	/* nothing left to write back */
+	CHECK(media_flush(&media) == MEDIA_STATUS_SUCCESS);
+	CHECK(backend_writes == CEIL_INT_DIV(NUM_BLOCKS, BLOCKS_PER_LINE));
+
+	/* dirty blocks are written back on invalidate */
+	write_random(3, 2);
+	CHECK(media_cache_invalidate(&media) == MEDIA_STATUS_SUCCESS);
+	CHECK(memcmp(disk, ref, sizeof(disk)) == 0);
+}
+
+static void test_trim(void)
+{
+	uint8_t old[BLOCK_SIZE];
+
+	setup(NUM_LINES, MAX_READAHEAD);
+
+	memcpy(old, disk + 5 * BLOCK_SIZE, BLOCK_SIZE);
+	write_random(4, 3);
+	CHECK(media_trim(&media, 5, 1) == MEDIA_STATUS_SUCCESS);
+	CHECK(media_flush(&media) == MEDIA_STATUS_SUCCESS);
+
+	/* the trimmed block is not written back, its neighbours are */
+	CHECK(memcmp(disk + 5 * BLOCK_SIZE, old, BLOCK_SIZE) == 0);
+	CHECK(memcmp(disk + 4 * BLOCK_SIZE, ref + 4 * BLOCK_SIZE,
+				BLOCK_SIZE) == 0);
+	CHECK(memcmp(disk + 6 * BLOCK_SIZE, ref + 6 * BLOCK_SIZE,
+				BLOCK_SIZE) == 0);
+	CHECK(backend_writes == 2);
+}
+
+static void test_random(void)
+{
+	uint32_t i;
+
+	setup(NUM_LINES, MAX_READAHEAD);
+
+	for (i = 0; i < 20000; i++) {
+		uint32_t address = rand() % NUM_BLOCKS;
+		uint32_t length = 1 + rand() % 20;
+
+		if (address + length > NUM_BLOCKS)
+			length = NUM_BLOCKS - address;
+		if (rand() % 3 == 0)
+			write_random(address, length);
+		else
+			read_and_check(address, length);
+
+		if (rand() % 1000 == 0)
+			CHECK(media_flush(&media) == MEDIA_STATUS_SUCCESS);
+	}
+
+	CHECK(media_flush(&media) == MEDIA_STATUS_SUCCESS);
+	CHECK(memcmp(disk, ref, sizeof(disk)) == 0);
+	check_stats_match_backend();
+}
+
+/*----------------------------------------------------------------------------
+ *        Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	srand(1);
+
+	test_initialize();
+	test_lru();
+	test_sequential_read();
+	test_write_back();
+	test_trim();
+	test_random();
+
+	printf("media_cache: OK\n");
+	return 0;
+}
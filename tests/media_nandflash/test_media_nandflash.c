@@ -0,0 +1,505 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the NAND flash translation layer media, on top of a RAM
+ * backed NAND device. The device injects power cuts during program and erase
+ * operations, program and erase failures, bitflips in the page tags and
+ * uncorrectable pages.
+ */
+
+#include "host.h"
+#include "intmath.h"
+
+#include "libstoragemedia/media.h"
+#include "libstoragemedia/media_private.h"
+#include "libstoragemedia/media_nandflash.h"
+
+#include "nvm/nand/nand_flash_common.h"
+#include "nvm/nand/nand_flash_ecc.h"
+#include "nvm/nand/nand_flash_model.h"
+#include "nvm/nand/nand_flash_raw.h"
+#include "nvm/nand/nand_flash_skip_block.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        RAM NAND device
+ *----------------------------------------------------------------------------*/
+
+#define NUM_BLOCKS      128
+#define PAGES_PER_BLOCK 16
+#define PAGE_SIZE       2048
+#define SPARE_SIZE      64
+#define TAG_OFFSET      30
+
+#define SECTORS_PER_PAGE (PAGE_SIZE / MEDIA_NANDFLASH_BLOCK_SIZE)
+
+static uint8_t mem[NUM_BLOCKS][PAGES_PER_BLOCK][PAGE_SIZE + SPARE_SIZE];
+static bool programmed[NUM_BLOCKS][PAGES_PER_BLOCK];
+static bool uncorrectable[NUM_BLOCKS][PAGES_PER_BLOCK];
+static bool erase_fails[NUM_BLOCKS];
+static uint32_t erase_counts[NUM_BLOCKS];
+
+/** Power cut: index of the program/erase operation to interrupt, -1 if none */
+static long cut_at = -1;
+static long cut_ops;
+static jmp_buf cut_jmp;
+
+/** Probability of a program failure, per 100000 operations, and number of
+ * failures left to inject: the reserve of the media is not exhausted */
+static int program_fail_rate;
+static int program_fails;
+
+/** Leaves some bits of a page unprogrammed, as an interrupted program */
+static void _tear_page(uint8_t *page, const uint8_t *data, const uint8_t *spare)
+{
+	int i;
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		page[i] &= data[i] | rand();
+	for (i = TAG_OFFSET; i < SPARE_SIZE; i++)
+		page[PAGE_SIZE + i] &= spare[i] | rand();
+}
+
+static bool _power_cut(void)
+{
+	return cut_at >= 0 && cut_ops++ == cut_at;
+}
+
+uint16_t nand_model_get_device_size_in_blocks(const struct _nand_flash_model *model)
+{
+	return NUM_BLOCKS;
+}
+
+uint16_t nand_model_get_block_size_in_pages(const struct _nand_flash_model *model)
+{
+	return PAGES_PER_BLOCK;
+}
+
+uint32_t nand_model_get_page_data_size(const struct _nand_flash_model *model)
+{
+	return PAGE_SIZE;
+}
+
+uint16_t nand_model_get_page_spare_size(const struct _nand_flash_model *model)
+{
+	return SPARE_SIZE;
+}
+
+uint16_t nand_ecc_get_spare_free_offset(const struct _nand_flash *nand)
+{
+	return TAG_OFFSET;
+}
+
+uint8_t nand_skipblock_check_block(const struct _nand_flash *nand, uint16_t block)
+{
+	if (mem[block][0][PAGE_SIZE] != 0xff || mem[block][1][PAGE_SIZE] != 0xff)
+		return BADBLOCK;
+	return GOODBLOCK;
+}
+
+uint8_t nand_skipblock_tag_block(struct _nand_flash *nand, uint16_t block,
+		bool bad)
+{
+	mem[block][0][PAGE_SIZE] = 0;
+	mem[block][1][PAGE_SIZE] = 0;
+	return 0;
+}
+
+uint8_t nand_raw_erase_block(const struct _nand_flash *nand, uint16_t block)
+{
+	int page;
+
+	if (_power_cut()) {
+		/* some pages are erased, the bad block markers are not
+		 * touched */
+		for (page = 0; page < PAGES_PER_BLOCK; page++) {
+			if (rand() & 1) {
+				memset(mem[block][page], 0xff, PAGE_SIZE + SPARE_SIZE);
+				programmed[block][page] = false;
+				uncorrectable[block][page] = false;
+			}
+		}
+		mem[block][0][PAGE_SIZE] = mem[block][1][PAGE_SIZE] = 0xff;
+		longjmp(cut_jmp, 1);
+	}
+	if (erase_fails[block])
+		return NAND_ERROR_BADBLOCK;
+
+	memset(mem[block], 0xff, sizeof(mem[block]));
+	memset(programmed[block], 0, sizeof(programmed[block]));
+	memset(uncorrectable[block], 0, sizeof(uncorrectable[block]));
+	erase_counts[block]++;
+	return 0;
+}
+
+uint8_t nand_raw_read_page(const struct _nand_flash *nand, uint16_t block,
+		uint16_t page, void *data, void *spare)
+{
+	if (data)
+		memcpy(data, mem[block][page], PAGE_SIZE);
+	if (spare)
+		memcpy(spare, mem[block][page] + PAGE_SIZE, SPARE_SIZE);
+	return 0;
+}
+
+uint8_t nand_ecc_read_page(const struct _nand_flash *nand, uint16_t block,
+		uint16_t page, void *data, void *spare)
+{
+	nand_raw_read_page(nand, block, page, data, spare);
+	return uncorrectable[block][page] ? NAND_ERROR_CORRUPTEDDATA : 0;
+}
+
+uint8_t nand_ecc_write_page(const struct _nand_flash *nand, uint16_t block,
+		uint16_t page, void *data, void *spare)
+{
+	uint8_t *p = mem[block][page];
+	int i;
+
+	/* NAND constraints: a page is programmed once, pages in order */
+	CHECK(!programmed[block][page]);
+	for (i = page + 1; i < PAGES_PER_BLOCK; i++)
+		CHECK(!programmed[block][i]);
+	programmed[block][page] = true;
+
+	if (_power_cut()) {
+		_tear_page(p, data, spare);
+		longjmp(cut_jmp, 1);
+	}
+	if (program_fails && rand() % 100000 < program_fail_rate) {
+		program_fails--;
+		_tear_page(p, data, spare);
+		return NAND_ERROR_CANNOTWRITE;
+	}
+	memcpy(p, data, PAGE_SIZE);
+	memcpy(p + PAGE_SIZE + TAG_OFFSET, (uint8_t*)spare + TAG_OFFSET,
+			SPARE_SIZE - TAG_OFFSET);
+	return 0;
+}
+
+static void nand_reset(unsigned seed)
+{
+	int i;
+
+	srand(seed);
+	memset(mem, 0xff, sizeof(mem));
+	memset(programmed, 0, sizeof(programmed));
+	memset(uncorrectable, 0, sizeof(uncorrectable));
+	memset(erase_fails, 0, sizeof(erase_fails));
+	memset(erase_counts, 0, sizeof(erase_counts));
+	cut_at = -1;
+	program_fail_rate = 0;
+	program_fails = 0;
+
+	/* factory bad blocks */
+	for (i = 0; i < 2; i++)
+		mem[rand() % NUM_BLOCKS][0][PAGE_SIZE] = 0;
+}
+
+/*----------------------------------------------------------------------------
+ *        Media
+ *----------------------------------------------------------------------------*/
+
+static struct _nand_flash nand;
+static struct _media media;
+static struct _media_nandflash ftl;
+static uint32_t workspace[1 << 14];
+
+/** Expected content, and the other content allowed after a power cut */
+static uint8_t *ref, *alt;
+
+/** Logical pages expected to fail reading */
+static bool lost[NUM_BLOCKS * PAGES_PER_BLOCK];
+
+static uint8_t buf[64 * MEDIA_NANDFLASH_BLOCK_SIZE];
+
+static uint8_t _mount(void)
+{
+	uint32_t size = media_nandflash_get_workspace_size(&nand);
+
+	CHECK(size && size <= sizeof(workspace));
+	return media_nandflash_initialize(&media, &ftl, &nand, workspace, size);
+}
+
+static void _mount_new(unsigned seed)
+{
+	nand_reset(seed);
+	CHECK(_mount() == MEDIA_STATUS_SUCCESS);
+
+	free(ref);
+	free(alt);
+	ref = malloc(media.size * MEDIA_NANDFLASH_BLOCK_SIZE);
+	alt = malloc(media.size * MEDIA_NANDFLASH_BLOCK_SIZE);
+	CHECK(ref && alt);
+	memset(ref, 0xff, media.size * MEDIA_NANDFLASH_BLOCK_SIZE);
+	memset(alt, 0xff, media.size * MEDIA_NANDFLASH_BLOCK_SIZE);
+	memset(lost, 0, sizeof(lost));
+}
+
+static void _write(uint32_t address, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length * MEDIA_NANDFLASH_BLOCK_SIZE; i++)
+		buf[i] = rand();
+	CHECK(media_write(&media, address, buf, length, NULL, NULL) ==
+			MEDIA_STATUS_SUCCESS);
+	memcpy(ref + address * MEDIA_NANDFLASH_BLOCK_SIZE, buf,
+			length * MEDIA_NANDFLASH_BLOCK_SIZE);
+	memcpy(alt + address * MEDIA_NANDFLASH_BLOCK_SIZE, buf,
+			length * MEDIA_NANDFLASH_BLOCK_SIZE);
+}
+
+/**
+ * Checks the content of the media, page by page. After a power cut, each
+ * sector may hold either the expected or the interrupted content, which
+ * then becomes the expected content.
+ */
+static void _verify(void)
+{
+	uint32_t lpage, i, offset;
+	uint8_t status;
+
+	for (lpage = 0; lpage < ftl.num_lpages; lpage++) {
+		offset = lpage * PAGE_SIZE;
+		status = media_read(&media, lpage * SECTORS_PER_PAGE, buf,
+				SECTORS_PER_PAGE, NULL, NULL);
+		if (lost[lpage]) {
+			CHECK(status != MEDIA_STATUS_SUCCESS);
+			continue;
+		}
+		CHECK(status == MEDIA_STATUS_SUCCESS);
+		for (i = 0; i < PAGE_SIZE; i++)
+			CHECK(buf[i] == ref[offset + i] ||
+			      buf[i] == alt[offset + i]);
+		memcpy(ref + offset, buf, PAGE_SIZE);
+		memcpy(alt + offset, buf, PAGE_SIZE);
+	}
+}
+
+/** Writes in a random place, mostly in a hot area */
+static void _random_write(void)
+{
+	uint32_t length = 1 + rand() % 32;
+	uint32_t address;
+
+	if (rand() % 4)
+		address = rand() % (media.size / 16);
+	else
+		address = rand() % (media.size - length);
+	_write(address, length);
+}
+
+/*----------------------------------------------------------------------------
+ *        Tests
+ *----------------------------------------------------------------------------*/
+
+/**
+ * Random writes interrupted by power cuts at random places, with program
+ * and erase failures. The media shall mount after each cut, with every
+ * sector holding either its old or its new content.
+ */
+static void test_power_cuts(unsigned seed)
+{
+	struct _media_nandflash_stats stats;
+	uint32_t length, address, i;
+	int iter, cuts = 0;
+
+	_mount_new(seed);
+	erase_fails[rand() % NUM_BLOCKS] = true;
+	program_fail_rate = 5;
+	program_fails = 3;
+
+	for (iter = 0; iter < 4000; iter++) {
+		if (rand() % 100 == 0) {
+			length = 1 + rand() % 32;
+			address = rand() % (media.size - length);
+			for (i = 0; i < length * MEDIA_NANDFLASH_BLOCK_SIZE; i++)
+				buf[i] = rand();
+			memcpy(alt + address * MEDIA_NANDFLASH_BLOCK_SIZE, buf,
+					length * MEDIA_NANDFLASH_BLOCK_SIZE);
+
+			cut_ops = 0;
+			cut_at = rand() % 40;
+			if (setjmp(cut_jmp)) {
+				cut_at = -1;
+				cuts++;
+				CHECK(_mount() == MEDIA_STATUS_SUCCESS);
+				_verify();
+				continue;
+			}
+			media_write(&media, address, buf, length, NULL, NULL);
+			cut_at = -1;
+			memcpy(ref + address * MEDIA_NANDFLASH_BLOCK_SIZE, buf,
+					length * MEDIA_NANDFLASH_BLOCK_SIZE);
+			continue;
+		}
+
+		_random_write();
+
+		if (rand() % 400 == 0) {
+			if (rand() & 1)
+				CHECK(media_nandflash_checkpoint(&media) ==
+						MEDIA_STATUS_SUCCESS);
+			CHECK(_mount() == MEDIA_STATUS_SUCCESS);
+			_verify();
+		}
+	}
+	_verify();
+
+	media_nandflash_get_stats(&media, &stats);
+	CHECK(cuts > 0 && stats.gc_runs > 0);
+}
+
+/** Flips one bit in the tag of a physical page */
+static void _flip_tag(uint16_t block, uint16_t page)
+{
+	mem[block][page][PAGE_SIZE + TAG_OFFSET + rand() % 12] ^=
+		1 << (rand() % 8);
+}
+
+/**
+ * Bitflips in the tags of the first pages of the blocks covered by a
+ * checkpoint, then of random pages. No data shall be lost at mount, nor by
+ * garbage collection which decides from the mapping which pages to move.
+ */
+static void test_tag_bitflips(unsigned seed)
+{
+	bool data_blocks[NUM_BLOCKS];
+	uint32_t erased[NUM_BLOCKS];
+	struct _media_nandflash_stats stats;
+	uint16_t block, page;
+	int iter;
+
+	_mount_new(seed);
+	for (iter = 0; iter < 1000; iter++)
+		_random_write();
+	for (block = 0; block < NUM_BLOCKS; block++)
+		data_blocks[block] = programmed[block][0];
+	memcpy(erased, erase_counts, sizeof(erased));
+	CHECK(media_nandflash_checkpoint(&media) == MEDIA_STATUS_SUCCESS);
+	for (iter = 0; iter < 300; iter++)
+		_random_write();
+
+	/* the data blocks covered by the checkpoint, not erased since */
+	for (block = 0; block < NUM_BLOCKS; block++)
+		if (data_blocks[block] && erased[block] == erase_counts[block])
+			_flip_tag(block, 0);
+	CHECK(_mount() == MEDIA_STATUS_SUCCESS);
+	_verify();
+
+	for (iter = 0; iter < 3000; iter++) {
+		if (rand() % 20 == 0) {
+			block = rand() % NUM_BLOCKS;
+			page = rand() % PAGES_PER_BLOCK;
+			if (programmed[block][page])
+				_flip_tag(block, page);
+		}
+		_random_write();
+	}
+	_verify();
+	media_nandflash_get_stats(&media, &stats);
+	CHECK(stats.lost_pages == 0);
+
+	/* the tags of the pages written since the last checkpoint are needed
+	 * to mount */
+	CHECK(media_nandflash_checkpoint(&media) == MEDIA_STATUS_SUCCESS);
+	CHECK(_mount() == MEDIA_STATUS_SUCCESS);
+	_verify();
+}
+
+/**
+ * An uncorrectable page fails reading and read-modify-write, and garbage
+ * collection marks it lost instead of moving it with a fresh ECC. Writing
+ * the whole logical page again recovers it.
+ */
+static void test_uncorrectable(unsigned seed)
+{
+	struct _media_nandflash_stats stats;
+	uint32_t lpage, other, ppage, i;
+	int iter;
+
+	_mount_new(seed);
+	for (i = 0; i < media.size; i += 32)
+		_write(i, min_u32(32, media.size - i));
+
+	lpage = ftl.num_lpages / 2;
+	ppage = ftl.l2p[lpage];
+	uncorrectable[ppage / PAGES_PER_BLOCK][ppage % PAGES_PER_BLOCK] = true;
+	lost[lpage] = true;
+
+	CHECK(media_read(&media, lpage * SECTORS_PER_PAGE, buf, 1, NULL, NULL)
+			!= MEDIA_STATUS_SUCCESS);
+	CHECK(media_write(&media, lpage * SECTORS_PER_PAGE + 1, buf, 1, NULL,
+			NULL) != MEDIA_STATUS_SUCCESS);
+
+	/* invalidate the other pages of the block, so that it is reclaimed */
+	for (other = 0; other < ftl.num_lpages; other++)
+		if (other != lpage &&
+		    ftl.l2p[other] / PAGES_PER_BLOCK == ppage / PAGES_PER_BLOCK)
+			_write(other * SECTORS_PER_PAGE, SECTORS_PER_PAGE);
+	for (iter = 0; iter < 2000; iter++) {
+		media_nandflash_get_stats(&media, &stats);
+		if (stats.lost_pages)
+			break;
+		_random_write();
+	}
+	CHECK(stats.lost_pages == 1);
+	CHECK(ftl.l2p[lpage] != ppage);
+	_verify();
+
+	/* the lost state is part of the checkpoint */
+	CHECK(media_nandflash_checkpoint(&media) == MEDIA_STATUS_SUCCESS);
+	CHECK(_mount() == MEDIA_STATUS_SUCCESS);
+	_verify();
+
+	_write(lpage * SECTORS_PER_PAGE, SECTORS_PER_PAGE);
+	lost[lpage] = false;
+	_verify();
+}
+
+int main(void)
+{
+	unsigned seed;
+
+	for (seed = 1; seed <= 4; seed++)
+		test_power_cuts(seed);
+	for (seed = 1; seed <= 4; seed++)
+		test_tag_bitflips(seed);
+	for (seed = 1; seed <= 4; seed++)
+		test_uncorrectable(seed);
+
+	printf("media_nandflash: OK\n");
+	return 0;
+}
@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Benchmark of the raw layer on the NAND flash simulator: time a block
+ * transfer takes on the simulated device, with and without the ONFI cache
+ * commands.
+ */
+
+#include "host.h"
+#include "sim_host.h"
+
+#include "nvm/nand/nand_flash_sim.h"
+#include "nvm/nand/nand_flash_skip_block.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PAGE_SIZE       2048
+#define PAGES_PER_BLOCK 64
+
+static struct _nand_flash nand;
+static uint8_t data[PAGES_PER_BLOCK * PAGE_SIZE];
+static uint8_t buf[PAGES_PER_BLOCK * PAGE_SIZE];
+
+static void report(const char *name, uint64_t start)
+{
+	uint64_t ns = nand_sim_get_time() - start;
+
+	printf("%-28s %8llu us %6llu KB/s\n", name,
+	    (unsigned long long)(ns / 1000),
+	    (unsigned long long)(sizeof(data) * 1000000ull / ns));
+}
+
+int main(void)
+{
+	uint64_t start;
+	uint32_t i;
+
+	memset(data, 0x5a, sizeof(data));
+	sim_host_setup(&nand);
+
+	CHECK(!nand_skipblock_erase_block(&nand, 10, NORMAL_ERASE));
+	start = nand_sim_get_time();
+	CHECK(!nand_raw_write_pages(&nand, 10, 0, PAGES_PER_BLOCK, data));
+	report("program, cache", start);
+
+	CHECK(!nand_skipblock_erase_block(&nand, 11, NORMAL_ERASE));
+	start = nand_sim_get_time();
+	for (i = 0; i < PAGES_PER_BLOCK; i++)
+		CHECK(!nand_raw_write_page(&nand, 11, i, data + i * PAGE_SIZE,
+		    NULL));
+	report("program, page by page", start);
+
+	start = nand_sim_get_time();
+	CHECK(!nand_raw_read_pages(&nand, 10, 0, PAGES_PER_BLOCK, buf, NULL));
+	report("read, cache", start);
+
+	start = nand_sim_get_time();
+	for (i = 0; i < PAGES_PER_BLOCK; i++)
+		CHECK(!nand_raw_read_page(&nand, 10, i, buf + i * PAGE_SIZE,
+		    NULL));
+	report("read, page by page", start);
+	CHECK(!memcmp(buf, data, sizeof(data)));
+	return 0;
+}
@@ -0,0 +1,150 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Board services of the NAND flash simulator tests: the timers run on the
+ * virtual clock of the simulated device. DMA, NFC and PMECC access the bus
+ * directly and cannot run on the simulator, so reaching them fails the test.
+ */
+
+#include "host.h"
+#include "sim_host.h"
+
+#include "timer.h"
+
+#include "dma/dma.h"
+#include "nvm/nand/nand_flash_dma.h"
+#include "nvm/nand/nand_flash_sim.h"
+#include "nvm/nand/nfc.h"
+
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------
+ *        Timers
+ *----------------------------------------------------------------------------*/
+
+void timer_start_timeout(struct _timeout* timeout, uint64_t count)
+{
+	timeout->start = timer_get_tick();
+	timeout->count = count;
+}
+
+uint8_t timer_timeout_reached(struct _timeout* timeout)
+{
+	return timer_get_tick() - timeout->start >= timeout->count;
+}
+
+uint64_t timer_get_tick(void)
+{
+	return nand_sim_get_time() / 1000000;
+}
+
+/*----------------------------------------------------------------------------
+ *        Bus masters the simulator does not model
+ *----------------------------------------------------------------------------*/
+
+uint8_t nand_dma_read(uint32_t src_address, uint32_t dest_address,
+		uint32_t size)
+{
+	CHECK(!"DMA is not supported by the simulator");
+	return 0;
+}
+
+uint8_t nand_dma_write(uint32_t src_address, uint32_t dest_address,
+		uint32_t size)
+{
+	CHECK(!"DMA is not supported by the simulator");
+	return 0;
+}
+
+uint8_t nand_dma_read_async(uint32_t src_address, uint32_t dest_address,
+		uint32_t size, struct _callback *cb)
+{
+	CHECK(!"DMA is not supported by the simulator");
+	return 0;
+}
+
+uint8_t nand_dma_write_async(uint32_t src_address, uint32_t dest_address,
+		uint32_t size, struct _callback *cb)
+{
+	CHECK(!"DMA is not supported by the simulator");
+	return 0;
+}
+
+void dma_poll(void)
+{
+	CHECK(!"DMA is not supported by the simulator");
+}
+
+void nfc_configure(uint32_t data_size, uint32_t spare_size,
+		bool read_spare, bool write_spare)
+{
+	CHECK(!"NFC is not supported by the simulator");
+}
+
+void nfc_enable(void)
+{
+}
+
+void nfc_disable(void)
+{
+}
+
+void nfc_send_cmd(uint32_t cmd, uint8_t *cycle_bytes)
+{
+	CHECK(!"NFC is not supported by the simulator");
+}
+
+void nfc_wait_xfr_done(void)
+{
+	CHECK(!"NFC is not supported by the simulator");
+}
+
+void nfc_wait_rb_busy(void)
+{
+	CHECK(!"NFC is not supported by the simulator");
+}
+
+/*----------------------------------------------------------------------------
+ *        Simulated device
+ *----------------------------------------------------------------------------*/
+
+void sim_host_setup(struct _nand_flash *nand)
+{
+	uint32_t size = nand_sim_get_storage_size(&nand_sim_default_config);
+	void *storage = malloc(size);
+
+	CHECK(storage);
+	CHECK(!nand_sim_initialize(&nand_sim_default_config, storage, size));
+	CHECK(!nand_initialize(nand));
+	CHECK(!nand_raw_initialize(nand, NULL));
+	CHECK(nand_onfi_device_detect(nand));
+	nand_set_ecc_type(ECC_NO);
+}
@@ -0,0 +1,191 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the NAND flash simulator, with the raw, skip-block, ONFI and
+ * scrubbing layers on top of it.
+ */
+
+#include "host.h"
+#include "sim_host.h"
+
+#include "nvm/nand/nand_flash_scrub.h"
+#include "nvm/nand/nand_flash_sim.h"
+#include "nvm/nand/nand_flash_skip_block.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_SIZE       2048
+#define SPARE_SIZE      64
+#define PAGES_PER_BLOCK 64
+
+static struct _nand_flash nand;
+static uint8_t data[PAGES_PER_BLOCK * PAGE_SIZE];
+static uint8_t buf[PAGES_PER_BLOCK * PAGE_SIZE];
+
+static void test_onfi(void)
+{
+	CHECK(nand_onfi_has_cache_read());
+	CHECK(nand_onfi_has_cache_program());
+	CHECK(nand_model_get_block_size_in_pages(&nand.model) == PAGES_PER_BLOCK);
+	CHECK(nand_model_get_page_data_size(&nand.model) == PAGE_SIZE);
+}
+
+static void test_bad_blocks(void)
+{
+	nand_sim_set_bad_block(5);
+	CHECK(nand_skipblock_check_block(&nand, 5) == BADBLOCK);
+	CHECK(nand_skipblock_check_block(&nand, 6) == GOODBLOCK);
+}
+
+static void test_cache_commands(void)
+{
+	struct _nand_sim_stats stats;
+
+	CHECK(!nand_skipblock_erase_block(&nand, 10, NORMAL_ERASE));
+	nand_sim_reset_stats();
+	CHECK(!nand_raw_write_pages(&nand, 10, 0, PAGES_PER_BLOCK, data));
+	nand_sim_get_stats(&stats);
+	CHECK(stats.cache_programs == PAGES_PER_BLOCK - 1);
+	CHECK(stats.page_programs == 1);
+
+	nand_sim_reset_stats();
+	memset(buf, 0, sizeof(buf));
+	CHECK(!nand_raw_read_pages(&nand, 10, 0, PAGES_PER_BLOCK, buf, NULL));
+	nand_sim_get_stats(&stats);
+	CHECK(stats.cache_reads == PAGES_PER_BLOCK);
+	CHECK(!memcmp(buf, data, sizeof(data)));
+}
+
+static void test_failures(void)
+{
+	uint8_t spare[SPARE_SIZE];
+
+	nand_sim_set_block_failure(11, false, true);
+	CHECK(!nand_skipblock_erase_block(&nand, 11, NORMAL_ERASE));
+	CHECK(nand_raw_write_pages(&nand, 11, 0, 4, data));
+	CHECK(nand_raw_write_page(&nand, 11, 0, data, NULL));
+
+	/* A block which fails to erase gets marked bad */
+	nand_sim_set_block_failure(12, true, false);
+	nand_skipblock_erase_block(&nand, 12, NORMAL_ERASE);
+	CHECK(!nand_raw_read_page(&nand, 12, 0, NULL, spare));
+	CHECK(spare[0] != 0xff);
+}
+
+static void _trigger_refresh(struct _nand_scrub *scrub, uint16_t block)
+{
+	const struct _nand_scrub_block *b = nand_scrub_get_block(scrub, block);
+	int i;
+
+	for (i = 0; !(b->flags & NAND_SCRUB_PENDING); i++) {
+		CHECK(i < 1000);
+		CHECK(!nand_scrub_read_page(scrub, block, i % PAGES_PER_BLOCK,
+		    buf, NULL));
+	}
+}
+
+static void test_scrub(void)
+{
+	static struct _nand_scrub scrub;
+	uint32_t size = nand_scrub_get_workspace_size(&nand);
+	void *workspace = malloc(size);
+	const struct _nand_scrub_block *b;
+	struct _nand_scrub_stats stats;
+	uint8_t spare[SPARE_SIZE];
+	uint16_t refreshes;
+	int steps, i;
+
+	CHECK(workspace);
+	CHECK(!nand_scrub_initialize(&scrub, &nand, workspace, size, 1000, 8));
+	nand_scrub_set_thresholds(&scrub, 100, 0);
+
+	/* A refresh keeps the data and the spare area of the block */
+	memset(spare, 0xff, sizeof(spare));
+	spare[10] = 0x5a;
+	CHECK(!nand_raw_write_page(&nand, 10, 3, NULL, spare));
+	_trigger_refresh(&scrub, 10);
+	while (nand_scrub_poll(&scrub, 5))
+		;
+	b = nand_scrub_get_block(&scrub, 10);
+	nand_scrub_get_stats(&scrub, &stats);
+	CHECK(b->refreshes == 1 && b->reads == 0 && !b->flags);
+	CHECK(stats.refreshes == 1 && stats.failures == 0);
+	CHECK(!nand_raw_read_pages(&nand, 10, 0, PAGES_PER_BLOCK, buf, NULL));
+	CHECK(!memcmp(buf, data, sizeof(data)));
+	CHECK(!nand_raw_read_page(&nand, 10, 3, NULL, spare));
+	CHECK(spare[10] == 0x5a);
+
+	/* A refresh interrupted at any step resumes from the saved map */
+	for (steps = 1; steps < 12; steps++) {
+		refreshes = nand_scrub_get_block(&scrub, 10)->refreshes;
+		_trigger_refresh(&scrub, 10);
+		for (i = 0; i < steps; i++)
+			nand_scrub_poll(&scrub, 0);
+		memset(&scrub, 0, sizeof(scrub));
+		CHECK(!nand_scrub_initialize(&scrub, &nand, workspace, size,
+		    1000, 8));
+		nand_scrub_set_thresholds(&scrub, 100, 0);
+		while (nand_scrub_poll(&scrub, 5))
+			;
+		CHECK(!nand_raw_read_pages(&nand, 10, 0, PAGES_PER_BLOCK, buf,
+		    NULL));
+		CHECK(!memcmp(buf, data, sizeof(data)));
+		b = nand_scrub_get_block(&scrub, 10);
+		CHECK(!(b->flags & (NAND_SCRUB_PENDING | NAND_SCRUB_FAILED)));
+		CHECK(b->refreshes >= refreshes);
+	}
+
+	/* The map survives a reload */
+	refreshes = nand_scrub_get_block(&scrub, 10)->refreshes;
+	memset(&scrub, 0, sizeof(scrub));
+	CHECK(!nand_scrub_initialize(&scrub, &nand, workspace, size, 1000, 8));
+	CHECK(nand_scrub_get_block(&scrub, 10)->refreshes == refreshes);
+	free(workspace);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	srand(1);
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = rand();
+	sim_host_setup(&nand);
+	test_onfi();
+	test_bad_blocks();
+	test_cache_commands();
+	test_failures();
+	test_scrub();
+	printf("nand_flash_sim: OK\n");
+	return 0;
+}
@@ -0,0 +1,237 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Syndrome and Berlekamp decode of the PMECC driver before the decode was
+ * reworked, kept as is to check the current driver against it.
+ */
+
+#include "pmecc_ref.h"
+
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define PMECC_NB_ERROR_MAX (25)
+
+/*----------------------------------------------------------------------------
+ *        Local types
+ *----------------------------------------------------------------------------*/
+
+struct _ref_desc {
+	int32_t tt;
+	int32_t mm;
+	int32_t nn;
+	const int16_t *alpha_to;
+	const int16_t *index_of;
+	int16_t partial_syn[2 * PMECC_NB_ERROR_MAX];
+	int16_t si[2 * PMECC_NB_ERROR_MAX];
+	int16_t smu[PMECC_NB_ERROR_MAX + 2][2 * PMECC_NB_ERROR_MAX + 1];
+	int16_t lmu[PMECC_NB_ERROR_MAX + 1];
+};
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _ref_desc ref_desc;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static void ref_substitute(void)
+{
+	int32_t i, j;
+	int16_t *si;
+	int16_t *partial_syn = ref_desc.partial_syn;
+	const int16_t *alpha_to = ref_desc.alpha_to;
+	const int16_t *index_of = ref_desc.index_of;
+
+	memset(ref_desc.si, 0, sizeof(ref_desc.si));
+	si = ref_desc.si;
+
+	/* Odd syndromes */
+	for (i = 1; i <= 2 * ref_desc.tt - 1; i = i + 2) {
+		si[i] = 0;
+		for (j = 0; j < ref_desc.mm; j++) {
+			if (partial_syn[i] & ((uint16_t)0x1 << j))
+				si[i] = alpha_to[(i * j)] ^ si[i];
+		}
+	}
+	/* Even syndrome = (Odd syndrome) ** 2 */
+	for (i = 2; i <= 2 * ref_desc.tt; i = i + 2) {
+		j = i / 2;
+		if (si[j] == 0) {
+			si[i] = 0;
+		} else {
+			si[i] = alpha_to[(2 * index_of[si[j]]) % ref_desc.nn];
+		}
+	}
+}
+
+static void ref_get_sigma(void)
+{
+	uint32_t dmu_0_count;
+	int32_t i, j, k;
+	int16_t *lmu = ref_desc.lmu;
+	int16_t *si = ref_desc.si;
+	int16_t tt = ref_desc.tt;
+
+	int32_t mu[PMECC_NB_ERROR_MAX + 1];
+	int32_t dmu[PMECC_NB_ERROR_MAX + 1];
+	int32_t delta[PMECC_NB_ERROR_MAX + 1];
+	int32_t ro;
+	int32_t largest;
+	int32_t diff;
+
+	dmu_0_count = 0;
+
+	/* -- First Row -- */
+	mu[0] = -1;
+	for (i = 0; i < (2 * PMECC_NB_ERROR_MAX + 1); i++)
+		ref_desc.smu[0][i] = 0;
+	ref_desc.smu[0][0] = 1;
+	dmu[0] = 1;
+	lmu[0] = 0;
+	delta[0] = (mu[0] * 2 - lmu[0]) >> 1;
+
+	/* -- Second Row -- */
+	mu[1] = 0;
+	for (i = 0; i < (2 * PMECC_NB_ERROR_MAX + 1); i++)
+		ref_desc.smu[1][i] = 0;
+	ref_desc.smu[1][0] = 1;
+	dmu[1] = si[1];
+	lmu[1] = 0;
+	delta[1] = (mu[1] * 2 - lmu[1]) >> 1;
+
+	for (i = 0; i < (2 * PMECC_NB_ERROR_MAX + 1); i++)
+		ref_desc.smu[tt + 1][i] = 0;
+
+	for (i = 1; i <= tt; i++) {
+		mu[i + 1] = i << 1;
+
+		if (dmu[i] == 0) {
+			dmu_0_count++;
+			if ((tt - (lmu[i] >> 1) - 1) & 0x1) {
+				if (dmu_0_count == (uint32_t)((tt - (lmu[i] >> 1) - 1) / 2) + 2) {
+					for (j = 0; j <= (lmu[i] >> 1) + 1; j++)
+						ref_desc.smu[tt + 1][j] = ref_desc.smu[i][j];
+					lmu[tt + 1] = lmu[i];
+					return;
+				}
+			} else {
+				if (dmu_0_count == (uint32_t)((tt - (lmu[i] >> 1) - 1) / 2) + 1) {
+					for (j = 0; j <= (lmu[i] >> 1) + 1; j++)
+						ref_desc.smu[tt + 1][j] = ref_desc.smu[i][j];
+					lmu[tt + 1] = lmu[i];
+					return;
+				}
+			}
+
+			for (j = 0; j <= (lmu[i] >> 1); j++)
+				ref_desc.smu[i + 1][j] = ref_desc.smu[i][j];
+
+			lmu[i + 1] = lmu[i];
+		} else {
+			/* find largest delta with dmu != 0 */
+			ro = 0;
+			largest = -1;
+			for (j = 0; j < i; j++) {
+				if (dmu[j]) {
+					if (delta[j] > largest) {
+						largest = delta[j];
+						ro = j;
+					}
+				}
+			}
+
+			diff = (mu[i] - mu[ro]);
+
+			if ((lmu[i] >> 1) > ((lmu[ro] >> 1) + diff))
+				lmu[i + 1] = lmu[i];
+			else
+				lmu[i + 1] = ((lmu[ro] >> 1) + diff) * 2;
+
+			for (k = 0; k < (2 * PMECC_NB_ERROR_MAX + 1); k++)
+				ref_desc.smu[i + 1][k] = 0;
+
+			for (k = 0; k <= (lmu[ro] >> 1); k++) {
+				if (ref_desc.smu[ro][k] && dmu[i])
+					ref_desc.smu[i + 1][k + diff] = ref_desc.alpha_to[(ref_desc.index_of[dmu[i]] +
+							(ref_desc.nn - ref_desc.index_of[dmu[ro]]) +
+							ref_desc.index_of[ref_desc.smu[ro][k]]) % ref_desc.nn];
+			}
+			for (k = 0; k <= (lmu[i] >> 1); k++)
+				ref_desc.smu[i + 1][k] ^= ref_desc.smu[i][k];
+		}
+
+		delta[i + 1] = (mu[i + 1] * 2 - lmu[i + 1]) >> 1;
+
+		if (i < tt) {
+			for (k = 0; k <= (lmu[i + 1] >> 1); k++) {
+				if (k == 0)
+					dmu[i + 1] = si[2 * (i - 1) + 3];
+				else if (ref_desc.smu[i + 1][k] && si[2 * (i - 1) + 3 - k])
+					dmu[i + 1] = ref_desc.alpha_to[(ref_desc.index_of[ref_desc.smu[i + 1][k]] +
+							ref_desc.index_of[si[2 * (i - 1) + 3 - k]]) % ref_desc.nn] ^ dmu[i + 1];
+			}
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int pmecc_ref_sigma(const int16_t *remainders, int tt, int mm,
+		const int16_t *alpha_to, const int16_t *index_of, int16_t *sigma)
+{
+	int i, degree;
+
+	memset(&ref_desc, 0, sizeof(ref_desc));
+	ref_desc.tt = tt;
+	ref_desc.mm = mm;
+	ref_desc.nn = (1 << mm) - 1;
+	ref_desc.alpha_to = alpha_to;
+	ref_desc.index_of = index_of;
+	for (i = 0; i < tt; i++)
+		ref_desc.partial_syn[1 + 2 * i] = remainders[i];
+
+	ref_substitute();
+	ref_get_sigma();
+
+	degree = ref_desc.lmu[tt + 1] >> 1;
+	for (i = 0; i <= tt; i++)
+		sigma[i] = i <= degree ? ref_desc.smu[tt + 1][i] : 0;
+	return degree;
+}
@@ -0,0 +1,54 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Reference PMECC decode: syndromes and error location polynomial as
+ * computed by the driver before the decode was reworked.
+ */
+
+#ifndef _PMECC_REF_H
+#define _PMECC_REF_H
+
+#include <stdint.h>
+
+/**
+ * \brief Compute the error location polynomial of a sector.
+ * \param remainders Remainders of the sector, as read from PMECC_REM.
+ * \param tt Error correcting capability.
+ * \param mm Degree of the Galois field, 13 or 14.
+ * \param alpha_to Galois field table.
+ * \param index_of Index of the Galois field table.
+ * \param sigma Receives the tt + 1 coefficients of the polynomial.
+ * \return Degree of the polynomial.
+ */
+extern int pmecc_ref_sigma(const int16_t *remainders, int tt, int mm,
+		const int16_t *alpha_to, const int16_t *index_of, int16_t *sigma);
+
+#endif /* _PMECC_REF_H */
@@ -0,0 +1,316 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the PMECC decode. Random bit errors are injected in the
+ * sectors of a page and the remainders the PMECC would have computed are
+ * derived from the error positions. The error location polynomial given to
+ * the PMERRLOC must match the one of the previous implementation, have its
+ * roots at the error positions, and the page must be restored once the
+ * error locations are returned.
+ */
+
+#include "host.h"
+#include "pmecc_ref.h"
+
+#include "chip.h"
+#include "nvm/nand/pmecc.h"
+#include "nvm/nand/pmecc_gf_512.h"
+#include "nvm/nand/pmecc_gf_1024.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define PAGE_SIZE 2048
+#define SPARE_SIZE 224
+#define ITERATIONS 400
+
+/*----------------------------------------------------------------------------
+ *        Peripheral stubs
+ *----------------------------------------------------------------------------*/
+
+Pmecc host_pmecc;
+Pmerrloc host_pmerrloc;
+
+/** Preset the result of the next error location */
+static void preset_error_location(const uint32_t *pos, int count, int roots)
+{
+	int i;
+
+	memset(&host_pmerrloc, 0, sizeof(host_pmerrloc));
+	*(uint32_t *)&host_pmerrloc.PMERRLOC_ISR = PMERRLOC_ISR_DONE |
+		((roots << PMERRLOC_ISR_ERR_CNT_Pos) & PMERRLOC_ISR_ERR_CNT_Msk);
+	for (i = 0; i < count; i++)
+		((uint32_t *)host_pmerrloc.PMERRLOC_EL)[i] = pos[i] + 1;
+}
+
+/*----------------------------------------------------------------------------
+ *        Galois field helpers
+ *----------------------------------------------------------------------------*/
+
+static const int16_t *alpha_to;
+static const int16_t *index_of;
+static int mm, nn;
+
+static int gf_mul(int a, int b)
+{
+	if (!a || !b)
+		return 0;
+	return alpha_to[(index_of[a] + index_of[b]) % nn];
+}
+
+/** Minimal polynomial of alpha^i, one bit per coefficient */
+static uint32_t minimal_polynomial(int i)
+{
+	int coef[16] = { 1 };
+	int conj[16];
+	int deg = 0, count = 0, e = i % nn, j, k;
+	uint32_t poly = 0;
+
+	do {
+		conj[count++] = e;
+		e = (e * 2) % nn;
+	} while (e != conj[0]);
+
+	for (k = 0; k < count; k++) {
+		int root = alpha_to[conj[k]];
+		int next[16] = { 0 };
+
+		for (j = 0; j <= deg; j++) {
+			next[j + 1] ^= coef[j];
+			next[j] ^= gf_mul(coef[j], root);
+		}
+		deg++;
+		memcpy(coef, next, sizeof(next));
+	}
+
+	for (j = 0; j <= deg; j++) {
+		CHECK(coef[j] == 0 || coef[j] == 1);
+		if (coef[j])
+			poly |= 1u << j;
+	}
+	return poly;
+}
+
+/** x^pos modulo a binary polynomial */
+static uint32_t xpow_mod(uint32_t pos, uint32_t poly)
+{
+	uint32_t top = 1u << (31 - __builtin_clz(poly));
+	uint32_t r = 1;
+
+	while (pos--) {
+		r <<= 1;
+		if (r & top)
+			r ^= poly;
+	}
+	return r;
+}
+
+/** Evaluate a polynomial at alpha^-pos */
+static int eval_at_position(const int16_t *poly, int degree, uint32_t pos)
+{
+	int x = alpha_to[(nn - pos % nn) % nn];
+	int v = 0, xp = 1, k;
+
+	for (k = 0; k <= degree; k++) {
+		v ^= gf_mul(poly[k], xp);
+		xp = gf_mul(xp, x);
+	}
+	return v;
+}
+
+/*----------------------------------------------------------------------------
+ *        Tests
+ *----------------------------------------------------------------------------*/
+
+static uint8_t page[PAGE_SIZE];
+static uint8_t original[PAGE_SIZE];
+static uint8_t ecc[SPARE_SIZE];
+
+static void test_erased(uint8_t sector_size, uint8_t tt)
+{
+	struct _pmecc_snapshot snapshot;
+	uint8_t bitflips[PMECC_MAX_SECTORS];
+	uint32_t sector_bytes = sector_size ? 1024 : 512;
+	uint32_t i;
+
+	CHECK(pmecc_initialize(sector_size, tt, PAGE_SIZE, SPARE_SIZE, 0, 0) == 0);
+
+	/* tt bitflips in sector 0, tt + 1 in sector 1 */
+	memset(page, 0xff, sizeof(page));
+	memset(ecc, 0xff, sizeof(ecc));
+	for (i = 0; i < tt; i++)
+		page[i * 7] &= ~(1 << (i & 7));
+	ecc[pmecc_get_ecc_bytes_per_page() / pmecc_get_sectors_per_page()] = 0xfe;
+	for (i = 0; i < tt; i++)
+		page[sector_bytes + i * 5] &= ~(1 << (i & 7));
+
+	memset(&snapshot, 0, sizeof(snapshot));
+	snapshot.status = 3;
+	preset_error_location(NULL, 0, 0);
+	pmecc_correct_snapshot(&snapshot, page, ecc, bitflips);
+
+	CHECK(bitflips[0] == tt);
+	for (i = 0; i < sector_bytes; i++)
+		CHECK(page[i] == 0xff);
+	/* not erased: decoded, remainders of zero give no error */
+	CHECK(bitflips[1] == 0);
+	CHECK(page[sector_bytes] != 0xff);
+}
+
+static void test_decode(uint8_t sector_size, uint8_t tt, bool snapshot_path)
+{
+	struct _pmecc_snapshot snapshot;
+	uint8_t bitflips[PMECC_MAX_SECTORS];
+	uint32_t minpoly[2 * PMECC_MAX_ERRORS];
+	uint32_t pos[PMECC_MAX_ERRORS + 2];
+	int16_t remainders[PMECC_MAX_ERRORS];
+	int16_t sigma[PMECC_MAX_ERRORS + 1];
+	uint32_t sector_bytes, sector_count, codeword_bits;
+	int iter, i, e, f;
+
+	CHECK(pmecc_initialize(sector_size, tt, PAGE_SIZE, SPARE_SIZE, 0, 0) == 0);
+	if (sector_size) {
+		pmecc_get_gf_1024_tables(&alpha_to, &index_of);
+		mm = 14;
+	} else {
+		pmecc_get_gf_512_tables(&alpha_to, &index_of);
+		mm = 13;
+	}
+	nn = (1 << mm) - 1;
+	sector_bytes = pmecc_get_sector_size();
+	sector_count = pmecc_get_sectors_per_page();
+	codeword_bits = sector_bytes * 8 + tt * mm;
+	CHECK(sector_bytes == (sector_size ? 1024u : 512u));
+
+	for (i = 1; i < 2 * tt; i += 2)
+		minpoly[i] = minimal_polynomial(i);
+
+	memset(ecc, 0, sizeof(ecc));
+
+	for (iter = 0; iter < ITERATIONS; iter++) {
+		uint32_t sector = rand() % sector_count;
+		int nerr = rand() % (tt + 3);
+		int degree;
+		uint32_t result;
+
+		for (i = 0; i < PAGE_SIZE; i++)
+			original[i] = rand();
+		memcpy(page, original, sizeof(page));
+
+		/* distinct error positions, in data or ECC bits */
+		for (e = 0; e < nerr; e++) {
+			do {
+				pos[e] = rand() % codeword_bits;
+				for (f = 0; f < e && pos[f] != pos[e]; f++);
+			} while (f < e);
+			if (pos[e] < sector_bytes * 8)
+				page[sector * sector_bytes + pos[e] / 8] ^= 1 << (pos[e] % 8);
+		}
+
+		/* remainders of the codeword by the minimal polynomials */
+		for (i = 0; i < tt; i++) {
+			uint32_t r = 0;
+
+			for (e = 0; e < nerr; e++)
+				r ^= xpow_mod(pos[e], minpoly[2 * i + 1]);
+			remainders[i] = r;
+		}
+
+		degree = pmecc_ref_sigma(remainders, tt, mm, alpha_to, index_of, sigma);
+
+		/* the PMERRLOC finds fewer roots than the degree when uncorrectable */
+		if (nerr <= tt)
+			preset_error_location(pos, nerr, nerr);
+		else
+			preset_error_location(NULL, 0, 0);
+
+		if (snapshot_path) {
+			memset(&snapshot, 0, sizeof(snapshot));
+			snapshot.status = 1 << sector;
+			memcpy(snapshot.remainders[sector], remainders, sizeof(remainders));
+			result = pmecc_correct_snapshot(&snapshot, page, ecc, bitflips);
+		} else {
+			memset(&host_pmecc, 0, sizeof(host_pmecc));
+			memcpy((void *)host_pmecc.PMECC_REM[sector].PMECC_REM,
+					remainders, tt * sizeof(remainders[0]));
+			result = pmecc_correction(1 << sector, (uint32_t)page);
+		}
+
+		/* same polynomial as the previous implementation */
+		CHECK(((host_pmerrloc.PMERRLOC_CFG & PMERRLOC_CFG_ERRNUM_Msk)
+				>> PMERRLOC_CFG_ERRNUM_Pos) == (uint32_t)degree);
+		for (i = 0; i <= degree; i++)
+			CHECK(host_pmerrloc.PMERRLOC_SIGMA[i] == (uint32_t)sigma[i]);
+
+		if (nerr <= tt) {
+			CHECK(degree == nerr);
+			for (e = 0; e < nerr; e++)
+				CHECK(eval_at_position(sigma, degree, pos[e]) == 0);
+			CHECK(result == 0);
+			CHECK(memcmp(page, original, sizeof(page)) == 0);
+			if (snapshot_path)
+				CHECK(bitflips[sector] == nerr);
+		} else if (degree) {
+			CHECK(result == 1);
+			if (snapshot_path)
+				CHECK(bitflips[sector] == PMECC_UNCORRECTABLE);
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *        Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	static const uint8_t tts[] = { 2, 4, 8, 12, 24 };
+	uint8_t sector_size;
+	uint32_t t;
+
+	srand(1);
+
+	for (sector_size = 0; sector_size < 2; sector_size++) {
+		for (t = 0; t < ARRAY_SIZE(tts); t++) {
+			test_decode(sector_size, tts[t], false);
+			test_decode(sector_size, tts[t], true);
+			test_erased(sector_size, tts[t]);
+		}
+	}
+
+	printf("pmecc: OK\n");
+	return 0;
+}
@@ -0,0 +1,413 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2018, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *
+ * Host test of the ADMA2 descriptor tables of the SDMMC driver. The driver
+ * source is built within the test, which runs its table builder, its two
+ * half chaining and its bounce buffers on a model of the ADMA2: the model
+ * runs the descriptor lines one at a time, moves the data of each line
+ * between the buffers and a device, and raises the DMA interrupt of the
+ * lines which request it, immediately or a few lines late.
+ *
+ * Random transfers, from single buffers or I/O vectors of any alignment,
+ * must move every byte of the data to or from its place, including the
+ * edges received in bounce buffers, and nothing else. A late interrupt may
+ * make the ADMA stop on a held End attribute, without moving stale data.
+ */
+
+#include "host.h"
+
+/* Build the driver here, for its local functions */
+#include "sdmmc/sdmmc.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+#define ITERATIONS 3000
+
+#define MAX_FRAGS 600
+
+#define POOL_SIZE (2 << 20)
+
+/*----------------------------------------------------------------------------
+ *        Board services
+ *----------------------------------------------------------------------------*/
+
+void SDD_Initialize(sSdCard * pSd, const void *pDrv, uint8_t bSlot,
+		    const sSdHalFunctions * pHalFunctions)
+{
+}
+
+Sdmmc* get_sdmmc_addr_from_id(uint32_t id)
+{
+	return NULL;
+}
+
+Tc* get_tc_addr_from_id(uint32_t id)
+{
+	return NULL;
+}
+
+uint32_t get_tc_id_from_addr(const Tc* addr, uint8_t channel)
+{
+	return 0;
+}
+
+void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
+{
+}
+
+void irq_enable(uint32_t source)
+{
+}
+
+void msleep(uint32_t count)
+{
+}
+
+void usleep(uint32_t count)
+{
+}
+
+void pmc_configure_peripheral(uint32_t id, const struct _pmc_periph_cfg* cfg,
+			      bool enable)
+{
+}
+
+uint32_t pmc_get_gck_clock(uint32_t id)
+{
+	return 0;
+}
+
+uint32_t pmc_get_peripheral_clock(uint32_t id)
+{
+	return 0;
+}
+
+void tc_configure(Tc* tc, uint32_t channel, uint32_t mode)
+{
+}
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint32_t dma_buf[1024] __attribute__((aligned(32)));
+
+/** Buffers of the transfers, and their initial content */
+static uint8_t pool[POOL_SIZE] __attribute__((aligned(32)));
+static uint8_t ref[POOL_SIZE];
+
+/** Data stream of the device */
+static uint8_t dev[POOL_SIZE];
+
+static sSdmmcIoVec iov[MAX_FRAGS];
+
+static struct {
+	uint32_t complete;
+	uint32_t chained;
+	uint32_t bounced_rx;    /* Received edges copied out of bounce buffers */
+	uint32_t late_stops;    /* Stops on a held End attribute */
+	uint32_t shortened;
+	uint32_t rejected;
+} stats;
+
+/*----------------------------------------------------------------------------
+ *        ADMA2 model
+ *----------------------------------------------------------------------------*/
+
+/** Sets the DMA buffer up as sdmmc_initialize() does */
+static void init_set(struct sdmmc_set *set, uint32_t size)
+{
+	uint32_t val;
+
+	memset(set, 0, sizeof(*set));
+	if (size * 4 >= (SDMMC_BOUNCE_SLOTS + 1) * SDMMC_BOUNCE_SIZE
+	    + 8 * SDMMC_DMADL_SIZE * 4) {
+		val = ((uint32_t)(dma_buf + size)
+		    - SDMMC_BOUNCE_SLOTS * SDMMC_BOUNCE_SIZE)
+		    & ~(SDMMC_BOUNCE_SIZE - 1);
+		set->bounce = (uint8_t *)val;
+		set->bounce_cnt = SDMMC_BOUNCE_SLOTS;
+		size = (val - (uint32_t)dma_buf) / 4;
+	}
+	set->table_size = size / SDMMC_DMADL_SIZE;
+	set->table = dma_buf;
+}
+
+static bool is_bounce(const struct sdmmc_set *set, const uint8_t *addr)
+{
+	return set->bounce_cnt && addr >= set->bounce
+	    && addr < set->bounce + SDMMC_BOUNCE_SLOTS * SDMMC_BOUNCE_SIZE;
+}
+
+/**
+ * Runs the descriptor table, the DMA interrupt being handled up to 'lag'
+ * lines after the line raising it.
+ * \return the count of bytes moved before the End attribute
+ */
+static uint32_t adma_run(struct sdmmc_set *set, sSdmmcCommand *cmd,
+			 uint32_t total, uint32_t lag)
+{
+	const bool rx = cmd->cmdOp.bmBits.xfrData == SDMMC_CMD_RX;
+	uint32_t *line = set->table;
+	uint32_t pending[64];
+	uint32_t npending = 0, xfered = 0, len, i;
+	uint8_t *addr;
+
+	for (;;) {
+		for (i = 0; i < npending; i++) {
+			if (pending[i]--)
+				continue;
+			sdmmc_chain_advance(set, cmd);
+			pending[i--] = pending[--npending];
+		}
+
+		CHECK(line >= set->table
+		    && line < set->table + set->table_size * SDMMC_DMADL_SIZE);
+		CHECK(line[0] & SDMMC_DMA0DL_ATTR_VALID);
+		if ((line[0] & SDMMC_DMA0DL_ATTR_ACT_Msk)
+		    == SDMMC_DMA0DL_ATTR_ACT_LINK) {
+			line = (uint32_t *)line[1];
+			continue;
+		}
+		CHECK((line[0] & SDMMC_DMA0DL_ATTR_ACT_Msk)
+		    == SDMMC_DMA0DL_ATTR_ACT_TRAN);
+
+		len = (line[0] & SDMMC_DMA0DL_LEN_Msk) >> SDMMC_DMA0DL_LEN_Pos;
+		if (len == 0)
+			len = SDMMC_DMADL_TRAN_LEN_MAX;
+		addr = (uint8_t *)line[1];
+		CHECK(!((uint32_t)addr & 3));
+		/* Received data only shares cache lines with bounce buffers */
+		if (rx && set->bounce_cnt && !is_bounce(set, addr))
+			CHECK(!((uint32_t)addr & 31) && !(len & 31));
+		CHECK(xfered + len <= total);
+		if (rx)
+			memcpy(addr, dev + xfered, len);
+		else
+			memcpy(dev + xfered, addr, len);
+		xfered += len;
+
+		if (line[0] & SDMMC_DMA0DL_ATTR_INT) {
+			CHECK(set->chained);
+			CHECK(npending < ARRAY_SIZE(pending));
+			if (lag)
+				pending[npending++] = rand() % lag;
+			else
+				sdmmc_chain_advance(set, cmd);
+		}
+		if (line[0] & SDMMC_DMA0DL_ATTR_END)
+			break;
+		line += SDMMC_DMADL_SIZE;
+	}
+
+	while (npending--)
+		sdmmc_chain_advance(set, cmd);
+	return xfered;
+}
+
+/*----------------------------------------------------------------------------
+ *        Tests
+ *----------------------------------------------------------------------------*/
+
+/** Fills a buffer with pseudo-random bytes, faster than rand() */
+static void fill_random(uint8_t *buf, uint32_t len)
+{
+	static uint32_t x = 1;
+
+	for (; len; len--, buf++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		*buf = (uint8_t)x;
+	}
+}
+
+/**
+ * Checks the buffers once the ADMA stopped: the received bytes are in place,
+ * or not copied out of their bounce buffer yet if the transfer failed, and
+ * nothing else changed.
+ */
+static void check_buffers(bool rx, uint32_t nfrags, uint32_t used,
+			  uint32_t xfered, bool complete)
+{
+	uint32_t off = 0, j, k, o, len;
+
+	if (!rx) {
+		for (j = 0; j < nfrags; j++) {
+			o = iov[j].pData - pool;
+			len = min_u32(iov[j].dwLen, xfered - min_u32(off, xfered));
+			CHECK(!memcmp(dev + off, ref + o, len));
+			off += iov[j].dwLen;
+		}
+		CHECK(!memcmp(pool, ref, used));
+		return;
+	}
+
+	for (j = 0; j < nfrags; j++) {
+		o = iov[j].pData - pool;
+		for (k = 0; k < iov[j].dwLen; k++, off++) {
+			if (off < xfered && pool[o + k] == dev[off])
+				ref[o + k] = dev[off];
+			else
+				CHECK(!complete);
+		}
+	}
+	CHECK(!memcmp(pool, ref, used));
+}
+
+static void test_transfers(unsigned seed)
+{
+	struct sdmmc_set set;
+	sSdmmcCommand cmd;
+	uint32_t it, i, words, lag, nb, total, left, pos, nfrags, used, l;
+	uint32_t xfered;
+	bool rx, use_iov;
+	uint8_t rc;
+
+	srand(seed);
+	for (it = 0; it < ITERATIONS; it++) {
+		words = rand() % 2 ? ARRAY_SIZE(dma_buf) : 8 + rand() % 200;
+		rx = rand() % 2;
+		lag = rand() % 4 == 0 ? rand() % 40 : 0;
+		nb = 1 + (rand() % 4 ? rand() % 64 : rand() % 2000);
+		total = nb * 512;
+		use_iov = rand() % 4 != 0;
+
+		init_set(&set, words);
+		memset(&cmd, 0, sizeof(cmd));
+		cmd.cmdOp.bmBits.xfrData = rx ? SDMMC_CMD_RX : SDMMC_CMD_TX;
+		cmd.wBlockSize = 512;
+		cmd.wNbBlocks = nb;
+
+		used = 4096 + total + MAX_FRAGS * 64;
+		fill_random(pool, used);
+		memcpy(ref, pool, used);
+		if (rx)
+			fill_random(dev, total);
+		else
+			memset(dev, 0, total);
+
+		/* Fragments of any alignment and length, some empty */
+		pos = 64;
+		nfrags = 0;
+		if (use_iov) {
+			for (left = total; left; left -= l) {
+				l = rand() % 3 ? 1 + rand() % 3000 : rand() % 200000;
+				if (rand() % 10 == 0)
+					l = 0;
+				if (l > left || nfrags == MAX_FRAGS - 1)
+					l = left;
+				pos += rand() % 3 ? rand() % 40 : 0;
+				iov[nfrags].pData = pool + pos;
+				iov[nfrags].dwLen = l;
+				pos += l;
+				nfrags++;
+			}
+			cmd.pIoVec = iov;
+			cmd.wIoVecCnt = nfrags;
+		} else {
+			pos += rand() % 2 ? rand() % 64 : 0;
+			cmd.pData = pool + pos;
+			iov[0].pData = cmd.pData;
+			iov[0].dwLen = total;
+			nfrags = 1;
+		}
+
+		rc = sdmmc_build_dma_table(&set, &cmd);
+		if (rc == SDMMC_NOT_SUPPORTED) {
+			/* Only I/O vectors too large for a small table */
+			CHECK(use_iov);
+			CHECK(set.table_size < 2 * (SDMMC_CHAIN_MIN_LINES + 1));
+			stats.rejected++;
+			continue;
+		}
+		if (rc == SDMMC_PARAM) {
+			/* Only misaligned data without bounce buffers */
+			CHECK(!set.bounce_cnt);
+			stats.rejected++;
+			continue;
+		}
+		if (rc == SDMMC_CHANGED) {
+			CHECK(!use_iov && !set.chained && cmd.wNbBlocks < nb);
+			total = cmd.wNbBlocks * 512;
+			iov[0].dwLen = total;
+			stats.shortened++;
+		} else {
+			CHECK(rc == SDMMC_OK);
+		}
+		if (set.chained)
+			stats.chained++;
+
+		xfered = adma_run(&set, &cmd, total, lag);
+		if (xfered == total) {
+			/* Deliver the data received in bounce buffers */
+			for (i = 0; i < set.bounce_cnt; i++)
+				if (rx && set.bounce_dst[i])
+					stats.bounced_rx++;
+			sdmmc_unbounce(&set, 0, set.bounce_cnt);
+			stats.complete++;
+		} else {
+			/* Only a late refill stops the ADMA early */
+			CHECK(set.chained && lag > SDMMC_CHAIN_MIN_LINES - 2);
+			for (i = 0; i < set.bounce_cnt; i++)
+				set.bounce_dst[i] = NULL;
+			stats.late_stops++;
+		}
+		check_buffers(rx, nfrags, used, xfered, xfered == total);
+	}
+}
+
+int main(void)
+{
+	test_transfers(1);
+
+	printf("sdmmc_adma: %u complete, %u chained, %u late stops, "
+	       "%u shortened, %u rejected, %u bounced edges received\n",
+	       (unsigned)stats.complete, (unsigned)stats.chained,
+	       (unsigned)stats.late_stops, (unsigned)stats.shortened,
+	       (unsigned)stats.rejected, (unsigned)stats.bounced_rx);
+
+	/* Each path of the table builder is exercised */
+	CHECK(stats.complete > 0);
+	CHECK(stats.chained > 0);
+	CHECK(stats.late_stops > 0);
+	CHECK(stats.shortened > 0);
+	CHECK(stats.rejected > 0);
+	CHECK(stats.bounced_rx > 0);
+
+	printf("sdmmc_adma: OK\n");
+	return 0;
+}